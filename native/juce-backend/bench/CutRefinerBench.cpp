@@ -0,0 +1,113 @@
+// Timing check for cut refinement (src/CutRefiner.h).
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target cut-refiner-bench
+//   ./build/cut-refiner-bench [points] [threads]
+//
+// Refines `points` cut points (default 100000) spread over an hour of
+// synthetic stereo audio in each mode and prints the time taken. Exits
+// non-zero if any mode needs a second or more, the budget for refining a
+// long edit without the user noticing.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "CutRefiner.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRate = 48000.0;
+constexpr double kBudgetMs = 1000.0;
+
+// Speech-like test signal from a table, so generating it costs next to
+// nothing beside the refinement: a 150 Hz tone whose level swells and
+// fades, over low noise.
+std::shared_ptr<const std::vector<float>> makeSignal() {
+  auto table = std::make_shared<std::vector<float>>((size_t) 1 << 16);
+  uint32_t seed = 1;
+  for (size_t n = 0; n < table->size(); ++n) {
+    seed = seed * 1664525u + 1013904223u;
+    const double t = (double) n / kRate;
+    const double level = 0.5 + 0.5 * std::sin(2.0 * kPi * 3.0 * t);
+    (*table)[n] = (float) (0.5 * level * std::sin(2.0 * kPi * 150.0 * t) + 0.01 * ((int32_t) seed / 2147483648.0));
+  }
+  return table;
+}
+
+class TableReader : public SampleReader {
+public:
+  TableReader(std::shared_ptr<const std::vector<float>> table, int64_t frames) : table(std::move(table)), frames(frames) {}
+
+  int numChannels() const override { return 2; }
+  double sampleRate() const override { return kRate; }
+  int64_t lengthInSamples() const override { return frames; }
+
+  bool read(float* const* dest, int channels, int64_t start, int numSamples) override {
+    const size_t mask = table->size() - 1;
+    for (int ch = 0; ch < channels; ++ch) {
+      for (int i = 0; i < numSamples; ++i) {
+        const int64_t n = start + i;
+        dest[ch][i] = n >= 0 && n < frames ? (*table)[(size_t) (n + ch * 7919) & mask] : 0.0f;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::shared_ptr<const std::vector<float>> table;
+  int64_t frames;
+};
+
+const char* modeName(CutSnapMode mode) {
+  switch (mode) {
+    case CutSnapMode::ZeroCrossing: return "zeroCrossing";
+    case CutSnapMode::Energy: return "energy";
+    case CutSnapMode::Auto: return "auto";
+  }
+  return "?";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? (size_t) std::max(1, std::atoi(argv[1])) : 100000;
+  const int threads = argc > 2 ? std::max(0, std::atoi(argv[2])) : 0;
+  const int64_t frames = (int64_t) (3600.0 * kRate);
+  const auto table = makeSignal();
+  const SampleReaderFactory factory = [&]() -> std::unique_ptr<SampleReader> {
+    return std::make_unique<TableReader>(table, frames);
+  };
+
+  // Evenly spread, each nudged off the sample grid by up to half a window.
+  std::vector<double> points(count);
+  uint32_t seed = 7;
+  for (size_t i = 0; i < count; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    const double jitter = ((double) (seed >> 8) / 16777216.0 - 0.5) * 0.01;
+    points[i] = std::clamp(((double) i + 0.5) * 3600.0 / (double) count + jitter, 0.0, 3600.0);
+  }
+  std::sort(points.begin(), points.end());
+
+  bool withinBudget = true;
+  std::printf("%-13s %8s %9s %8s %10s\n", "mode", "points", "ms", "threads", "moved");
+  for (const auto mode : { CutSnapMode::ZeroCrossing, CutSnapMode::Energy, CutSnapMode::Auto }) {
+    CutRefineParams params;
+    params.mode = mode;
+    params.threads = threads;
+    const CutRefineResult result = refineCutPoints(factory, points, params);
+    if (!result.ok) {
+      std::printf("%-13s failed\n", modeName(mode));
+      return 1;
+    }
+    const bool fast = result.elapsedMs < kBudgetMs;
+    withinBudget = withinBudget && fast;
+    std::printf("%-13s %8zu %9.1f %8d %10zu%s\n", modeName(mode), count, result.elapsedMs, result.threads,
+                result.moved, fast ? "" : "  over budget");
+  }
+  return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Quality and CPU benchmark for the playback resampler (src/Resampler.h).
+//
+//   cmake -S . -B build -DBUILD_BENCHMARKS=ON && cmake --build build --target resampler-bench
+//   ./build/resampler-bench [seconds]
+//
+// For each conversion (file rate -> device rate at a playback rate) and each
+// quality preset, plus plain linear interpolation for reference:
+//   snr@f   sine at f through the resampler, least-squares fit of the ideal
+//           output sine removed, residual (noise + distortion + images) in dB
+//   alias   sine between the output and input Nyquists, output level in dB
+//           (only when downsampling; it should be filtered out)
+//   ns/fr   time per output frame, two channels
+//   xRT     real-time factor at the device rate
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Resampler.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kBlock = 512;
+
+struct Conversion {
+  const char* name;
+  double fileRate;
+  double deviceRate;
+  double playbackRate;
+  double ratio() const { return fileRate * playbackRate / deviceRate; }
+};
+
+struct Method {
+  const char* name;
+  const dsp::ResamplerQuality* quality; // nullptr = linear interpolation
+};
+
+// Renders `frames` output frames of `channels` channels from gen(channel, inputIndex).
+template <typename Gen>
+std::vector<std::vector<float>> render(const Method& method, double ratio, int channels, int frames, Gen gen) {
+  std::vector<std::vector<float>> out((size_t) channels, std::vector<float>((size_t) frames));
+  int64_t consumed = 0;
+  if (!method.quality) {
+    // Linear interpolation between neighbouring input samples.
+    for (int n = 0; n < frames; ++n) {
+      const double pos = n * ratio;
+      const int64_t i = (int64_t) pos;
+      const float t = (float) (pos - (double) i);
+      for (int ch = 0; ch < channels; ++ch) {
+        out[(size_t) ch][(size_t) n] = gen(ch, i) + t * (gen(ch, i + 1) - gen(ch, i));
+      }
+    }
+    return out;
+  }
+  int taps = 0;
+  double cutoff = 1.0;
+  dsp::PolyphaseResampler::filterShape(*method.quality, ratio, taps, cutoff);
+  auto filter = dsp::designPolyphaseFilter(taps, cutoff, method.quality->beta);
+  dsp::PolyphaseResampler resampler;
+  resampler.prepare(channels, 4096);
+  std::vector<float*> ptrs((size_t) channels);
+  for (int done = 0; done < frames;) {
+    const int n = std::min({ kBlock, frames - done, resampler.maxOutput(ratio) });
+    const int need = resampler.inputNeeded(n, ratio);
+    for (int ch = 0; ch < channels; ++ch) {
+      float* in = resampler.input(ch);
+      for (int i = 0; i < need; ++i) in[i] = gen(ch, consumed + i);
+      ptrs[(size_t) ch] = out[(size_t) ch].data() + done;
+    }
+    resampler.process(*filter, need, ptrs.data(), channels, n, ratio);
+    consumed += need;
+    done += n;
+  }
+  return out;
+}
+
+// Residual after removing the best-fitting sine of frequency cycles/sample.
+double residualDb(const std::vector<float>& y, size_t skip, double cyclesPerSample) {
+  double cc = 0.0, ss = 0.0, cs = 0.0, yc = 0.0, ys = 0.0;
+  for (size_t n = skip; n < y.size(); ++n) {
+    const double w = 2.0 * kPi * cyclesPerSample * (double) n;
+    const double c = std::cos(w), s = std::sin(w);
+    cc += c * c;
+    ss += s * s;
+    cs += c * s;
+    yc += y[n] * c;
+    ys += y[n] * s;
+  }
+  const double det = cc * ss - cs * cs;
+  const double a = (yc * ss - ys * cs) / det;
+  const double b = (ys * cc - yc * cs) / det;
+  double err = 0.0, sig = 0.0;
+  for (size_t n = skip; n < y.size(); ++n) {
+    const double w = 2.0 * kPi * cyclesPerSample * (double) n;
+    const double fit = a * std::cos(w) + b * std::sin(w);
+    err += (y[n] - fit) * (y[n] - fit);
+    sig += fit * fit;
+  }
+  return 10.0 * std::log10(std::max(err, 1e-30) / std::max(sig, 1e-30));
+}
+
+double levelDb(const std::vector<float>& y, size_t skip, double amplitude) {
+  double sum = 0.0;
+  for (size_t n = skip; n < y.size(); ++n) sum += (double) y[n] * y[n];
+  const double rms = std::sqrt(sum / (double) (y.size() - skip));
+  return 20.0 * std::log10(std::max(rms, 1e-15) / (amplitude / std::sqrt(2.0)));
+}
+
+std::string formatDb(double db) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "%7.1f", db);
+  return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const double seconds = argc > 1 ? std::max(0.5, std::atof(argv[1])) : 5.0;
+  const Conversion conversions[] = {
+    { "44.1k->48k", 44100.0, 48000.0, 1.0 },
+    { "48k->44.1k", 48000.0, 44100.0, 1.0 },
+    { "96k->48k", 96000.0, 48000.0, 1.0 },
+    { "48k x0.5", 48000.0, 48000.0, 0.5 },
+    { "48k x1.5", 48000.0, 48000.0, 1.5 },
+    { "44.1k->48k x2", 44100.0, 48000.0, 2.0 },
+  };
+  const Method methods[] = {
+    { "linear", nullptr },
+    { "draft", &dsp::kDraftResampling },
+    { "standard", &dsp::kStandardResampling },
+    { "high", &dsp::kHighResampling },
+  };
+  const double amplitude = 0.5;
+  const int qualityFrames = 1 << 15;
+  const size_t skip = 1024; // filter warm-up
+
+  std::printf("%-15s %-9s %7s %7s %7s %7s %7s %8s\n", "conversion", "method", "snr@1k", "snr@10k", "snr@17k", "alias",
+              "ns/fr", "xRT");
+  for (const auto& conv : conversions) {
+    const double ratio = conv.ratio();
+    for (const auto& method : methods) {
+      std::string cells;
+      for (const double hz : { 1000.0, 10000.0, 17000.0 }) {
+        // The tone as heard at the device: playback rate shifts its pitch.
+        const double heard = hz * conv.playbackRate;
+        if (hz >= 0.45 * conv.fileRate || heard >= 0.45 * conv.deviceRate) {
+          cells += "      -";
+          continue;
+        }
+        const double step = 2.0 * kPi * hz / conv.fileRate;
+        auto out = render(method, ratio, 1, qualityFrames, [&](int, int64_t i) {
+          return (float) (amplitude * std::sin(step * (double) i));
+        });
+        cells += " " + formatDb(residualDb(out[0], skip, heard / conv.deviceRate));
+      }
+      if (ratio > 1.0) {
+        // Halfway between the output Nyquist and the input's: aliases
+        // straight back into the audible band if not filtered.
+        const double hz = 0.5 * (0.5 * conv.deviceRate / conv.playbackRate + 0.5 * conv.fileRate);
+        const double step = 2.0 * kPi * hz / conv.fileRate;
+        auto out = render(method, ratio, 1, qualityFrames, [&](int, int64_t i) {
+          return (float) (amplitude * std::sin(step * (double) i));
+        });
+        cells += " " + formatDb(levelDb(out[0], skip, amplitude));
+      } else {
+        cells += "      -";
+      }
+
+      // CPU: stereo noise, the whole duration.
+      const int frames = (int) (seconds * conv.deviceRate);
+      uint32_t seed = 1;
+      std::vector<float> noise(1 << 16);
+      for (auto& v : noise) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (float) ((int32_t) seed) / 2147483648.0f * 0.5f;
+      }
+      const auto start = std::chrono::steady_clock::now();
+      auto out = render(method, ratio, 2, frames, [&](int ch, int64_t i) {
+        return noise[(size_t) ((i + ch * 7919) & 0xffff)];
+      });
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      volatile float sink = out[0][out[0].size() / 2];
+      (void) sink;
+      std::printf("%-15s %-9s%s %7.1f %8.0f\n", conv.name, method.name, cells.c_str(), elapsed * 1e9 / frames,
+                  seconds / elapsed);
+    }
+  }
+  return 0;
+}
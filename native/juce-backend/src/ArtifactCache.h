@@ -0,0 +1,443 @@
+// Content-addressed store for analysis artifacts (loudness steps, silence
+// maps, spectrogram tiles, processed copies). Sources are identified by a
+// fingerprint of their bytes rather than their path, so a renamed, copied or
+// re-imported file finds everything computed for it before. Artifacts are
+// files named <fingerprint>-<kind>-<params>.<ext> in one per-user directory;
+// the directory is bounded in bytes and evicted least recently used, with a
+// file's modification time standing in for its last use.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "SampleReader.h"
+
+namespace artifacts {
+
+// --- Fingerprint ---
+// XXH64 (Yann Collet's xxHash, 64-bit variant).
+namespace detail {
+constexpr uint64_t kPrime1 = 11400714785074694791ull;
+constexpr uint64_t kPrime2 = 14029467366897019727ull;
+constexpr uint64_t kPrime3 = 1609587929392839161ull;
+constexpr uint64_t kPrime4 = 9650029242287828579ull;
+constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t lane(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t value) {
+  acc ^= lane(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+} // namespace detail
+
+inline uint64_t xxh64(const void* data, size_t length, uint64_t seed) {
+  using namespace detail;
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = p + length;
+  uint64_t h;
+  if (length >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    for (const unsigned char* limit = end - 32; p <= limit; p += 32) {
+      v1 = lane(v1, read64(p));
+      v2 = lane(v2, read64(p + 8));
+      v3 = lane(v3, read64(p + 16));
+      v4 = lane(v4, read64(p + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h = merge(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+  h += (uint64_t) length;
+  for (; p + 8 <= end; p += 8) {
+    h ^= lane(0, read64(p));
+    h = rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= (uint64_t) read32(p) * kPrime1;
+    h = rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= (uint64_t) *p * kPrime5;
+    h = rotl(h, 11) * kPrime1;
+  }
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline std::string hex64(uint64_t v) {
+  char text[17];
+  std::snprintf(text, sizeof(text), "%016llx", (unsigned long long) v);
+  return text;
+}
+
+struct Fingerprint {
+  bool ok = false;
+  std::string hash;     // 32 hex digits: chunk-tree hash, then byte length
+  uint64_t bytes = 0;
+  double elapsedMs = 0.0;
+  int threads = 0;
+};
+
+constexpr size_t kFingerprintChunk = 4u << 20;
+
+// Hashes the file's bytes in fixed chunks on up to `threads` threads of the
+// job scheduler, each chunk through its own stream; the chunk hashes are then
+// hashed in order. Independent of the thread count, and of the file's name
+// and timestamps.
+inline Fingerprint fingerprint(const std::string& path, int threads = 0, const std::atomic<bool>* cancel = nullptr) {
+  Fingerprint result;
+  const auto started = std::chrono::steady_clock::now();
+  std::error_code ec;
+  const uintmax_t size = std::filesystem::file_size(path, ec);
+  if (ec) return result;
+  const size_t chunks = std::max<size_t>(1, (size_t) ((size + kFingerprintChunk - 1) / kFingerprintChunk));
+  std::vector<uint64_t> chunkHashes(chunks, 0);
+  const int workers = (int) std::min<size_t>((size_t) analysisThreadCount(threads), chunks);
+  const bool ok = jobs::parallelFor(chunks, [&](size_t index) {
+    thread_local std::vector<char> buffer;
+    buffer.resize(kFingerprintChunk);
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good()) return false;
+    const uint64_t offset = (uint64_t) index * kFingerprintChunk;
+    const size_t want = (size_t) std::min<uint64_t>(kFingerprintChunk, size - std::min<uint64_t>(size, offset));
+    in.seekg((std::streamoff) offset);
+    in.read(buffer.data(), (std::streamsize) want);
+    if ((size_t) in.gcount() != want) return false;
+    chunkHashes[index] = xxh64(buffer.data(), want, (uint64_t) index);
+    return true;
+  }, workers, cancel);
+  if (!ok) return result;
+
+  result.ok = true;
+  result.bytes = (uint64_t) size;
+  result.hash = hex64(xxh64(chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t), (uint64_t) size)) +
+                hex64((uint64_t) size);
+  result.threads = workers;
+  result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return result;
+}
+
+// --- Serialisation ---
+// Flat records, in host byte order, for artifacts held in memory as plain
+// structs. Each starts with a tag naming its layout; a reader that finds another tag
+// treats the file as a miss.
+class BlobWriter {
+public:
+  explicit BlobWriter(uint32_t tag) { put(tag); }
+
+  template <typename T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void putVector(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+    put((uint64_t) values.size());
+    bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+  }
+
+  void putString(std::string_view text) {
+    put((uint64_t) text.size());
+    bytes.append(text.data(), text.size());
+  }
+
+  const std::string& data() const { return bytes; }
+
+private:
+  std::string bytes;
+};
+
+class BlobReader {
+public:
+  BlobReader(std::string_view data, uint32_t tag) : bytes(data) {
+    uint32_t found = 0;
+    ok = get(found) && found == tag;
+  }
+
+  template <typename T>
+  bool get(T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+    if (!ok) return false;
+    if (bytes.size() - offset < sizeof(T)) return ok = false;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+  }
+
+  template <typename T>
+  bool getVector(std::vector<T>& values) {
+    uint64_t count = 0;
+    if (!get(count) || count > (bytes.size() - offset) / sizeof(T)) return ok = false;
+    values.resize((size_t) count);
+    std::memcpy(values.data(), bytes.data() + offset, (size_t) count * sizeof(T));
+    offset += (size_t) count * sizeof(T);
+    return true;
+  }
+
+  bool getString(std::string& text) {
+    uint64_t count = 0;
+    if (!get(count) || count > bytes.size() - offset) return ok = false;
+    text.assign(bytes.data() + offset, (size_t) count);
+    offset += (size_t) count;
+    return true;
+  }
+
+  // True when the tag matched and every field so far was present.
+  bool good() const { return ok; }
+
+private:
+  std::string_view bytes;
+  size_t offset = 0;
+  bool ok = true;
+};
+
+// --- Store ---
+// The platform's per-user cache location, with juce-backend/artifacts
+// appended; the system temp directory when none can be found.
+inline std::string userCacheDirectory() {
+  auto env = [](const char* name) {
+    const char* value = std::getenv(name);
+    return std::string(value ? value : "");
+  };
+  std::filesystem::path base;
+#if defined(_WIN32)
+  if (!env("LOCALAPPDATA").empty()) base = env("LOCALAPPDATA");
+#elif defined(__APPLE__)
+  if (!env("HOME").empty()) base = std::filesystem::path(env("HOME")) / "Library" / "Caches";
+#else
+  if (!env("XDG_CACHE_HOME").empty()) base = env("XDG_CACHE_HOME");
+  else if (!env("HOME").empty()) base = std::filesystem::path(env("HOME")) / ".cache";
+#endif
+  if (base.empty()) {
+    std::error_code ec;
+    base = std::filesystem::temp_directory_path(ec);
+    if (ec) base = ".";
+  }
+  return (base / "juce-backend" / "artifacts").string();
+}
+
+struct CacheStats {
+  std::string directory;
+  uint64_t files = 0;
+  uint64_t bytes = 0;
+  uint64_t maxBytes = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+// Thread-safe. Writers go through a .part file and a rename, so readers never
+// see a partial artifact; a hit refreshes the file's modification time. A
+// .part file belongs to a write in progress: it is neither counted towards
+// the limit nor evicted. Hits and misses are counted when an artifact is
+// looked up.
+class Cache {
+public:
+  Cache(std::string dir, uint64_t limit) : root(std::move(dir)), maxBytes(limit) {}
+
+  const std::string& directory() const { return root; }
+
+  // Points the cache at another directory. Call before the first lookup.
+  void relocate(std::string dir) {
+    std::lock_guard<std::mutex> lock(mutex);
+    root = std::move(dir);
+    total = 0;
+    scanned = false;
+    created.store(false, std::memory_order_release);
+  }
+
+  // Where the artifact of `kind` computed from `content` with `params` (any
+  // text that pins down the parameters) lives.
+  std::string pathFor(const std::string& content, const std::string& kind, const std::string& params,
+                      const std::string& extension) {
+    ensureDirectory();
+    return (std::filesystem::path(root) /
+            (content + "-" + kind + "-" + hex64(xxh64(params.data(), params.size(), 0)) + "." + extension))
+      .string();
+  }
+
+  // Reads a whole artifact; a hit when it exists, otherwise a miss.
+  bool read(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (in.good()) out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (!in.is_open() || in.bad()) {
+      noteMiss();
+      return false;
+    }
+    touch(path);
+    return true;
+  }
+
+  // Stores a whole artifact computed after a miss.
+  bool write(const std::string& path, const std::string& bytes) {
+    const std::string partPath = path + ".part";
+    {
+      std::ofstream out(partPath, std::ios::binary | std::ios::trunc);
+      if (!out.good()) return false;
+      out.write(bytes.data(), (std::streamsize) bytes.size());
+      if (!out.good()) {
+        out.close();
+        std::remove(partPath.c_str());
+        return false;
+      }
+    }
+    std::error_code ec;
+    std::filesystem::rename(partPath, path, ec);
+    if (ec) {
+      std::remove(partPath.c_str());
+      return false;
+    }
+    commit(path);
+    return true;
+  }
+
+  // For producers that look an artifact up themselves (e.g. by opening it):
+  // it was not there, or not usable.
+  void noteMiss() { misses.fetch_add(1, std::memory_order_relaxed); }
+
+  // An existing artifact was used (a hit): it becomes the most recent.
+  void touch(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    hits.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // A new artifact was written at path (by write() or by its producer);
+  // evicts the least recently used ones if the store is now over its limit.
+  void commit(const std::string& path) {
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(path, ec);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!scanned) scanLocked();
+    else if (!ec) total += size;
+    if (total > maxBytes) evictLocked();
+  }
+
+  void setMaxBytes(uint64_t limit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxBytes = limit;
+    scanLocked();
+    if (total > maxBytes) evictLocked();
+  }
+
+  CacheStats stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto files = scanLocked();
+    CacheStats s;
+    s.directory = root;
+    s.files = files.size();
+    s.bytes = total;
+    s.maxBytes = maxBytes;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    return s;
+  }
+
+private:
+  struct Entry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type used;
+    uintmax_t size = 0;
+  };
+
+  void ensureDirectory() {
+    if (created.load(std::memory_order_acquire)) return;
+    std::error_code ec;
+    std::filesystem::create_directories(root, ec);
+    created.store(true, std::memory_order_release);
+  }
+
+  std::vector<Entry> scanLocked() {
+    std::vector<Entry> files;
+    total = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+      std::error_code entryError;
+      if (!it->is_regular_file(entryError)) continue;
+      if (it->path().extension() == ".part") continue; // being written
+      Entry entry;
+      entry.path = it->path();
+      entry.size = it->file_size(entryError);
+      entry.used = it->last_write_time(entryError);
+      if (entryError) continue;
+      total += entry.size;
+      files.push_back(std::move(entry));
+    }
+    scanned = true;
+    return files;
+  }
+
+  // Oldest first down to 90% of the limit, so a full store is not rescanned
+  // on every write.
+  void evictLocked() {
+    auto files = scanLocked();
+    std::sort(files.begin(), files.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    const uint64_t target = maxBytes - maxBytes / 10;
+    for (const auto& entry : files) {
+      if (total <= target) break;
+      std::error_code ec;
+      if (!std::filesystem::remove(entry.path, ec) || ec) continue; // in use (Windows) or gone
+      total -= std::min<uint64_t>(total, entry.size);
+      evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::string root;
+  std::mutex mutex;
+  uint64_t maxBytes;
+  uint64_t total = 0;
+  bool scanned = false;
+  std::atomic<bool> created{false};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> evictions{0};
+};
+
+} // namespace artifacts
@@ -0,0 +1,237 @@
+// Per-clip / per-speaker processing strip: high-pass, compressor/leveller,
+// gain and mute/solo. Settings are resolved on the control thread into a flat
+// StripBank (one entry per clip) that the audio thread reads through a
+// SnapshotExchange; the offline render runs the same ClipChain so exports
+// match what was heard.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "DspKernels.h"
+
+struct StripParams {
+  float gainDb = 0.0f;
+  float highPassHz = 0.0f;        // 0 = off
+  bool compressor = false;
+  float compThresholdDb = -18.0f;
+  float compRatio = 3.0f;
+  float compAttackMs = 10.0f;
+  float compReleaseMs = 120.0f;
+  float compMakeupDb = 0.0f;
+  bool mute = false;
+  bool solo = false;
+};
+
+// Partial settings as sent by setStrip. A clip's strip is its speaker's
+// settings overlaid with its own: clip values replace speaker values, except
+// gain (which adds) and mute/solo (either one sets them).
+struct StripSettings {
+  std::optional<float> gainDb;
+  std::optional<float> highPassHz;
+  std::optional<bool> compressor;
+  std::optional<float> compThresholdDb;
+  std::optional<float> compRatio;
+  std::optional<float> compAttackMs;
+  std::optional<float> compReleaseMs;
+  std::optional<float> compMakeupDb;
+  std::optional<bool> mute;
+  std::optional<bool> solo;
+
+  // Later values win field by field.
+  void merge(const StripSettings& o) {
+    if (o.gainDb) gainDb = o.gainDb;
+    if (o.highPassHz) highPassHz = o.highPassHz;
+    if (o.compressor) compressor = o.compressor;
+    if (o.compThresholdDb) compThresholdDb = o.compThresholdDb;
+    if (o.compRatio) compRatio = o.compRatio;
+    if (o.compAttackMs) compAttackMs = o.compAttackMs;
+    if (o.compReleaseMs) compReleaseMs = o.compReleaseMs;
+    if (o.compMakeupDb) compMakeupDb = o.compMakeupDb;
+    if (o.mute) mute = o.mute;
+    if (o.solo) solo = o.solo;
+  }
+};
+
+inline StripParams resolveStrip(const StripSettings* speaker, const StripSettings* clip) {
+  StripParams p;
+  auto apply = [&p](const StripSettings& s) {
+    if (s.highPassHz) p.highPassHz = std::clamp(*s.highPassHz, 0.0f, 2000.0f);
+    if (s.compressor) p.compressor = *s.compressor;
+    if (s.compThresholdDb) p.compThresholdDb = std::clamp(*s.compThresholdDb, -60.0f, 0.0f);
+    if (s.compRatio) p.compRatio = std::clamp(*s.compRatio, 1.0f, 20.0f);
+    if (s.compAttackMs) p.compAttackMs = std::clamp(*s.compAttackMs, 0.1f, 500.0f);
+    if (s.compReleaseMs) p.compReleaseMs = std::clamp(*s.compReleaseMs, 1.0f, 5000.0f);
+    if (s.compMakeupDb) p.compMakeupDb = std::clamp(*s.compMakeupDb, -24.0f, 24.0f);
+  };
+  if (speaker) apply(*speaker);
+  if (clip) apply(*clip);
+  const float speakerGain = speaker && speaker->gainDb ? *speaker->gainDb : 0.0f;
+  const float clipGain = clip && clip->gainDb ? *clip->gainDb : 0.0f;
+  p.gainDb = std::clamp(speakerGain + clipGain, -60.0f, 24.0f);
+  p.mute = (speaker && speaker->mute.value_or(false)) || (clip && clip->mute.value_or(false));
+  p.solo = (speaker && speaker->solo.value_or(false)) || (clip && clip->solo.value_or(false));
+  return p;
+}
+
+// Resolved strips indexed by clip. Clips past the end (or clipIndex -1) get
+// neutral settings.
+struct StripBank {
+  std::vector<StripParams> clips;
+  bool anySolo = false;
+
+  const StripParams& forClip(int clipIndex) const {
+    static const StripParams neutral;
+    return clipIndex >= 0 && (size_t) clipIndex < clips.size() ? clips[(size_t) clipIndex] : neutral;
+  }
+};
+
+// setStrip settings keyed by speaker name and clip id, kept across EDL
+// revisions. Control thread only.
+struct StripStore {
+  std::map<std::string, StripSettings> speakers;
+  std::map<std::string, StripSettings> clips;
+
+  bool empty() const { return speakers.empty() && clips.empty(); }
+
+  void clear() {
+    speakers.clear();
+    clips.clear();
+  }
+
+  // Returns false for an unknown scope.
+  bool set(const std::string& scope, const std::string& target, const StripSettings& settings) {
+    if (scope == "speaker") speakers[target].merge(settings);
+    else if (scope == "clip") clips[target].merge(settings);
+    else return false;
+    return true;
+  }
+
+  // Resolves one strip per entry of clipList (anything with id and speaker
+  // members), in clip-index order.
+  template <typename ClipList>
+  std::shared_ptr<StripBank> bankFor(const ClipList& clipList) const {
+    auto bank = std::make_shared<StripBank>();
+    bank->clips.reserve(clipList.size());
+    for (const auto& clip : clipList) {
+      const auto speaker = speakers.find(clip.speaker);
+      const auto own = clips.find(clip.id);
+      bank->clips.push_back(resolveStrip(speaker != speakers.end() ? &speaker->second : nullptr,
+                                         own != clips.end() ? &own->second : nullptr));
+      bank->anySolo = bank->anySolo || bank->clips.back().solo;
+    }
+    return bank;
+  }
+};
+
+class ClipChain {
+public:
+  static constexpr int kMaxChannels = 8;
+
+  void prepare(double rate, int channels) {
+    sampleRate = rate > 0.0 ? rate : 48000.0;
+    numChannels = std::clamp(channels, 1, kMaxChannels);
+    reset();
+  }
+
+  // Clears filter and envelope state, e.g. after a seek.
+  void reset() {
+    for (auto& f : highPass) f.reset();
+    envelope = 0.0f;
+    compGainDb = 0.0f;
+    primed = false;
+  }
+
+  // Processes channels[ch][offset, offset + n) in place. soloActive is true
+  // when any strip in the bank is soloed; strips that are not then fade out.
+  void process(float* const* channels, int numCh, int offset, int n, const StripParams& p, bool soloActive) {
+    numCh = std::min(numCh, numChannels);
+    const float targetGain = (p.mute || (soloActive && !p.solo)) ? 0.0f : dsp::dbToGain(p.gainDb);
+    const int rampSamples = (int) (sampleRate * kRampSec);
+    if (!primed) {
+      gain.reset(targetGain);
+      primed = true;
+    } else {
+      gain.setTarget(targetGain, rampSamples);
+    }
+    // Unity gain, no filters and no fade in progress: leave the signal untouched.
+    if (targetGain == 1.0f && gain.currentGain() == 1.0f && p.highPassHz <= 0.0f && !p.compressor) {
+      compGainDb = 0.0f;
+      envelope = 0.0f;
+      return;
+    }
+    // Nothing audible and nothing to fade: skip the filters entirely.
+    if (targetGain == 0.0f && gain.currentGain() == 0.0f) {
+      for (int ch = 0; ch < numCh; ++ch) std::fill(channels[ch] + offset, channels[ch] + offset + n, 0.0f);
+      return;
+    }
+
+    if (p.highPassHz > 0.0f) {
+      if (p.highPassHz != highPassHz) {
+        highPassHz = p.highPassHz;
+        for (auto& f : highPass) f.setHighPass(sampleRate, highPassHz);
+      }
+      for (int ch = 0; ch < numCh; ++ch) highPass[ch].process(channels[ch] + offset, n);
+    }
+
+    if (p.compressor) {
+      for (int done = 0; done < n;) {
+        const int k = std::min(kChunk, n - done);
+        compress(channels, numCh, offset + done, k, p);
+        done += k;
+      }
+    } else {
+      compGainDb = 0.0f;
+      envelope = 0.0f;
+    }
+
+    gain.process(channels, numCh, offset, n);
+  }
+
+private:
+  static constexpr double kRampSec = 0.01;
+  static constexpr int kChunk = 256;
+  static constexpr int kControlStep = 16; // gain computed per step, interpolated in between
+
+  // Peak-detecting feed-forward compressor. The envelope and gain computer
+  // run at control rate; the per-sample work is the side-chain max and the
+  // gain multiply, both plain loops the compiler vectorises.
+  void compress(float* const* channels, int numCh, int offset, int n, const StripParams& p) {
+    dsp::maxAbsAcross(channels, numCh, offset, n, side);
+    const double stepSec = kControlStep / sampleRate;
+    const float attack = (float) std::exp(-stepSec / (p.compAttackMs * 0.001));
+    const float release = (float) std::exp(-stepSec / (p.compReleaseMs * 0.001));
+    const float slope = 1.0f - 1.0f / std::max(1.0f, p.compRatio);
+    for (int start = 0; start < n; start += kControlStep) {
+      const int k = std::min(kControlStep, n - start);
+      float peak = 0.0f;
+      for (int i = 0; i < k; ++i) peak = std::max(peak, side[start + i]);
+      const float coeff = peak > envelope ? attack : release;
+      envelope = peak + coeff * (envelope - peak);
+      const float levelDb = dsp::gainToDb(envelope);
+      const float over = levelDb - p.compThresholdDb;
+      const float targetDb = (over > 0.0f ? -over * slope : 0.0f) + p.compMakeupDb;
+      const float from = dsp::dbToGain(compGainDb);
+      const float to = dsp::dbToGain(targetDb);
+      const float step = (to - from) / (float) k;
+      for (int i = 0; i < k; ++i) side[start + i] = from + step * (float) (i + 1);
+      compGainDb = targetDb;
+    }
+    for (int ch = 0; ch < numCh; ++ch) dsp::multiply(channels[ch] + offset, side, n);
+  }
+
+  double sampleRate = 48000.0;
+  int numChannels = 2;
+  bool primed = false;
+  dsp::GainRamp gain;
+  dsp::Biquad highPass[kMaxChannels];
+  float highPassHz = 0.0f;
+  float envelope = 0.0f;
+  float compGainDb = 0.0f;
+  float side[kChunk] = {};
+};
@@ -0,0 +1,149 @@
+// Moves EDL cut points onto nearby samples where a cut will not click. Word
+// timings from transcription land wherever the aligner put them, often in
+// the middle of a waveform cycle; each cut point is searched for within a
+// small window of the original audio (channels summed):
+//
+// - ZeroCrossing: the sign change nearest the cut point
+// - Energy: the quietest point, by the energy of a short frame around it
+// - Auto: the quietest point, then the sign change nearest it within one
+//   frame, so the cut is both quiet and click-free
+//
+// Points are sorted and refined in parallel chunks, each window read on its
+// own, so the cost follows the number of cuts and not the file length.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "DspKernels.h"
+#include "SampleReader.h"
+
+enum class CutSnapMode { Auto, ZeroCrossing, Energy };
+
+struct CutRefineParams {
+  CutSnapMode mode = CutSnapMode::Auto;
+  double windowSec = 0.010; // searched on each side of a cut point
+  double frameSec = 0.0025; // energy window for Energy and Auto
+  int threads = 0;          // 0 = hardware concurrency
+};
+
+struct CutRefineResult {
+  bool ok = false;
+  std::vector<double> refinedSec; // one per input point, in the same order
+  size_t moved = 0;
+  double meanShiftSec = 0.0;
+  double maxShiftSec = 0.0;
+  double elapsedMs = 0.0;
+  int threads = 0;
+};
+
+// Refines pointsSec (original-file seconds, sorted ascending). Points
+// outside the file are returned unchanged.
+inline CutRefineResult refineCutPoints(const SampleReaderFactory& factory,
+                                       const std::vector<double>& pointsSec,
+                                       const CutRefineParams& params,
+                                       const std::atomic<bool>* cancel = nullptr) {
+  CutRefineResult result;
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0 || probe->numChannels() <= 0) return result;
+  const double rate = probe->sampleRate();
+  const int channels = probe->numChannels();
+  const int64_t length = probe->lengthInSamples();
+  probe.reset();
+
+  const int reach = std::max(1, (int) std::lround(params.windowSec * rate));
+  const int half = std::max(1, (int) std::lround(params.frameSec * rate * 0.5));
+  const int span = 2 * (reach + half) + 1; // frames read per point
+  result.refinedSec = pointsSec;
+
+  constexpr size_t kPointsPerChunk = 1024;
+  const size_t numChunks = (pointsSec.size() + kPointsPerChunk - 1) / kPointsPerChunk;
+  result.threads = analysisThreadCount(params.threads);
+  const bool completed = runChunksInParallel(factory, numChunks, result.threads,
+    [&](size_t chunk, SampleReader& reader) {
+      thread_local std::vector<float> planes, mono, energy;
+      thread_local std::vector<double> prefix;
+      thread_local std::vector<float*> ptrs;
+      planes.resize((size_t) channels * (size_t) span);
+      mono.resize((size_t) span);
+      energy.resize((size_t) span);
+      prefix.resize((size_t) span + 1);
+      ptrs.resize((size_t) channels);
+      for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = planes.data() + (size_t) ch * (size_t) span;
+
+      const size_t first = chunk * kPointsPerChunk;
+      const size_t last = std::min(pointsSec.size(), first + kPointsPerChunk);
+      for (size_t p = first; p < last; ++p) {
+        const int64_t at = (int64_t) std::llround(pointsSec[p] * rate);
+        if (at <= 0 || at >= length) continue;
+        // Window [at - reach, at + reach], with half a frame more on each
+        // side for the energy, clamped to the file.
+        const int64_t from = std::max<int64_t>(0, at - reach - half);
+        const int64_t to = std::min<int64_t>(length, at + reach + half + 1);
+        const int n = (int) (to - from);
+        if (!reader.read(ptrs.data(), channels, from, n)) return false;
+        dsp::sumAcross(ptrs.data(), channels, n, mono.data());
+        const int centre = (int) (at - from);
+        const int lo = std::max(0, centre - reach);
+        const int hi = std::min(n, centre + reach + 1);
+
+        int best = centre;
+        if (params.mode == CutSnapMode::ZeroCrossing) {
+          const int change = dsp::nearestSignChange(mono.data() + lo, hi - lo, centre - lo);
+          if (change >= 0) best = lo + change;
+        } else {
+          prefix[0] = 0.0;
+          for (int i = 0; i < n; ++i) prefix[(size_t) i + 1] = prefix[(size_t) i] + (double) mono[(size_t) i] * mono[(size_t) i];
+          // Frame sums; only frames cut short by the ends of the file need
+          // scaling to compare with the rest.
+          const int fullFrom = std::clamp(half, lo, hi), fullTo = std::clamp(n - half, fullFrom, hi);
+          const double* sums = prefix.data();
+          float* e = energy.data() - lo;
+          for (int i = fullFrom; i < fullTo; ++i) e[i] = (float) (sums[i + half + 1] - sums[i - half]);
+          auto scaled = [&](int from, int to) {
+            for (int i = from; i < to; ++i) {
+              const int a = std::max(0, i - half), b = std::min(n, i + half + 1);
+              e[i] = (float) ((sums[b] - sums[a]) * (2.0 * half + 1.0) / (double) (b - a));
+            }
+          };
+          scaled(lo, fullFrom);
+          scaled(fullTo, hi);
+          best = lo + dsp::argMinNearest(energy.data(), hi - lo, centre - lo);
+          if (params.mode == CutSnapMode::Auto) {
+            const int a = std::max(lo, best - half), b = std::min(hi, best + half + 1);
+            const int change = dsp::nearestSignChange(mono.data() + a, b - a, best - a);
+            if (change >= 0) best = a + change;
+          }
+        }
+        // Of the two samples either side of a crossing, the one nearer zero.
+        if (params.mode != CutSnapMode::Energy && best > 0 &&
+            (mono[(size_t) best - 1] < 0.0f) != (mono[(size_t) best] < 0.0f) &&
+            std::fabs(mono[(size_t) best - 1]) < std::fabs(mono[(size_t) best])) {
+          --best;
+        }
+        result.refinedSec[p] = (double) (from + best) / rate;
+      }
+      return true;
+    }, cancel);
+  if (!completed) return result;
+
+  double totalShift = 0.0;
+  for (size_t p = 0; p < pointsSec.size(); ++p) {
+    const double shift = std::fabs(result.refinedSec[p] - pointsSec[p]);
+    if (shift <= 0.5 / rate) {
+      result.refinedSec[p] = pointsSec[p]; // already on the sample it would snap to
+      continue;
+    }
+    ++result.moved;
+    totalShift += shift;
+    result.maxShiftSec = std::max(result.maxShiftSec, shift);
+  }
+  result.meanShiftSec = result.moved ? totalShift / (double) result.moved : 0.0;
+  result.ok = true;
+  result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return result;
+}
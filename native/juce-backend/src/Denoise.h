@@ -0,0 +1,294 @@
+// Offline spectral noise reduction. A noise profile (mean power per FFT bin)
+// is learnt from regions known to hold only background noise, then every
+// frame of the file goes through a spectral gate: bins that do not rise
+// clearly above the profile are attenuated, with gains smoothed over time
+// and frequency to avoid musical noise. The file is processed in chunks on
+// worker threads; each chunk starts a few frames early so the smoothing state
+// matches what a single sequential pass would have reached, and the chunks
+// are written to a WAV cache in order.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Fft.h"
+#include "SampleReader.h"
+#include "SilenceDetector.h"
+#include "WavWriter.h"
+
+struct DenoiseParams {
+  double reductionDb = 18.0;  // attenuation of gated bins
+  double thresholdDb = 6.0;   // a bin passes once it is this far above the noise profile
+  double releaseMs = 80.0;    // how fast a bin closes again after it opened
+  int fftSize = 2048;
+  int threads = 0;            // 0 = hardware concurrency
+};
+
+struct NoiseProfile {
+  int fftSize = 0;
+  std::vector<float> power;   // mean |X|^2 per bin, summed over channels
+  int64_t frames = 0;
+  double seconds = 0.0;
+
+  bool usable() const { return frames >= 4 && !power.empty(); }
+};
+
+struct DenoiseResult {
+  bool ok = false;
+  bool cancelled = false;
+  double durationSec = 0.0;
+  double elapsedMs = 0.0;
+  int threads = 0;
+};
+
+namespace denoise {
+
+constexpr int kOverlap = 4;      // hop = fftSize / 4
+constexpr int kWarmupFrames = 32;
+constexpr double kChunkSec = 8.0;
+constexpr double kPi = 3.14159265358979323846;
+
+// Square-root periodic Hann, used for analysis and synthesis. At 75% overlap
+// the product windows sum to 2, which process() compensates for.
+inline std::vector<float> window(int n) {
+  std::vector<float> w((size_t) n);
+  for (int i = 0; i < n; ++i) w[(size_t) i] = (float) std::sqrt(0.5 - 0.5 * std::cos(2.0 * kPi * i / n));
+  return w;
+}
+
+inline int validFftSize(int requested) {
+  int n = 256;
+  while (n < requested && n < 8192) n <<= 1;
+  return n;
+}
+
+// Learns the profile from the given original-time ranges (seconds). Ranges
+// shorter than one FFT frame contribute nothing.
+inline NoiseProfile learnProfile(const SampleReaderFactory& factory,
+                                 const std::vector<std::pair<double, double>>& ranges,
+                                 int fftSize,
+                                 const std::atomic<bool>* cancel = nullptr) {
+  NoiseProfile profile;
+  std::unique_ptr<SampleReader> reader = factory();
+  if (!reader || reader->sampleRate() <= 0.0) return profile;
+  const int n = validFftSize(fftSize);
+  const int hop = n / kOverlap;
+  const int channels = std::max(1, reader->numChannels());
+  const double rate = reader->sampleRate();
+  dsp::RealFft fft(n);
+  const std::vector<float> win = window(n);
+  std::vector<float> frame((size_t) n), re((size_t) fft.bins()), im((size_t) fft.bins());
+  std::vector<double> sum((size_t) fft.bins(), 0.0);
+  std::vector<std::vector<float>> buffers((size_t) channels, std::vector<float>((size_t) n));
+  std::vector<float*> ptrs((size_t) channels);
+  for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = buffers[(size_t) ch].data();
+
+  for (const auto& range : ranges) {
+    const int64_t start = (int64_t) std::llround(std::max(0.0, range.first) * rate);
+    const int64_t end = std::min(reader->lengthInSamples(), (int64_t) std::llround(range.second * rate));
+    for (int64_t pos = start; pos + n <= end; pos += hop) {
+      if (cancel && cancel->load()) return NoiseProfile();
+      if (!reader->read(ptrs.data(), channels, pos, n)) return NoiseProfile();
+      for (int ch = 0; ch < channels; ++ch) {
+        const float* x = ptrs[(size_t) ch];
+        for (int i = 0; i < n; ++i) frame[(size_t) i] = x[i] * win[(size_t) i];
+        fft.forward(frame.data(), re.data(), im.data());
+        for (int k = 0; k < fft.bins(); ++k) sum[(size_t) k] += (double) re[(size_t) k] * re[(size_t) k] + (double) im[(size_t) k] * im[(size_t) k];
+      }
+      profile.frames++;
+    }
+  }
+  profile.fftSize = n;
+  profile.seconds = (double) profile.frames * hop / rate;
+  if (profile.frames > 0) {
+    profile.power.resize(sum.size());
+    for (size_t k = 0; k < sum.size(); ++k) profile.power[k] = (float) (sum[k] / (double) profile.frames);
+  }
+  return profile;
+}
+
+// Fallback noise regions when the EDL has no spacers: runs of frames within
+// a few dB of the quietest `fraction` of the file. Background noise that sits above the
+// silence threshold (hum, air conditioning) is still found this way.
+inline std::vector<std::pair<double, double>> quietestRanges(const SilenceResult& frames, double fraction = 0.1) {
+  std::vector<std::pair<double, double>> ranges;
+  if (frames.frameDb.empty() || frames.frameSec <= 0.0) return ranges;
+  std::vector<float> sorted = frames.frameDb;
+  const size_t nth = std::min(sorted.size() - 1, (size_t) ((double) sorted.size() * fraction));
+  std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t) nth, sorted.end());
+  const float limit = sorted[nth] + 3.0f; // frame energies of steady noise still scatter a few dB
+  size_t runStart = 0;
+  bool inRun = false;
+  for (size_t i = 0; i <= frames.frameDb.size(); ++i) {
+    const bool quiet = i < frames.frameDb.size() && frames.frameDb[i] <= limit;
+    if (quiet && !inRun) { runStart = i; inRun = true; }
+    if (!quiet && inRun) {
+      ranges.emplace_back((double) runStart * frames.frameSec, (double) i * frames.frameSec);
+      inRun = false;
+    }
+  }
+  return ranges;
+}
+
+// Per-thread gate state for one chunk: FFT, window, per-channel bin gains.
+class SpectralGate {
+public:
+  SpectralGate(const NoiseProfile& profile, const DenoiseParams& params, double sampleRate, int channels)
+    : n(profile.fftSize), hop(profile.fftSize / kOverlap), fft(profile.fftSize), win(window(profile.fftSize)) {
+    const int bins = fft.bins();
+    // Profile power is summed over channels; gate each channel against its share.
+    const float thresholdScale = (float) std::pow(10.0, params.thresholdDb / 10.0) / (float) std::max(1, channels);
+    threshold.resize((size_t) bins);
+    for (int k = 0; k < bins; ++k) threshold[(size_t) k] = profile.power[(size_t) k] * thresholdScale;
+    floorGain = (float) std::pow(10.0, -std::max(0.0, params.reductionDb) / 20.0);
+    const double hopSec = hop / sampleRate;
+    release = (float) std::exp(-hopSec / std::max(1e-3, params.releaseMs * 0.001));
+    gains.assign((size_t) channels, std::vector<float>((size_t) bins, 1.0f));
+    frame.resize((size_t) n);
+    re.resize((size_t) bins);
+    im.resize((size_t) bins);
+    target.resize((size_t) bins);
+    smoothed.resize((size_t) bins);
+  }
+
+  int fftSize() const { return n; }
+  int hopSize() const { return hop; }
+
+  // Windows in[0, n), gates it and overlap-adds the result into out[0, n).
+  void processFrame(int channel, const float* in, float* out) {
+    const int bins = fft.bins();
+    for (int i = 0; i < n; ++i) frame[(size_t) i] = in[i] * win[(size_t) i];
+    fft.forward(frame.data(), re.data(), im.data());
+    std::vector<float>& g = gains[(size_t) channel];
+    for (int k = 0; k < bins; ++k) {
+      const float p = re[(size_t) k] * re[(size_t) k] + im[(size_t) k] * im[(size_t) k];
+      target[(size_t) k] = p > threshold[(size_t) k] ? 1.0f : floorGain;
+    }
+    // Open instantly, close with the release time constant.
+    for (int k = 0; k < bins; ++k) {
+      const float closing = target[(size_t) k] + release * (g[(size_t) k] - target[(size_t) k]);
+      g[(size_t) k] = target[(size_t) k] > g[(size_t) k] ? target[(size_t) k] : closing;
+    }
+    // Three-bin smoothing across frequency.
+    smoothed[0] = g[0];
+    smoothed[(size_t) bins - 1] = g[(size_t) bins - 1];
+    for (int k = 1; k < bins - 1; ++k) smoothed[(size_t) k] = 0.25f * g[(size_t) k - 1] + 0.5f * g[(size_t) k] + 0.25f * g[(size_t) k + 1];
+    for (int k = 0; k < bins; ++k) {
+      re[(size_t) k] *= smoothed[(size_t) k];
+      im[(size_t) k] *= smoothed[(size_t) k];
+    }
+    fft.inverse(re.data(), im.data(), frame.data());
+    const float norm = 2.0f / (float) kOverlap;
+    for (int i = 0; i < n; ++i) out[i] += frame[(size_t) i] * win[(size_t) i] * norm;
+  }
+
+private:
+  int n;
+  int hop;
+  dsp::RealFft fft;
+  std::vector<float> win;
+  std::vector<float> threshold;
+  float floorGain = 1.0f;
+  float release = 0.0f;
+  std::vector<std::vector<float>> gains;
+  std::vector<float> frame, re, im, target, smoothed;
+};
+
+// Processes the whole source into outputPath (32-bit float WAV at the source
+// rate and channel count). progress(fraction) is called after each batch of
+// chunks has been written.
+inline DenoiseResult processToFile(const SampleReaderFactory& factory,
+                                   const NoiseProfile& profile,
+                                   const DenoiseParams& params,
+                                   const std::string& outputPath,
+                                   const std::function<void(double)>& progress,
+                                   const std::atomic<bool>& cancel) {
+  DenoiseResult result;
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0 || !profile.usable()) return result;
+  const double rate = probe->sampleRate();
+  const int channels = std::max(1, probe->numChannels());
+  const int64_t length = probe->lengthInSamples();
+  probe.reset();
+
+  const int n = profile.fftSize;
+  const int hop = n / kOverlap;
+  const int64_t chunkSamples = std::max<int64_t>(hop, ((int64_t) (kChunkSec * rate) / hop) * hop);
+  const size_t numChunks = (size_t) ((length + chunkSamples - 1) / chunkSamples);
+  result.threads = analysisThreadCount(params.threads);
+  result.durationSec = (double) length / rate;
+
+  WavFileWriter writer(outputPath, rate, channels, 32);
+  if (!writer.isOpen()) return result;
+
+  // Frame f covers [f * hop - (n - hop), f * hop + hop), so every sample is
+  // covered by kOverlap frames, including the first.
+  const int64_t lead = n - hop;
+  const size_t batch = (size_t) result.threads;
+  std::vector<std::vector<float>> outputs(batch);
+  for (size_t first = 0; first < numChunks; first += batch) {
+    const size_t count = std::min(batch, numChunks - first);
+    const bool ok = runChunksInParallel(factory, count, result.threads,
+      [&](size_t index, SampleReader& reader) {
+        const int64_t chunkStart = (int64_t) (first + index) * chunkSamples;
+        const int64_t chunkEnd = std::min(length, chunkStart + chunkSamples);
+        const int64_t firstFrame = std::max<int64_t>(0, chunkStart / hop - kWarmupFrames);
+        const int64_t endFrame = (chunkEnd + lead) / hop + 1; // exclusive
+        const int64_t readStart = firstFrame * hop - lead;
+        const int64_t readLength = (endFrame - firstFrame - 1) * hop + n;
+        std::vector<std::vector<float>> in((size_t) channels, std::vector<float>((size_t) readLength));
+        std::vector<std::vector<float>> acc((size_t) channels, std::vector<float>((size_t) readLength, 0.0f));
+        std::vector<float*> ptrs((size_t) channels);
+        for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = in[(size_t) ch].data();
+        // Samples before the start of the file read as silence.
+        const int64_t pad = std::max<int64_t>(0, -readStart);
+        if (pad > 0) {
+          for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] += pad;
+        }
+        if (!reader.read(ptrs.data(), channels, readStart + pad, (int) (readLength - pad))) return false;
+
+        SpectralGate gate(profile, params, rate, channels);
+        for (int64_t f = firstFrame; f < endFrame; ++f) {
+          if (cancel.load()) return false;
+          const size_t offset = (size_t) ((f - firstFrame) * hop);
+          for (int ch = 0; ch < channels; ++ch) {
+            gate.processFrame(ch, in[(size_t) ch].data() + offset, acc[(size_t) ch].data() + offset);
+          }
+        }
+        std::vector<float>& out = outputs[index];
+        const int64_t frames = chunkEnd - chunkStart;
+        out.resize((size_t) (frames * channels));
+        const int64_t skip = chunkStart - readStart;
+        for (int ch = 0; ch < channels; ++ch) {
+          std::copy_n(acc[(size_t) ch].data() + skip, frames, out.data() + (size_t) ch * (size_t) frames);
+        }
+        return true;
+      }, &cancel);
+    if (!ok) {
+      result.cancelled = cancel.load();
+      return result;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const int64_t chunkStart = (int64_t) (first + i) * chunkSamples;
+      const int frames = (int) (std::min(length, chunkStart + chunkSamples) - chunkStart);
+      std::vector<const float*> planes((size_t) channels);
+      for (int ch = 0; ch < channels; ++ch) planes[(size_t) ch] = outputs[i].data() + (size_t) ch * (size_t) frames;
+      if (!writer.write(planes.data(), frames)) return result;
+    }
+    if (progress) progress((double) (first + count) / (double) numChunks);
+  }
+  if (!writer.close()) return result;
+  result.ok = true;
+  result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return result;
+}
+
+} // namespace denoise
@@ -0,0 +1,304 @@
+// Small DSP kernels shared by the audio callback and the offline analysis
+// passes. Loops are written with independent lane accumulators so clang/gcc
+// turn them into SSE/NEON code without needing intrinsics or -ffast-math.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace dsp {
+
+constexpr int kLanes = 8;
+
+// Largest absolute sample value.
+inline float peakAbs(const float* x, int n) {
+  float lane[kLanes] = {};
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    for (int k = 0; k < kLanes; ++k) {
+      const float a = std::fabs(x[i + k]);
+      lane[k] = a > lane[k] ? a : lane[k];
+    }
+  }
+  float m = 0.0f;
+  for (int k = 0; k < kLanes; ++k) m = lane[k] > m ? lane[k] : m;
+  for (; i < n; ++i) m = std::max(m, std::fabs(x[i]));
+  return m;
+}
+
+// Smallest and largest sample value, folded into lo / hi.
+inline void minMax(const float* x, int n, float& lo, float& hi) {
+  float low[kLanes], high[kLanes];
+  std::fill(low, low + kLanes, lo);
+  std::fill(high, high + kLanes, hi);
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    for (int k = 0; k < kLanes; ++k) {
+      low[k] = x[i + k] < low[k] ? x[i + k] : low[k];
+      high[k] = x[i + k] > high[k] ? x[i + k] : high[k];
+    }
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    lo = std::min(lo, low[k]);
+    hi = std::max(hi, high[k]);
+  }
+  for (; i < n; ++i) {
+    lo = std::min(lo, x[i]);
+    hi = std::max(hi, x[i]);
+  }
+}
+
+// Sum of squares; lanes accumulate in float, the fold is done in double.
+inline double sumSquares(const float* x, int n) {
+  float lane[kLanes] = {};
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    for (int k = 0; k < kLanes; ++k) lane[k] += x[i + k] * x[i + k];
+  }
+  double total = 0.0;
+  for (int k = 0; k < kLanes; ++k) total += lane[k];
+  for (; i < n; ++i) total += (double) x[i] * x[i];
+  return total;
+}
+
+// Number of samples at or above full scale (clip indicator).
+inline int countClipped(const float* x, int n, float ceiling = 0.999f) {
+  int count = 0;
+  for (int i = 0; i < n; ++i) count += std::fabs(x[i]) >= ceiling ? 1 : 0;
+  return count;
+}
+
+inline float gainToDb(double gain, float floorDb = -120.0f) {
+  if (!(gain > 0.0)) return floorDb;
+  return std::max(floorDb, (float) (20.0 * std::log10(gain)));
+}
+
+inline float dbToGain(float db) {
+  return (float) std::pow(10.0, db / 20.0);
+}
+
+inline float powerToDb(double power, float floorDb = -120.0f) {
+  if (!(power > 0.0)) return floorDb;
+  return std::max(floorDb, (float) (10.0 * std::log10(power)));
+}
+
+// True-peak estimate per ITU-R BS.1770-4 Annex 2: 4x oversampling through a
+// 48-tap windowed-sinc interpolator (12 taps per phase), peak of the result.
+// One instance per channel; keeps the tail of the previous block as history.
+class TruePeakDetector {
+public:
+  static constexpr int kPhases = 4;
+  static constexpr int kTapsPerPhase = 12;
+
+  TruePeakDetector() { reset(); }
+
+  void reset() { std::fill(history, history + kHistory, 0.0f); }
+
+  // Returns the true-peak (linear) of this block, including inter-sample peaks.
+  // Works through the block in fixed-size stretches so the scratch lives on
+  // the stack; each phase is a short FIR that vectorises across samples.
+  float process(const float* x, int n) {
+    const Kernel& kernel = sharedKernel();
+    float peak = 0.0f;
+    float buffer[kHistory + kStretch];
+    float acc[kStretch];
+    for (int done = 0; done < n;) {
+      const int count = std::min(kStretch, n - done);
+      std::copy(history, history + kHistory, buffer);
+      std::copy(x + done, x + done + count, buffer + kHistory);
+      for (int phase = 0; phase < kPhases; ++phase) {
+        std::fill(acc, acc + count, 0.0f);
+        for (int t = 0; t < kTapsPerPhase; ++t) {
+          const float tap = kernel.taps[t][phase];
+          const float* src = buffer + t;
+          for (int i = 0; i < count; ++i) acc[i] += tap * src[i];
+        }
+        peak = std::max(peak, peakAbs(acc, count));
+      }
+      // The newest inputs become the history for what follows.
+      std::copy(buffer + count, buffer + count + kHistory, history);
+      done += count;
+    }
+    return peak;
+  }
+
+private:
+  static constexpr int kHistory = kTapsPerPhase - 1;
+  static constexpr int kStretch = 256;
+
+  struct Kernel {
+    float taps[kTapsPerPhase][kPhases];
+  };
+
+  static const Kernel& sharedKernel() {
+    static const Kernel kernel = [] {
+      Kernel k{};
+      const double pi = 3.14159265358979323846;
+      const int total = kPhases * kTapsPerPhase;
+      for (int phase = 0; phase < kPhases; ++phase) {
+        for (int t = 0; t < kTapsPerPhase; ++t) {
+          const int idx = t * kPhases + phase;
+          const double centre = (total - 1) * 0.5;
+          const double xpos = (idx - centre) / kPhases;
+          const double sinc = std::fabs(xpos) < 1e-9 ? 1.0 : std::sin(pi * xpos) / (pi * xpos);
+          const double window = 0.5 - 0.5 * std::cos(2.0 * pi * (idx + 0.5) / total);
+          k.taps[kTapsPerPhase - 1 - t][phase] = (float) (sinc * window);
+        }
+      }
+      return k;
+    }();
+    return kernel;
+  }
+
+  float history[kHistory];
+};
+
+// x[i] *= g[i]; independent iterations, so it vectorises.
+inline void multiply(float* x, const float* g, int n) {
+  for (int i = 0; i < n; ++i) x[i] *= g[i];
+}
+
+// out[i] = max over channels of |x[ch][i]|, for side-chain detection.
+inline void maxAbsAcross(const float* const* x, int numChannels, int offset, int n, float* out) {
+  std::fill(out, out + n, 0.0f);
+  for (int ch = 0; ch < numChannels; ++ch) {
+    const float* in = x[ch] + offset;
+    for (int i = 0; i < n; ++i) {
+      const float a = std::fabs(in[i]);
+      out[i] = a > out[i] ? a : out[i];
+    }
+  }
+}
+
+// out[i] = sum over channels of x[ch][i] (a downmix without the 1/n).
+inline void sumAcross(const float* const* x, int numChannels, int n, float* out) {
+  std::copy(x[0], x[0] + n, out);
+  for (int ch = 1; ch < numChannels; ++ch) {
+    const float* in = x[ch];
+    for (int i = 0; i < n; ++i) out[i] += in[i];
+  }
+}
+
+// Index of the smallest x[i]; among equal values, the one nearest centre
+// (the lower index on a tie). -1 when n is 0. The minimum is a lane-wise
+// reduction; finding it again searches outward from centre, so a minimum
+// near the centre costs little.
+inline int argMinNearest(const float* x, int n, int centre) {
+  if (n <= 0) return -1;
+  float lane[kLanes];
+  std::fill(lane, lane + kLanes, HUGE_VALF);
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    for (int k = 0; k < kLanes; ++k) lane[k] = x[i + k] < lane[k] ? x[i + k] : lane[k];
+  }
+  for (; i < n; ++i) lane[0] = x[i] < lane[0] ? x[i] : lane[0];
+  const float least = *std::min_element(lane, lane + kLanes);
+  centre = std::clamp(centre, 0, n - 1);
+  const int reach = std::max(centre, n - 1 - centre);
+  for (int d = 0; d <= reach; ++d) {
+    if (centre - d >= 0 && x[centre - d] == least) return centre - d;
+    if (centre + d < n && x[centre + d] == least) return centre + d;
+  }
+  return centre; // only NaN
+}
+
+// The i in [1, n) nearest centre where x[i - 1] and x[i] lie on opposite
+// sides of zero (zero counts as positive), or -1 if there is none; the
+// lower i on a tie. Searches outward from centre, since in program audio a
+// crossing is rarely more than a few samples away.
+inline int nearestSignChange(const float* x, int n, int centre) {
+  if (n < 2) return -1;
+  auto change = [x](int i) { return (x[i - 1] < 0.0f) != (x[i] < 0.0f); };
+  centre = std::clamp(centre, 1, n - 1);
+  const int reach = std::max(centre - 1, n - 1 - centre);
+  for (int d = 0; d <= reach; ++d) {
+    if (centre - d >= 1 && change(centre - d)) return centre - d;
+    if (centre + d < n && change(centre + d)) return centre + d;
+  }
+  return -1;
+}
+
+// Second-order section (transposed direct form II). Coefficients follow the
+// RBJ cookbook, normalised by a0.
+struct Biquad {
+  float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+  float z1 = 0.0f, z2 = 0.0f;
+
+  void setHighPass(double sampleRate, double hz, double q = 0.7071067811865476) {
+    const double w = 2.0 * 3.14159265358979323846 * std::clamp(hz, 1.0, 0.45 * sampleRate) / sampleRate;
+    const double alpha = std::sin(w) / (2.0 * q);
+    const double c = std::cos(w);
+    const double a0 = 1.0 + alpha;
+    b0 = (float) ((1.0 + c) * 0.5 / a0);
+    b1 = (float) (-(1.0 + c) / a0);
+    b2 = b0;
+    a1 = (float) (-2.0 * c / a0);
+    a2 = (float) ((1.0 - alpha) / a0);
+  }
+
+  void reset() { z1 = z2 = 0.0f; }
+
+  void process(float* x, int n) {
+    float s1 = z1, s2 = z2;
+    for (int i = 0; i < n; ++i) {
+      const float in = x[i];
+      const float out = b0 * in + s1;
+      s1 = b1 * in - a1 * out + s2;
+      s2 = b2 * in - a2 * out;
+      x[i] = out;
+    }
+    // Flush denormals once per block rather than per sample.
+    z1 = std::fabs(s1) < 1e-15f ? 0.0f : s1;
+    z2 = std::fabs(s2) < 1e-15f ? 0.0f : s2;
+  }
+};
+
+// Per-sample linear gain ramp applied across channels. Changing the target
+// starts a ramp of rampSamples from the current gain, so gain switches at
+// clip boundaries and seeks never click. Unity gain with no ramp is a no-op.
+class GainRamp {
+public:
+  void reset(float gain = 1.0f) {
+    current = target = gain;
+    remaining = 0;
+  }
+
+  void setTarget(float newTarget, int rampSamples) {
+    if (newTarget == target) return;
+    target = newTarget;
+    remaining = std::max(1, rampSamples);
+    step = (target - current) / (float) remaining;
+  }
+
+  float currentGain() const { return current; }
+
+  void process(float* const* channels, int numChannels, int offset, int n) {
+    int i = 0;
+    if (remaining > 0) {
+      const int k = std::min(n, remaining);
+      for (int ch = 0; ch < numChannels; ++ch) {
+        float g = current;
+        float* x = channels[ch] + offset;
+        for (int s = 0; s < k; ++s) { g += step; x[s] *= g; }
+      }
+      remaining -= k;
+      current = remaining > 0 ? current + step * (float) k : target;
+      i = k;
+    }
+    if (i < n && current != 1.0f) {
+      for (int ch = 0; ch < numChannels; ++ch) {
+        float* x = channels[ch] + offset;
+        for (int s = i; s < n; ++s) x[s] *= current;
+      }
+    }
+  }
+
+private:
+  float current = 1.0f;
+  float target = 1.0f;
+  float step = 0.0f;
+  int remaining = 0;
+};
+
+} // namespace dsp
@@ -0,0 +1,128 @@
+// Engine threads (timer, command reader, audio-adjacent code) never write to
+// stdout themselves: they push into a bounded lock-free queue that a dedicated
+// writer thread drains. If the Electron side stops reading and the pipe fills,
+// the writer blocks first. Position events carry a sequence number so the
+// writer can skip any position that a newer queued one has superseded, and
+// they are refused early when the queue runs hot so the last quarter is kept
+// for events that cannot be coalesced. Nothing ever waits for room: the timer
+// emits while holding the engine lock, so a wait would stall every command
+// behind a stalled reader. An event that finds even the reserve full is
+// counted as lost, and outputStats reports the count. Meter events follow the
+// position rules on their own coalescing key.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "LockFree.h"
+
+enum class CoalesceKey : uint8_t { None = 0, Position, Meter, Count };
+
+struct OutboundEvent {
+  std::string json;
+  CoalesceKey key = CoalesceKey::None;
+  uint64_t seq = 0;
+};
+
+class EventWriter {
+public:
+  static constexpr size_t kCapacity = 4096;
+  static constexpr size_t kCoalescedHighWater = kCapacity * 3 / 4;
+
+  explicit EventWriter(std::ostream& out = std::cout) : out(out) {}
+
+  void start() {
+    if (thread.joinable()) return;
+    stopping.store(false);
+    thread = std::thread([this] { run(); });
+  }
+
+  // Drains everything still queued, then joins the writer thread.
+  void stop() {
+    if (!thread.joinable()) return;
+    stopping.store(true);
+    wake.notify_one();
+    thread.join();
+  }
+
+  void push(const std::string& json) {
+    OutboundEvent evt{ json, CoalesceKey::None, 0 };
+    if (queue.tryPush(evt)) { pushed(); return; }
+    lost.fetch_add(1, std::memory_order_relaxed);
+    wake.notify_one();
+  }
+
+  // The sequence number only becomes the latest once the event is queued, so
+  // a refused update never hides the one before it.
+  void pushCoalesced(CoalesceKey key, const std::string& json) {
+    if (queue.approxSize() >= kCoalescedHighWater) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    const uint64_t seq = issuedSeq[(size_t) key].fetch_add(1, std::memory_order_relaxed) + 1;
+    OutboundEvent evt{ json, key, seq };
+    if (!queue.tryPush(evt)) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    atomicStoreMax(latestSeq[(size_t) key], seq);
+    pushed();
+  }
+
+  size_t depth() const { return queue.approxSize(); }
+
+  std::atomic<uint64_t> enqueued{0};
+  std::atomic<uint64_t> written{0};
+  std::atomic<uint64_t> dropped{0}; // coalescable events refused (a later one follows)
+  std::atomic<uint64_t> lost{0};    // other events refused with the queue full
+  std::atomic<uint64_t> coalesced{0};
+  std::atomic<size_t> highWater{0};
+
+private:
+  void pushed() {
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+    atomicStoreMax(highWater, queue.approxSize());
+    // Notifying without holding the mutex keeps producers wait-free; a missed
+    // wakeup is bounded by the writer's poll interval.
+    wake.notify_one();
+  }
+
+  void run() {
+    using namespace std::chrono_literals;
+    OutboundEvent evt;
+    for (;;) {
+      bool wroteAny = false;
+      while (queue.tryPop(evt)) {
+        if (evt.key != CoalesceKey::None &&
+            evt.seq < latestSeq[(size_t) evt.key].load(std::memory_order_relaxed)) {
+          coalesced.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        out << evt.json << "\n";
+        written.fetch_add(1, std::memory_order_relaxed);
+        wroteAny = true;
+      }
+      if (wroteAny) out.flush();
+      if (stopping.load() && queue.approxSize() == 0) break;
+      std::unique_lock<std::mutex> lock(wakeMutex);
+      wake.wait_for(lock, 10ms, [this] { return queue.approxSize() > 0 || stopping.load(); });
+    }
+    out.flush();
+  }
+
+  std::ostream& out;
+  BoundedMpmcQueue<OutboundEvent> queue{ kCapacity };
+  std::atomic<uint64_t> issuedSeq[(size_t) CoalesceKey::Count] = {};
+  std::atomic<uint64_t> latestSeq[(size_t) CoalesceKey::Count] = {}; // newest queued
+  std::atomic<bool> stopping{false};
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::thread thread;
+};
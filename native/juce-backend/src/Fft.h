@@ -0,0 +1,138 @@
+// Real-input FFT for the offline spectral passes. A size-N real transform is
+// computed as an N/2-point complex FFT plus a split step. Data is kept in
+// split (separate re/im) arrays and every stage's twiddles are stored
+// contiguously, so the butterfly loops are unit-stride and the compiler
+// vectorises them without intrinsics. One instance per thread; the scratch
+// buffers make it non-reentrant.
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+namespace dsp {
+
+class RealFft {
+public:
+  // size must be a power of two, at least 4.
+  explicit RealFft(int size) : n(size), half(size / 2) {
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    bitReverse.resize((size_t) half);
+    for (int i = 0; i < half; ++i) {
+      int r = 0;
+      for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+      bitReverse[(size_t) i] = r;
+    }
+    // Stage twiddles: for a stage of length len, e^{-2 pi i j / len} for
+    // j < len / 2, starting at stageOffset[stage].
+    for (int len = 2; len <= half; len <<= 1) {
+      stageOffset.push_back((int) twRe.size());
+      for (int j = 0; j < len / 2; ++j) {
+        const double a = -2.0 * kPi * j / len;
+        twRe.push_back((float) std::cos(a));
+        twIm.push_back((float) std::sin(a));
+      }
+    }
+    splitRe.resize((size_t) half + 1);
+    splitIm.resize((size_t) half + 1);
+    for (int k = 0; k <= half; ++k) {
+      const double a = -2.0 * kPi * k / n;
+      splitRe[(size_t) k] = (float) std::cos(a);
+      splitIm[(size_t) k] = (float) std::sin(a);
+    }
+    zRe.resize((size_t) half);
+    zIm.resize((size_t) half);
+  }
+
+  int size() const { return n; }
+  int bins() const { return half + 1; }
+
+  // time[0, size) -> re/im[0, size / 2]. Unnormalised.
+  void forward(const float* time, float* re, float* im) {
+    for (int i = 0; i < half; ++i) {
+      const int r = bitReverse[(size_t) i];
+      zRe[(size_t) r] = time[2 * i];
+      zIm[(size_t) r] = time[2 * i + 1];
+    }
+    butterflies();
+    // Separate the even/odd sample spectra and combine them.
+    re[0] = zRe[0] + zIm[0];
+    im[0] = 0.0f;
+    re[half] = zRe[0] - zIm[0];
+    im[half] = 0.0f;
+    for (int k = 1; k < half; ++k) {
+      const float ar = zRe[(size_t) k], ai = zIm[(size_t) k];
+      const float br = zRe[(size_t) (half - k)], bi = -zIm[(size_t) (half - k)];
+      const float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+      const float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+      // odd = -i * d
+      const float orr = di, oi = -dr;
+      const float wr = splitRe[(size_t) k], wi = splitIm[(size_t) k];
+      re[k] = er + wr * orr - wi * oi;
+      im[k] = ei + wr * oi + wi * orr;
+    }
+  }
+
+  // re/im[0, size / 2] -> time[0, size), scaled so inverse(forward(x)) == x.
+  void inverse(const float* re, const float* im, float* time) {
+    for (int k = 0; k < half; ++k) {
+      const float ar = re[k], ai = im[k];
+      const float br = re[half - k], bi = -im[half - k];
+      const float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+      const float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+      // odd = d * conj(w); z = even + i * odd
+      const float wr = splitRe[(size_t) k], wi = -splitIm[(size_t) k];
+      const float orr = dr * wr - di * wi, oi = dr * wi + di * wr;
+      const int r = bitReverse[(size_t) k];
+      // Conjugate in, conjugate out turns the forward butterflies into an
+      // inverse transform.
+      zRe[(size_t) r] = er - oi;
+      zIm[(size_t) r] = -(ei + orr);
+    }
+    butterflies();
+    const float scale = 1.0f / (float) half;
+    for (int i = 0; i < half; ++i) {
+      time[2 * i] = zRe[(size_t) i] * scale;
+      time[2 * i + 1] = -zIm[(size_t) i] * scale;
+    }
+  }
+
+private:
+  static constexpr double kPi = 3.14159265358979323846;
+
+  // In-place iterative radix-2 on zRe/zIm (already in bit-reversed order).
+  void butterflies() {
+    float* xr = zRe.data();
+    float* xi = zIm.data();
+    int stage = 0;
+    for (int len = 2; len <= half; len <<= 1, ++stage) {
+      const int h = len / 2;
+      const float* wr = twRe.data() + stageOffset[(size_t) stage];
+      const float* wi = twIm.data() + stageOffset[(size_t) stage];
+      for (int start = 0; start < half; start += len) {
+        float* ar = xr + start;
+        float* ai = xi + start;
+        float* br = ar + h;
+        float* bi = ai + h;
+        for (int j = 0; j < h; ++j) {
+          const float tr = br[j] * wr[j] - bi[j] * wi[j];
+          const float ti = br[j] * wi[j] + bi[j] * wr[j];
+          br[j] = ar[j] - tr;
+          bi[j] = ai[j] - ti;
+          ar[j] += tr;
+          ai[j] += ti;
+        }
+      }
+    }
+  }
+
+  int n;
+  int half;
+  std::vector<int> bitReverse;
+  std::vector<int> stageOffset;
+  std::vector<float> twRe, twIm;
+  std::vector<float> splitRe, splitIm;
+  std::vector<float> zRe, zIm;
+};
+
+} // namespace dsp
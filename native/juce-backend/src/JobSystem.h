@@ -0,0 +1,570 @@
+// The backend's one scheduler for offline work: rendering, exports, peaks,
+// loudness, silence, spectrogram tiles, fingerprints and denoise all split
+// their passes into indexed loops and run them here, on a fixed set of
+// workers that sit below normal OS priority so they never compete with the
+// audio callback or the command threads.
+//
+// Each worker owns a pair of deques, one per priority. A worker pops its own
+// newest task first and, when it has nothing, steals the oldest task from the
+// other workers; interactive tasks anywhere are taken before background ones.
+// A loop is run by a few self-requeueing runner tasks that claim one index at
+// a time, so a background pass yields to an interactive one between indices.
+// The thread that starts a loop claims indices too, which keeps nested loops
+// (a loop started from inside a task) from waiting on themselves; for a
+// background loop it holds off while any interactive loop is running, since
+// it is a thread over and above the workers.
+//
+// Cancellation is cooperative: loops stop claiming once their cancel flag is
+// set and return false after the indices in flight have finished.
+//
+// Long-running commands sit on top as jobs (Runner), one per kind, each
+// driven by a thread of its own that supersedes the previous job of its kind.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+inline int analysisThreadCount(int requested = 0) {
+  if (requested > 0) return std::min(requested, 64);
+  const unsigned hw = std::thread::hardware_concurrency();
+  return (int) std::max(1u, std::min(hw == 0 ? 4u : hw, 16u));
+}
+
+namespace jobs {
+
+enum class Priority { Interactive = 0, Background = 1 };
+
+inline const char* priorityName(Priority priority) {
+  return priority == Priority::Interactive ? "interactive" : "background";
+}
+
+// A long-running command as the scheduler sees it. The owner fills it in and
+// keeps it alive until the work started under it has returned.
+struct Job {
+  uint64_t id = 0;
+  std::string kind;
+  Priority priority = Priority::Background;
+  std::atomic<bool> cancel{false};
+  // Loops report done/total here unless the job reports its own progress.
+  bool loopProgress = true;
+  // Called with each new twentieth of the way, in order, from whichever thread
+  // got there.
+  std::function<void(const Job&, double)> onProgress;
+  std::atomic<int> reportedStep{0};
+  // Set by reportFailure(); the owner reports it once the work returns.
+  std::atomic<bool> failed{false};
+
+  static constexpr int kSteps = 20;
+
+  double fraction() const { return (double) reportedStep.load(std::memory_order_relaxed) / kSteps; }
+};
+
+namespace detail {
+inline thread_local Job* tJob = nullptr;
+inline thread_local Priority tPriority = Priority::Interactive;
+} // namespace detail
+
+// The job the calling thread is working for, if any.
+inline Job* currentJob() { return detail::tJob; }
+
+// Loops started with no job behind them answer a waiting command, so they run
+// as interactive.
+inline Priority currentPriority() { return detail::tJob ? detail::tJob->priority : detail::tPriority; }
+
+// Makes job current on this thread for the lifetime of the scope.
+class JobScope {
+public:
+  explicit JobScope(Job* job) : previousJob(detail::tJob), previousPriority(detail::tPriority) {
+    detail::tJob = job;
+    if (job) detail::tPriority = job->priority;
+  }
+  ~JobScope() {
+    detail::tJob = previousJob;
+    detail::tPriority = previousPriority;
+  }
+  JobScope(const JobScope&) = delete;
+  JobScope& operator=(const JobScope&) = delete;
+
+private:
+  Job* previousJob;
+  Priority previousPriority;
+};
+
+// Moves the current job's progress forward; never back.
+inline void reportProgress(double fraction) {
+  Job* job = detail::tJob;
+  if (!job) return;
+  const int step = (int) (std::clamp(fraction, 0.0, 1.0) * Job::kSteps);
+  int seen = job->reportedStep.load(std::memory_order_relaxed);
+  while (step > seen) {
+    if (!job->reportedStep.compare_exchange_weak(seen, seen + 1)) continue;
+    ++seen;
+    if (job->onProgress) job->onProgress(*job, (double) seen / Job::kSteps);
+  }
+}
+
+// Marks the current job as failed. The work says why in its own result
+// event; this only changes how the job itself is reported as ending.
+inline void reportFailure() {
+  if (Job* job = detail::tJob) job->failed.store(true, std::memory_order_relaxed);
+}
+
+// Drops the calling thread below the audio and command threads: nice 10 on
+// Linux, the utility QoS class on macOS, below normal on Windows.
+inline void lowerCurrentThreadPriority() {
+#if defined(_WIN32)
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__APPLE__)
+  pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+  setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), 10);
+#endif
+}
+
+struct SchedulerStats {
+  int workers = 0;
+  uint64_t executed = 0;
+  uint64_t stolen = 0;
+  uint64_t queued = 0;
+};
+
+class Scheduler {
+public:
+  using Task = std::function<void()>;
+
+  explicit Scheduler(int workerCount) : workers((size_t) std::max(1, workerCount)) {
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].thread = std::thread([this, i] { run(i); });
+    }
+  }
+
+  ~Scheduler() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.thread.join();
+  }
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  // From a worker, onto its own deque (it will likely run the task itself);
+  // from any other thread, onto the workers in turn.
+  void submit(Task task, Priority priority) {
+    const size_t target = tWorker >= 0 && tOwner == this
+                              ? (size_t) tWorker
+                              : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    {
+      std::lock_guard<std::mutex> lock(workers[target].mutex);
+      workers[target].queues[(size_t) priority].push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      ++pending;
+    }
+    wake.notify_one();
+  }
+
+  int workerCount() const { return (int) workers.size(); }
+
+  void beginInteractive() { interactiveLoops.fetch_add(1); }
+
+  void endInteractive() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      interactiveLoops.fetch_sub(1);
+    }
+    interactiveDone.notify_all();
+  }
+
+  // Blocks while an interactive loop is running. Polls the cancel flag, which
+  // nobody signals.
+  void waitForInteractive(const std::atomic<bool>* cancel) {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    while (interactiveLoops.load() > 0 && !(cancel && cancel->load())) {
+      interactiveDone.wait_for(lock, std::chrono::milliseconds(5));
+    }
+  }
+
+  SchedulerStats stats() const {
+    SchedulerStats s;
+    s.workers = (int) workers.size();
+    s.executed = executed.load(std::memory_order_relaxed);
+    s.stolen = stolen.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    s.queued = pending;
+    return s;
+  }
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::array<std::deque<Task>, 2> queues;
+    std::thread thread;
+  };
+
+  bool take(size_t self, Task& out) {
+    for (size_t priority = 0; priority < 2; ++priority) {
+      {
+        Worker& own = workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        auto& queue = own.queues[priority];
+        if (!queue.empty()) {
+          out = std::move(queue.back());
+          queue.pop_back();
+          return true;
+        }
+      }
+      for (size_t k = 1; k < workers.size(); ++k) {
+        Worker& victim = workers[(self + k) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        auto& queue = victim.queues[priority];
+        if (!queue.empty()) {
+          out = std::move(queue.front());
+          queue.pop_front();
+          stolen.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void run(size_t self) {
+    tWorker = (int) self;
+    tOwner = this;
+    lowerCurrentThreadPriority();
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&] { return stopping || pending > 0; });
+        if (stopping) return;
+      }
+      Task task;
+      if (!take(self, task)) {
+        std::this_thread::yield(); // another worker got there first
+        continue;
+      }
+      {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        --pending;
+      }
+      task();
+      executed.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static inline thread_local int tWorker = -1;
+  static inline thread_local const Scheduler* tOwner = nullptr;
+
+  std::vector<Worker> workers;
+  std::atomic<size_t> nextWorker{0};
+  std::atomic<uint64_t> executed{0};
+  std::atomic<uint64_t> stolen{0};
+  mutable std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::condition_variable interactiveDone;
+  std::atomic<int> interactiveLoops{0};
+  uint64_t pending = 0;
+  bool stopping = false;
+};
+
+// One worker per core, up to 16. Never destroyed: a background pass may
+// still hold a worker while static destructors run at exit.
+inline Scheduler& scheduler() {
+  static Scheduler* instance = new Scheduler(analysisThreadCount());
+  return *instance;
+}
+
+// Runs fn(index) for every index in [0, count) on up to `width` threads (the
+// caller's included; 0 means one per worker), at the current job's priority.
+// Started on construction; wait() joins in and returns false if fn failed or
+// the loop was cancelled. The destructor waits too.
+class ParallelLoop {
+public:
+  using Body = std::function<bool(size_t)>;
+
+  ParallelLoop(size_t count, Body fn, int width = 0, const std::atomic<bool>* cancel = nullptr)
+      : state(std::make_shared<State>()) {
+    state->count = count;
+    state->fn = std::move(fn);
+    state->cancel = cancel;
+    state->job = currentJob();
+    state->priority = currentPriority();
+    Scheduler& pool = scheduler();
+    if (state->priority == Priority::Interactive) pool.beginInteractive();
+    const size_t limit = (size_t) (width > 0 ? width : pool.workerCount() + 1);
+    const size_t runners = std::min(count, limit);
+    for (size_t i = 1; i < runners; ++i) schedule(state);
+  }
+
+  ~ParallelLoop() { wait(); }
+
+  ParallelLoop(const ParallelLoop&) = delete;
+  ParallelLoop& operator=(const ParallelLoop&) = delete;
+
+  bool wait() {
+    if (!done) {
+      JobScope scope(state->job);
+      const bool yields = state->priority == Priority::Background;
+      for (;;) {
+        if (yields) scheduler().waitForInteractive(state->cancel);
+        if (!state->runOne()) break;
+      }
+      {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->closed = true;
+        state->idle.wait(lock, [&] { return state->active == 0; });
+      }
+      if (!yields) scheduler().endInteractive();
+      done = true;
+    }
+    return !state->failed.load() && !state->cancelled();
+  }
+
+private:
+  struct State {
+    size_t count = 0;
+    Body fn;
+    const std::atomic<bool>* cancel = nullptr;
+    Job* job = nullptr;
+    Priority priority = Priority::Interactive;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    std::condition_variable idle;
+    size_t active = 0;
+    bool closed = false;
+
+    bool cancelled() const { return cancel && cancel->load(); }
+
+    // Claims and runs one index; false once there is nothing left to claim.
+    bool runOne() {
+      if (failed.load() || cancelled()) return false;
+      const size_t index = next.fetch_add(1);
+      if (index >= count) return false;
+      if (!fn(index)) failed.store(true);
+      const size_t total = finished.fetch_add(1) + 1;
+      if (job && job->loopProgress) reportProgress((double) total / (double) count);
+      return true;
+    }
+  };
+
+  // A runner claims one index per turn and requeues itself, so tasks of
+  // higher priority get a worker between indices. Once the loop is closed
+  // its state is only kept alive for runners still queued, which leave
+  // without touching fn or cancel.
+  static void schedule(const std::shared_ptr<State>& state) {
+    scheduler().submit([state] {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->closed) return;
+        ++state->active;
+      }
+      bool more;
+      {
+        JobScope scope(state->job);
+        more = state->runOne();
+      }
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        --state->active;
+        if (state->active == 0) state->idle.notify_all();
+      }
+      if (more) schedule(state);
+    }, state->priority);
+  }
+
+  std::shared_ptr<State> state;
+  bool done = false;
+};
+
+inline bool parallelFor(size_t count,
+                        const std::function<bool(size_t)>& fn,
+                        int width = 0,
+                        const std::atomic<bool>* cancel = nullptr) {
+  ParallelLoop loop(count, fn, width, cancel);
+  return loop.wait();
+}
+
+// What Runner says about a job as it goes; every callback may run on any
+// thread, but a job's progress and finish always follow its start.
+struct RunnerEvents {
+  std::function<void(const Job&)> started;
+  std::function<void(const Job&, double)> progress;
+  // status is "ok", "cancelled" or "error" (the job called reportFailure).
+  std::function<void(const Job&, const char* status, double elapsedMs)> finished;
+};
+
+struct JobInfo {
+  uint64_t id = 0;
+  std::string kind;
+  Priority priority = Priority::Background;
+  double fraction = 0.0;
+  bool cancelled = false;
+  double elapsedMs = 0.0;
+};
+
+// Runs long-running commands as jobs, one per kind: starting a job cancels
+// any earlier job of the same kind, which the new job's thread waits out
+// before running, so jobs of one kind never overlap. A job cancelled before
+// its turn comes never runs its task. Each job's thread sits below normal
+// priority and makes the job current while its task runs.
+class Runner {
+public:
+  using Task = std::function<void(const std::atomic<bool>& cancel)>;
+
+  explicit Runner(RunnerEvents events) : events(std::move(events)) {}
+  ~Runner() { stopAll(); }
+
+  Runner(const Runner&) = delete;
+  Runner& operator=(const Runner&) = delete;
+
+  // Returns the new job's id. Never blocks: callers may hold an engine lock,
+  // and cancel/active must not wait behind a job that is stopping.
+  // loopProgress: whether the job's loops report its progress, or it does.
+  uint64_t start(const std::string& kind, Priority priority, bool loopProgress, Task task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = slots[kind];
+    if (slot.job) slot.job->job.cancel.store(true);
+    std::thread previous = std::move(slot.thread);
+    auto running = std::make_shared<Running>();
+    running->job.id = ++lastId;
+    running->job.kind = kind;
+    running->job.priority = priority;
+    running->job.loopProgress = loopProgress;
+    running->job.onProgress = events.progress;
+    running->started = std::chrono::steady_clock::now();
+    if (events.started) events.started(running->job);
+    slot.job = running;
+    slot.thread = std::thread([this, task = std::move(task), running, previous = std::move(previous)]() mutable {
+      if (previous.joinable()) previous.join();
+      lowerCurrentThreadPriority();
+      if (!running->job.cancel.load()) {
+        JobScope scope(&running->job);
+        task(running->job.cancel);
+      }
+      const double elapsedMs =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - running->started).count();
+      const char* status = running->job.cancel.load() ? "cancelled" : running->job.failed.load() ? "error" : "ok";
+      if (events.finished) events.finished(running->job, status, elapsedMs);
+      std::lock_guard<std::mutex> lock(mutex);
+      running->done.store(true);
+      idle.notify_all();
+    });
+    return running->job.id;
+  }
+
+  // Blocks until every job has finished, including any a job starts before
+  // it finishes.
+  void waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] {
+      for (const auto& entry : slots) {
+        if (entry.second.job && !entry.second.job->done.load()) return false;
+      }
+      return true;
+    });
+  }
+
+  // Asks the job of this kind to stop without waiting for it.
+  void cancel(const std::string& kind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = slots.find(kind);
+    if (it != slots.end() && it->second.job) it->second.job->job.cancel.store(true);
+  }
+
+  // False when no job with this id is still running.
+  bool cancelJob(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : slots) {
+      const auto& running = entry.second.job;
+      if (!running || running->job.id != id || running->done.load()) continue;
+      running->job.cancel.store(true);
+      return true;
+    }
+    return false;
+  }
+
+  // The jobs still running, by kind.
+  std::vector<JobInfo> active() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<JobInfo> list;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : slots) {
+      const auto& running = entry.second.job;
+      if (!running || running->done.load()) continue;
+      JobInfo info;
+      info.id = running->job.id;
+      info.kind = running->job.kind;
+      info.priority = running->job.priority;
+      info.fraction = running->job.fraction();
+      info.cancelled = running->job.cancel.load();
+      info.elapsedMs = std::chrono::duration<double, std::milli>(now - running->started).count();
+      list.push_back(std::move(info));
+    }
+    return list;
+  }
+
+  // Cancels every job and waits for their threads.
+  void stopAll() {
+    std::map<std::string, Slot> stopping;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& entry : slots) {
+        if (entry.second.job) entry.second.job->job.cancel.store(true);
+      }
+      stopping.swap(slots);
+    }
+    for (auto& entry : stopping) {
+      if (entry.second.thread.joinable()) entry.second.thread.join();
+    }
+  }
+
+private:
+  struct Running {
+    Job job;
+    std::chrono::steady_clock::time_point started;
+    std::atomic<bool> done{false};
+  };
+  struct Slot {
+    std::thread thread;
+    std::shared_ptr<Running> job;
+  };
+  RunnerEvents events;
+  std::mutex mutex;
+  std::condition_variable idle; // a job finished
+  std::map<std::string, Slot> slots;
+  uint64_t lastId = 0;
+};
+
+} // namespace jobs
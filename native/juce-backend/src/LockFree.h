@@ -0,0 +1,195 @@
+// Lock-free building blocks shared by the engine threads (audio callback,
+// high-resolution timer, command reader and the stdout writer).
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Bounded multi-producer / multi-consumer queue (Vyukov). Every cell carries a
+// sequence number so producers and consumers only ever CAS a shared index and
+// never wait on each other. Capacity is rounded up to a power of two.
+template <typename T>
+class BoundedMpmcQueue {
+public:
+  explicit BoundedMpmcQueue(size_t requestedCapacity) {
+    size_t cap = 2;
+    while (cap < requestedCapacity) cap <<= 1;
+    mask = cap - 1;
+    cells.reset(new Cell[cap]);
+    for (size_t i = 0; i < cap; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+  BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+  size_t capacity() const { return mask + 1; }
+
+  // Returns false (and leaves value untouched) when the queue is full.
+  bool tryPush(T& value) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells[pos & mask];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& out) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells[pos & mask];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+      if (diff == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    out = std::move(cell->value);
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued items; exact only when producers are quiet.
+  size_t approxSize() const {
+    const size_t enq = enqueuePos.load(std::memory_order_relaxed);
+    const size_t deq = dequeuePos.load(std::memory_order_relaxed);
+    return enq >= deq ? enq - deq : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    T value{};
+  };
+
+  static constexpr size_t kCacheLine = 64;
+  std::unique_ptr<Cell[]> cells;
+  size_t mask = 0;
+  alignas(kCacheLine) std::atomic<size_t> enqueuePos{0};
+  alignas(kCacheLine) std::atomic<size_t> dequeuePos{0};
+};
+
+// Monotonic maximum on an atomic without a lock.
+template <typename T>
+inline void atomicStoreMax(std::atomic<T>& target, T value) {
+  T current = target.load(std::memory_order_relaxed);
+  while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+// Single-writer / multi-reader slot for small trivially copyable snapshots.
+// The writer never waits; readers retry if they raced a write. Used to hand
+// audio-thread measurements to the timer thread without a lock.
+template <typename T>
+class SeqLockSlot {
+public:
+  void write(const T& value) {
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    data = value;
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence.store(seq + 2, std::memory_order_relaxed);
+  }
+
+  // Returns false if a consistent copy could not be taken after a few tries.
+  bool read(T& out) const {
+    for (int attempt = 0; attempt < 8; ++attempt) {
+      const uint32_t before = sequence.load(std::memory_order_acquire);
+      if (before & 1u) continue;
+      out = data;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+  }
+
+  uint32_t version() const { return sequence.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<uint32_t> sequence{0};
+  T data{};
+};
+
+// Hands immutable snapshots (gain maps, compiled timelines) from a control
+// thread to the audio thread. The audio thread only loads pointers and never
+// frees anything; the control thread retains every published snapshot and
+// releases one only after the reader's hazard slots show it is no longer in
+// use. There are two slots: the snapshot just acquired and the one acquired
+// before it, which the reader may still be leaving (e.g. a timeline it
+// crossfades from) when the new one arrives. Publishing is serialised by the
+// caller.
+template <typename T>
+class SnapshotExchange {
+public:
+  // Control thread. Passing nullptr withdraws the current snapshot.
+  void publish(std::shared_ptr<const T> snapshot) {
+    const T* raw = snapshot.get();
+    if (snapshot) retained.push_back(std::move(snapshot));
+    latest.store(raw, std::memory_order_seq_cst);
+    collect();
+  }
+
+  // Control thread: the most recently published snapshot.
+  std::shared_ptr<const T> current() const {
+    const T* raw = latest.load(std::memory_order_seq_cst);
+    for (auto it = retained.rbegin(); it != retained.rend(); ++it) {
+      if (it->get() == raw) return *it;
+    }
+    return nullptr;
+  }
+
+  // Audio thread: the snapshot to use for this block. It, and the snapshot
+  // the previous call returned, stay valid until the next acquire() call
+  // from the same thread.
+  const T* acquire() {
+    // Before the hazard moves on, so one of the two slots always covers it.
+    previous.store(hazard.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    const T* p = latest.load(std::memory_order_seq_cst);
+    for (;;) {
+      hazard.store(p, std::memory_order_seq_cst);
+      const T* again = latest.load(std::memory_order_seq_cst);
+      if (again == p) return p;
+      p = again;
+    }
+  }
+
+  // Control thread: drop snapshots that are neither current nor in use.
+  void collect() {
+    const T* keep = latest.load(std::memory_order_seq_cst);
+    // hazard before previous: acquire() writes them in the opposite order.
+    const T* inUse = hazard.load(std::memory_order_seq_cst);
+    const T* leaving = previous.load(std::memory_order_seq_cst);
+    size_t out = 0;
+    for (size_t i = 0; i < retained.size(); ++i) {
+      const T* p = retained[i].get();
+      if (p == keep || p == inUse || p == leaving) retained[out++] = std::move(retained[i]);
+    }
+    retained.resize(out);
+  }
+
+private:
+  std::atomic<const T*> latest{nullptr};
+  std::atomic<const T*> hazard{nullptr};
+  std::atomic<const T*> previous{nullptr};
+  std::vector<std::shared_ptr<const T>> retained;
+};
@@ -0,0 +1,337 @@
+// EBU R128 / ITU-R BS.1770-4 loudness analysis. The source is K-weighted and
+// reduced to 100 ms step powers (plus a per-step true peak) in parallel
+// chunks; momentary (400 ms), short-term (3 s) and gated integrated loudness
+// for the whole file or any set of original-time ranges are then derived from
+// the steps without touching the audio again.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "DspKernels.h"
+#include "SampleReader.h"
+
+namespace loudness {
+
+constexpr double kStepSec = 0.1;
+constexpr int kMomentarySteps = 4;   // 400 ms
+constexpr int kShortTermSteps = 30;  // 3 s
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kRelativeGateLu = -10.0;
+constexpr double kSilentLufs = -std::numeric_limits<double>::infinity();
+
+inline double powerToLufs(double power) {
+  return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : kSilentLufs;
+}
+
+inline double lufsToPower(double lufs) {
+  return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+// BS.1770 channel weights: 1.0 for L/R/C, 1.41 for surrounds; LFE ignored.
+inline double channelWeight(int channel, int channels) {
+  if (channels >= 6) {
+    if (channel == 3) return 0.0;
+    if (channel >= 4) return 1.41;
+  }
+  return 1.0;
+}
+
+// Two-stage K-weighting (high shelf + RLB high-pass), coefficients derived for
+// any sample rate from the analogue prototypes in BS.1770.
+class KWeighting {
+public:
+  explicit KWeighting(double sampleRate) {
+    const double pi = 3.14159265358979323846;
+    {
+      const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+      const double k = std::tan(pi * f0 / sampleRate);
+      const double vh = std::pow(10.0, gainDb / 20.0);
+      const double vb = std::pow(vh, 0.4996667741545416);
+      const double a0 = 1.0 + k / q + k * k;
+      shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+    }
+    {
+      const double f0 = 38.13547087602444, q = 0.5003270373238773;
+      const double k = std::tan(pi * f0 / sampleRate);
+      const double a0 = 1.0 + k / q + k * k;
+      highPass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+    }
+  }
+
+  // Filters x in place into out and returns the sum of squares of the output.
+  double process(const float* x, float* out, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+      const double y = highPass.tick(shelf.tick(x[i]));
+      out[i] = (float) y;
+      sum += y * y;
+    }
+    return sum;
+  }
+
+private:
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+    double z1 = 0.0, z2 = 0.0;
+    double tick(double x) {
+      const double y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      return y;
+    }
+  };
+  Biquad shelf{};
+  Biquad highPass{};
+};
+
+// Step-level reduction of a whole source. Everything else is derived from it.
+struct Analysis {
+  double sampleRate = 0.0;
+  double durationSec = 0.0;
+  int channels = 0;
+  std::vector<double> stepPower;    // channel-weighted mean square per 100 ms step
+  std::vector<float> stepTruePeak;  // linear, loudest channel
+  double elapsedMs = 0.0;
+  int threads = 0;
+
+  size_t bytes() const { return stepPower.size() * sizeof(double) + stepTruePeak.size() * sizeof(float); }
+};
+
+struct Summary {
+  double integratedLufs = kSilentLufs;
+  double momentaryMaxLufs = kSilentLufs;
+  double shortTermMaxLufs = kSilentLufs;
+  double truePeakDbtp = -120.0;
+  double durationSec = 0.0;
+};
+
+using StepRun = std::pair<size_t, size_t>; // [first, last) step indices
+
+inline std::shared_ptr<Analysis> analyse(const SampleReaderFactory& factory, int threads,
+                                         const std::atomic<bool>* cancel = nullptr) {
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0 || probe->numChannels() <= 0) return nullptr;
+
+  auto result = std::make_shared<Analysis>();
+  result->sampleRate = probe->sampleRate();
+  result->channels = probe->numChannels();
+  const int64_t length = probe->lengthInSamples();
+  result->durationSec = (double) length / result->sampleRate;
+  probe.reset();
+
+  const int stepSamples = std::max(1, (int) std::lround(kStepSec * result->sampleRate));
+  const size_t totalSteps = (size_t) ((length + stepSamples - 1) / stepSamples);
+  result->stepPower.assign(totalSteps, 0.0);
+  result->stepTruePeak.assign(totalSteps, 0.0f);
+
+  constexpr size_t kStepsPerChunk = 600; // 60 s of audio per work item
+  const int warmupSamples = (int) std::lround(0.5 * result->sampleRate);
+  const size_t numChunks = (totalSteps + kStepsPerChunk - 1) / kStepsPerChunk;
+  result->threads = analysisThreadCount(threads);
+  const int channels = result->channels;
+
+  const bool ok = runChunksInParallel(factory, numChunks, result->threads,
+    [&](size_t chunk, SampleReader& reader) {
+      std::vector<KWeighting> filters((size_t) channels, KWeighting(result->sampleRate));
+      std::vector<dsp::TruePeakDetector> peaks((size_t) channels);
+      std::vector<std::vector<float>> in((size_t) channels, std::vector<float>((size_t) std::max(stepSamples, warmupSamples)));
+      std::vector<float> scratch((size_t) std::max(stepSamples, warmupSamples));
+      std::vector<float*> ptrs((size_t) channels);
+      for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = in[(size_t) ch].data();
+
+      const size_t firstStep = chunk * kStepsPerChunk;
+      const size_t lastStep = std::min(totalSteps, firstStep + kStepsPerChunk);
+      const int64_t chunkStart = (int64_t) firstStep * stepSamples;
+
+      // Let the filters and the true-peak history settle on audio preceding the chunk.
+      if (chunkStart > 0) {
+        const int warm = (int) std::min<int64_t>(warmupSamples, chunkStart);
+        if (!reader.read(ptrs.data(), channels, chunkStart - warm, warm)) return false;
+        for (int ch = 0; ch < channels; ++ch) {
+          filters[(size_t) ch].process(ptrs[(size_t) ch], scratch.data(), warm);
+          peaks[(size_t) ch].process(ptrs[(size_t) ch], warm);
+        }
+      }
+
+      for (size_t step = firstStep; step < lastStep; ++step) {
+        const int64_t start = (int64_t) step * stepSamples;
+        const int n = (int) std::min<int64_t>(stepSamples, length - start);
+        if (n <= 0) break;
+        if (!reader.read(ptrs.data(), channels, start, n)) return false;
+        double power = 0.0;
+        float truePeak = 0.0f;
+        for (int ch = 0; ch < channels; ++ch) {
+          const double ms = filters[(size_t) ch].process(ptrs[(size_t) ch], scratch.data(), n) / n;
+          power += channelWeight(ch, channels) * ms;
+          // Near-silent steps cannot carry an inter-sample peak worth measuring.
+          const float samplePeak = dsp::peakAbs(ptrs[(size_t) ch], n);
+          const float tp = samplePeak > 1e-4f ? peaks[(size_t) ch].process(ptrs[(size_t) ch], n) : samplePeak;
+          if (samplePeak <= 1e-4f) peaks[(size_t) ch].reset();
+          truePeak = std::max(truePeak, std::max(tp, samplePeak));
+        }
+        result->stepPower[step] = power;
+        result->stepTruePeak[step] = truePeak;
+      }
+      return true;
+    }, cancel);
+  if (!ok) return nullptr;
+
+  result->elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return result;
+}
+
+// Steps whose centre lies inside any of the given original-time ranges,
+// merged into sorted runs.
+inline std::vector<StepRun> stepRunsFor(const Analysis& analysis,
+                                        std::vector<std::pair<double, double>> ranges) {
+  std::vector<StepRun> runs;
+  const size_t total = analysis.stepPower.size();
+  std::sort(ranges.begin(), ranges.end());
+  for (const auto& r : ranges) {
+    if (!(r.second > r.first)) continue;
+    const double a = std::ceil(r.first / kStepSec - 0.5);
+    const double b = std::ceil(r.second / kStepSec - 0.5);
+    size_t first = (size_t) std::max(0.0, a);
+    size_t last = (size_t) std::min((double) total, std::max(0.0, b));
+    if (last <= first) continue;
+    if (!runs.empty() && first <= runs.back().second) {
+      runs.back().second = std::max(runs.back().second, last);
+    } else {
+      runs.emplace_back(first, last);
+    }
+  }
+  return runs;
+}
+
+inline std::vector<StepRun> wholeSource(const Analysis& analysis) {
+  return { StepRun(0, analysis.stepPower.size()) };
+}
+
+inline double windowPower(const Analysis& analysis, size_t first, int steps) {
+  double sum = 0.0;
+  for (int i = 0; i < steps; ++i) sum += analysis.stepPower[first + (size_t) i];
+  return sum / steps;
+}
+
+inline Summary summarise(const Analysis& analysis, const std::vector<StepRun>& runs) {
+  Summary summary;
+  std::vector<double> blocks;
+  double ungatedSum = 0.0;
+  size_t ungatedCount = 0;
+  float truePeak = 0.0f;
+  for (const auto& run : runs) {
+    summary.durationSec += (double) (run.second - run.first) * kStepSec;
+    for (size_t s = run.first; s < run.second; ++s) {
+      truePeak = std::max(truePeak, analysis.stepTruePeak[s]);
+      ungatedSum += analysis.stepPower[s];
+      ungatedCount++;
+    }
+    for (size_t s = run.first; s + kMomentarySteps <= run.second; ++s) {
+      const double power = windowPower(analysis, s, kMomentarySteps);
+      blocks.push_back(power);
+      summary.momentaryMaxLufs = std::max(summary.momentaryMaxLufs, powerToLufs(power));
+    }
+    for (size_t s = run.first; s + kShortTermSteps <= run.second; ++s) {
+      summary.shortTermMaxLufs = std::max(summary.shortTermMaxLufs, powerToLufs(windowPower(analysis, s, kShortTermSteps)));
+    }
+  }
+  summary.truePeakDbtp = dsp::gainToDb(truePeak);
+
+  if (blocks.empty()) {
+    // Shorter than one 400 ms block: report the ungated level instead.
+    if (ungatedCount > 0) summary.integratedLufs = powerToLufs(ungatedSum / (double) ungatedCount);
+    return summary;
+  }
+
+  const double absoluteGate = lufsToPower(kAbsoluteGateLufs);
+  double sum = 0.0;
+  size_t count = 0;
+  for (double p : blocks) if (p > absoluteGate) { sum += p; count++; }
+  if (count == 0) return summary;
+  const double relativeGate = lufsToPower(powerToLufs(sum / (double) count) + kRelativeGateLu);
+  sum = 0.0;
+  count = 0;
+  for (double p : blocks) if (p > absoluteGate && p > relativeGate) { sum += p; count++; }
+  if (count > 0) summary.integratedLufs = powerToLufs(sum / (double) count);
+  return summary;
+}
+
+// Momentary or short-term loudness sampled every hopSteps steps.
+inline std::vector<double> curve(const Analysis& analysis, int windowSteps, size_t hopSteps) {
+  std::vector<double> values;
+  const size_t total = analysis.stepPower.size();
+  hopSteps = std::max<size_t>(1, hopSteps);
+  for (size_t s = 0; s + (size_t) windowSteps <= total; s += hopSteps) {
+    values.push_back(powerToLufs(windowPower(analysis, s, windowSteps)));
+  }
+  return values;
+}
+
+// Gain that brings `summary` to targetLufs, limited so the true peak stays
+// under ceilingDbtp and the boost/cut stays within maxGainDb.
+inline double normalisationGainDb(const Summary& summary, double targetLufs, double ceilingDbtp, double maxGainDb = 20.0) {
+  if (!std::isfinite(summary.integratedLufs)) return 0.0;
+  double gainDb = std::clamp(targetLufs - summary.integratedLufs, -maxGainDb, maxGainDb);
+  if (summary.truePeakDbtp + gainDb > ceilingDbtp) gainDb = ceilingDbtp - summary.truePeakDbtp;
+  return gainDb;
+}
+
+// Identity of a file on disk: path, size and modification time.
+inline std::string fileIdentity(const std::string& path) {
+  struct stat info {};
+  if (::stat(path.c_str(), &info) != 0) return {};
+  return path + "|" + std::to_string((long long) info.st_size) + "|" + std::to_string((long long) info.st_mtime);
+}
+
+// Process-wide cache of step analyses keyed by source (a content
+// fingerprint), so repeated analyses, normalised playback and exports never
+// rescan the same audio.
+class Cache {
+public:
+  std::shared_ptr<const Analysis> find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) { misses++; return nullptr; }
+    hits++;
+    return it->second;
+  }
+
+  void store(const std::string& key, std::shared_ptr<const Analysis> analysis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.size() >= kMaxEntries) entries.erase(entries.begin());
+    entries[key] = std::move(analysis);
+  }
+
+  size_t bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (const auto& e : entries) total += e.second->bytes();
+    return total;
+  }
+
+  uint64_t hitCount() const { return hits.load(); }
+  uint64_t missCount() const { return misses.load(); }
+
+private:
+  static constexpr size_t kMaxEntries = 16;
+  std::mutex mutex;
+  std::map<std::string, std::shared_ptr<const Analysis>> entries;
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+} // namespace loudness
@@ -0,0 +1,152 @@
+// Read-only view of a payload handed over in a file: a temp file, a file on a
+// tmpfs such as /dev/shm, or an anonymous memfd passed by path
+// (/proc/<pid>/fd/N) or by inherited descriptor. Regular files are mapped
+// and parsed in place, so the bytes are never copied; pipes, and platforms
+// without mmap, are read into memory once. copiedBytes() says which.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { release(); }
+
+  // False, with error set, when path cannot be opened or read.
+  bool open(const std::string& path, std::string& error) {
+    release();
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good()) {
+      error = "cannot open " + path;
+      return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+    copied = size;
+    trimPadding();
+    return true;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      error = "cannot open " + path + ": " + std::strerror(errno);
+      return false;
+    }
+    return adopt(fd, error);
+#endif
+  }
+
+#if !defined(_WIN32)
+  // Maps an open descriptor and takes ownership of it: it is closed before
+  // this returns, whatever the outcome. The mapping outlives it.
+  bool adopt(int fd, std::string& error) {
+    release();
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      error = std::string("cannot stat descriptor: ") + std::strerror(errno);
+      ::close(fd);
+      return false;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+      void* p = ::mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        ::posix_madvise(p, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+        mapping = p;
+        mappedLength = (size_t) st.st_size;
+        data = static_cast<const char*>(p);
+        size = mappedLength;
+        ::close(fd);
+        trimPadding();
+        return true;
+      }
+    }
+    // Empty, unmappable or not a regular file (a pipe): read it once.
+    char chunk[65536];
+    for (;;) {
+      const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+      if (n > 0) {
+        buffer.append(chunk, (size_t) n);
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) {
+        error = std::string("cannot read descriptor: ") + std::strerror(errno);
+        ::close(fd);
+        buffer.clear();
+        return false;
+      }
+      break;
+    }
+    ::close(fd);
+    data = buffer.data();
+    size = buffer.size();
+    copied = size;
+    trimPadding();
+    return true;
+  }
+
+  // Maps a descriptor that stays open for its owner. Regular files only, so
+  // a pipe is never drained.
+  bool peek(int fd, std::string& error) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      error = "descriptor is not a regular file";
+      return false;
+    }
+    const int copy = ::dup(fd);
+    if (copy < 0) {
+      error = std::string("cannot duplicate descriptor: ") + std::strerror(errno);
+      return false;
+    }
+    return adopt(copy, error);
+  }
+#endif
+
+  std::string_view view() const { return { data, size }; }
+  bool mapped() const { return mapping != nullptr; }
+  // Payload bytes copied to produce view(): 0 when mapped.
+  size_t copiedBytes() const { return copied; }
+
+private:
+  // A shared-memory region sized up to a page boundary ends in zeros.
+  void trimPadding() {
+    while (size > 0 && data[size - 1] == '\0') --size;
+  }
+
+  void release() {
+#if !defined(_WIN32)
+    if (mapping) ::munmap(mapping, mappedLength);
+#endif
+    mapping = nullptr;
+    mappedLength = 0;
+    buffer.clear();
+    buffer.shrink_to_fit();
+    data = nullptr;
+    size = 0;
+    copied = 0;
+  }
+
+  void* mapping = nullptr;
+  size_t mappedLength = 0;
+  std::string buffer; // when not mapped
+  const char* data = nullptr;
+  size_t size = 0;
+  size_t copied = 0;
+};
@@ -0,0 +1,267 @@
+// Runtime metrics that stay on in production: callback and command timing
+// histograms, xrun counters and memory gauges. Every hot-path update is a
+// relaxed atomic add or store, so the audio thread can record one sample per
+// callback without locks or allocation; readers take approximate snapshots.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace metrics {
+
+struct HistogramSnapshot {
+  uint64_t count = 0;
+  double meanUs = 0.0;
+  double p50Us = 0.0;
+  double p90Us = 0.0;
+  double p99Us = 0.0;
+  double p999Us = 0.0;
+  double maxUs = 0.0;
+};
+
+// Log-linear histogram of microsecond durations: exact below 16 us, then
+// eight buckets per octave (about 9% resolution) up to ~35 minutes.
+class LatencyHistogram {
+public:
+  static constexpr int kLinear = 16;
+  static constexpr int kSubBuckets = 8;
+  static constexpr int kOctaves = 28;
+  static constexpr int kBuckets = kLinear + kOctaves * kSubBuckets;
+
+  void record(uint64_t us) {
+    buckets[(size_t) bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumUs.fetch_add(us, std::memory_order_relaxed);
+    uint64_t seen = maxSeen.load(std::memory_order_relaxed);
+    while (us > seen && !maxSeen.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {}
+  }
+
+  template <typename Duration>
+  void record(Duration d) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    record((uint64_t) std::max<int64_t>(0, (int64_t) us));
+  }
+
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+  HistogramSnapshot snapshot() const {
+    HistogramSnapshot s;
+    std::array<uint64_t, kBuckets> counts;
+    uint64_t n = 0;
+    for (int i = 0; i < kBuckets; ++i) n += counts[(size_t) i] = buckets[(size_t) i].load(std::memory_order_relaxed);
+    s.count = n;
+    if (n == 0) return s;
+    s.meanUs = (double) sumUs.load(std::memory_order_relaxed) / (double) n;
+    s.maxUs = (double) maxSeen.load(std::memory_order_relaxed);
+    auto quantile = [&](double q) {
+      const uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(q * (double) n));
+      uint64_t seen = 0;
+      for (int i = 0; i < kBuckets; ++i) {
+        seen += counts[(size_t) i];
+        if (seen >= rank) return std::min(bucketMidpoint(i), s.maxUs);
+      }
+      return s.maxUs;
+    };
+    s.p50Us = quantile(0.50);
+    s.p90Us = quantile(0.90);
+    s.p99Us = quantile(0.99);
+    s.p999Us = quantile(0.999);
+    return s;
+  }
+
+  // Not atomic with respect to concurrent record(); a sample racing a reset
+  // may land on either side.
+  void reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    sumUs.store(0, std::memory_order_relaxed);
+    maxSeen.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  static int bucketFor(uint64_t us) {
+    if (us < (uint64_t) kLinear) return (int) us;
+    int octave = 63;
+    while (!(us >> octave)) --octave; // octave >= 4
+    if (octave >= 4 + kOctaves) return kBuckets - 1;
+    const int sub = (int) ((us >> (octave - 3)) & (kSubBuckets - 1));
+    return kLinear + (octave - 4) * kSubBuckets + sub;
+  }
+
+  static double bucketMidpoint(int i) {
+    if (i < kLinear) return (double) i;
+    const int octave = 4 + (i - kLinear) / kSubBuckets;
+    const int sub = (i - kLinear) % kSubBuckets;
+    const double width = std::ldexp(1.0, octave - 3);
+    return std::ldexp(1.0, octave) + (sub + 0.5) * width;
+  }
+
+  std::array<std::atomic<uint64_t>, kBuckets> buckets {};
+  std::atomic<uint64_t> total { 0 };
+  std::atomic<uint64_t> sumUs { 0 };
+  std::atomic<uint64_t> maxSeen { 0 };
+};
+
+// Per-command latency, keyed by the command's "type". Slots are claimed by
+// the command thread only (the single writer) and published with a release
+// store, so any thread can walk them without a lock.
+class CommandLatencies {
+public:
+  static constexpr size_t kSlots = 96;
+  static constexpr size_t kNameLength = 31;
+
+  LatencyHistogram* forType(const char* type, size_t length) {
+    length = std::min(length, kNameLength);
+    const size_t n = used.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) {
+      if (std::strlen(slots[i].name) == length && std::memcmp(slots[i].name, type, length) == 0) return &slots[i].histogram;
+    }
+    if (n == kSlots) return &slots[kSlots - 1].histogram; // shared overflow slot
+    std::memcpy(slots[n].name, type, length);
+    slots[n].name[length] = '\0';
+    used.store(n + 1, std::memory_order_release);
+    return &slots[n].histogram;
+  }
+
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    const size_t n = used.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) fn(slots[i].name, slots[i].histogram);
+  }
+
+  void reset() {
+    const size_t n = used.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) slots[i].histogram.reset();
+  }
+
+private:
+  struct Slot {
+    char name[kNameLength + 1] = {};
+    LatencyHistogram histogram;
+  };
+  std::array<Slot, kSlots> slots;
+  std::atomic<size_t> used { 0 };
+};
+
+struct Registry {
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+  // Audio device callback.
+  LatencyHistogram callbackUs;
+  std::atomic<uint64_t> callbackBudgetUs { 0 }; // duration of the last block at the device rate
+  std::atomic<uint64_t> overBudget { 0 };       // callbacks that took longer than their block
+  std::atomic<uint64_t> callbackGaps { 0 };     // callbacks that started over two blocks late
+  std::atomic<int64_t> deviceXruns { -1 };      // as reported by the device, -1 if unsupported
+
+  LatencyHistogram timerTickUs;
+  CommandLatencies commands;
+
+  // Command lanes: time from reading a command to starting it.
+  LatencyHistogram controlQueueUs;
+  LatencyHistogram workQueueUs;
+  std::atomic<uint64_t> workDepth { 0 };     // queued or running on the work lane
+  std::atomic<uint64_t> workHighWater { 0 };
+
+  // EDL ingest.
+  LatencyHistogram edlParseUs;
+  LatencyHistogram edlCompileUs;
+  std::atomic<uint64_t> edlPayloadBytes { 0 };
+  std::atomic<uint64_t> edlCopiedBytes { 0 }; // payload bytes copied on the way to the parser
+  std::atomic<uint64_t> edlSegments { 0 };
+
+  // Memory held by subsystems, updated when they change.
+  std::atomic<uint64_t> prerollBytes { 0 };
+  std::atomic<uint64_t> edlBytes { 0 };
+  std::atomic<uint64_t> revisionCacheBytes { 0 };
+
+  void reset() {
+    callbackUs.reset();
+    overBudget.store(0, std::memory_order_relaxed);
+    callbackGaps.store(0, std::memory_order_relaxed);
+    timerTickUs.reset();
+    commands.reset();
+    controlQueueUs.reset();
+    workQueueUs.reset();
+    workHighWater.store(workDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    edlParseUs.reset();
+    edlCompileUs.reset();
+  }
+};
+
+// Times one audio callback against its block duration. Audio thread only.
+class CallbackTimer {
+public:
+  CallbackTimer(Registry& r, int numSamples, double sampleRate)
+      : registry(r), start(std::chrono::steady_clock::now()),
+        budgetUs(sampleRate > 0.0 ? (uint64_t) (numSamples * 1e6 / sampleRate) : 0) {}
+
+  ~CallbackTimer() {
+    const auto end = std::chrono::steady_clock::now();
+    const uint64_t us = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    registry.callbackUs.record(us);
+    registry.callbackBudgetUs.store(budgetUs, std::memory_order_relaxed);
+    if (budgetUs > 0 && us > budgetUs) registry.overBudget.fetch_add(1, std::memory_order_relaxed);
+    // A late start means the device waited on us or dropped a period. Long
+    // pauses (device restart) are not counted.
+    static thread_local std::chrono::steady_clock::time_point lastStart;
+    if (budgetUs > 0 && lastStart.time_since_epoch().count() != 0) {
+      const auto interval = std::chrono::duration_cast<std::chrono::microseconds>(start - lastStart).count();
+      if (interval > (int64_t) (2 * budgetUs) && interval < 1000000) registry.callbackGaps.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastStart = start;
+  }
+
+private:
+  Registry& registry;
+  const std::chrono::steady_clock::time_point start;
+  const uint64_t budgetUs;
+};
+
+// Records the lifetime of a scope into a histogram.
+class ScopeTimer {
+public:
+  explicit ScopeTimer(LatencyHistogram* h) : histogram(h), start(std::chrono::steady_clock::now()) {}
+  ~ScopeTimer() {
+    if (histogram) histogram->record(std::chrono::steady_clock::now() - start);
+  }
+
+private:
+  LatencyHistogram* histogram;
+  const std::chrono::steady_clock::time_point start;
+};
+
+// Resident set size of the process, or 0 where it cannot be read.
+inline uint64_t residentBytes() {
+#if defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS) {
+    return (uint64_t) info.resident_size;
+  }
+  return 0;
+#elif defined(__linux__)
+  unsigned long long pages = 0, resident = 0;
+  FILE* f = std::fopen("/proc/self/statm", "r");
+  if (!f) return 0;
+  const int read = std::fscanf(f, "%llu %llu", &pages, &resident);
+  std::fclose(f);
+  return read == 2 ? (uint64_t) resident * (uint64_t) sysconf(_SC_PAGESIZE) : 0;
+#else
+  return 0;
+#endif
+}
+
+} // namespace metrics
@@ -0,0 +1,123 @@
+// Waveform overview: the minimum and maximum sample of the source, all
+// channels folded together, at a ladder of resolutions. Level 0 has one
+// bucket per kBaseSamples frames; each level above folds kFanout buckets of
+// the one below, up to the first level with a single bucket. Values are
+// int16 (full scale 32767), stored min then max for each bucket, so a level
+// can be drawn straight from a mapped file.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DspKernels.h"
+#include "SampleReader.h"
+
+namespace peaks {
+
+constexpr int kBaseSamples = 256;
+constexpr int kFanout = 4;
+constexpr size_t kChunkBuckets = 4096;  // level-0 buckets per parallel chunk
+constexpr int kBlockBuckets = 64;       // buckets read at a time
+
+struct Level {
+  int64_t samplesPerBucket = 0;
+  std::vector<int16_t> minMax;  // [min, max] per bucket
+
+  size_t buckets() const { return minMax.size() / 2; }
+};
+
+struct Pyramid {
+  double sampleRate = 0.0;
+  int64_t lengthInSamples = 0;
+  int channels = 0;
+  std::vector<Level> levels;
+  double elapsedMs = 0.0;
+  int threads = 0;
+
+  size_t bytes() const {
+    size_t total = 0;
+    for (const auto& level : levels) total += level.minMax.size() * sizeof(int16_t);
+    return total;
+  }
+};
+
+inline int16_t toPeak(float v) {
+  return (int16_t) std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+// Level 0 from the audio in parallel chunks; the coarser levels from it.
+inline std::shared_ptr<const Pyramid> build(const SampleReaderFactory& factory,
+                                            int threads,
+                                            const std::atomic<bool>* cancel = nullptr) {
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0 || probe->numChannels() <= 0) return nullptr;
+  auto pyramid = std::make_shared<Pyramid>();
+  pyramid->sampleRate = probe->sampleRate();
+  pyramid->lengthInSamples = std::max<int64_t>(0, probe->lengthInSamples());
+  pyramid->channels = probe->numChannels();
+  probe.reset();
+
+  const size_t buckets = std::max<size_t>(1, (size_t) ((pyramid->lengthInSamples + kBaseSamples - 1) / kBaseSamples));
+  Level base;
+  base.samplesPerBucket = kBaseSamples;
+  base.minMax.assign(buckets * 2, 0);
+  const int channels = pyramid->channels;
+  const int64_t length = pyramid->lengthInSamples;
+  const size_t chunks = (buckets + kChunkBuckets - 1) / kChunkBuckets;
+  pyramid->threads = analysisThreadCount(threads);
+  const bool ok = runChunksInParallel(factory, chunks, pyramid->threads, [&](size_t chunk, SampleReader& reader) {
+    thread_local std::vector<float> block;
+    thread_local std::vector<float*> ptrs;
+    block.resize((size_t) channels * kBlockBuckets * kBaseSamples);
+    ptrs.resize((size_t) channels);
+    for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = block.data() + (size_t) ch * kBlockBuckets * kBaseSamples;
+    const size_t first = chunk * kChunkBuckets;
+    const size_t last = std::min(buckets, first + kChunkBuckets);
+    for (size_t b = first; b < last; b += kBlockBuckets) {
+      const int count = (int) std::min<size_t>(kBlockBuckets, last - b);
+      const int64_t start = (int64_t) b * kBaseSamples;
+      const int frames = (int) std::min<int64_t>((int64_t) count * kBaseSamples, std::max<int64_t>(0, length - start));
+      if (frames > 0 && !reader.read(ptrs.data(), channels, start, frames)) return false;
+      for (int k = 0; k < count; ++k) {
+        const int offset = k * kBaseSamples;
+        const int n = std::clamp(frames - offset, 0, kBaseSamples);
+        float lo = 0.0f, hi = 0.0f;
+        for (int ch = 0; ch < channels && n > 0; ++ch) dsp::minMax(ptrs[(size_t) ch] + offset, n, lo, hi);
+        base.minMax[(b + (size_t) k) * 2] = toPeak(lo);
+        base.minMax[(b + (size_t) k) * 2 + 1] = toPeak(hi);
+      }
+    }
+    return true;
+  }, cancel);
+  if (!ok) return nullptr;
+
+  pyramid->levels.push_back(std::move(base));
+  while (pyramid->levels.back().buckets() > 1) {
+    const Level& below = pyramid->levels.back();
+    Level level;
+    level.samplesPerBucket = below.samplesPerBucket * kFanout;
+    const size_t n = (below.buckets() + kFanout - 1) / kFanout;
+    level.minMax.resize(n * 2);
+    for (size_t i = 0; i < n; ++i) {
+      int16_t lo = below.minMax[i * kFanout * 2];
+      int16_t hi = below.minMax[i * kFanout * 2 + 1];
+      for (size_t j = i * kFanout + 1; j < std::min(below.buckets(), (i + 1) * kFanout); ++j) {
+        lo = std::min(lo, below.minMax[j * 2]);
+        hi = std::max(hi, below.minMax[j * 2 + 1]);
+      }
+      level.minMax[i * 2] = lo;
+      level.minMax[i * 2 + 1] = hi;
+    }
+    pyramid->levels.push_back(std::move(level));
+  }
+  pyramid->elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return pyramid;
+}
+
+} // namespace peaks
@@ -0,0 +1,97 @@
+// In-memory copies of the first ~150 ms after every clip and word start of
+// the current EDL, so seek + play to a word starts without a cold read. A set
+// is built off the audio thread after each EDL change and never modified
+// afterwards; overlapping starts are merged into one region.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SampleReader.h"
+
+struct PrerollRegion {
+  int64_t start = 0;   // original-file sample
+  int length = 0;      // frames
+  size_t offset = 0;   // into PrerollSet::samples; channel c at offset + c * length
+};
+
+struct PrerollSet {
+  int channels = 0;
+  std::vector<PrerollRegion> regions; // sorted by start, non-overlapping
+  std::vector<float> samples;
+  size_t requestedStarts = 0;
+  size_t cachedStarts = 0;            // may be lower than requested when the budget ran out
+  double fillMs = 0.0;
+
+  size_t bytes() const { return samples.size() * sizeof(float) + regions.size() * sizeof(PrerollRegion); }
+
+  // Region containing pos, or nullptr.
+  const PrerollRegion* find(int64_t pos) const {
+    const auto it = std::upper_bound(regions.begin(), regions.end(), pos,
+                                     [](int64_t value, const PrerollRegion& r) { return value < r.start; });
+    if (it == regions.begin()) return nullptr;
+    const PrerollRegion& r = *(it - 1);
+    return pos < r.start + r.length ? &r : nullptr;
+  }
+
+  const float* channel(const PrerollRegion& r, int ch) const {
+    return samples.data() + r.offset + (size_t) std::min(ch, channels - 1) * (size_t) r.length;
+  }
+};
+
+// Reads `length` frames at each start (priority order: earlier entries are
+// kept when maxBytes runs out). Returns nullptr if the source cannot be read
+// or the build was cancelled.
+inline std::shared_ptr<PrerollSet> buildPrerollSet(const SampleReaderFactory& factory,
+                                                   std::vector<int64_t> starts,
+                                                   int length,
+                                                   size_t maxBytes,
+                                                   const std::atomic<bool>& cancel) {
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> reader = factory();
+  if (!reader || length <= 0) return nullptr;
+  auto set = std::make_shared<PrerollSet>();
+  set->channels = std::max(1, reader->numChannels());
+  set->requestedStarts = starts.size();
+
+  // Trim to the budget in priority order, then merge in file order.
+  const size_t bytesPerStart = (size_t) length * (size_t) set->channels * sizeof(float);
+  const size_t budgetStarts = bytesPerStart ? maxBytes / bytesPerStart : 0;
+  if (starts.size() > budgetStarts) starts.resize(budgetStarts);
+  set->cachedStarts = starts.size();
+  std::sort(starts.begin(), starts.end());
+  starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+  std::vector<std::pair<int64_t, int64_t>> spans;
+  for (int64_t s : starts) {
+    const int64_t start = std::max<int64_t>(0, s);
+    const int64_t end = std::min(reader->lengthInSamples(), start + length);
+    if (end <= start) continue;
+    if (!spans.empty() && start <= spans.back().second) spans.back().second = std::max(spans.back().second, end);
+    else spans.emplace_back(start, end);
+  }
+
+  size_t total = 0;
+  for (const auto& span : spans) total += (size_t) (span.second - span.first) * (size_t) set->channels;
+  set->samples.resize(total);
+  set->regions.reserve(spans.size());
+  std::vector<float*> dest((size_t) set->channels);
+  size_t offset = 0;
+  for (const auto& span : spans) {
+    if (cancel.load()) return nullptr;
+    PrerollRegion region;
+    region.start = span.first;
+    region.length = (int) (span.second - span.first);
+    region.offset = offset;
+    for (int ch = 0; ch < set->channels; ++ch) dest[(size_t) ch] = set->samples.data() + offset + (size_t) ch * (size_t) region.length;
+    if (!reader->read(dest.data(), set->channels, region.start, region.length)) return nullptr;
+    set->regions.push_back(region);
+    offset += (size_t) region.length * (size_t) set->channels;
+  }
+  set->fillMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  return set;
+}
@@ -0,0 +1,192 @@
+// Band-limited polyphase resampler for the playback path: one stage takes the
+// file's rate to the device's and applies the playback rate at the same time,
+// for any number of channels.
+//
+// The filter is a Kaiser-windowed sinc tabulated at kPhases fractional
+// offsets; an output sample interpolates between the two nearest phases, so
+// any ratio works, including ones that change from block to block. When
+// downsampling (ratio > 1, i.e. more input consumed than output produced) the
+// cutoff moves down with the output Nyquist and the filter grows to keep the
+// same transition band, up to kMaxTaps. Dot products are written with
+// independent lane accumulators, like DspKernels.h, so they vectorise
+// without intrinsics.
+//
+// Latency is a constant kMaxTaps / 2 input samples whatever the filter, so
+// changing the rate never shifts the output in time. At a ratio of exactly 1
+// with no fractional offset the output is the input delayed, bit for bit.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "DspKernels.h"
+
+namespace dsp {
+
+struct ResamplerQuality {
+  int taps;        // filter length at ratios up to 1, multiple of kLanes
+  double passband; // cutoff as a fraction of the lower of the two Nyquists
+  double beta;     // Kaiser window shape: higher = deeper stopband, wider transition
+};
+
+// Stopband figures are what bench/ResamplerBench.cpp measures for aliasing.
+constexpr ResamplerQuality kDraftResampling{ 16, 0.80, 6.0 };    // ~ -65 dB
+constexpr ResamplerQuality kStandardResampling{ 64, 0.91, 9.0 }; // ~ -100 dB; playback default
+constexpr ResamplerQuality kHighResampling{ 128, 0.95, 11.0 };   // ~ -115 dB
+
+// Immutable once built; shared with the audio thread by pointer.
+struct PolyphaseFilter {
+  static constexpr int kPhases = 256;
+  int taps = 0;
+  double cutoff = 1.0; // of the input Nyquist
+  std::vector<float> coeffs; // [kPhases + 1][taps]; the extra row is phase 0 shifted one sample
+
+  const float* phase(int p) const { return coeffs.data() + (size_t) p * (size_t) taps; }
+};
+
+namespace detail {
+
+// Zeroth-order modified Bessel function of the first kind (power series).
+inline double besselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  const double q = x * x / 4.0;
+  for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+    term *= q / ((double) k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+} // namespace detail
+
+// Control thread: allocates and evaluates (kPhases + 1) * taps coefficients.
+// Tap k of phase p weighs the input sample at distance k + 1 - p / kPhases -
+// taps / 2 from the output instant; each phase is normalised to unity gain
+// at DC so the level does not ripple with the fractional position.
+inline std::shared_ptr<const PolyphaseFilter> designPolyphaseFilter(int taps, double cutoff, double beta) {
+  const double pi = 3.14159265358979323846;
+  auto filter = std::make_shared<PolyphaseFilter>();
+  filter->taps = std::max(kLanes, (taps + kLanes - 1) / kLanes * kLanes);
+  filter->cutoff = std::clamp(cutoff, 0.01, 1.0);
+  const int n = filter->taps;
+  const double half = n / 2.0;
+  const double norm = detail::besselI0(beta);
+  filter->coeffs.resize((size_t) (PolyphaseFilter::kPhases + 1) * (size_t) n);
+  for (int p = 0; p <= PolyphaseFilter::kPhases; ++p) {
+    const double frac = (double) p / PolyphaseFilter::kPhases;
+    float* row = filter->coeffs.data() + (size_t) p * (size_t) n;
+    double sum = 0.0;
+    for (int k = 0; k < n; ++k) {
+      const double d = k + 1 - frac - half;
+      const double x = filter->cutoff * d;
+      const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(pi * x) / (pi * x);
+      const double r = d / half;
+      const double window = std::fabs(r) >= 1.0 ? 0.0 : detail::besselI0(beta * std::sqrt(1.0 - r * r)) / norm;
+      const double h = filter->cutoff * sinc * window;
+      row[k] = (float) h;
+      sum += h;
+    }
+    if (sum != 0.0) {
+      for (int k = 0; k < n; ++k) row[k] = (float) (row[k] / sum);
+    }
+  }
+  return filter;
+}
+
+// Streaming state: per-channel history plus the fractional read position.
+// prepare() allocates; everything else is safe on the audio thread.
+class PolyphaseResampler {
+public:
+  static constexpr int kMaxTaps = 128;
+  static constexpr int kLatency = kMaxTaps / 2; // input samples
+
+  // Taps and cutoff for a ratio (input samples per output sample). Ratios
+  // above 1 are rounded up to the next 1/8 so a rate slider does not design
+  // a new filter for every value it passes through.
+  static void filterShape(const ResamplerQuality& quality, double ratio, int& taps, double& cutoff) {
+    const double down = ratio > 1.0 ? std::ceil(ratio * 8.0) / 8.0 : 1.0;
+    cutoff = quality.passband / down;
+    taps = std::min(kMaxTaps, (int) std::ceil(quality.taps * down / kLanes) * kLanes);
+  }
+
+  void prepare(int channels, int maxInputPerCall) {
+    numChannels = std::max(1, channels);
+    capacity = std::max(16, maxInputPerCall);
+    buffers.assign((size_t) numChannels, std::vector<float>((size_t) (kMaxTaps + capacity), 0.0f));
+    reset();
+  }
+
+  void reset() {
+    for (auto& buffer : buffers) std::fill(buffer.begin(), buffer.end(), 0.0f);
+    frac = 0.0;
+  }
+
+  int channels() const { return numChannels; }
+
+  // Most outputs one process() call can produce at ratio.
+  int maxOutput(double ratio) const { return std::max(1, (int) ((capacity - 2) / std::max(ratio, 1e-3))); }
+
+  // Input frames the next numOutput outputs consume; at most capacity when
+  // numOutput <= maxOutput(ratio). May be 0 when upsampling.
+  int inputNeeded(int numOutput, double ratio) const {
+    if (numOutput <= 0) return 0;
+    return (int) std::floor(frac + (numOutput - 1) * ratio) + 1;
+  }
+
+  // Where the caller writes those frames before calling process().
+  float* input(int ch) { return buffers[(size_t) ch].data() + kMaxTaps; }
+
+  // Consumes numInput (= inputNeeded(numOutput, ratio)) frames from input()
+  // and writes numOutput samples to each of out[0 .. numOut), numOut <=
+  // channels(). Channels past numOut keep whatever history they had.
+  void process(const PolyphaseFilter& filter, int numInput, float* const* out, int numOut, int numOutput, double ratio) {
+    const int taps = std::min(filter.taps, kMaxTaps);
+    const int base = kMaxTaps / 2 - taps / 2;
+    const bool bypass = ratio == 1.0 && frac == 0.0;
+    for (int ch = 0; ch < std::min(numOut, numChannels); ++ch) {
+      const float* x = buffers[(size_t) ch].data();
+      float* y = out[ch];
+      if (bypass) {
+        std::memcpy(y, x + kLatency, sizeof(float) * (size_t) numOutput);
+        continue;
+      }
+      for (int n = 0; n < numOutput; ++n) {
+        const double pos = frac + n * ratio;
+        const double whole = std::floor(pos);
+        const double phasePos = (pos - whole) * PolyphaseFilter::kPhases;
+        const int p = std::min((int) phasePos, PolyphaseFilter::kPhases - 1);
+        const float mix = (float) (phasePos - p);
+        const float* window = x + base + (int) whole + 1;
+        const float s0 = dot(window, filter.phase(p), taps);
+        const float s1 = dot(window, filter.phase(p + 1), taps);
+        y[n] = s0 + mix * (s1 - s0);
+      }
+    }
+    frac += numOutput * ratio - numInput;
+    // The newest kMaxTaps frames are the history for the next call.
+    for (auto& buffer : buffers) {
+      std::memmove(buffer.data(), buffer.data() + numInput, sizeof(float) * kMaxTaps);
+    }
+  }
+
+private:
+  static float dot(const float* x, const float* c, int n) {
+    float lane[kLanes] = {};
+    for (int i = 0; i < n; i += kLanes) {
+      for (int k = 0; k < kLanes; ++k) lane[k] += x[i + k] * c[i + k];
+    }
+    float sum = 0.0f;
+    for (int k = 0; k < kLanes; ++k) sum += lane[k];
+    return sum;
+  }
+
+  std::vector<std::vector<float>> buffers; // [kMaxTaps history][capacity new]
+  int numChannels = 0;
+  int capacity = 0;
+  double frac = 0.0; // position of the next output relative to the new frames, in [-1, ratio)
+};
+
+} // namespace dsp
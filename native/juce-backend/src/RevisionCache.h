@@ -0,0 +1,180 @@
+// Recently compiled EDL revisions, so undo/redo (which resends an earlier
+// EDL) re-activates the old compile instead of parsing it again. Entries are
+// keyed by a hash of the payload's clips array and also reachable by revision
+// number; the cache is LRU and bounded by an estimate of the bytes each entry
+// holds. Control thread only.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct RevisionCacheStats {
+  size_t entries = 0;
+  size_t bytes = 0;
+  size_t maxBytes = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+// Identity of an EDL payload: a 64-bit hash of the clips array plus its
+// length. Payloads run to megabytes, so the hash consumes 32 bytes per step
+// in four independent multiply-rotate lanes rather than a byte at a time.
+struct EdlContentKey {
+  uint64_t hash = 0;
+  size_t size = 0;
+
+  bool valid() const { return size > 0; }
+  bool operator==(const EdlContentKey& o) const { return hash == o.hash && size == o.size; }
+
+  static EdlContentKey of(const char* data, size_t size) {
+    uint64_t lane[4] = { kSeed + kP1 + kP2, kSeed + kP2, kSeed, kSeed - kP1 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      for (int l = 0; l < 4; ++l) lane[l] = round(lane[l], load(data + i + 8 * l));
+    }
+    uint64_t h = rotl(lane[0], 1) + rotl(lane[1], 7) + rotl(lane[2], 12) + rotl(lane[3], 18);
+    for (; i + 8 <= size; i += 8) h = rotl(h ^ round(0, load(data + i)), 27) * kP1 + kP2;
+    for (; i < size; ++i) h = rotl(h ^ ((unsigned char) data[i] * kP1), 11) * kP2;
+    h ^= (uint64_t) size;
+    h ^= h >> 33;
+    h *= kP2;
+    h ^= h >> 29;
+    return { h, size };
+  }
+
+private:
+  static constexpr uint64_t kSeed = 0x9e3779b97f4a7c15ull;
+  static constexpr uint64_t kP1 = 0x9e3779b185ebca87ull;
+  static constexpr uint64_t kP2 = 0xc2b2ae3d27d4eb4full;
+
+  static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+  static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * kP2, 31) * kP1; }
+  static uint64_t load(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+};
+
+template <typename T>
+class RevisionCache {
+public:
+  static constexpr size_t kDefaultMaxBytes = 64u << 20;
+
+  explicit RevisionCache(size_t maxBytes = kDefaultMaxBytes) : limit(maxBytes) {}
+
+  // Counts a hit or a miss.
+  std::shared_ptr<const T> findContent(const EdlContentKey& key) {
+    const auto it = byHash.find(key.hash);
+    if (it == byHash.end() || !(it->second->key == key)) {
+      ++counters.misses;
+      return nullptr;
+    }
+    ++counters.hits;
+    touch(it->second);
+    return it->second->value;
+  }
+
+  // Counts a hit or a miss.
+  std::shared_ptr<const T> findRevision(int revision) {
+    const auto r = byRevision.find(revision);
+    if (r == byRevision.end()) {
+      ++counters.misses;
+      return nullptr;
+    }
+    const auto it = byHash.find(r->second);
+    if (it == byHash.end()) {
+      byRevision.erase(r);
+      ++counters.misses;
+      return nullptr;
+    }
+    ++counters.hits;
+    touch(it->second);
+    return it->second->value;
+  }
+
+  // Records that revision now names the entry for key (a resend of identical
+  // content under a new revision number).
+  void addRevision(int revision, const EdlContentKey& key) {
+    const auto it = byHash.find(key.hash);
+    if (it == byHash.end()) return;
+    byRevision[revision] = key.hash;
+    it->second->revisions.push_back(revision);
+  }
+
+  // Entries larger than the whole budget are not kept.
+  void insert(int revision, const EdlContentKey& key, std::shared_ptr<const T> value, size_t bytes) {
+    if (!key.valid()) return;
+    const auto existing = byHash.find(key.hash);
+    if (existing != byHash.end()) erase(existing->second);
+    if (bytes > limit) return;
+    lru.push_front(Entry { key, std::move(value), bytes, { revision } });
+    byHash[key.hash] = lru.begin();
+    byRevision[revision] = key.hash;
+    used += bytes;
+    trim();
+  }
+
+  void setMaxBytes(size_t maxBytes) {
+    limit = maxBytes;
+    trim();
+  }
+
+  void clear() {
+    lru.clear();
+    byHash.clear();
+    byRevision.clear();
+    used = 0;
+  }
+
+  RevisionCacheStats stats() const {
+    RevisionCacheStats s = counters;
+    s.entries = lru.size();
+    s.bytes = used;
+    s.maxBytes = limit;
+    return s;
+  }
+
+private:
+  struct Entry {
+    EdlContentKey key;
+    std::shared_ptr<const T> value;
+    size_t bytes = 0;
+    std::vector<int> revisions;
+  };
+  using Iterator = typename std::list<Entry>::iterator;
+
+  void touch(Iterator it) { lru.splice(lru.begin(), lru, it); }
+
+  void erase(Iterator it) {
+    for (int revision : it->revisions) {
+      const auto r = byRevision.find(revision);
+      if (r != byRevision.end() && r->second == it->key.hash) byRevision.erase(r);
+    }
+    byHash.erase(it->key.hash);
+    used -= it->bytes;
+    lru.erase(it);
+  }
+
+  void trim() {
+    while (used > limit && !lru.empty()) {
+      erase(std::prev(lru.end()));
+      ++counters.evictions;
+    }
+  }
+
+  std::list<Entry> lru; // most recently used first
+  std::unordered_map<uint64_t, Iterator> byHash;
+  std::unordered_map<int, uint64_t> byRevision;
+  size_t used = 0;
+  size_t limit;
+  RevisionCacheStats counters;
+};
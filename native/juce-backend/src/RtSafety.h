@@ -0,0 +1,448 @@
+// Real-time safety checks for the audio callback, enabled with the
+// RT_SAFETY_CHECKS build option. rt::ScopedRealtime marks the calling thread
+// as being inside the audio callback; while it is, heap allocation (operator
+// new/delete, and malloc/free on glibc), mutex locking, condition waits,
+// sleeps and file I/O are recorded as violations with the stack that caused
+// them. Identical call sites are folded into one entry with a count. With
+// RT_SAFETY_TRAP=1 in the environment the first violation aborts instead, so
+// a headless run fails loudly.
+//
+// Locks, sleeps and I/O are seen by interposing the libc/pthread entry points,
+// which is only done on Linux/glibc; elsewhere only allocations are checked.
+// This header defines the replacement functions, so it must be included by
+// exactly one translation unit (main.cpp). Without RT_SAFETY_CHECKS every
+// entry point below compiles to nothing.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rt {
+
+enum class Violation : uint8_t { Allocation = 0, Deallocation, Lock, Syscall, Count };
+
+inline const char* violationName(Violation v) {
+  switch (v) {
+    case Violation::Allocation: return "allocation";
+    case Violation::Deallocation: return "deallocation";
+    case Violation::Lock: return "lock";
+    case Violation::Syscall: return "syscall";
+    default: return "unknown";
+  }
+}
+
+struct SiteReport {
+  Violation kind = Violation::Allocation;
+  std::string what;
+  uint64_t count = 0;
+  std::vector<std::string> stack;
+};
+
+struct Report {
+  bool enabled = false;
+  bool trap = false;
+  uint64_t counts[(size_t) Violation::Count] = {};
+  uint64_t droppedSites = 0; // violations whose call site did not fit the table
+  std::vector<SiteReport> sites;
+};
+
+} // namespace rt
+
+#if RT_SAFETY_CHECKS
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define RT_SAFETY_HAVE_BACKTRACE 1
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#define RT_SAFETY_INTERPOSE 1
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void __libc_free(void*);
+#endif
+
+namespace rt {
+namespace detail {
+
+constexpr int kMaxFrames = 24;
+constexpr int kSkipFrames = 2; // record() and the hook that called it
+constexpr size_t kMaxSites = 128;
+
+struct Site {
+  std::atomic<int> state { 0 }; // 0 empty, 1 being written, 2 ready
+  Violation kind = Violation::Allocation;
+  const char* what = "";
+  uint64_t hash = 0;
+  int frames = 0;
+  void* stack[kMaxFrames] = {};
+  std::atomic<uint64_t> count { 0 };
+};
+
+struct State {
+  std::atomic<uint64_t> counts[(size_t) Violation::Count] = {};
+  std::atomic<uint64_t> droppedSites { 0 };
+  Site sites[kMaxSites];
+  bool trap = false;
+};
+
+inline State& state() {
+  static State s;
+  return s;
+}
+
+// Plain thread_locals: no constructors, so reading them from inside malloc
+// cannot allocate.
+inline thread_local int realtimeDepth = 0;
+inline thread_local bool inHook = false;
+
+inline void writeStderr(const char* text) {
+#if RT_SAFETY_INTERPOSE
+  static auto realWrite = (ssize_t (*)(int, const void*, size_t)) dlsym(RTLD_NEXT, "write");
+  if (realWrite) realWrite(2, text, std::strlen(text));
+#else
+  std::fputs(text, stderr);
+#endif
+}
+
+// Called from every hook. Cheap when the thread is not in a realtime scope.
+inline void record(Violation kind, const char* what) {
+  if (realtimeDepth == 0 || inHook) return;
+  inHook = true;
+  State& s = state();
+  s.counts[(size_t) kind].fetch_add(1, std::memory_order_relaxed);
+
+  void* frames[kMaxFrames + kSkipFrames] = {};
+  int n = 0;
+#if RT_SAFETY_HAVE_BACKTRACE
+  n = backtrace(frames, kMaxFrames + kSkipFrames);
+#endif
+  void** stack = frames + std::min(n, kSkipFrames);
+  const int depth = std::max(0, n - kSkipFrames);
+  uint64_t hash = 1469598103934665603ull ^ (uint64_t) kind;
+  for (int i = 0; i < depth; ++i) hash = (hash ^ (uint64_t) (uintptr_t) stack[i]) * 1099511628211ull;
+
+  // Open addressing over a fixed table; slots are claimed with a CAS so
+  // several realtime threads can report at once.
+  bool stored = false;
+  for (size_t probe = 0; probe < kMaxSites && !stored; ++probe) {
+    Site& site = s.sites[(hash + probe) % kMaxSites];
+    int st = site.state.load(std::memory_order_acquire);
+    if (st == 0) {
+      int expected = 0;
+      if (site.state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+        site.kind = kind;
+        site.what = what;
+        site.hash = hash;
+        site.frames = depth;
+        for (int i = 0; i < depth; ++i) site.stack[i] = stack[i];
+        site.count.store(1, std::memory_order_relaxed);
+        site.state.store(2, std::memory_order_release);
+        stored = true;
+        break;
+      }
+      st = expected;
+    }
+    if (st == 2 && site.hash == hash && site.kind == kind) {
+      site.count.fetch_add(1, std::memory_order_relaxed);
+      stored = true;
+    }
+  }
+  if (!stored) s.droppedSites.fetch_add(1, std::memory_order_relaxed);
+
+  if (s.trap) {
+    writeStderr("[rt-safety] ");
+    writeStderr(violationName(kind));
+    writeStderr(" in audio callback: ");
+    writeStderr(what);
+    writeStderr("\n");
+#if RT_SAFETY_HAVE_BACKTRACE
+    backtrace_symbols_fd(stack, depth, 2);
+#endif
+    std::abort();
+  }
+  inHook = false;
+}
+
+// The allocator underneath the operator new hooks, bypassing the malloc hooks
+// so one allocation is reported once.
+inline void* rawMalloc(size_t size) {
+#if RT_SAFETY_INTERPOSE
+  return __libc_malloc(size);
+#else
+  return std::malloc(size);
+#endif
+}
+
+inline void rawFree(void* p) {
+#if RT_SAFETY_INTERPOSE
+  __libc_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+} // namespace detail
+
+constexpr bool kEnabled = true;
+
+// Call once at startup, before any audio thread runs: reads RT_SAFETY_TRAP
+// and warms up backtrace(), whose first call loads the unwinder.
+inline void init() {
+  const char* trap = std::getenv("RT_SAFETY_TRAP");
+  detail::state().trap = trap && *trap && std::strcmp(trap, "0") != 0;
+#if RT_SAFETY_HAVE_BACKTRACE
+  void* frames[4];
+  backtrace(frames, 4);
+#endif
+}
+
+class ScopedRealtime {
+public:
+  ScopedRealtime() { ++detail::realtimeDepth; }
+  ~ScopedRealtime() { --detail::realtimeDepth; }
+  ScopedRealtime(const ScopedRealtime&) = delete;
+  ScopedRealtime& operator=(const ScopedRealtime&) = delete;
+};
+
+// Clears counts and call sites, e.g. after warm-up so a test sees only the
+// steady state. A report racing the reset may survive it.
+inline void reset() {
+  detail::State& s = detail::state();
+  for (auto& c : s.counts) c.store(0, std::memory_order_relaxed);
+  s.droppedSites.store(0, std::memory_order_relaxed);
+  for (auto& site : s.sites) {
+    int ready = 2;
+    site.state.compare_exchange_strong(ready, 0, std::memory_order_acq_rel);
+  }
+}
+
+// Snapshot with symbolised stacks. Allocates; call off the audio thread.
+inline Report report() {
+  Report r;
+  r.enabled = true;
+  detail::State& s = detail::state();
+  r.trap = s.trap;
+  for (size_t k = 0; k < (size_t) Violation::Count; ++k) r.counts[k] = s.counts[k].load(std::memory_order_relaxed);
+  r.droppedSites = s.droppedSites.load(std::memory_order_relaxed);
+  for (auto& site : s.sites) {
+    if (site.state.load(std::memory_order_acquire) != 2) continue;
+    SiteReport out;
+    out.kind = site.kind;
+    out.what = site.what;
+    out.count = site.count.load(std::memory_order_relaxed);
+#if RT_SAFETY_HAVE_BACKTRACE
+    if (char** symbols = backtrace_symbols(site.stack, site.frames)) {
+      for (int i = 0; i < site.frames; ++i) out.stack.emplace_back(symbols[i]);
+      std::free(symbols);
+    }
+#endif
+    r.sites.push_back(std::move(out));
+  }
+  return r;
+}
+
+} // namespace rt
+
+// --- Allocation hooks ---
+
+void* operator new(std::size_t size) {
+  rt::detail::record(rt::Violation::Allocation, "operator new");
+  if (void* p = rt::detail::rawMalloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+  rt::detail::record(rt::Violation::Allocation, "operator new[]");
+  if (void* p = rt::detail::rawMalloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  rt::detail::record(rt::Violation::Allocation, "operator new");
+  return rt::detail::rawMalloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  rt::detail::record(rt::Violation::Allocation, "operator new[]");
+  return rt::detail::rawMalloc(size ? size : 1);
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+  rt::detail::record(rt::Violation::Allocation, "operator new(aligned)");
+  const std::size_t a = std::max<std::size_t>((std::size_t) align, sizeof(void*));
+  void* p = nullptr;
+  if (posix_memalign(&p, a, size ? size : 1) == 0) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+void operator delete(void* p) noexcept {
+  if (p) rt::detail::record(rt::Violation::Deallocation, "operator delete");
+  rt::detail::rawFree(p);
+}
+void operator delete[](void* p) noexcept {
+  if (p) rt::detail::record(rt::Violation::Deallocation, "operator delete[]");
+  rt::detail::rawFree(p);
+}
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete[](p); }
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { operator delete[](p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { operator delete[](p); }
+
+#if RT_SAFETY_INTERPOSE
+// --- libc / pthread interposition (Linux, glibc) ---
+// The executable's definitions win over libc's for every caller, including
+// JUCE and the audio driver libraries. Originals come from RTLD_NEXT, or from
+// glibc's __libc_* aliases for the allocator (dlsym itself may allocate).
+
+namespace rt {
+namespace detail {
+template <typename Fn>
+inline Fn next(Fn& cached, const char* name) {
+  if (!cached) cached = (Fn) dlsym(RTLD_NEXT, name);
+  return cached;
+}
+} // namespace detail
+} // namespace rt
+
+extern "C" {
+
+void* malloc(size_t size) {
+  rt::detail::record(rt::Violation::Allocation, "malloc");
+  return __libc_malloc(size);
+}
+void* calloc(size_t n, size_t size) {
+  rt::detail::record(rt::Violation::Allocation, "calloc");
+  return __libc_calloc(n, size);
+}
+void* realloc(void* p, size_t size) {
+  rt::detail::record(rt::Violation::Allocation, "realloc");
+  return __libc_realloc(p, size);
+}
+void free(void* p) {
+  if (p) rt::detail::record(rt::Violation::Deallocation, "free");
+  __libc_free(p);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* m) {
+  static int (*real)(pthread_mutex_t*) = nullptr;
+  rt::detail::record(rt::Violation::Lock, "pthread_mutex_lock");
+  return rt::detail::next(real, "pthread_mutex_lock")(m);
+}
+int pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m) {
+  static int (*real)(pthread_cond_t*, pthread_mutex_t*) = nullptr;
+  rt::detail::record(rt::Violation::Lock, "pthread_cond_wait");
+  return rt::detail::next(real, "pthread_cond_wait")(c, m);
+}
+int pthread_cond_timedwait(pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t) {
+  static int (*real)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*) = nullptr;
+  rt::detail::record(rt::Violation::Lock, "pthread_cond_timedwait");
+  return rt::detail::next(real, "pthread_cond_timedwait")(c, m, t);
+}
+int pthread_rwlock_rdlock(pthread_rwlock_t* l) {
+  static int (*real)(pthread_rwlock_t*) = nullptr;
+  rt::detail::record(rt::Violation::Lock, "pthread_rwlock_rdlock");
+  return rt::detail::next(real, "pthread_rwlock_rdlock")(l);
+}
+int pthread_rwlock_wrlock(pthread_rwlock_t* l) {
+  static int (*real)(pthread_rwlock_t*) = nullptr;
+  rt::detail::record(rt::Violation::Lock, "pthread_rwlock_wrlock");
+  return rt::detail::next(real, "pthread_rwlock_wrlock")(l);
+}
+
+int open(const char* path, int flags, ...) {
+  static int (*real)(const char*, int, ...) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "open");
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = (mode_t) va_arg(args, int);
+    va_end(args);
+  }
+  return rt::detail::next(real, "open")(path, flags, mode);
+}
+int open64(const char* path, int flags, ...) {
+  static int (*real)(const char*, int, ...) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "open64");
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = (mode_t) va_arg(args, int);
+    va_end(args);
+  }
+  return rt::detail::next(real, "open64")(path, flags, mode);
+}
+FILE* fopen(const char* path, const char* mode) {
+  static FILE* (*real)(const char*, const char*) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "fopen");
+  return rt::detail::next(real, "fopen")(path, mode);
+}
+FILE* fopen64(const char* path, const char* mode) {
+  static FILE* (*real)(const char*, const char*) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "fopen64");
+  return rt::detail::next(real, "fopen64")(path, mode);
+}
+ssize_t read(int fd, void* buf, size_t n) {
+  static ssize_t (*real)(int, void*, size_t) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "read");
+  return rt::detail::next(real, "read")(fd, buf, n);
+}
+ssize_t pread(int fd, void* buf, size_t n, off_t offset) {
+  static ssize_t (*real)(int, void*, size_t, off_t) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "pread");
+  return rt::detail::next(real, "pread")(fd, buf, n, offset);
+}
+ssize_t write(int fd, const void* buf, size_t n) {
+  static ssize_t (*real)(int, const void*, size_t) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "write");
+  return rt::detail::next(real, "write")(fd, buf, n);
+}
+int nanosleep(const struct timespec* req, struct timespec* rem) {
+  static int (*real)(const struct timespec*, struct timespec*) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "nanosleep");
+  return rt::detail::next(real, "nanosleep")(req, rem);
+}
+int usleep(useconds_t us) {
+  static int (*real)(useconds_t) = nullptr;
+  rt::detail::record(rt::Violation::Syscall, "usleep");
+  return rt::detail::next(real, "usleep")(us);
+}
+
+} // extern "C"
+#endif // RT_SAFETY_INTERPOSE
+
+#else // !RT_SAFETY_CHECKS
+
+namespace rt {
+
+constexpr bool kEnabled = false;
+
+inline void init() {}
+inline void reset() {}
+
+class ScopedRealtime {
+public:
+  ScopedRealtime() {}
+};
+
+inline Report report() { return {}; }
+
+} // namespace rt
+
+#endif
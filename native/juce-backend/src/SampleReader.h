@@ -0,0 +1,182 @@
+// Random-access PCM reader used by the offline analysis passes. Each thread
+// opens its own reader through a factory, because neither JUCE's
+// AudioFormatReader nor std::ifstream may be shared between threads.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+class SampleReader {
+public:
+  virtual ~SampleReader() = default;
+  virtual int numChannels() const = 0;
+  virtual double sampleRate() const = 0;
+  virtual int64_t lengthInSamples() const = 0;
+  // Reads numSamples frames starting at start into dest[0..channels). Frames
+  // past the end of the file are zero-filled. Returns false on I/O failure.
+  virtual bool read(float* const* dest, int channels, int64_t start, int numSamples) = 0;
+};
+
+using SampleReaderFactory = std::function<std::unique_ptr<SampleReader>()>;
+
+// Minimal RIFF/WAVE reader (PCM 8/16/24/32 and IEEE float 32/64, including
+// WAVE_FORMAT_EXTENSIBLE). Enough for the WAV files the app imports; used by
+// the mock engine, which has no JUCE codecs available.
+class WavFileReader : public SampleReader {
+public:
+  explicit WavFileReader(const std::string& path) : file(path, std::ios::binary) {
+    ok = file.good() && parseHeader();
+  }
+
+  bool isOpen() const { return ok; }
+  int numChannels() const override { return channels; }
+  double sampleRate() const override { return rate; }
+  int64_t lengthInSamples() const override { return frames; }
+
+  bool read(float* const* dest, int destChannels, int64_t start, int numSamples) override {
+    if (!ok || numSamples <= 0) return ok;
+    int64_t available = frames - start;
+    if (start < 0 || available < 0) available = 0;
+    const int toRead = (int) std::min<int64_t>(numSamples, available);
+    if (toRead > 0) {
+      raw.resize((size_t) toRead * frameBytes);
+      file.clear();
+      file.seekg((std::streamoff) (dataOffset + start * frameBytes));
+      file.read(reinterpret_cast<char*>(raw.data()), (std::streamsize) raw.size());
+      if (file.gcount() != (std::streamsize) raw.size()) return false;
+      for (int ch = 0; ch < destChannels; ++ch) {
+        const int srcCh = ch < channels ? ch : channels - 1;
+        decodeChannel(dest[ch], srcCh, toRead);
+      }
+    }
+    for (int ch = 0; ch < destChannels; ++ch) {
+      if (toRead < numSamples) std::memset(dest[ch] + toRead, 0, sizeof(float) * (size_t) (numSamples - toRead));
+    }
+    return true;
+  }
+
+private:
+  bool parseHeader() {
+    char riff[12];
+    if (!file.read(riff, 12) || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) return false;
+    bool haveFormat = false;
+    for (;;) {
+      char chunkHeader[8];
+      if (!file.read(chunkHeader, 8)) return false;
+      const uint32_t size = readLE32(reinterpret_cast<unsigned char*>(chunkHeader + 4));
+      const std::streamoff bodyStart = file.tellg();
+      if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+        unsigned char fmt[40] = {};
+        file.read(reinterpret_cast<char*>(fmt), std::min<uint32_t>(size, sizeof(fmt)));
+        formatTag = (uint16_t) (fmt[0] | (fmt[1] << 8));
+        channels = fmt[2] | (fmt[3] << 8);
+        rate = (double) readLE32(fmt + 4);
+        bitsPerSample = fmt[14] | (fmt[15] << 8);
+        if (formatTag == 0xFFFE && size >= 26) formatTag = (uint16_t) (fmt[24] | (fmt[25] << 8));
+        haveFormat = true;
+      } else if (std::memcmp(chunkHeader, "data", 4) == 0) {
+        if (!haveFormat || channels <= 0 || bitsPerSample <= 0) return false;
+        if (formatTag != 1 && formatTag != 3) return false;
+        frameBytes = channels * (bitsPerSample / 8);
+        if (frameBytes <= 0) return false;
+        dataOffset = bodyStart;
+        file.seekg(0, std::ios::end);
+        const int64_t fileBytes = (int64_t) file.tellg() - dataOffset;
+        const int64_t declared = size == 0xFFFFFFFFu ? fileBytes : std::min<int64_t>(size, fileBytes);
+        frames = declared / frameBytes;
+        return true;
+      }
+      file.seekg(bodyStart + (std::streamoff) size + (size & 1u));
+    }
+  }
+
+  // One loop per format, so each is a straight strided conversion the
+  // compiler can unroll (this is most of the cost of an analysis read).
+  void decodeChannel(float* out, int ch, int count) const {
+    const int bytes = bitsPerSample / 8;
+    const size_t stride = (size_t) frameBytes;
+    const unsigned char* p = raw.data() + (size_t) ch * bytes;
+    if (formatTag == 3) {
+      if (bytes == 4) {
+        for (int i = 0; i < count; ++i, p += stride) std::memcpy(out + i, p, 4);
+      } else {
+        for (int i = 0; i < count; ++i, p += stride) { double v; std::memcpy(&v, p, 8); out[i] = (float) v; }
+      }
+      return;
+    }
+    switch (bytes) {
+      case 1:
+        for (int i = 0; i < count; ++i, p += stride) out[i] = ((int) p[0] - 128) * (1.0f / 128.0f);
+        break;
+      case 2:
+        for (int i = 0; i < count; ++i, p += stride) out[i] = (float) (int16_t) (p[0] | (p[1] << 8)) * (1.0f / 32768.0f);
+        break;
+      case 3:
+        for (int i = 0; i < count; ++i, p += stride)
+          out[i] = (float) ((int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24) >> 8) * (1.0f / 8388608.0f);
+        break;
+      default:
+        for (int i = 0; i < count; ++i, p += stride) out[i] = (float) ((int32_t) readLE32(p) / 2147483648.0);
+        break;
+    }
+  }
+
+  static uint32_t readLE32(const unsigned char* p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+  }
+
+  std::ifstream file;
+  bool ok = false;
+  uint16_t formatTag = 0;
+  int channels = 0;
+  int bitsPerSample = 0;
+  int frameBytes = 0;
+  double rate = 0.0;
+  int64_t frames = 0;
+  int64_t dataOffset = 0;
+  std::vector<unsigned char> raw;
+};
+
+inline SampleReaderFactory makeWavReaderFactory(const std::string& path) {
+  return [path]() -> std::unique_ptr<SampleReader> {
+    std::unique_ptr<WavFileReader> reader(new WavFileReader(path));
+    if (!reader->isOpen()) return nullptr;
+    return reader;
+  };
+}
+
+// Runs fn(chunkIndex, reader) for every chunk in [0, numChunks) on up to
+// `threads` threads of the job scheduler. Chunks are claimed one at a time so
+// uneven I/O does not leave cores idle, and each thread that picks one up
+// opens its own reader on first use. Returns false if a reader could not be
+// opened, fn failed, or the pass was cancelled.
+inline bool runChunksInParallel(const SampleReaderFactory& factory,
+                                size_t numChunks,
+                                int threads,
+                                const std::function<bool(size_t, SampleReader&)>& fn,
+                                const std::atomic<bool>* cancel = nullptr) {
+  std::mutex mutex;
+  std::map<std::thread::id, std::unique_ptr<SampleReader>> readers;
+  return jobs::parallelFor(numChunks, [&](size_t chunk) {
+    SampleReader* reader = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto& slot = readers[std::this_thread::get_id()];
+      if (!slot) slot = factory();
+      reader = slot.get();
+    }
+    return reader && fn(chunk, *reader);
+  }, std::max(1, threads), cancel);
+}
@@ -0,0 +1,183 @@
+// Session capture: every command the backend receives, with its arrival time,
+// written to a file that --replay can feed back later. The format is JSON
+// lines, so a capture can be read (and trimmed) by hand:
+//
+//   {"capture":1,"startedAt":"2026-01-01T12:00:00Z"}   header
+//   {"t":1532,"cmd":{...}}                             a command, t in us since the header
+//   {"t":1532,"attach":"/tmp/edl.json","bytes":N}      N raw bytes follow, then a newline:
+//                                                      a file the next command reads
+//   {"t":1532,"media":"/audio/a.wav","bytes":N}        size of an audio file a load opened
+//   {"t":90210,"end":true}                             written when the capture is closed
+//
+// Attachments exist because updateEdlFromFile deletes its file once read.
+// Audio is not copied; replay expects the media at the same paths.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+struct CaptureRecord {
+  enum class Kind { Command, Attachment, Media, End };
+  Kind kind = Kind::Command;
+  uint64_t tUs = 0;
+  std::string text; // the command line, or the attachment's contents
+  std::string path; // attachment or media path, as it appeared in the command
+  uint64_t bytes = 0;
+};
+
+// Command thread only. Every record is flushed, so a capture survives the
+// crash it is meant to reproduce.
+class CaptureWriter {
+public:
+  bool open(const std::string& path) {
+    close();
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out.good()) return false;
+    filePath = path;
+    started = std::chrono::steady_clock::now();
+    written = 0;
+    char stamp[32] = "";
+    const std::time_t now = std::time(nullptr);
+    if (const std::tm* utc = std::gmtime(&now)) std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", utc);
+    put(std::string("{\"capture\":1,\"startedAt\":\"") + stamp + "\"}\n");
+    return true;
+  }
+
+  void close() {
+    if (!out.is_open()) return;
+    put("{\"t\":" + std::to_string(nowUs()) + ",\"end\":true}\n");
+    out.close();
+  }
+
+  bool isOpen() const { return out.is_open(); }
+  const std::string& path() const { return filePath; }
+  uint64_t bytesWritten() const { return written; }
+
+  // Lines that are not a JSON object cannot be embedded and are skipped.
+  void command(const std::string& line) {
+    if (line.empty() || line.front() != '{' || line.back() != '}') return;
+    put("{\"t\":" + std::to_string(nowUs()) + ",\"cmd\":" + line + "}\n");
+  }
+
+  void attach(const std::string& path, const std::string& contents) {
+    put("{\"t\":" + std::to_string(nowUs()) + ",\"attach\":\"" + path + "\",\"bytes\":" +
+        std::to_string(contents.size()) + "}\n");
+    put(contents);
+    put("\n");
+  }
+
+  void media(const std::string& path, uint64_t bytes) {
+    put("{\"t\":" + std::to_string(nowUs()) + ",\"media\":\"" + path + "\",\"bytes\":" + std::to_string(bytes) + "}\n");
+  }
+
+private:
+  uint64_t nowUs() const {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+  }
+
+  void put(const std::string& text) {
+    out.write(text.data(), (std::streamsize) text.size());
+    out.flush();
+    written += text.size();
+  }
+
+  std::ofstream out;
+  std::string filePath;
+  std::chrono::steady_clock::time_point started;
+  uint64_t written = 0;
+};
+
+class CaptureReader {
+public:
+  bool open(const std::string& path, std::string& error) {
+    in.open(path, std::ios::binary);
+    if (!in.good()) {
+      error = "Unable to open capture";
+      return false;
+    }
+    std::string header;
+    if (!std::getline(in, header) || header.compare(0, 12, "{\"capture\":1") != 0) {
+      error = "Not a capture file";
+      return false;
+    }
+    return true;
+  }
+
+  // False at the end of the file or on a malformed record; error says which.
+  bool next(CaptureRecord& record, std::string& error) {
+    error.clear();
+    std::string line;
+    while (std::getline(in, line) && line.empty()) {}
+    if (line.empty()) return false;
+    if (line.compare(0, 5, "{\"t\":") != 0 || line.back() != '}') return fail(error, line);
+    char* end = nullptr;
+    record.tUs = std::strtoull(line.c_str() + 5, &end, 10);
+    const size_t keyStart = (size_t) (end - line.c_str());
+    const std::string rest = line.substr(keyStart, line.size() - 1 - keyStart); // ,"key":... without the closing brace
+    record.text.clear();
+    record.path.clear();
+    record.bytes = 0;
+    if (rest.compare(0, 7, ",\"cmd\":") == 0) {
+      record.kind = CaptureRecord::Kind::Command;
+      record.text = rest.substr(7);
+      return true;
+    }
+    if (rest == ",\"end\":true") {
+      record.kind = CaptureRecord::Kind::End;
+      return true;
+    }
+    const bool attachment = rest.compare(0, 11, ",\"attach\":\"") == 0;
+    const bool media = rest.compare(0, 10, ",\"media\":\"") == 0;
+    if (!attachment && !media) return fail(error, line);
+    const size_t pathStart = attachment ? 11 : 10;
+    const size_t pathEnd = rest.rfind("\",\"bytes\":");
+    if (pathEnd == std::string::npos || pathEnd < pathStart) return fail(error, line);
+    record.kind = attachment ? CaptureRecord::Kind::Attachment : CaptureRecord::Kind::Media;
+    record.path = rest.substr(pathStart, pathEnd - pathStart);
+    record.bytes = std::strtoull(rest.c_str() + pathEnd + 10, nullptr, 10);
+    if (attachment) {
+      record.text.resize((size_t) record.bytes);
+      if (record.bytes > 0 && !in.read(&record.text[0], (std::streamsize) record.bytes)) {
+        error = "Truncated attachment";
+        return false;
+      }
+      in.ignore(1); // the newline after the contents
+    }
+    return true;
+  }
+
+private:
+  static bool fail(std::string& error, const std::string& line) {
+    error = "Malformed capture record: " + line.substr(0, 80);
+    return false;
+  }
+
+  std::ifstream in;
+};
+
+// Running FNV-1a hash over rendered audio, consumed a word at a time. Bit
+// exact: any change to the samples, however small, changes the hash.
+class AudioHash {
+public:
+  void add(const float* samples, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t bits;
+      static_assert(sizeof(bits) == sizeof(float), "float must be 32-bit");
+      std::memcpy(&bits, samples + i, sizeof(bits));
+      hash = (hash ^ bits) * 1099511628211ull;
+    }
+    total += count;
+  }
+
+  uint64_t value() const { return hash; }
+  uint64_t samples() const { return total; }
+
+private:
+  uint64_t hash = 1469598103934665603ull;
+  uint64_t total = 0;
+};
@@ -0,0 +1,403 @@
+// Project sidecar: one binary file next to a project holding what the backend
+// computed for its audio, opened with mmap so a chunk is paged in only when
+// something reads it. Integers are in host byte order (little-endian on every
+// supported platform); everything is 8-byte aligned.
+//
+//   header   "JBSIDECR"  u32 version  u32 0                        16 bytes
+//   chunk    char tag[4]  u32 0  u64 length  u64 xxh64(payload)     24 bytes
+//            payload, zero-padded to 8
+//   ...
+//   index    u32 count  u32 0, then per entry:
+//            char tag[4]  u32 nameLength  u64 offset  u64 length  u64 hash
+//            name, zero-padded to 8
+//   trailer  u64 generation  u64 indexOffset  u64 indexLength
+//            u64 xxh64(index, seed generation)  "JBSCEND1"              40 bytes
+//
+// A file is only ever appended to. Saving writes the chunks that changed and
+// a new index, syncs, then appends the trailer and syncs again, so the last
+// valid trailer always describes complete data: a save cut short leaves a
+// tail that the reader skips, walking back to the previous trailer. When
+// dead chunks outweigh live ones the file is rewritten whole and renamed
+// over the old one.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "ArtifactCache.h"
+#include "MappedFile.h"
+
+namespace sidecar {
+
+constexpr uint32_t kVersion = 1;
+constexpr char kHeaderMagic[8] = { 'J', 'B', 'S', 'I', 'D', 'E', 'C', 'R' };
+constexpr char kTrailerMagic[8] = { 'J', 'B', 'S', 'C', 'E', 'N', 'D', '1' };
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kChunkHeaderBytes = 24;
+constexpr size_t kTrailerBytes = 40;
+// Below this much dead space a save never compacts.
+constexpr uint64_t kCompactMinBytes = 1u << 20;
+
+inline uint64_t padded(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+// Tags are stored as exactly four bytes: shorter ones padded with spaces,
+// longer ones cut. Every comparison goes through this, so "pk" finds "pk  ".
+inline std::string tagKey(std::string_view tag) {
+  std::string key(4, ' ');
+  key.replace(0, std::min<size_t>(4, tag.size()), tag.substr(0, 4));
+  return key;
+}
+
+struct Entry {
+  std::string tag;   // four characters (tagKey)
+  std::string name;  // distinguishes chunks of one tag, e.g. by parameters
+  uint64_t offset = 0; // of the payload
+  uint64_t length = 0;
+  uint64_t hash = 0;
+};
+
+// Something to store: tag, name and the payload bytes.
+struct Chunk {
+  std::string tag;
+  std::string name;
+  std::string payload;
+};
+
+class Reader {
+public:
+  // False, with error set, when path is missing or holds no valid trailer.
+  bool open(const std::string& path, std::string& error) {
+    list.clear();
+    if (!file.open(path, error)) return false;
+    const std::string_view data = file.view();
+    if (data.size() < kHeaderBytes + kTrailerBytes || std::memcmp(data.data(), kHeaderMagic, 8) != 0) {
+      error = "not a sidecar file: " + path;
+      return false;
+    }
+    std::memcpy(&formatVersion, data.data() + 8, sizeof(formatVersion));
+    if (formatVersion > kVersion) {
+      error = "sidecar version " + std::to_string(formatVersion) + " is newer than this backend";
+      return false;
+    }
+    // The view ends at the last non-zero byte, which a trailer's magic is.
+    size_t end = data.size();
+    end -= end % 8;
+    for (; end >= kHeaderBytes + kTrailerBytes; end -= 8) {
+      if (std::memcmp(data.data() + end - 8, kTrailerMagic, 8) != 0) continue;
+      if (readIndex(data, end)) {
+        validBytes = end;
+        fileBytes = data.size();
+        return true;
+      }
+      ++skippedTrailers;
+    }
+    error = "no intact index in " + path;
+    return false;
+  }
+
+  const std::vector<Entry>& entries() const { return list; }
+
+  const Entry* find(std::string_view tag, std::string_view name = {}) const {
+    const std::string key = tagKey(tag);
+    for (const auto& entry : list) {
+      if (entry.tag == key && entry.name == name) return &entry;
+    }
+    return nullptr;
+  }
+
+  // The payload in place; false when its hash does not match.
+  bool payload(const Entry& entry, std::string_view& out) const {
+    out = file.view().substr((size_t) entry.offset, (size_t) entry.length);
+    return artifacts::xxh64(out.data(), out.size(), 0) == entry.hash;
+  }
+
+  bool payload(std::string_view tag, std::string_view name, std::string_view& out) const {
+    const Entry* entry = find(tag, name);
+    return entry && payload(*entry, out);
+  }
+
+  uint32_t version() const { return formatVersion; }
+  uint64_t generation() const { return gen; }
+  // End of the trailer in use; bytes past it belong to a save that never
+  // finished.
+  uint64_t committedBytes() const { return validBytes; }
+  uint64_t totalBytes() const { return fileBytes; }
+  uint64_t liveBytes() const {
+    uint64_t total = 0;
+    for (const auto& entry : list) total += kChunkHeaderBytes + padded(entry.length);
+    return total;
+  }
+  // Trailers passed over on the way to the one in use.
+  int damagedTrailers() const { return skippedTrailers; }
+  bool mapped() const { return file.mapped(); }
+
+private:
+  template <typename T>
+  static bool readAt(std::string_view data, uint64_t offset, T& value) {
+    if (offset > data.size() || data.size() - offset < sizeof(T)) return false;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return true;
+  }
+
+  bool readIndex(std::string_view data, size_t end) {
+    const size_t trailer = end - kTrailerBytes;
+    uint64_t generation = 0, indexOffset = 0, indexLength = 0, indexHash = 0;
+    readAt(data, trailer, generation);
+    readAt(data, trailer + 8, indexOffset);
+    readAt(data, trailer + 16, indexLength);
+    readAt(data, trailer + 24, indexHash);
+    if (indexOffset < kHeaderBytes || indexOffset > trailer || trailer - indexOffset != indexLength) return false;
+    if (artifacts::xxh64(data.data() + indexOffset, (size_t) indexLength, generation) != indexHash) return false;
+
+    std::vector<Entry> entries;
+    uint32_t count = 0;
+    uint64_t at = indexOffset;
+    if (!readAt(data, at, count)) return false;
+    at += 8;
+    for (uint32_t i = 0; i < count; ++i) {
+      Entry entry;
+      char tag[4];
+      uint32_t nameLength = 0;
+      if (!readAt(data, at, tag) || !readAt(data, at + 4, nameLength) || !readAt(data, at + 8, entry.offset) ||
+          !readAt(data, at + 16, entry.length) || !readAt(data, at + 24, entry.hash)) {
+        return false;
+      }
+      at += 32;
+      if (at + nameLength > trailer) return false;
+      entry.tag.assign(tag, 4);
+      entry.name.assign(data.data() + at, nameLength);
+      at += padded(nameLength);
+      if (entry.offset > indexOffset || indexOffset - entry.offset < entry.length) return false;
+      entries.push_back(std::move(entry));
+    }
+    list = std::move(entries);
+    gen = generation;
+    return true;
+  }
+
+  MappedFile file;
+  std::vector<Entry> list;
+  uint32_t formatVersion = 0;
+  uint64_t gen = 0;
+  uint64_t validBytes = 0;
+  uint64_t fileBytes = 0;
+  int skippedTrailers = 0;
+};
+
+struct SaveResult {
+  bool ok = false;
+  std::string error;
+  uint64_t generation = 0;
+  uint64_t appendedBytes = 0;
+  uint64_t fileBytes = 0;
+  bool compacted = false;
+  std::vector<std::pair<Entry, bool>> chunks; // every live entry; true if written by this save
+};
+
+namespace detail {
+class Appender {
+public:
+  ~Appender() { close(); }
+
+  bool open(const std::string& path, bool truncate) {
+    out = std::fopen(path.c_str(), truncate ? "wb" : "r+b");
+    if (!out) return false;
+    if (std::fseek(out, 0, SEEK_END) != 0) return false;
+    const long end = std::ftell(out);
+    if (end < 0) return false;
+    position = (uint64_t) end;
+    return pad();
+  }
+
+  uint64_t tell() const { return position; }
+
+  bool write(const void* data, size_t length) {
+    if (length && std::fwrite(data, 1, length, out) != length) return false;
+    position += length;
+    return true;
+  }
+
+  template <typename T>
+  bool put(const T& value) { return write(&value, sizeof(T)); }
+
+  bool pad() {
+    static const char zeros[8] = {};
+    return write(zeros, (size_t) (padded(position) - position));
+  }
+
+  // Flushed to the device, not just to the OS.
+  bool sync() {
+    if (std::fflush(out) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(out)) == 0;
+#else
+    return ::fsync(fileno(out)) == 0;
+#endif
+  }
+
+  bool close() {
+    if (!out) return true;
+    const bool ok = std::fclose(out) == 0;
+    out = nullptr;
+    return ok;
+  }
+
+private:
+  std::FILE* out = nullptr;
+  uint64_t position = 0;
+};
+
+inline bool writeChunk(Appender& out, const std::string& tag, std::string_view payload, Entry& entry) {
+  entry.tag = tagKey(tag);
+  entry.length = payload.size();
+  entry.hash = artifacts::xxh64(payload.data(), payload.size(), 0);
+  const uint32_t zero = 0;
+  if (!out.write(entry.tag.data(), 4) || !out.put(zero) || !out.put(entry.length) || !out.put(entry.hash)) return false;
+  entry.offset = out.tell();
+  return out.write(payload.data(), payload.size()) && out.pad();
+}
+
+inline bool writeIndexAndTrailer(Appender& out, const std::vector<Entry>& entries, uint64_t generation) {
+  std::string index;
+  auto put = [&index](const auto& value) { index.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+  put((uint32_t) entries.size());
+  put((uint32_t) 0);
+  for (const auto& entry : entries) {
+    index.append(entry.tag.data(), 4);
+    put((uint32_t) entry.name.size());
+    put(entry.offset);
+    put(entry.length);
+    put(entry.hash);
+    index += entry.name;
+    index.append((size_t) (padded(entry.name.size()) - entry.name.size()), '\0');
+  }
+  const uint64_t indexOffset = out.tell();
+  if (!out.write(index.data(), index.size()) || !out.sync()) return false;
+  const uint64_t indexLength = index.size();
+  const uint64_t hash = artifacts::xxh64(index.data(), index.size(), generation);
+  return out.put(generation) && out.put(indexOffset) && out.put(indexLength) && out.put(hash) &&
+         out.write(kTrailerMagic, 8) && out.sync();
+}
+
+inline bool writeHeader(Appender& out) {
+  const uint32_t zero = 0;
+  return out.write(kHeaderMagic, 8) && out.put(kVersion) && out.put(zero);
+}
+} // namespace detail
+
+// Stores chunks in the sidecar at path, creating it if needed. A chunk whose
+// tag, name and bytes are already there is kept where it is; chunks already
+// in the file that are not in `chunks` stay too.
+inline SaveResult save(const std::string& path, const std::vector<Chunk>& chunks) {
+  SaveResult result;
+  auto previous = std::make_unique<Reader>();
+  std::string error;
+  const bool existing = previous->open(path, error);
+  if (!existing) previous.reset();
+
+  // Entries to keep, and chunks to append.
+  std::vector<Entry> entries = existing ? previous->entries() : std::vector<Entry>();
+  std::vector<const Chunk*> pending;
+  for (const auto& chunk : chunks) {
+    const uint64_t hash = artifacts::xxh64(chunk.payload.data(), chunk.payload.size(), 0);
+    const Entry* kept = existing ? previous->find(chunk.tag, chunk.name) : nullptr;
+    if (kept && kept->hash == hash && kept->length == chunk.payload.size()) continue;
+    pending.push_back(&chunk);
+  }
+  uint64_t live = 0, dead = existing ? previous->committedBytes() - kHeaderBytes : 0;
+  for (const auto& entry : entries) live += kChunkHeaderBytes + padded(entry.length);
+  for (const Chunk* chunk : pending) {
+    if (const Entry* old = existing ? previous->find(chunk->tag, chunk->name) : nullptr) {
+      live -= kChunkHeaderBytes + padded(old->length);
+    }
+    live += kChunkHeaderBytes + padded(chunk->payload.size());
+  }
+  dead = dead > live ? dead - live : 0;
+  const bool compact = !existing || (dead > kCompactMinBytes && dead > live);
+  result.generation = existing ? previous->generation() + 1 : 1;
+
+  auto replace = [&entries](Entry entry, std::string name) {
+    entry.name = std::move(name);
+    for (auto& e : entries) {
+      if (e.tag == entry.tag && e.name == entry.name) {
+        e = std::move(entry);
+        return;
+      }
+    }
+    entries.push_back(std::move(entry));
+  };
+
+  detail::Appender out;
+  const std::string target = compact ? path + ".part" : path;
+  if (!out.open(target, compact)) {
+    result.error = "cannot write " + target;
+    return result;
+  }
+  const uint64_t startBytes = out.tell();
+  std::vector<std::string> written;
+  bool ok = true;
+  if (compact) {
+    // Rewrite: every kept chunk that is not being replaced is copied from
+    // the old file.
+    ok = detail::writeHeader(out);
+    std::vector<Entry> copied;
+    for (const auto& entry : entries) {
+      const bool replaced = std::any_of(pending.begin(), pending.end(), [&entry](const Chunk* chunk) {
+        return entry.tag == tagKey(chunk->tag) && entry.name == chunk->name;
+      });
+      std::string_view bytes;
+      if (replaced) continue;
+      if (!previous || !previous->payload(entry, bytes)) continue; // damaged: dropped
+      Entry moved;
+      ok = ok && detail::writeChunk(out, entry.tag, bytes, moved);
+      moved.name = entry.name;
+      copied.push_back(std::move(moved));
+    }
+    entries = std::move(copied);
+  }
+  for (const Chunk* chunk : pending) {
+    Entry entry;
+    ok = ok && detail::writeChunk(out, chunk->tag, chunk->payload, entry);
+    written.push_back(entry.tag + "/" + chunk->name);
+    replace(std::move(entry), chunk->name);
+  }
+  ok = ok && detail::writeIndexAndTrailer(out, entries, result.generation);
+  result.appendedBytes = out.tell() - startBytes;
+  result.fileBytes = out.tell();
+  ok = out.close() && ok;
+  previous.reset(); // unmap before the rename (Windows)
+  if (ok && compact) {
+    std::error_code ec;
+    std::filesystem::rename(target, path, ec);
+    ok = !ec;
+  }
+  if (!ok) {
+    if (compact) std::remove(target.c_str());
+    result.error = "cannot write " + path;
+    return result;
+  }
+  result.ok = true;
+  result.compacted = existing && compact;
+  for (const auto& entry : entries) {
+    const bool fresh = std::find(written.begin(), written.end(), entry.tag + "/" + entry.name) != written.end();
+    result.chunks.emplace_back(entry, fresh);
+  }
+  return result;
+}
+
+} // namespace sidecar
@@ -0,0 +1,136 @@
+// Offline silence detection over the loaded source. Frame energies are
+// computed in parallel chunks (one reader per worker), then a single
+// sequential pass applies threshold, hangover and minimum duration.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "DspKernels.h"
+#include "SampleReader.h"
+
+struct SilenceParams {
+  double thresholdDb = -45.0;   // frame energy below this is silent (dBFS, loudest channel)
+  double minDurationSec = 0.30; // shorter silent runs are ignored
+  double hangoverSec = 0.05;    // speech is held this long on each side of a silent run
+  double frameSec = 0.010;
+  int threads = 0;              // 0 = hardware concurrency
+};
+
+struct SilenceInterval {
+  double startSec = 0.0;
+  double endSec = 0.0;
+};
+
+struct SilenceResult {
+  bool ok = false;
+  std::vector<SilenceInterval> intervals;
+  std::vector<float> frameDb;   // per-frame energy, reused by spacer refinement
+  double frameSec = 0.0;
+  double analysedSec = 0.0;
+  double elapsedMs = 0.0;
+  int threads = 0;
+};
+
+inline SilenceResult detectSilence(const SampleReaderFactory& factory,
+                                   const SilenceParams& params,
+                                   const std::atomic<bool>* cancel = nullptr) {
+  SilenceResult result;
+  const auto started = std::chrono::steady_clock::now();
+
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0 || probe->numChannels() <= 0) return result;
+  const double sampleRate = probe->sampleRate();
+  const int channels = probe->numChannels();
+  const int64_t length = probe->lengthInSamples();
+  probe.reset();
+
+  const int frameSamples = std::max(1, (int) std::lround(params.frameSec * sampleRate));
+  const int64_t totalFrames = (length + frameSamples - 1) / frameSamples;
+  result.frameSec = (double) frameSamples / sampleRate;
+  result.analysedSec = (double) length / sampleRate;
+  result.frameDb.assign((size_t) totalFrames, -120.0f);
+
+  constexpr int64_t kFramesPerChunk = 4096;
+  const size_t numChunks = (size_t) ((totalFrames + kFramesPerChunk - 1) / kFramesPerChunk);
+  result.threads = analysisThreadCount(params.threads);
+
+  const bool completed = runChunksInParallel(factory, numChunks, result.threads,
+    [&](size_t chunk, SampleReader& reader) {
+      constexpr int kFramesPerRead = 256;
+      std::vector<std::vector<float>> buffers((size_t) channels, std::vector<float>((size_t) kFramesPerRead * frameSamples));
+      std::vector<float*> ptrs((size_t) channels);
+      for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = buffers[(size_t) ch].data();
+
+      const int64_t firstFrame = (int64_t) chunk * kFramesPerChunk;
+      const int64_t lastFrame = std::min(totalFrames, firstFrame + kFramesPerChunk);
+      for (int64_t f = firstFrame; f < lastFrame; f += kFramesPerRead) {
+        const int frames = (int) std::min<int64_t>(kFramesPerRead, lastFrame - f);
+        const int64_t start = f * frameSamples;
+        const int samples = (int) std::min<int64_t>((int64_t) frames * frameSamples, length - start);
+        if (samples <= 0) break;
+        if (!reader.read(ptrs.data(), channels, start, samples)) return false;
+        for (int i = 0; i < frames; ++i) {
+          const int offset = i * frameSamples;
+          const int n = std::min(frameSamples, samples - offset);
+          if (n <= 0) break;
+          double loudest = 0.0;
+          for (int ch = 0; ch < channels; ++ch) {
+            loudest = std::max(loudest, dsp::sumSquares(ptrs[(size_t) ch] + offset, n) / n);
+          }
+          result.frameDb[(size_t) (f + i)] = dsp::powerToDb(loudest);
+        }
+      }
+      return true;
+    }, cancel);
+  if (!completed) return result;
+
+  const int64_t hangoverFrames = (int64_t) std::lround(params.hangoverSec / result.frameSec);
+  const double minDuration = std::max(0.0, params.minDurationSec);
+  const float threshold = (float) params.thresholdDb;
+  int64_t runStart = -1;
+  auto closeRun = [&](int64_t runEnd) {
+    int64_t a = runStart;
+    int64_t b = runEnd;
+    if (a > 0) a += hangoverFrames;
+    if (b < totalFrames) b -= hangoverFrames;
+    if (b <= a) return;
+    const double startSec = (double) a * result.frameSec;
+    const double endSec = std::min(result.analysedSec, (double) b * result.frameSec);
+    if (endSec - startSec >= minDuration) result.intervals.push_back({ startSec, endSec });
+  };
+  for (int64_t f = 0; f < totalFrames; ++f) {
+    const bool silent = result.frameDb[(size_t) f] < threshold;
+    if (silent && runStart < 0) runStart = f;
+    else if (!silent && runStart >= 0) { closeRun(f); runStart = -1; }
+  }
+  if (runStart >= 0) closeRun(totalFrames);
+
+  result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  result.ok = true;
+  return result;
+}
+
+// Spacer refinement: for a spacer with original bounds [start, end), pick the
+// detected silence that overlaps it the most and clip it to the spacer grown
+// by maxShiftSec on each side. Returns false if no silence overlaps.
+inline bool refineSpacerBounds(const std::vector<SilenceInterval>& intervals,
+                               double start, double end, double maxShiftSec,
+                               double& refinedStart, double& refinedEnd) {
+  auto it = std::lower_bound(intervals.begin(), intervals.end(), start - maxShiftSec,
+    [](const SilenceInterval& iv, double t) { return iv.endSec < t; });
+  double bestOverlap = 0.0;
+  bool found = false;
+  for (; it != intervals.end() && it->startSec < end + maxShiftSec; ++it) {
+    const double overlap = std::min(end, it->endSec) - std::max(start, it->startSec);
+    if (overlap > bestOverlap) {
+      bestOverlap = overlap;
+      refinedStart = std::max(it->startSec, start - maxShiftSec);
+      refinedEnd = std::min(it->endSec, end + maxShiftSec);
+      found = true;
+    }
+  }
+  return found;
+}
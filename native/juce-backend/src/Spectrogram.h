@@ -0,0 +1,240 @@
+// Log-magnitude STFT spectrogram in fixed-size tiles, for the editor's
+// spectrogram view. Tiles are in original-file time and come in zoom levels:
+// a level-0 column is one 256-sample hop and each level up is four times
+// wider, its columns holding the maximum of the finer frames they cover so
+// short events (breaths, plosives, clicks) stay visible when zoomed out.
+// Every tile is computed independently, so visible tiles can be made first
+// and the rest filled in the background, on as many threads as there are
+// tiles.
+//
+// Tile file (little-endian), one per tile in the cache directory:
+//   0  "SPG1"
+//   4  u32 level          8  u32 columns        12 u32 rows
+//   16 u32 validColumns   (columns past the end of the file are zero)
+//   20 f32 minDb          24 f32 maxDb
+//   28 u32 fftSize        32 f64 sampleRate
+//   40 i64 firstSample    48 i64 columnHop (samples)
+//   56 u8 data[columns][rows], column-major, lowest frequency first; each
+//      byte maps [minDb, maxDb] onto [0, 255]
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Fft.h"
+#include "SampleReader.h"
+
+namespace spectrogram {
+
+constexpr int kFftSize = 1024;
+constexpr int kRows = 256;      // pairs of FFT bins, Nyquist dropped
+constexpr int kColumns = 256;   // per tile
+constexpr int kBaseHop = 256;   // level-0 column width in samples
+constexpr int kLevels = 4;
+constexpr float kMinDb = -100.0f;
+constexpr float kMaxDb = 0.0f;
+constexpr size_t kHeaderBytes = 56;
+
+inline int64_t columnHop(int level) { return (int64_t) kBaseHop << (2 * level); }
+inline int64_t tileSamples(int level) { return columnHop(level) * kColumns; }
+
+struct TileKey {
+  int level = 0;
+  int64_t index = 0;
+  bool operator==(const TileKey& other) const { return level == other.level && index == other.index; }
+};
+
+// Tiles of level covering original samples [start, end), in time order.
+inline std::vector<TileKey> tilesCovering(int level, int64_t start, int64_t end) {
+  std::vector<TileKey> keys;
+  if (end <= start) return keys;
+  const int64_t span = tileSamples(level);
+  for (int64_t i = std::max<int64_t>(0, start) / span; i <= (end - 1) / span; ++i) keys.push_back({ level, i });
+  return keys;
+}
+
+// Per-thread FFT state. Frames are Hann-windowed mono downmixes; a column
+// holds the largest power of the frames inside it, so the analysis hop is
+// the column width up to the FFT size and the FFT size beyond it.
+class TileRenderer {
+public:
+  TileRenderer() : fft(kFftSize), window((size_t) kFftSize), frame((size_t) kFftSize),
+                   re((size_t) fft.bins()), im((size_t) fft.bins()), power((size_t) kRows), peak((size_t) kRows) {
+    double sum = 0.0;
+    for (int i = 0; i < kFftSize; ++i) {
+      window[(size_t) i] = (float) (0.5 - 0.5 * std::cos(2.0 * 3.14159265358979323846 * i / kFftSize));
+      sum += window[(size_t) i];
+    }
+    // A full-scale sine centred on a bin reads 0 dB.
+    const double fullScale = sum / 2.0;
+    reference = (float) (fullScale * fullScale);
+  }
+
+  // Renders tile key of a file of length samples into data[kColumns * kRows].
+  // Returns the number of columns that start inside the file, or -1 on a read
+  // failure.
+  int render(SampleReader& reader, const TileKey& key, int64_t length, uint8_t* data) {
+    const int64_t hop = columnHop(key.level);
+    const int64_t analysisHop = std::min<int64_t>(hop, kFftSize);
+    const int64_t framesPerColumn = hop / analysisHop;
+    const int64_t first = key.index * tileSamples(key.level);
+    const int valid = (int) std::clamp<int64_t>((length - first + hop - 1) / hop, 0, kColumns);
+    std::memset(data, 0, (size_t) kColumns * kRows);
+    if (valid == 0) return 0;
+
+    // Frame j of column c is centred on the middle of its analysis hop.
+    const int64_t lead = kFftSize / 2 - analysisHop / 2;
+    const int64_t readStart = first - lead;
+    const int64_t readLength = (int64_t) valid * hop + kFftSize;
+    if (!readMono(reader, readStart, readLength)) return -1;
+
+    const float scale = (float) (255.0 / (kMaxDb - kMinDb));
+    for (int c = 0; c < valid; ++c) {
+      std::fill(peak.begin(), peak.end(), 0.0f);
+      for (int64_t j = 0; j < framesPerColumn; ++j) {
+        const float* in = mono.data() + (size_t) ((int64_t) c * hop + j * analysisHop);
+        for (int i = 0; i < kFftSize; ++i) frame[(size_t) i] = in[i] * window[(size_t) i];
+        fft.forward(frame.data(), re.data(), im.data());
+        const float* r = re.data();
+        const float* m = im.data();
+        float* p = power.data();
+        for (int k = 0; k < kRows; ++k) {
+          p[k] = r[2 * k] * r[2 * k] + m[2 * k] * m[2 * k] + r[2 * k + 1] * r[2 * k + 1] + m[2 * k + 1] * m[2 * k + 1];
+        }
+        float* q = peak.data();
+        for (int k = 0; k < kRows; ++k) q[k] = std::max(q[k], p[k]);
+      }
+      uint8_t* out = data + (size_t) c * kRows;
+      for (int k = 0; k < kRows; ++k) {
+        const float db = 10.0f * std::log10(peak[(size_t) k] / reference + 1e-20f);
+        out[k] = (uint8_t) std::clamp((db - kMinDb) * scale + 0.5f, 0.0f, 255.0f);
+      }
+    }
+    return valid;
+  }
+
+private:
+  bool readMono(SampleReader& reader, int64_t start, int64_t count) {
+    const int channels = std::max(1, reader.numChannels());
+    mono.assign((size_t) count, 0.0f);
+    // Samples before the start of the file read as silence.
+    const int64_t pad = std::max<int64_t>(0, -start);
+    if (pad >= count) return true;
+    const int n = (int) (count - pad);
+    planes.resize((size_t) channels);
+    for (auto& plane : planes) plane.resize((size_t) n);
+    std::vector<float*> ptrs((size_t) channels);
+    for (int ch = 0; ch < channels; ++ch) ptrs[(size_t) ch] = planes[(size_t) ch].data();
+    if (!reader.read(ptrs.data(), channels, start + pad, n)) return false;
+    const float gain = 1.0f / (float) channels;
+    float* out = mono.data() + pad;
+    for (int ch = 0; ch < channels; ++ch) {
+      const float* in = planes[(size_t) ch].data();
+      for (int i = 0; i < n; ++i) out[i] += in[i] * gain;
+    }
+    return true;
+  }
+
+  dsp::RealFft fft;
+  std::vector<float> window, frame, re, im, power, peak, mono;
+  std::vector<std::vector<float>> planes;
+  float reference = 1.0f;
+};
+
+inline bool tileExists(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return file.good() && (size_t) file.tellg() == kHeaderBytes + (size_t) kColumns * kRows;
+}
+
+// Writes through a .part file so a reader never sees half a tile.
+inline bool writeTile(const std::string& path, const TileKey& key, int valid, double sampleRate, const uint8_t* data) {
+  uint8_t header[kHeaderBytes] = {};
+  auto put = [&](size_t offset, const void* value, size_t size) { std::memcpy(header + offset, value, size); };
+  const uint32_t level = (uint32_t) key.level, columns = kColumns, rows = kRows, validColumns = (uint32_t) valid;
+  const uint32_t fftSize = kFftSize;
+  const float minDb = kMinDb, maxDb = kMaxDb;
+  const int64_t firstSample = key.index * tileSamples(key.level), hop = columnHop(key.level);
+  std::memcpy(header, "SPG1", 4);
+  put(4, &level, 4);
+  put(8, &columns, 4);
+  put(12, &rows, 4);
+  put(16, &validColumns, 4);
+  put(20, &minDb, 4);
+  put(24, &maxDb, 4);
+  put(28, &fftSize, 4);
+  put(32, &sampleRate, 8);
+  put(40, &firstSample, 8);
+  put(48, &hop, 8);
+  const std::string partPath = path + ".part";
+  {
+    std::ofstream out(partPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), (std::streamsize) sizeof(header));
+    out.write(reinterpret_cast<const char*>(data), (std::streamsize) kColumns * kRows);
+    if (!out.good()) {
+      out.close();
+      std::remove(partPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(partPath.c_str(), path.c_str()) != 0) {
+    std::remove(partPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+struct RenderResult {
+  size_t computed = 0;
+  size_t cached = 0;
+  std::vector<TileKey> written; // the computed tiles
+  bool ok = false;
+};
+
+// Makes sure every tile in keys exists on disk, computing the missing ones
+// in parallel (one tile per chunk).
+inline RenderResult renderTiles(const SampleReaderFactory& factory,
+                                const std::vector<TileKey>& keys,
+                                const std::function<std::string(const TileKey&)>& pathFor,
+                                int threads,
+                                const std::atomic<bool>& cancel) {
+  RenderResult result;
+  std::vector<TileKey> missing;
+  for (const auto& key : keys) {
+    if (tileExists(pathFor(key))) ++result.cached;
+    else missing.push_back(key);
+  }
+  if (missing.empty()) {
+    result.ok = true;
+    return result;
+  }
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0) return result;
+  const double rate = probe->sampleRate();
+  const int64_t length = probe->lengthInSamples();
+  probe.reset();
+  std::vector<char> done(missing.size(), 0);
+  result.ok = runChunksInParallel(factory, missing.size(), threads, [&](size_t index, SampleReader& reader) {
+    thread_local TileRenderer renderer;
+    std::vector<uint8_t> data((size_t) kColumns * kRows);
+    const int valid = renderer.render(reader, missing[index], length, data.data());
+    if (valid < 0) return false;
+    if (!writeTile(pathFor(missing[index]), missing[index], valid, rate, data.data())) return false;
+    done[index] = 1;
+    return true;
+  }, &cancel);
+  for (size_t i = 0; i < missing.size(); ++i) {
+    if (done[i]) result.written.push_back(missing[i]);
+  }
+  result.computed = result.written.size();
+  return result;
+}
+
+} // namespace spectrogram
@@ -0,0 +1,233 @@
+// Transcript search over the compiled timeline. Built alongside the
+// CompiledTimeline whenever the EDL changes: every word segment is split into
+// normalised tokens, stored in edited order, with an inverted index from
+// token to word positions and a sorted vocabulary for prefix lookups. Text
+// queries and edited-time range queries are then hash lookups and binary
+// searches rather than scans over the transcript.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Timeline.h"
+
+struct TextWord {
+  uint32_t segmentIndex = 0; // flattened segment, as in TimelineSpan::segmentIndex
+  uint32_t token = 0;        // vocabulary id
+  int clipIndex = -1;
+  double editedStart = 0.0;
+  double editedEnd = 0.0;
+  double originalStart = 0.0;
+  double originalEnd = 0.0;
+};
+
+// A match covers words [first, first + count).
+struct TextMatch {
+  size_t first = 0;
+  size_t count = 0;
+};
+
+class TextIndex {
+public:
+  // Lower-case ASCII, keep letters, digits, non-ASCII bytes and apostrophes
+  // inside a word (a typographic apostrophe counts as one); everything else
+  // separates tokens.
+  static std::vector<std::string> tokenise(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string current;
+    auto flush = [&]() {
+      while (!current.empty() && current.back() == '\'') current.pop_back();
+      if (!current.empty()) tokens.push_back(current);
+      current.clear();
+    };
+    for (size_t i = 0; i < text.size(); ++i) {
+      const unsigned char c = (unsigned char) text[i];
+      if (c == 0xE2 && i + 2 < text.size() && (unsigned char) text[i + 1] == 0x80 && (unsigned char) text[i + 2] == 0x99) {
+        if (!current.empty()) current.push_back('\'');
+        i += 2;
+      } else if (c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')) {
+        current.push_back((char) c);
+      } else if (c >= 'A' && c <= 'Z') {
+        current.push_back((char) (c - 'A' + 'a'));
+      } else if (c == '\'' && !current.empty()) {
+        current.push_back('\'');
+      } else {
+        flush();
+      }
+    }
+    flush();
+    return tokens;
+  }
+
+  // Appends the tokens of one word segment. Spans must arrive in edited order.
+  void add(const std::string& text, const TimelineSpan& span) {
+    for (const auto& token : tokenise(text)) {
+      TextWord word;
+      word.segmentIndex = (uint32_t) std::max(0, span.segmentIndex);
+      word.clipIndex = span.clipIndex;
+      word.editedStart = span.editedStart;
+      word.editedEnd = span.editedEnd;
+      word.originalStart = span.originalStart;
+      word.originalEnd = span.originalEnd;
+      auto it = ids.find(token);
+      if (it == ids.end()) {
+        it = ids.emplace(token, (uint32_t) vocabulary.size()).first;
+        vocabulary.push_back(token);
+        postings.emplace_back();
+      }
+      word.token = it->second;
+      postings[word.token].push_back((uint32_t) words.size());
+      words.push_back(word);
+      tokenAt.push_back(word.token);
+    }
+    sortedVocabulary.clear();
+  }
+
+  // Call once after the last add(); builds the prefix lookup.
+  void finish() {
+    sortedVocabulary.resize(vocabulary.size());
+    for (uint32_t i = 0; i < (uint32_t) vocabulary.size(); ++i) sortedVocabulary[i] = i;
+    std::sort(sortedVocabulary.begin(), sortedVocabulary.end(),
+              [this](uint32_t a, uint32_t b) { return vocabulary[a] < vocabulary[b]; });
+  }
+
+  size_t size() const { return words.size(); }
+  size_t vocabularySize() const { return vocabulary.size(); }
+  const TextWord& operator[](size_t i) const { return words[i]; }
+  const std::string& tokenText(uint32_t token) const { return vocabulary[token]; }
+
+  // Approximate heap footprint.
+  size_t memoryBytes() const {
+    size_t total = words.capacity() * sizeof(TextWord) + tokenAt.capacity() * sizeof(uint32_t) +
+                   sortedVocabulary.capacity() * sizeof(uint32_t) + postings.capacity() * sizeof(postings[0]);
+    for (const auto& list : postings) total += list.capacity() * sizeof(uint32_t);
+    // Each token text is held by vocabulary and by a hash node in ids.
+    for (const auto& token : vocabulary) total += 2 * (sizeof(std::string) + token.capacity()) + 2 * sizeof(void*);
+    return total;
+  }
+
+  // Occurrences of the query phrase whose first word starts in
+  // [fromSec, toSec), in edited order. With prefix the last query token
+  // matches any token it begins. total receives the number of matches even
+  // when more than maxResults were found.
+  std::vector<TextMatch> find(const std::string& query, bool prefix, double fromSec, double toSec,
+                              size_t maxResults, size_t* total = nullptr) const {
+    std::vector<TextMatch> matches;
+    size_t found = 0;
+    const std::vector<std::string> terms = tokenise(query);
+    if (terms.empty() || words.empty()) {
+      if (total) *total = 0;
+      return matches;
+    }
+    // Resolve every term except a prefix last term to a token id up front.
+    const size_t exactTerms = prefix ? terms.size() - 1 : terms.size();
+    std::vector<uint32_t> termIds(exactTerms);
+    for (size_t i = 0; i < exactTerms; ++i) {
+      const auto it = ids.find(terms[i]);
+      if (it == ids.end()) {
+        if (total) *total = 0;
+        return matches;
+      }
+      termIds[i] = it->second;
+    }
+    std::vector<uint32_t> lastTokens;
+    if (prefix) lastTokens = tokensWithPrefix(terms.back());
+    if (prefix && lastTokens.empty()) {
+      if (total) *total = 0;
+      return matches;
+    }
+
+    // Walk the shortest posting list among the exact terms (the anchor) and
+    // check the rest of the phrase around each hit. A single prefix term has
+    // no exact term, so its tokens' postings are merged instead.
+    std::vector<uint32_t> merged;
+    const std::vector<uint32_t>* candidates = nullptr;
+    size_t anchor = 0;
+    if (exactTerms > 0) {
+      for (size_t t = 1; t < exactTerms; ++t) {
+        if (postings[termIds[t]].size() < postings[termIds[anchor]].size()) anchor = t;
+      }
+      candidates = &postings[termIds[anchor]];
+    } else {
+      for (uint32_t token : lastTokens) merged.insert(merged.end(), postings[token].begin(), postings[token].end());
+      std::sort(merged.begin(), merged.end());
+      candidates = &merged;
+    }
+
+    const size_t first = firstCandidateStartingAt(*candidates, anchor, fromSec);
+    if (terms.size() == 1) {
+      // Every candidate matches: the total is the size of the time window.
+      const size_t last = firstCandidateStartingAt(*candidates, 0, toSec);
+      for (size_t c = first; c < last && matches.size() < maxResults; ++c) matches.push_back({ (*candidates)[c], 1 });
+      if (total) *total = last - first;
+      return matches;
+    }
+    for (size_t c = first; c < candidates->size(); ++c) {
+      if ((*candidates)[c] < anchor) continue;
+      const size_t w = (*candidates)[c] - anchor;
+      if (w + terms.size() > words.size()) break;
+      bool ok = true;
+      for (size_t t = 0; t < exactTerms && ok; ++t) ok = t == anchor || tokenAt[w + t] == termIds[t];
+      if (ok && prefix) {
+        ok = std::binary_search(lastTokens.begin(), lastTokens.end(), tokenAt[w + terms.size() - 1]);
+      }
+      if (!ok) continue;
+      if (words[w].editedStart >= toSec) break;
+      if (matches.size() < maxResults) matches.push_back({ w, terms.size() });
+      ++found;
+    }
+    if (total) *total = found;
+    return matches;
+  }
+
+  // Words overlapping edited range [startSec, endSec): indices [first, last).
+  std::pair<size_t, size_t> wordsInRange(double startSec, double endSec) const {
+    const auto begin = std::upper_bound(words.begin(), words.end(), startSec,
+                                        [](double t, const TextWord& w) { return t < w.editedEnd; });
+    const auto end = std::lower_bound(begin, words.end(), endSec,
+                                      [](const TextWord& w, double t) { return w.editedStart < t; });
+    return { (size_t) (begin - words.begin()), (size_t) (end - words.begin()) };
+  }
+
+  // First word of the given flattened segment, or size(). Segments are
+  // compiled in index order, so words are sorted by segment as well.
+  size_t wordForSegment(size_t segmentIndex) const {
+    const auto it = std::lower_bound(words.begin(), words.end(), segmentIndex,
+                                     [](const TextWord& w, size_t s) { return w.segmentIndex < s; });
+    return it != words.end() && it->segmentIndex == segmentIndex ? (size_t) (it - words.begin()) : words.size();
+  }
+
+private:
+  // Sorted token ids whose text starts with prefix.
+  std::vector<uint32_t> tokensWithPrefix(const std::string& prefix) const {
+    std::vector<uint32_t> tokens;
+    auto it = std::lower_bound(sortedVocabulary.begin(), sortedVocabulary.end(), prefix,
+                               [this](uint32_t id, const std::string& p) { return vocabulary[id] < p; });
+    for (; it != sortedVocabulary.end() && vocabulary[*it].compare(0, prefix.size(), prefix) == 0; ++it) tokens.push_back(*it);
+    std::sort(tokens.begin(), tokens.end());
+    return tokens;
+  }
+
+  // First position in list whose phrase start (entry - offset) begins at or
+  // after sec. Entries below offset cannot start a phrase and sort first.
+  size_t firstCandidateStartingAt(const std::vector<uint32_t>& list, size_t offset, double sec) const {
+    if (!(sec > -std::numeric_limits<double>::infinity())) return 0;
+    if (!(sec < std::numeric_limits<double>::infinity())) return list.size();
+    const auto it = std::lower_bound(list.begin(), list.end(), sec, [this, offset](uint32_t w, double t) {
+      return w < offset || words[w - offset].editedStart < t;
+    });
+    return (size_t) (it - list.begin());
+  }
+
+  std::vector<TextWord> words;                       // edited order
+  std::vector<uint32_t> tokenAt;                     // words[i].token, packed for phrase checks
+  std::vector<std::string> vocabulary;               // token id -> text
+  std::unordered_map<std::string, uint32_t> ids;     // text -> token id
+  std::vector<std::vector<uint32_t>> postings;       // token id -> word positions, ascending
+  std::vector<uint32_t> sortedVocabulary;            // token ids ordered by text
+};
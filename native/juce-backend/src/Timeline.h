@@ -0,0 +1,165 @@
+// Immutable, flattened view of the current EDL for lookups off the command
+// thread. The Backend compiles one whenever the segments change and hands it
+// to the audio thread through a SnapshotExchange; mapping an edited time is a
+// binary search instead of a walk over every segment. An index by original
+// time lets a playhead follow the audio it was playing into the next EDL.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// One playable segment: edited range [editedStart, editedEnd) plays original
+// range [originalStart, originalEnd).
+struct TimelineSpan {
+  double editedStart = 0.0;
+  double editedEnd = 0.0;
+  double originalStart = 0.0;
+  double originalEnd = 0.0;
+  int clipIndex = -1;
+  int segmentIndex = -1;
+};
+
+// A playhead expressed as a span and a moment of the original file inside it.
+struct TimelinePlayhead {
+  size_t span = 0;
+  double originalSec = 0.0;
+};
+
+class CompiledTimeline {
+public:
+  // Spans in edited order. Edited starts are the running sum of durations,
+  // matching how the Backend has always mapped edited time.
+  void add(double editedDur, double originalStart, double originalEnd, int clipIndex, int segmentIndex) {
+    if (!(editedDur > 0.0) || !(originalEnd > originalStart)) return;
+    TimelineSpan span;
+    span.editedStart = spans.empty() ? 0.0 : spans.back().editedEnd;
+    span.editedEnd = span.editedStart + editedDur;
+    span.originalStart = originalStart;
+    span.originalEnd = originalEnd;
+    span.clipIndex = clipIndex;
+    span.segmentIndex = segmentIndex;
+    spans.push_back(span);
+  }
+
+  // Builds the original-order index behind spanAtOriginal() and follow().
+  // Call once after the last add().
+  void finish() {
+    byOriginal.resize(spans.size());
+    std::iota(byOriginal.begin(), byOriginal.end(), (size_t) 0);
+    std::stable_sort(byOriginal.begin(), byOriginal.end(),
+                     [&](size_t a, size_t b) { return spans[a].originalStart < spans[b].originalStart; });
+    reach.resize(byOriginal.size());
+    double furthest = -HUGE_VAL;
+    for (size_t k = 0; k < byOriginal.size(); ++k) {
+      furthest = std::max(furthest, spans[byOriginal[k]].originalEnd);
+      reach[k] = furthest;
+    }
+  }
+
+  bool empty() const { return spans.empty(); }
+  size_t size() const { return spans.size(); }
+  const TimelineSpan& operator[](size_t i) const { return spans[i]; }
+  const std::vector<TimelineSpan>& all() const { return spans; }
+  double editedDuration() const { return spans.empty() ? 0.0 : spans.back().editedEnd; }
+
+  // Index of the span holding edited time t (the first one whose end is at or
+  // after t), or size() when t is past the end.
+  size_t spanAtEdited(double t) const {
+    const auto it = std::lower_bound(spans.begin(), spans.end(), t,
+                                     [](const TimelineSpan& s, double value) { return s.editedEnd < value; });
+    return (size_t) (it - spans.begin());
+  }
+
+  double editedToOriginal(double t) const {
+    if (spans.empty()) return t;
+    const size_t i = spanAtEdited(t);
+    if (i >= spans.size()) return spans.back().originalEnd;
+    const TimelineSpan& s = spans[i];
+    const double r = std::clamp((t - s.editedStart) / (s.editedEnd - s.editedStart), 0.0, 1.0);
+    return s.originalStart + r * (s.originalEnd - s.originalStart);
+  }
+
+  double editedAt(const TimelinePlayhead& at) const {
+    if (at.span >= spans.size()) return editedDuration();
+    const TimelineSpan& s = spans[at.span];
+    const double r = std::clamp((at.originalSec - s.originalStart) / (s.originalEnd - s.originalStart), 0.0, 1.0);
+    return s.editedStart + r * (s.editedEnd - s.editedStart);
+  }
+
+  // Index of a span playing original time sec, or size(). When the same
+  // material is used more than once, the use that plays sec nearest
+  // editedHint wins.
+  size_t spanAtOriginal(double sec, double editedHint) const {
+    size_t best = spans.size();
+    double bestDistance = HUGE_VAL;
+    // Spans starting at or before sec, scanned back until none can reach it.
+    for (size_t k = startingAtOrBefore(sec); k-- > 0 && reach[k] > sec;) {
+      const TimelineSpan& s = spans[byOriginal[k]];
+      if (s.originalEnd <= sec) continue;
+      const double scale = (s.editedEnd - s.editedStart) / (s.originalEnd - s.originalStart);
+      const double distance = std::fabs(s.editedStart + (sec - s.originalStart) * scale - editedHint);
+      if (distance < bestDistance) {
+        best = byOriginal[k];
+        bestDistance = distance;
+      }
+    }
+    return best;
+  }
+
+  // Where a playhead at originalSec in span `from` of `before` carries on once
+  // this timeline replaces it: the same original moment if it survived the
+  // edit, otherwise the next material of `before`, in its edited order, that
+  // did. Looks at most kMaxFollowSpans spans ahead, so the cost is a bounded
+  // number of binary searches; span is size() when nothing within reach
+  // survived.
+  static constexpr size_t kMaxFollowSpans = 64;
+
+  TimelinePlayhead follow(const CompiledTimeline& before, size_t from, double originalSec, double editedHint) const {
+    TimelinePlayhead at;
+    at.span = spans.size();
+    if (byOriginal.size() != spans.size()) return at; // finish() not called
+    const size_t last = std::min(before.size(), from + kMaxFollowSpans);
+    for (size_t i = from; i < last; ++i) {
+      const TimelineSpan& old = before[i];
+      const double sec = i == from ? std::max(originalSec, old.originalStart) : old.originalStart;
+      if (sec >= old.originalEnd) continue;
+      const size_t holding = spanAtOriginal(sec, editedHint);
+      if (holding < spans.size()) return { holding, sec };
+      // Part of this span was cut: the first surviving piece after sec.
+      const size_t k = startingAtOrBefore(sec);
+      if (k < byOriginal.size() && spans[byOriginal[k]].originalStart < old.originalEnd) {
+        return { byOriginal[k], spans[byOriginal[k]].originalStart };
+      }
+    }
+    return at;
+  }
+
+  // follow() in edited seconds, for callers that only keep an edited time.
+  // Past the end of `before` the playhead stays at the end; when nothing
+  // within reach survived it keeps its edited time.
+  double remapEdited(const CompiledTimeline& before, double editedSec) const {
+    if (before.empty() || spans.empty()) return std::clamp(editedSec, 0.0, editedDuration());
+    const size_t from = before.spanAtEdited(editedSec);
+    if (from >= before.size()) return editedDuration();
+    const TimelinePlayhead at = follow(before, from, before.editedToOriginal(editedSec), editedSec);
+    if (at.span >= spans.size()) return std::clamp(editedSec, 0.0, editedDuration());
+    return editedAt(at);
+  }
+
+  size_t indexBytes() const { return byOriginal.capacity() * sizeof(size_t) + reach.capacity() * sizeof(double); }
+
+private:
+  // Number of spans whose original start is at or before sec.
+  size_t startingAtOrBefore(double sec) const {
+    const auto it = std::upper_bound(byOriginal.begin(), byOriginal.end(), sec,
+                                     [&](double value, size_t i) { return value < spans[i].originalStart; });
+    return (size_t) (it - byOriginal.begin());
+  }
+
+  std::vector<TimelineSpan> spans;
+  std::vector<size_t> byOriginal; // span indices by original start
+  std::vector<double> reach;      // furthest original end among byOriginal[0 .. k]
+};
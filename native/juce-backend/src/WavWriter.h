@@ -0,0 +1,86 @@
+// Streaming WAV writer (32-bit float or 16/24-bit PCM) used by the offline
+// render and export commands. The RIFF sizes are patched when the file is
+// closed, so a half-written file is detectable by its zero data size.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class WavFileWriter {
+public:
+  WavFileWriter(const std::string& path, double sampleRate, int channels, int bitsPerSample = 32)
+    : channels(channels), bits(bitsPerSample) {
+    if (bits != 16 && bits != 24) bits = 32;
+    file = std::fopen(path.c_str(), "wb");
+    if (!file || channels <= 0) return;
+    const uint16_t format = bits == 32 ? 3 : 1;
+    const uint32_t rate = (uint32_t) std::lround(sampleRate);
+    const uint16_t blockAlign = (uint16_t) (channels * (bits / 8));
+    writeBytes("RIFF", 4); write32(0); writeBytes("WAVE", 4);
+    writeBytes("fmt ", 4); write32(16); write16(format); write16((uint16_t) channels);
+    write32(rate); write32(rate * blockAlign); write16(blockAlign); write16((uint16_t) bits);
+    writeBytes("data", 4); write32(0);
+  }
+
+  ~WavFileWriter() { close(); }
+
+  bool isOpen() const { return file != nullptr; }
+  uint64_t framesWritten() const { return frames; }
+
+  // Interleaves and writes n frames from planar channel pointers.
+  bool write(const float* const* data, int n) {
+    if (!file || n <= 0) return file != nullptr;
+    const size_t bytesPerSample = (size_t) bits / 8;
+    interleaved.resize((size_t) n * (size_t) channels * bytesPerSample);
+    unsigned char* out = interleaved.data();
+    for (int i = 0; i < n; ++i) {
+      for (int ch = 0; ch < channels; ++ch) {
+        const float v = data[ch][i];
+        if (bits == 32) {
+          std::memcpy(out, &v, 4);
+        } else {
+          const float clamped = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+          const int32_t q = (int32_t) std::lround(clamped * (bits == 16 ? 32767.0f : 8388607.0f));
+          out[0] = (unsigned char) (q & 0xFF);
+          out[1] = (unsigned char) ((q >> 8) & 0xFF);
+          if (bits == 24) out[2] = (unsigned char) ((q >> 16) & 0xFF);
+        }
+        out += bytesPerSample;
+      }
+    }
+    if (std::fwrite(interleaved.data(), 1, interleaved.size(), file) != interleaved.size()) return false;
+    frames += (uint64_t) n;
+    return true;
+  }
+
+  bool close() {
+    if (!file) return false;
+    const uint64_t dataBytes = frames * (uint64_t) channels * (uint64_t) (bits / 8);
+    const uint32_t clamped = dataBytes > 0xFFFFFFFFull - 36 ? 0xFFFFFFFFu - 36 : (uint32_t) dataBytes;
+    bool ok = std::fseek(file, 4, SEEK_SET) == 0;
+    ok = ok && write32(36 + clamped);
+    ok = ok && std::fseek(file, 40, SEEK_SET) == 0;
+    ok = ok && write32(clamped);
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+  }
+
+private:
+  bool writeBytes(const char* p, size_t n) { return std::fwrite(p, 1, n, file) == n; }
+  bool write16(uint16_t v) { unsigned char b[2] = { (unsigned char) v, (unsigned char) (v >> 8) }; return std::fwrite(b, 1, 2, file) == 2; }
+  bool write32(uint32_t v) {
+    unsigned char b[4] = { (unsigned char) v, (unsigned char) (v >> 8), (unsigned char) (v >> 16), (unsigned char) (v >> 24) };
+    return std::fwrite(b, 1, 4, file) == 4;
+  }
+
+  std::FILE* file = nullptr;
+  int channels = 0;
+  int bits = 32;
+  uint64_t frames = 0;
+  std::vector<unsigned char> interleaved;
+};
@@ -2,21 +2,32 @@
 // Build with -DUSE_JUCE=ON and set JUCE_DIR to compile real audio engine.
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <csignal>
 #include <cstring>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
@@ -29,12 +40,43 @@
 #include <juce_core/juce_core.h>
 #endif
 
+#include "ArtifactCache.h"
+#include "ClipChain.h"
+#include "CutRefiner.h"
+#include "Denoise.h"
+#include "DspKernels.h"
+#include "EventWriter.h"
+#include "JobSystem.h"
+#include "LockFree.h"
+#include "Loudness.h"
+#include "MappedFile.h"
+#include "Metrics.h"
+#include "Peaks.h"
+#include "PrerollCache.h"
+#include "Resampler.h"
+#include "RevisionCache.h"
+#include "RtSafety.h"
+#include "SampleReader.h"
+#include "SessionCapture.h"
+#include "Sidecar.h"
+#include "SilenceDetector.h"
+#include "Spectrogram.h"
+#include "TextIndex.h"
+#include "Timeline.h"
+#include "WavWriter.h"
+
 struct State {
   std::string id;
+  std::string path;
   std::atomic<bool> playing{false};
   std::atomic<bool> running{true};
   std::atomic<double> editedSec{0.0};
   double durationSec{60.0};
+  // Mock strip settings, applied by renderEdited only.
+  StripStore strips;
+  // Mock noise-reduced copy of path, used by renderEdited. Guarded by gMutex.
+  std::string denoisedPath;
+  bool denoiseEnabled = true;
 };
 
 static State g;
@@ -96,9 +138,265 @@ static std::string jsonEscape(const std::string& value) {
   return escaped.str();
 }
 
+// --- Event output ---
+static EventWriter gEvents;
+static metrics::Registry gMetrics;
+
+// Events by type, counted while replaying a capture so two runs can be
+// compared. Position and meter events are coalesced and paced by the wall
+// clock, so they bypass emit() and are not counted.
+struct EventTally {
+  std::atomic<bool> enabled{false};
+  std::mutex mutex;
+  std::map<std::string, uint64_t> counts;
+
+  void observe(const std::string& json) {
+    const size_t p = json.find("\"type\":\"");
+    if (p == std::string::npos) return;
+    const size_t end = json.find('"', p + 8);
+    if (end == std::string::npos) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    ++counts[json.substr(p + 8, end - (p + 8))];
+  }
+};
+
+static EventTally gEventTally;
+
 static void emit(const std::string& json) {
-  std::cout << json << "\n";
-  std::cout.flush();
+  if (gEventTally.enabled.load(std::memory_order_relaxed)) gEventTally.observe(json);
+  gEvents.push(json);
+}
+
+static void emitPositionJson(const std::string& json) {
+  gEvents.pushCoalesced(CoalesceKey::Position, json);
+}
+
+static void emitOutputStats() {
+  std::ostringstream evt;
+  evt << "{\"type\":\"outputStats\",\"id\":\"" << g.id << "\""
+      << ",\"enqueued\":" << gEvents.enqueued.load()
+      << ",\"written\":" << gEvents.written.load()
+      << ",\"dropped\":" << gEvents.dropped.load()
+      << ",\"lost\":" << gEvents.lost.load()
+      << ",\"coalesced\":" << gEvents.coalesced.load()
+      << ",\"depth\":" << gEvents.depth()
+      << ",\"highWater\":" << gEvents.highWater.load()
+      << ",\"capacity\":" << EventWriter::kCapacity << "}";
+  emit(evt.str());
+}
+
+static void writeHistogramJson(std::ostringstream& evt, const metrics::LatencyHistogram& histogram) {
+  const metrics::HistogramSnapshot s = histogram.snapshot();
+  evt << "\"count\":" << s.count << ",\"meanUs\":" << s.meanUs << ",\"p50Us\":" << s.p50Us
+      << ",\"p90Us\":" << s.p90Us << ",\"p99Us\":" << s.p99Us << ",\"p999Us\":" << s.p999Us << ",\"maxUs\":" << s.maxUs;
+}
+
+// One snapshot of gMetrics. Reads atomics only, so any thread may call it.
+static void emitMetrics() {
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(1);
+  const double uptimeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - gMetrics.started).count();
+  const metrics::HistogramSnapshot callback = gMetrics.callbackUs.snapshot();
+  const uint64_t budgetUs = gMetrics.callbackBudgetUs.load();
+  evt << "{\"type\":\"metrics\",\"id\":\"" << g.id << "\",\"uptimeSec\":" << uptimeSec;
+  evt << ",\"audio\":{";
+  writeHistogramJson(evt, gMetrics.callbackUs);
+  evt << ",\"budgetUs\":" << budgetUs
+      << ",\"loadP99\":" << std::setprecision(3) << (budgetUs ? callback.p99Us / (double) budgetUs : 0.0) << std::setprecision(1)
+      << ",\"overBudget\":" << gMetrics.overBudget.load()
+      << ",\"gaps\":" << gMetrics.callbackGaps.load()
+      << ",\"deviceXruns\":" << gMetrics.deviceXruns.load() << "}";
+  evt << ",\"timer\":{";
+  writeHistogramJson(evt, gMetrics.timerTickUs);
+  evt << "},\"commands\":{";
+  bool first = true;
+  gMetrics.commands.forEach([&](const char* name, const metrics::LatencyHistogram& histogram) {
+    if (histogram.count() == 0) return;
+    evt << (first ? "" : ",") << "\"" << jsonEscape(name) << "\":{";
+    writeHistogramJson(evt, histogram);
+    evt << "}";
+    first = false;
+  });
+  evt << "},\"lanes\":{\"control\":{";
+  writeHistogramJson(evt, gMetrics.controlQueueUs);
+  evt << "},\"work\":{";
+  writeHistogramJson(evt, gMetrics.workQueueUs);
+  evt << ",\"depth\":" << gMetrics.workDepth.load() << ",\"highWater\":" << gMetrics.workHighWater.load() << "}";
+  evt << "},\"edl\":{\"parse\":{";
+  writeHistogramJson(evt, gMetrics.edlParseUs);
+  evt << "},\"compile\":{";
+  writeHistogramJson(evt, gMetrics.edlCompileUs);
+  evt << "},\"payloadBytes\":" << gMetrics.edlPayloadBytes.load()
+      << ",\"copiedBytes\":" << gMetrics.edlCopiedBytes.load()
+      << ",\"segments\":" << gMetrics.edlSegments.load() << "}";
+  evt << ",\"output\":{\"depth\":" << gEvents.depth()
+      << ",\"highWater\":" << gEvents.highWater.load()
+      << ",\"capacity\":" << EventWriter::kCapacity
+      << ",\"dropped\":" << gEvents.dropped.load()
+      << ",\"lost\":" << gEvents.lost.load()
+      << ",\"coalesced\":" << gEvents.coalesced.load() << "}";
+  evt << ",\"memory\":{\"residentBytes\":" << metrics::residentBytes()
+      << ",\"prerollBytes\":" << gMetrics.prerollBytes.load()
+      << ",\"edlBytes\":" << gMetrics.edlBytes.load()
+      << ",\"revisionCacheBytes\":" << gMetrics.revisionCacheBytes.load()
+      << ",\"eventQueueBytes\":" << EventWriter::kCapacity * sizeof(OutboundEvent) << "}}";
+  emit(evt.str());
+}
+
+// Real-time safety report: what the audio callback did that it should not
+// (see RtSafety.h). Builds without RT_SAFETY_CHECKS report enabled:false.
+static void emitRtSafety(bool reset) {
+  const rt::Report report = rt::report();
+  if (reset) rt::reset();
+  std::ostringstream evt;
+  evt << "{\"type\":\"rtSafety\",\"id\":\"" << g.id << "\",\"enabled\":" << (report.enabled ? "true" : "false")
+      << ",\"trap\":" << (report.trap ? "true" : "false") << ",\"counts\":{";
+  for (size_t k = 0; k < (size_t) rt::Violation::Count; ++k) {
+    evt << (k ? "," : "") << "\"" << rt::violationName((rt::Violation) k) << "\":" << report.counts[k];
+  }
+  evt << "},\"droppedSites\":" << report.droppedSites << ",\"sites\":[";
+  for (size_t i = 0; i < report.sites.size(); ++i) {
+    const auto& site = report.sites[i];
+    evt << (i ? "," : "") << "{\"kind\":\"" << rt::violationName(site.kind) << "\",\"what\":\"" << jsonEscape(site.what)
+        << "\",\"count\":" << site.count << ",\"stack\":[";
+    for (size_t f = 0; f < site.stack.size(); ++f) evt << (f ? "," : "") << "\"" << jsonEscape(site.stack[f]) << "\"";
+    evt << "]}";
+  }
+  evt << "]}";
+  emit(evt.str());
+}
+
+// Latency histogram for a command line, by its "type".
+static metrics::LatencyHistogram* commandHistogram(const std::string& line) {
+  static const char kKey[] = "\"type\":\"";
+  const size_t p = line.find(kKey);
+  if (p == std::string::npos) return gMetrics.commands.forType("unknown", 7);
+  const size_t start = p + sizeof(kKey) - 1;
+  const size_t end = line.find('"', start);
+  if (end == std::string::npos) return gMetrics.commands.forType("unknown", 7);
+  return gMetrics.commands.forType(line.data() + start, end - start);
+}
+
+// Emits a metrics event every interval while one is set. Off by default.
+class MetricsReporter {
+public:
+  void start() {
+    if (thread.joinable()) return;
+    thread = std::thread([this] { run(); });
+  }
+
+  void stop() {
+    if (!thread.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+  }
+
+  // 0 turns periodic reporting off.
+  void setIntervalMs(int ms) {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      intervalMs = std::clamp(ms, 0, 3600000);
+      if (intervalMs > 0) intervalMs = std::max(intervalMs, 100);
+    }
+    wake.notify_one();
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!stopping) {
+      if (intervalMs <= 0) {
+        wake.wait(lock);
+        continue;
+      }
+      const int waited = intervalMs;
+      if (wake.wait_for(lock, std::chrono::milliseconds(waited), [&] { return stopping || intervalMs != waited; })) continue;
+      lock.unlock();
+      emitMetrics();
+      lock.lock();
+    }
+  }
+
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  int intervalMs = 0;
+  bool stopping = false;
+  std::thread thread;
+};
+
+static MetricsReporter gMetricsReporter;
+
+// --- Session capture ---
+// Records the command stream for --replay (see SessionCapture.h). Started by
+// JUCE_CAPTURE_FILE at launch or by startCapture. Command thread only.
+static CaptureWriter gCapture;
+
+static void emitCaptureState() {
+  std::ostringstream evt;
+  evt << "{\"type\":\"captureState\",\"id\":\"" << g.id << "\",\"active\":" << (gCapture.isOpen() ? "true" : "false")
+      << ",\"path\":\"" << jsonEscape(gCapture.path()) << "\",\"bytes\":" << gCapture.bytesWritten() << "}";
+  emit(evt.str());
+}
+
+static void startCapture(const std::string& path) {
+  if (path.empty() || !gCapture.open(path)) {
+    emit("{\"type\":\"error\",\"message\":\"Unable to open capture file\"}");
+    return;
+  }
+  juceDLog("[JUCE] capturing commands to " + path);
+  emitCaptureState();
+}
+
+static void stopCapture() {
+  gCapture.close();
+  emitCaptureState();
+}
+
+// Records one incoming command, preceded by the contents of the EDL file it
+// references (the handler deletes that file) or the size of the audio it loads.
+static void captureCommand(const std::string& line) {
+  auto pathField = [&]() -> std::string {
+    const size_t p = line.find("\"path\":\"");
+    if (p == std::string::npos) return {};
+    const size_t end = line.find('"', p + 8);
+    return end == std::string::npos ? std::string() : line.substr(p + 8, end - (p + 8));
+  };
+  if (line.find("\"type\":\"updateEdlFromFile\"") != std::string::npos) {
+    std::string path = pathField();
+    MappedFile file;
+    std::string error;
+    bool read = !path.empty() && file.open(path, error);
+#if !defined(_WIN32)
+    // A descriptor handoff is recorded as a path, which --replay rewrites to
+    // the staged copy like any other.
+    const size_t fdKey = line.find("\"fd\":");
+    if (path.empty() && fdKey != std::string::npos) {
+      const size_t start = fdKey + 5;
+      const size_t end = std::min(line.find_first_of(",}", start), line.size());
+      const int fd = end > start ? (int) std::strtol(line.c_str() + start, nullptr, 10) : -1;
+      if (fd >= 0 && file.peek(fd, error)) {
+        path = "fd:" + std::to_string(fd);
+        read = true;
+        std::string recorded = line;
+        recorded.replace(fdKey, end - fdKey, "\"path\":\"" + path + "\"");
+        gCapture.attach(path, std::string(file.view()));
+        gCapture.command(recorded);
+        return;
+      }
+    }
+#endif
+    if (read) gCapture.attach(path, std::string(file.view()));
+  } else if (line.find("\"type\":\"load\"") != std::string::npos) {
+    const std::string path = pathField();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (file.good()) gCapture.media(path, (uint64_t) std::max<std::streamoff>(0, file.tellg()));
+  }
+  gCapture.command(line);
 }
 
 static void emitEdlAppliedEvent(
@@ -141,6 +439,18 @@ static void emitEdlAppliedEvent(
   emit(evt.str());
 }
 
+static void emitRevisionCacheStats(const RevisionCacheStats& stats) {
+  std::ostringstream evt;
+  evt << "{\"type\":\"revisionCacheStats\",\"id\":\"" << g.id << "\""
+      << ",\"entries\":" << stats.entries
+      << ",\"bytes\":" << stats.bytes
+      << ",\"maxBytes\":" << stats.maxBytes
+      << ",\"hits\":" << stats.hits
+      << ",\"misses\":" << stats.misses
+      << ",\"evictions\":" << stats.evictions << "}";
+  emit(evt.str());
+}
+
 static void emitLoaded(double sampleRate = 48000.0, int channels = 2) {
   emit(std::string("{") +
        "\"type\":\"loaded\",\"id\":\"" + g.id + "\",\"durationSec\":" + std::to_string(g.durationSec) +
@@ -152,583 +462,4970 @@ static void emitState() {
        "\"type\":\"state\",\"id\":\"" + g.id + "\",\"playing\":" + (g.playing ? "true" : "false") + "}");
 }
 
-static void emitPosition() {
-  // originalSec mirrors editedSec in this mock
-  const double es = g.editedSec.load();
-  emit(std::string("{") +
-       "\"type\":\"position\",\"id\":\"" + g.id + "\",\"editedSec\":" + std::to_string(es) +
-       ",\"originalSec\":" + std::to_string(es) + "}");
+// --- Command lanes ---
+// Commands are read on the main thread. Transport, volume, rate and state
+// queries run there straight away (the control lane). EDL ingest, and
+// anything that reads the EDL or starts offline work, goes to one worker in
+// arrival order (the work lane): a large updateEdlFromFile no longer holds up
+// a play or pause behind it, and every EDL-dependent command still sees the
+// revisions sent before it. seek, playRange and setLoop carry edited times,
+// so one sent while an EDL change is still queued or compiling is stamped
+// with the number of EDL changes sent before it and run by the worker right
+// after that many have been applied, before the next one: its times land in
+// the EDL it was sent against, and nothing else waits for it. `load` waits
+// for the work lane to empty and then runs on the main thread, so nothing
+// queued for the old file lands on the new one. Replays run every command
+// inline, in order.
+enum class CommandLane { Control, Positioned, Work, EdlChange, Barrier };
+
+static CommandLane laneFor(const std::string& line) {
+  static const char kKey[] = "\"type\":\"";
+  static const char* const kEdlChange[] = { "updateEdlFromFile", "updateEdl", "activateRevision" };
+  static const char* const kPositioned[] = { "seek", "playRange", "setLoop" };
+  static const char* const kWork[] = {
+    "getRevisionCacheStats", "setRevisionCache",
+    "getArtifactCacheStats", "setArtifactCache", "saveSidecar", "openSidecar",
+    "analyzeSilence", "analyzeLoudness", "setLoudnessNormalization", "renderEdited", "exportStems", "exportClips",
+    "findText", "getWordsInRange", "seekToWord", "refineCuts", "getSpectrogramTiles", "computeSpectrogram",
+    "denoise", "cancelDenoise", "setDenoise", "setStrip", "clearStrips",
+  };
+  const size_t p = line.find(kKey);
+  if (p == std::string::npos) return CommandLane::Control;
+  const size_t start = p + sizeof(kKey) - 1;
+  const size_t end = line.find('"', start);
+  if (end == std::string::npos) return CommandLane::Control;
+  const size_t length = end - start;
+  auto is = [&](const char* type) { return std::strlen(type) == length && line.compare(start, length, type) == 0; };
+  if (is("load")) return CommandLane::Barrier;
+  for (const char* type : kEdlChange) {
+    if (is(type)) return CommandLane::EdlChange;
+  }
+  for (const char* type : kWork) {
+    if (is(type)) return CommandLane::Work;
+  }
+  for (const char* type : kPositioned) {
+    if (is(type)) return CommandLane::Positioned;
+  }
+  return CommandLane::Control;
 }
 
-static void timerThread() {
-  using namespace std::chrono_literals;
-  while (g.running) {
-    if (g.playing) {
-      g.editedSec.store(g.editedSec.load() + 0.033); // ~30 Hz
-      if (g.editedSec >= g.durationSec) {
-        g.playing = false;
-        emit("{\"type\":\"ended\",\"id\":\"" + g.id + "\"}");
+class CommandLanes {
+public:
+  using Handler = std::function<void(const std::string&)>;
+
+  CommandLanes(Handler h, bool inlineOnly) : handler(std::move(h)), synchronous(inlineOnly) {
+    if (!synchronous) worker = std::thread([this] { run(); });
+  }
+
+  ~CommandLanes() { stop(); }
+
+  // Main thread. The histogram is looked up here because CommandLatencies
+  // takes new slots from this thread only.
+  void submit(std::string line) {
+    const auto received = std::chrono::steady_clock::now();
+    metrics::LatencyHistogram* timing = commandHistogram(line);
+    const CommandLane lane = synchronous ? CommandLane::Control : laneFor(line);
+    if (lane == CommandLane::Work || lane == CommandLane::EdlChange || lane == CommandLane::Positioned) {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (lane == CommandLane::Positioned) {
+        if (edlSent > edlApplied) {
+          deferred.push_back({ std::move(line), timing, received, edlSent });
+          return;
+        }
       } else {
-        emitPosition();
+        if (lane == CommandLane::EdlChange) ++edlSent;
+        queue.push_back({ std::move(line), timing, received, lane == CommandLane::EdlChange ? edlSent : 0 });
+        const uint64_t depth = queue.size() + (busy ? 1 : 0);
+        gMetrics.workDepth.store(depth, std::memory_order_relaxed);
+        if (depth > gMetrics.workHighWater.load(std::memory_order_relaxed)) {
+          gMetrics.workHighWater.store(depth, std::memory_order_relaxed);
+        }
+        lock.unlock();
+        wake.notify_one();
+        return;
       }
     }
-    std::this_thread::sleep_for(33ms);
+    if (lane == CommandLane::Barrier) drain();
+    gMetrics.controlQueueUs.record(std::chrono::steady_clock::now() - received);
+    metrics::ScopeTimer commandTimer(timing);
+    handler(line);
   }
-}
 
-static void handleLine(const std::string& line) {
-  // Extremely simple command parsing to avoid JSON dependencies
-  auto contains = [&](const char* s) { return line.find(s) != std::string::npos; };
-  auto extract = [&](const char* key) -> std::string {
-    // extract value for key in a very naive way: "key":"value" or numeric
-    std::string k = std::string("\"") + key + "\":";
-    size_t p = line.find(k);
-    if (p == std::string::npos) return {};
-    p += k.size();
-    if (p >= line.size()) return {};
-    if (line[p] == '"') {
-      size_t end = line.find('"', p + 1);
-      if (end == std::string::npos) return {};
-      return line.substr(p + 1, end - (p + 1));
-    } else {
-      size_t end = line.find_first_of(",}\n", p);
-      if (end == std::string::npos) end = line.size();
-      return line.substr(p, end - p);
+  // Runs what is queued, then joins the worker.
+  void stop() {
+    if (!worker.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
     }
+    wake.notify_one();
+    worker.join();
+  }
+
+private:
+  struct Item {
+    std::string line;
+    metrics::LatencyHistogram* timing;
+    std::chrono::steady_clock::time_point received;
+    uint64_t edl; // EDL changes: its number; positioned: how many must be applied first
   };
 
-  if (contains("\"type\":\"load\"")) {
-    std::lock_guard<std::mutex> lock(gMutex);
-    g.id = extract("id");
-    g.editedSec = 0.0;
-    g.playing = false;
-    emitLoaded();
-    emitState();
-    return;
-  }
-  if (contains("\"type\":\"play\"")) {
-    g.playing = true;
-    emitState();
-    return;
+  void drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return queue.empty() && !busy; });
   }
-  if (contains("\"type\":\"pause\"")) {
-    g.playing = false;
-    emitState();
-    return;
-  }
-  if (contains("\"type\":\"stop\"")) {
-    g.playing = false;
-    g.editedSec = 0.0;
-    emitState();
-    emitPosition();
-    return;
-  }
-  if (contains("\"type\":\"seek\"")) {
-    const std::string t = extract("timeSec");
-    try { g.editedSec = std::stod(t); } catch (...) {}
-    emitPosition();
-    return;
-  }
-  if (contains("\"type\":\"queryState\"")) {
-    emitState();
-    emitPosition();
-    return;
+
+  void execute(const Item& item, std::chrono::steady_clock::time_point now) {
+    gMetrics.workQueueUs.record(now - item.received);
+    metrics::ScopeTimer commandTimer(item.timing);
+    handler(item.line);
   }
-  if (contains("\"type\":\"updateEdlFromFile\"")) {
-    const std::string path = extract("path");
-    if (!path.empty()) {
-      std::remove(path.c_str());
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [&] { return stopping || !queue.empty(); });
+      if (queue.empty()) return;
+      Item item = std::move(queue.front());
+      queue.pop_front();
+      busy = true;
+      lock.unlock();
+      execute(item, std::chrono::steady_clock::now());
+      lock.lock();
+      if (item.edl > 0) {
+        // Positioned commands sent against this EDL, including any that
+        // arrive while these run; edlApplied only counts it once they
+        // have, so none can overtake them.
+        for (;;) {
+          std::vector<Item> ready;
+          while (!deferred.empty() && deferred.front().edl <= item.edl) {
+            ready.push_back(std::move(deferred.front()));
+            deferred.pop_front();
+          }
+          if (ready.empty()) break;
+          lock.unlock();
+          for (const Item& positioned : ready) execute(positioned, std::chrono::steady_clock::now());
+          lock.lock();
+        }
+        edlApplied = item.edl;
+      }
+      busy = false;
+      gMetrics.workDepth.store(queue.size(), std::memory_order_relaxed);
+      if (queue.empty()) idle.notify_all();
     }
-    return;
-  }
-  if (contains("\"type\":\"updateEdl\"")) {
-    // Accept silently in mock handler
-    return;
   }
-  if (contains("\"type\":\"setRate\"") || contains("\"type\":\"setVolume\"")) {
-    // Accept silently
-    return;
-  }
-  emit("{\"type\":\"error\",\"message\":\"unknown command\"}");
-}
 
-#ifdef USE_JUCE
-// --- JUCE Implementation ---
+  Handler handler;
+  const bool synchronous;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::deque<Item> queue;
+  std::deque<Item> deferred; // positioned commands waiting for their EDL, in arrival order
+  bool busy = false;
+  bool stopping = false;
+  uint64_t edlSent = 0;    // EDL changes queued so far
+  uint64_t edlApplied = 0; // of those, run along with the commands sent against them
+  std::thread worker;
+};
 
-// Individual word or spacer within a clip
-struct Segment {
-  std::string type;        // "word" or "spacer"
-  double start;            // Start time
-  double end;              // End time
-  double dur;              // Duration
-  std::string text;        // Text content (for words, empty for spacers)
-  double originalStart = -1; // Original timing (if provided)
-  double originalEnd = -1;   // Original timing (if provided)
+// --- Offline analysis ---
+static double numberOr(const std::string& token, double fallback) {
+  if (token.empty()) return fallback;
+  try {
+    const double v = std::stod(token);
+    return std::isfinite(v) ? v : fallback;
+  } catch (...) {
+    return fallback;
+  }
+}
 
-  bool hasOriginal() const { return originalStart >= 0 && originalEnd >= 0; }
+// Long-running commands run as jobs (jobs::Runner), one per kind: starting a
+// job cancels any earlier job of the same kind, which the new job's thread
+// waits out. Each job has its own thread, below normal priority, that drives
+// it; the heavy lifting goes through the scheduler's loops (JobSystem.h) at
+// the job's priority. A job announces itself with jobStarted, moves in
+// twentieths with jobProgress and ends with jobFinished, whose status is
+// "error" when the job reported a failure; `cancel` stops one by id.
+struct JobKind {
+  const char* kind;
+  jobs::Priority priority;
+  bool reportsProgress; // else progress comes from its loops
 };
 
-// Clip container holding segments (words and spacers)
-struct Clip {
-  std::string id;
-  double startSec;         // Clip start in EDL timeline
-  double endSec;           // Clip end in EDL timeline
-  double originalStartSec = -1; // Original audio position
-  double originalEndSec = -1;   // Original audio position
-  std::string speaker;
-  std::string type;        // "speech", etc.
-  std::vector<Segment> segments; // Words and spacers within this clip
-
-  double duration() const { return endSec - startSec; }
-  bool hasOriginal() const { return originalStartSec >= 0 && originalEndSec >= 0; }
-  size_t segmentCount() const { return segments.size(); }
+static const JobKind kJobKinds[] = {
+  { "fingerprint", jobs::Priority::Interactive, false },
+  { "spectrogram", jobs::Priority::Interactive, false },
+  { "silence", jobs::Priority::Interactive, false },
+  { "loudness", jobs::Priority::Interactive, false },
+  { "preroll", jobs::Priority::Interactive, false },
+  { "refineCuts", jobs::Priority::Interactive, false },
+  { "spectrogramFill", jobs::Priority::Background, true },
+  { "render", jobs::Priority::Background, true },
+  { "exportStems", jobs::Priority::Background, true },
+  { "exportClips", jobs::Priority::Background, true },
+  { "denoise", jobs::Priority::Background, true },
+  { "sidecar", jobs::Priority::Background, false },
 };
 
-static void logParseDiagnostic(const std::string& message) {
-  juceDLog(std::string("[JUCE][EDL][parse] ") + message);
+static JobKind jobKindFor(const std::string& kind) {
+  for (const JobKind& entry : kJobKinds) {
+    if (kind == entry.kind) return entry;
+  }
+  return { "", jobs::Priority::Background, false };
 }
 
-static bool parseClipsFromJsonPayload(const std::string& json, std::vector<Clip>& clipsOut, int* revisionOut = nullptr) {
-  clipsOut.clear();
+class AnalysisRunner {
+public:
+  using Task = jobs::Runner::Task;
 
-  auto findClipsArray = [&](size_t& aStart, size_t& aEnd) -> bool {
-    size_t key = json.find("\"clips\"");
-    if (key == std::string::npos) return false;
-    size_t colon = json.find(':', key);
-    if (colon == std::string::npos) return false;
-    size_t lb = json.find('[', colon);
-    if (lb == std::string::npos) return false;
-    int depth = 1;
-    size_t i = lb + 1;
-    while (i < json.size() && depth > 0) {
-      if (json[i] == '[') depth++;
-      else if (json[i] == ']') depth--;
-      i++;
-    }
-    if (depth != 0) return false;
-    aStart = lb + 1;
-    aEnd = i - 1;
-    return true;
-  };
+  // Returns the new job's id; see jobs::Runner::start.
+  uint64_t start(const std::string& kind, Task task) {
+    const JobKind traits = jobKindFor(kind);
+    return runner.start(kind, traits.priority, !traits.reportsProgress, std::move(task));
+  }
 
-  size_t aStart = 0;
-  size_t aEnd = 0;
-  if (!findClipsArray(aStart, aEnd)) {
-    logParseDiagnostic("Failed to locate clips array in payload");
-    return false;
+  // Replays call this between commands so each job's events land in the
+  // same place on every run.
+  void waitIdle() { runner.waitIdle(); }
+
+  void cancel(const std::string& kind) { runner.cancel(kind); }
+
+  bool cancelJob(uint64_t id) { return runner.cancelJob(id); }
+
+  // Answers getJobs: the jobs still running, and the scheduler's counters.
+  void emitJobs() {
+    const jobs::SchedulerStats stats = jobs::scheduler().stats();
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(3);
+    evt << "{\"type\":\"jobs\",\"id\":\"" << g.id << "\",\"workers\":" << stats.workers
+        << ",\"executed\":" << stats.executed << ",\"stolen\":" << stats.stolen << ",\"queued\":" << stats.queued
+        << ",\"active\":[";
+    bool first = true;
+    for (const jobs::JobInfo& job : runner.active()) {
+      if (!first) evt << ",";
+      first = false;
+      evt << "{\"jobId\":" << job.id << ",\"kind\":\"" << job.kind << "\""
+          << ",\"priority\":\"" << jobs::priorityName(job.priority) << "\""
+          << ",\"fraction\":" << job.fraction << ",\"cancelled\":" << (job.cancelled ? "true" : "false")
+          << ",\"elapsedMs\":" << job.elapsedMs << "}";
+    }
+    evt << "]}";
+    emit(evt.str());
   }
 
-  logParseDiagnostic("clips array located: start=" + std::to_string(aStart) + ", end=" + std::to_string(aEnd));
+  void stopAll() { runner.stopAll(); }
 
-  std::vector<std::string> itemStrings;
-  size_t cursor = aStart;
-  size_t maxIterations = 0;
-  while (cursor < aEnd) {
-    if (++maxIterations > 1000000) {
-      logParseDiagnostic("Aborting clip extraction after 1M iterations (possible malformed JSON)");
-      return false;
-    }
+private:
+  static jobs::RunnerEvents events() {
+    jobs::RunnerEvents events;
+    events.started = [](const jobs::Job& job) {
+      emit("{\"type\":\"jobStarted\",\"id\":\"" + g.id + "\",\"jobId\":" + std::to_string(job.id) + ",\"kind\":\"" +
+           job.kind + "\",\"priority\":\"" + jobs::priorityName(job.priority) + "\"}");
+    };
+    events.progress = [](const jobs::Job& job, double fraction) {
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << "{\"type\":\"jobProgress\",\"id\":\"" << g.id << "\",\"jobId\":" << job.id << ",\"kind\":\"" << job.kind
+          << "\",\"fraction\":" << fraction << "}";
+      emit(evt.str());
+    };
+    events.finished = [](const jobs::Job& job, const char* status, double elapsedMs) {
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << "{\"type\":\"jobFinished\",\"id\":\"" << g.id << "\",\"jobId\":" << job.id << ",\"kind\":\"" << job.kind
+          << "\",\"status\":\"" << status << "\"" << ",\"elapsedMs\":" << elapsedMs << "}";
+      emit(evt.str());
+    };
+    return events;
+  }
 
-    while (cursor < aEnd && (json[cursor] == ' ' || json[cursor] == ',' || json[cursor] == '\n' || json[cursor] == '\r' || json[cursor] == '\t')) cursor++;
-    if (cursor >= aEnd) break;
-    if (json[cursor] != '{') {
-      cursor++;
-      continue;
-    }
+  jobs::Runner runner{events()};
+};
 
-    int depth = 1;
-    size_t objStart = cursor;
-    cursor++;
-    while (cursor < aEnd && depth > 0) {
-      if (json[cursor] == '{') depth++;
-      else if (json[cursor] == '}') depth--;
-      cursor++;
-    }
+static AnalysisRunner gAnalysis;
 
-    if (depth != 0) {
-      logParseDiagnostic("Unbalanced braces while scanning clip object at index " + std::to_string(itemStrings.size()));
-      return false;
-    }
+static void cancelJobFromCommand(const std::string& jobId) {
+  const double id = numberOr(jobId, 0.0);
+  if (id < 1.0 || !gAnalysis.cancelJob((uint64_t) id)) {
+    emit("{\"type\":\"error\",\"message\":\"No running job " + jsonEscape(jobId) + "\"}");
+  }
+}
 
-    size_t objEnd = cursor;
-    if (objEnd <= objStart) {
-      logParseDiagnostic("Invalid clip bounds: start=" + std::to_string(objStart) + ", end=" + std::to_string(objEnd));
-      return false;
-    }
+// --- Artifact cache ---
+static std::string cacheDirectory() {
+  const char* dir = std::getenv("JUCE_CACHE_DIR");
+  return (dir && *dir) ? std::string(dir) : std::string("/tmp");
+}
 
-    const size_t length = objEnd - objStart;
-    if (length > json.size()) {
-      logParseDiagnostic("Clip length overflow detected (" + std::to_string(length) + ")");
-      return false;
-    }
+// Analysis artifacts live under JUCE_CACHE_DIR when it is set (tests keep
+// their own), otherwise in the per-user cache directory.
+static std::string artifactDirectory() {
+  const char* dir = std::getenv("JUCE_CACHE_DIR");
+  return (dir && *dir) ? std::string(dir) + "/artifacts" : artifacts::userCacheDirectory();
+}
 
-    itemStrings.push_back(json.substr(objStart, length));
-  }
+static uint64_t artifactCacheLimit() {
+  const char* bytes = std::getenv("JUCE_ARTIFACT_CACHE_BYTES");
+  const double limit = numberOr(bytes ? bytes : "", 2.0 * 1024 * 1024 * 1024);
+  return (uint64_t) std::max(0.0, limit);
+}
 
-  logParseDiagnostic("Found " + std::to_string(itemStrings.size()) + " clip objects");
+static artifacts::Cache gArtifacts(artifactDirectory(), artifactCacheLimit());
 
-  auto extractNumber = [&](const std::string& s, const char* key) -> double {
-    size_t p = s.find(key);
+// Content fingerprints by file identity (path, size, mtime), so a file is
+// hashed once per change however many artifacts it has. load starts the hash
+// in the background; an analysis that needs it first waits for that pass.
+class FingerprintRegistry {
+public:
+  // Replays hash on the command thread so the fingerprint event always
+  // lands in the same place.
+  void setInline(bool value) { inlineOnly = value; }
+
+  // Fingerprints path off the command thread and reports it as a
+  // fingerprint event; an unchanged file is answered from memory.
+  void prefetch(const std::string& path) {
+    const std::string identity = loudness::fileIdentity(path);
+    if (identity.empty()) return;
+    std::shared_future<artifacts::Fingerprint> known;
+    std::shared_ptr<std::promise<artifacts::Fingerprint>> promise;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = entries.find(identity);
+      if (it != entries.end()) {
+        known = it->second;
+      } else {
+        promise = std::make_shared<std::promise<artifacts::Fingerprint>>();
+        insertLocked(identity, promise->get_future().share());
+      }
+    }
+    const std::string id = g.id;
+    auto task = [this, identity, path, id, known, promise](const std::atomic<bool>& cancel) {
+      artifacts::Fingerprint fp;
+      if (promise) {
+        fp = artifacts::fingerprint(path, 0, &cancel);
+        promise->set_value(fp);
+        if (!fp.ok) forget(identity);
+      } else {
+        fp = known.get();
+      }
+      if (!fp.ok) {
+        if (!cancel.load()) jobs::reportFailure(); // unreadable, rather than superseded by another load
+        return;
+      }
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << "{\"type\":\"fingerprint\",\"id\":\"" << id << "\",\"hash\":\"" << fp.hash << "\""
+          << ",\"bytes\":" << fp.bytes << ",\"cached\":" << (promise ? "false" : "true")
+          << ",\"elapsedMs\":" << fp.elapsedMs << ",\"threads\":" << fp.threads << "}";
+      emit(evt.str());
+    };
+    if (inlineOnly) {
+      const std::atomic<bool> never{false};
+      task(never);
+      return;
+    }
+    gAnalysis.start("fingerprint", task);
+  }
+
+  // Content hash of path, empty when it cannot be read. Waits for a pass in
+  // flight, else hashes inline.
+  std::string of(const std::string& path) {
+    const std::string identity = loudness::fileIdentity(path);
+    if (identity.empty()) return {};
+    std::shared_future<artifacts::Fingerprint> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = entries.find(identity);
+      if (it != entries.end()) pending = it->second;
+    }
+    if (pending.valid()) {
+      const artifacts::Fingerprint fp = pending.get();
+      if (fp.ok) return fp.hash;
+    }
+    const artifacts::Fingerprint fp = artifacts::fingerprint(path);
+    if (!fp.ok) return {};
+    std::promise<artifacts::Fingerprint> ready;
+    ready.set_value(fp);
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(identity);
+    insertLocked(identity, ready.get_future().share());
+    return fp.hash;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+private:
+  static constexpr size_t kMaxEntries = 64;
+
+  void insertLocked(const std::string& identity, std::shared_future<artifacts::Fingerprint> future) {
+    if (entries.size() >= kMaxEntries) {
+      for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+        entries.erase(it);
+        break;
+      }
+    }
+    entries[identity] = std::move(future);
+  }
+
+  void forget(const std::string& identity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(identity);
+    if (it != entries.end() && it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        !it->second.get().ok) {
+      entries.erase(it);
+    }
+  }
+
+  std::mutex mutex;
+  std::map<std::string, std::shared_future<artifacts::Fingerprint>> entries;
+  bool inlineOnly = false;
+};
+
+static FingerprintRegistry gFingerprints;
+
+// The project sidecar opened with openSidecar, and the fingerprint it was
+// written for. Artifacts are looked up here before the artifact cache and
+// decoded straight from the mapping.
+class SidecarSlot {
+public:
+  void set(std::shared_ptr<const sidecar::Reader> next, std::string content) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reader = std::move(next);
+    fingerprint = std::move(content);
+  }
+
+  // The open sidecar if it belongs to the audio with this fingerprint.
+  std::shared_ptr<const sidecar::Reader> forContent(const std::string& content) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (reader && !content.empty() && content == fingerprint) ? reader : nullptr;
+  }
+
+private:
+  std::mutex mutex;
+  std::shared_ptr<const sidecar::Reader> reader;
+  std::string fingerprint;
+};
+
+static SidecarSlot gSidecar;
+
+static void emitArtifactCacheStats() {
+  const artifacts::CacheStats stats = gArtifacts.stats();
+  const uint64_t lookups = stats.hits + stats.misses;
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"artifactCacheStats\",\"id\":\"" << g.id << "\",\"directory\":\"" << jsonEscape(stats.directory)
+      << "\",\"files\":" << stats.files << ",\"bytes\":" << stats.bytes << ",\"maxBytes\":" << stats.maxBytes
+      << ",\"hits\":" << stats.hits << ",\"misses\":" << stats.misses
+      << ",\"hitRate\":" << (lookups ? (double) stats.hits / (double) lookups : 0.0)
+      << ",\"evictions\":" << stats.evictions << ",\"fingerprints\":" << gFingerprints.size() << "}";
+  emit(evt.str());
+}
+
+// --- Silence analysis ---
+// Spacer from the current EDL, in both timelines, for silence refinement.
+struct SpacerSpan {
+  size_t index = 0;
+  double startSec = 0.0;
+  double endSec = 0.0;
+  double originalStartSec = 0.0;
+  double originalEndSec = 0.0;
+};
+
+template <typename Extract>
+static SilenceParams silenceParamsFromCommand(const Extract& extract) {
+  SilenceParams params;
+  params.thresholdDb = std::clamp(numberOr(extract("thresholdDb"), params.thresholdDb), -120.0, 0.0);
+  params.minDurationSec = std::clamp(numberOr(extract("minDurationSec"), params.minDurationSec), 0.0, 60.0);
+  params.hangoverSec = std::clamp(numberOr(extract("hangoverSec"), params.hangoverSec), 0.0, 2.0);
+  params.frameSec = std::clamp(numberOr(extract("frameSec"), params.frameSec), 0.001, 0.1);
+  params.threads = (int) std::clamp(numberOr(extract("threads"), 0.0), 0.0, 64.0);
+  return params;
+}
+
+static constexpr uint32_t kSilenceArtifactTag = 0x31534c53; // "SLS1"
+
+static std::string encodeSilence(const SilenceResult& result) {
+  std::vector<double> bounds;
+  bounds.reserve(result.intervals.size() * 2);
+  for (const auto& interval : result.intervals) {
+    bounds.push_back(interval.startSec);
+    bounds.push_back(interval.endSec);
+  }
+  artifacts::BlobWriter out(kSilenceArtifactTag);
+  out.put(result.frameSec);
+  out.put(result.analysedSec);
+  out.put(result.elapsedMs);
+  out.put((int32_t) result.threads);
+  out.putVector(bounds);
+  out.putVector(result.frameDb);
+  return out.data();
+}
+
+static bool decodeSilence(std::string_view bytes, SilenceResult& result) {
+  artifacts::BlobReader in(bytes, kSilenceArtifactTag);
+  int32_t threads = 0;
+  std::vector<double> bounds;
+  in.get(result.frameSec);
+  in.get(result.analysedSec);
+  in.get(result.elapsedMs);
+  in.get(threads);
+  in.getVector(bounds);
+  in.getVector(result.frameDb);
+  if (!in.good() || bounds.size() % 2 != 0) return false;
+  result.threads = threads;
+  result.intervals.clear();
+  for (size_t i = 0; i < bounds.size(); i += 2) result.intervals.push_back({ bounds[i], bounds[i + 1] });
+  result.ok = true;
+  return true;
+}
+
+static std::string silenceParamsKey(const SilenceParams& params) {
+  std::ostringstream key;
+  key << params.thresholdDb << "|" << params.minDurationSec << "|" << params.hangoverSec << "|" << params.frameSec;
+  return key.str();
+}
+
+// Silence map for the file at path, from the project sidecar or the artifact
+// cache when the same audio was scanned with the same parameters before.
+static SilenceResult silenceFor(const std::string& path,
+                                const SampleReaderFactory& factory,
+                                const SilenceParams& params,
+                                const std::atomic<bool>& cancel,
+                                bool* cachedOut = nullptr) {
+  if (cachedOut) *cachedOut = false;
+  const std::string content = gFingerprints.of(path);
+  std::string artifact;
+  if (!content.empty()) {
+    SilenceResult cached;
+    std::string_view mapped;
+    if (auto side = gSidecar.forContent(content)) {
+      if (side->payload("SILN", silenceParamsKey(params), mapped) && decodeSilence(mapped, cached)) {
+        if (cachedOut) *cachedOut = true;
+        return cached;
+      }
+    }
+    artifact = gArtifacts.pathFor(content, "silence", silenceParamsKey(params), "bin");
+    std::string bytes;
+    if (gArtifacts.read(artifact, bytes) && decodeSilence(bytes, cached)) {
+      if (cachedOut) *cachedOut = true;
+      return cached;
+    }
+  }
+  SilenceResult result = detectSilence(factory, params, &cancel);
+  if (result.ok && !cancel.load() && !artifact.empty()) gArtifacts.write(artifact, encodeSilence(result));
+  return result;
+}
+
+static void runSilenceAnalysis(const std::string& path,
+                               const SampleReaderFactory& factory,
+                               const SilenceParams& params,
+                               const std::vector<SpacerSpan>& spacers,
+                               double maxShiftSec,
+                               const std::atomic<bool>& cancel) {
+  bool cached = false;
+  const SilenceResult result = silenceFor(path, factory, params, cancel, &cached);
+  if (cancel.load()) return;
+  if (!result.ok) {
+    emit("{\"type\":\"silenceAnalysis\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"message\":\"Unable to read audio for silence analysis\"}");
+    jobs::reportFailure();
+    return;
+  }
+
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"silenceAnalysis\",\"id\":\"" << g.id << "\",\"status\":\"ok\""
+      << ",\"cached\":" << (cached ? "true" : "false")
+      << ",\"thresholdDb\":" << params.thresholdDb
+      << ",\"minDurationSec\":" << params.minDurationSec
+      << ",\"hangoverSec\":" << params.hangoverSec
+      << ",\"durationSec\":" << result.analysedSec
+      << ",\"elapsedMs\":" << result.elapsedMs
+      << ",\"threads\":" << result.threads
+      << ",\"intervals\":[";
+  for (size_t i = 0; i < result.intervals.size(); ++i) {
+    if (i) evt << ",";
+    evt << "{\"startSec\":" << result.intervals[i].startSec << ",\"endSec\":" << result.intervals[i].endSec << "}";
+  }
+  evt << "]";
+  if (!spacers.empty()) {
+    evt << ",\"spacers\":[";
+    bool first = true;
+    for (const auto& spacer : spacers) {
+      double refinedStart = 0.0;
+      double refinedEnd = 0.0;
+      if (!refineSpacerBounds(result.intervals, spacer.originalStartSec, spacer.originalEndSec,
+                              maxShiftSec, refinedStart, refinedEnd)) {
+        continue;
+      }
+      if (!first) evt << ",";
+      first = false;
+      evt << "{\"index\":" << spacer.index
+          << ",\"startSec\":" << spacer.startSec << ",\"endSec\":" << spacer.endSec
+          << ",\"originalStartSec\":" << spacer.originalStartSec
+          << ",\"originalEndSec\":" << spacer.originalEndSec
+          << ",\"refinedStartSec\":" << refinedStart
+          << ",\"refinedEndSec\":" << refinedEnd << "}";
+    }
+    evt << "]";
+  }
+  evt << "}";
+  juceDLog("[JUCE] silence analysis: " + std::to_string(result.intervals.size()) + " intervals" +
+           (cached ? std::string(" (cached)")
+                   : " in " + std::to_string(result.elapsedMs) + " ms on " + std::to_string(result.threads) + " threads"));
+  emit(evt.str());
+}
+
+// --- Loudness ---
+// EDL clip (or speaker) as a set of original-time ranges, for per-clip
+// loudness and normalisation gain.
+struct LoudnessClip {
+  std::string id;
+  std::string speaker;
+  std::vector<std::pair<double, double>> originalRanges;
+};
+
+struct LoudnessOptions {
+  double targetLufs = -16.0;
+  double ceilingDbtp = -1.0;
+  bool curves = false;
+  double curveHopSec = 0.1;
+  int threads = 0;
+};
+
+template <typename Extract>
+static LoudnessOptions loudnessOptionsFromCommand(const Extract& extract) {
+  LoudnessOptions options;
+  options.targetLufs = std::clamp(numberOr(extract("targetLufs"), options.targetLufs), -70.0, 0.0);
+  options.ceilingDbtp = std::clamp(numberOr(extract("ceilingDbtp"), options.ceilingDbtp), -20.0, 0.0);
+  options.curves = extract("curves") == "true";
+  options.curveHopSec = std::clamp(numberOr(extract("curveHopSec"), options.curveHopSec), loudness::kStepSec, 10.0);
+  options.threads = (int) std::clamp(numberOr(extract("threads"), 0.0), 0.0, 64.0);
+  return options;
+}
+
+// Fields absent from the command stay unset so they fall through to the
+// speaker (or keep their previous value).
+template <typename Extract>
+static StripSettings stripSettingsFromCommand(const Extract& extract) {
+  StripSettings s;
+  auto number = [&](const char* key, std::optional<float>& out) {
+    const std::string token = extract(key);
+    const double fallback = std::numeric_limits<double>::quiet_NaN();
+    const double v = numberOr(token, fallback);
+    if (std::isfinite(v)) out = (float) v;
+  };
+  auto flag = [&](const char* key, std::optional<bool>& out) {
+    const std::string token = extract(key);
+    if (token == "true") out = true;
+    else if (token == "false") out = false;
+  };
+  number("gainDb", s.gainDb);
+  number("highPassHz", s.highPassHz);
+  flag("compressor", s.compressor);
+  number("compThresholdDb", s.compThresholdDb);
+  number("compRatio", s.compRatio);
+  number("compAttackMs", s.compAttackMs);
+  number("compReleaseMs", s.compReleaseMs);
+  number("compMakeupDb", s.compMakeupDb);
+  flag("mute", s.mute);
+  flag("solo", s.solo);
+  return s;
+}
+
+static loudness::Cache gLoudnessCache;
+
+static constexpr uint32_t kLoudnessArtifactTag = 0x31534c4c; // "LLS1"
+
+static std::string encodeLoudness(const loudness::Analysis& analysis) {
+  artifacts::BlobWriter out(kLoudnessArtifactTag);
+  out.put(loudness::kStepSec);
+  out.put(analysis.sampleRate);
+  out.put(analysis.durationSec);
+  out.put((int32_t) analysis.channels);
+  out.put(analysis.elapsedMs);
+  out.put((int32_t) analysis.threads);
+  out.putVector(analysis.stepPower);
+  out.putVector(analysis.stepTruePeak);
+  return out.data();
+}
+
+static std::shared_ptr<const loudness::Analysis> decodeLoudness(std::string_view bytes) {
+  artifacts::BlobReader in(bytes, kLoudnessArtifactTag);
+  auto analysis = std::make_shared<loudness::Analysis>();
+  double stepSec = 0.0;
+  int32_t channels = 0, threads = 0;
+  in.get(stepSec);
+  in.get(analysis->sampleRate);
+  in.get(analysis->durationSec);
+  in.get(channels);
+  in.get(analysis->elapsedMs);
+  in.get(threads);
+  in.getVector(analysis->stepPower);
+  in.getVector(analysis->stepTruePeak);
+  if (!in.good() || stepSec != loudness::kStepSec || analysis->stepPower.size() != analysis->stepTruePeak.size()) {
+    return nullptr;
+  }
+  analysis->channels = channels;
+  analysis->threads = threads;
+  return analysis;
+}
+
+// Step analysis for the file at path: from memory, else from the project
+// sidecar or the artifact cache, when the same audio was scanned before under
+// any name.
+static std::shared_ptr<const loudness::Analysis> loudnessAnalysisFor(const std::string& path,
+                                                                    const SampleReaderFactory& factory,
+                                                                    int threads,
+                                                                    const std::atomic<bool>& cancel,
+                                                                    bool* cachedOut = nullptr) {
+  if (cachedOut) *cachedOut = true;
+  const std::string content = gFingerprints.of(path);
+  std::string artifact;
+  if (!content.empty()) {
+    if (auto hit = gLoudnessCache.find(content)) return hit;
+    std::string_view mapped;
+    if (auto side = gSidecar.forContent(content)) {
+      if (side->payload("LOUD", "steps", mapped)) {
+        if (auto stored = decodeLoudness(mapped)) {
+          gLoudnessCache.store(content, stored);
+          return stored;
+        }
+      }
+    }
+    artifact = gArtifacts.pathFor(content, "loudness", "steps", "bin");
+    std::string bytes;
+    if (gArtifacts.read(artifact, bytes)) {
+      if (auto stored = decodeLoudness(bytes)) {
+        gLoudnessCache.store(content, stored);
+        return stored;
+      }
+    }
+  }
+  if (cachedOut) *cachedOut = false;
+  std::shared_ptr<const loudness::Analysis> analysis = loudness::analyse(factory, threads, &cancel);
+  if (analysis && !cancel.load() && !content.empty()) {
+    gLoudnessCache.store(content, analysis);
+    gArtifacts.write(artifact, encodeLoudness(*analysis));
+  }
+  return analysis;
+}
+
+// Normalisation gain (dB) for each clip, in clip order.
+static std::vector<double> clipNormalisationGains(const loudness::Analysis& analysis,
+                                                  const std::vector<LoudnessClip>& clips,
+                                                  double targetLufs,
+                                                  double ceilingDbtp) {
+  std::vector<double> gains;
+  gains.reserve(clips.size());
+  for (const auto& clip : clips) {
+    const loudness::Summary summary = loudness::summarise(analysis, loudness::stepRunsFor(analysis, clip.originalRanges));
+    gains.push_back(loudness::normalisationGainDb(summary, targetLufs, ceilingDbtp));
+  }
+  return gains;
+}
+
+static void writeLoudnessFields(std::ostringstream& evt, const loudness::Summary& summary) {
+  auto lufs = [](double v) { return std::isfinite(v) ? v : -120.0; };
+  evt << "\"integratedLufs\":" << lufs(summary.integratedLufs)
+      << ",\"momentaryMaxLufs\":" << lufs(summary.momentaryMaxLufs)
+      << ",\"shortTermMaxLufs\":" << lufs(summary.shortTermMaxLufs)
+      << ",\"truePeakDbtp\":" << summary.truePeakDbtp;
+}
+
+static void runLoudnessAnalysis(const std::string& path,
+                                const SampleReaderFactory& factory,
+                                const LoudnessOptions& options,
+                                const std::vector<LoudnessClip>& clips,
+                                const std::atomic<bool>& cancel,
+                                const std::function<void(std::shared_ptr<const loudness::Analysis>)>& onReady) {
+  bool cached = false;
+  const auto analysis = loudnessAnalysisFor(path, factory, options.threads, cancel, &cached);
+  if (cancel.load()) return;
+  if (!analysis) {
+    emit("{\"type\":\"loudnessAnalysis\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"message\":\"Unable to read audio for loudness analysis\"}");
+    jobs::reportFailure();
+    return;
+  }
+  if (onReady) onReady(analysis);
+
+  auto lufs = [](double v) { return std::isfinite(v) ? v : -120.0; };
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(2);
+  evt << "{\"type\":\"loudnessAnalysis\",\"id\":\"" << g.id << "\",\"status\":\"ok\""
+      << ",\"cached\":" << (cached ? "true" : "false")
+      << ",\"elapsedMs\":" << analysis->elapsedMs
+      << ",\"threads\":" << analysis->threads
+      << ",\"durationSec\":" << analysis->durationSec
+      << ",\"targetLufs\":" << options.targetLufs << ",";
+  const loudness::Summary whole = loudness::summarise(*analysis, loudness::wholeSource(*analysis));
+  writeLoudnessFields(evt, whole);
+  evt << ",\"gainDb\":" << loudness::normalisationGainDb(whole, options.targetLufs, options.ceilingDbtp);
+  if (options.curves) {
+    const size_t hop = (size_t) std::max(1L, std::lround(options.curveHopSec / loudness::kStepSec));
+    auto writeCurve = [&](const char* key, int windowSteps) {
+      evt << ",\"" << key << "\":[";
+      const auto values = loudness::curve(*analysis, windowSteps, hop);
+      for (size_t i = 0; i < values.size(); ++i) {
+        if (i) evt << ",";
+        evt << lufs(values[i]);
+      }
+      evt << "]";
+    };
+    evt << ",\"curveHopSec\":" << (double) hop * loudness::kStepSec;
+    writeCurve("momentaryLufs", loudness::kMomentarySteps);
+    writeCurve("shortTermLufs", loudness::kShortTermSteps);
+  }
+
+  const std::vector<double> gains = clipNormalisationGains(*analysis, clips, options.targetLufs, options.ceilingDbtp);
+  evt << ",\"clips\":[";
+  std::map<std::string, std::vector<std::pair<double, double>>> speakers;
+  for (size_t i = 0; i < clips.size(); ++i) {
+    const auto& clip = clips[i];
+    if (i) evt << ",";
+    evt << "{\"id\":\"" << jsonEscape(clip.id) << "\",\"speaker\":\"" << jsonEscape(clip.speaker) << "\",";
+    writeLoudnessFields(evt, loudness::summarise(*analysis, loudness::stepRunsFor(*analysis, clip.originalRanges)));
+    evt << ",\"gainDb\":" << gains[i] << "}";
+    auto& ranges = speakers[clip.speaker];
+    ranges.insert(ranges.end(), clip.originalRanges.begin(), clip.originalRanges.end());
+  }
+  evt << "],\"speakers\":[";
+  bool first = true;
+  for (const auto& entry : speakers) {
+    if (!first) evt << ",";
+    first = false;
+    const loudness::Summary summary = loudness::summarise(*analysis, loudness::stepRunsFor(*analysis, entry.second));
+    evt << "{\"speaker\":\"" << jsonEscape(entry.first) << "\",";
+    writeLoudnessFields(evt, summary);
+    evt << ",\"gainDb\":" << loudness::normalisationGainDb(summary, options.targetLufs, options.ceilingDbtp) << "}";
+  }
+  evt << "]}";
+  juceDLog("[JUCE] loudness analysis: I=" + std::to_string(whole.integratedLufs) + " LUFS, " +
+           (cached ? std::string("cached") : std::to_string(analysis->elapsedMs) + " ms"));
+  emit(evt.str());
+}
+
+// --- Offline render ---
+// One stretch of the edited timeline: original samples [start, end) taken
+// from the clip at clipIndex (-1 when the stretch belongs to no clip).
+struct RenderPiece {
+  int64_t start = 0;
+  int64_t end = 0;
+  int clipIndex = -1;
+};
+
+struct RenderJob {
+  std::string sourcePath;
+  std::string outputPath;
+  std::vector<RenderPiece> pieces;
+  std::vector<LoudnessClip> clips;
+  bool normalize = false;
+  double targetLufs = -16.0;
+  double ceilingDbtp = -1.0;
+  int bitsPerSample = 32;
+  std::shared_ptr<const StripBank> strips; // per-clip processing, as heard in playback
+};
+
+// Linear gain per clip of job: the loudness normalisation gain, or unity
+// without normalisation. False if the analysis failed or was cancelled.
+static bool renderClipGains(const RenderJob& job, const SampleReaderFactory& factory, const std::atomic<bool>& cancel,
+                            std::vector<float>& clipGains) {
+  clipGains.assign(job.clips.size(), 1.0f);
+  if (!job.normalize) return true;
+  const auto analysis = loudnessAnalysisFor(job.sourcePath, factory, 0, cancel);
+  if (cancel.load() || !analysis) return false;
+  const auto gainsDb = clipNormalisationGains(*analysis, job.clips, job.targetLufs, job.ceilingDbtp);
+  for (size_t i = 0; i < gainsDb.size(); ++i) clipGains[i] = (float) std::pow(10.0, gainsDb[i] / 20.0);
+  return true;
+}
+
+// Renders the edited timeline to a WAV file. Each piece runs through its
+// clip's strip first; with normalisation each clip then gets its loudness
+// gain, ramped over 10 ms where the gain changes.
+static void runRender(const RenderJob& job, const SampleReaderFactory& factory, const std::atomic<bool>& cancel) {
+  auto fail = [&](const std::string& message) {
+    emit("{\"type\":\"renderComplete\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"path\":\"" +
+         jsonEscape(job.outputPath) + "\",\"message\":\"" + jsonEscape(message) + "\"}");
+    jobs::reportFailure();
+  };
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> reader = factory();
+  if (!reader) { fail("Unable to read source audio"); return; }
+  const int channels = reader->numChannels();
+  const double sampleRate = reader->sampleRate();
+
+  std::vector<float> clipGains;
+  if (!renderClipGains(job, factory, cancel, clipGains)) {
+    if (!cancel.load()) fail("Unable to analyse loudness");
+    return;
+  }
+
+  WavFileWriter writer(job.outputPath, sampleRate, channels, job.bitsPerSample);
+  if (!writer.isOpen()) { fail("Unable to create output file"); return; }
+
+  constexpr int kBlock = 8192;
+  const int rampSamples = std::max(1, (int) std::lround(0.01 * sampleRate));
+  std::vector<float> storage((size_t) channels * kBlock);
+  std::vector<float*> planes((size_t) channels);
+  for (int ch = 0; ch < channels; ++ch) planes[(size_t) ch] = storage.data() + (size_t) ch * kBlock;
+  dsp::GainRamp ramp;
+  ClipChain chain;
+  chain.prepare(sampleRate, channels);
+  int64_t totalFrames = 0, framesDone = 0;
+  for (const auto& piece : job.pieces) totalFrames += piece.end - piece.start;
+  bool firstPiece = true;
+  for (const auto& piece : job.pieces) {
+    const float gain = piece.clipIndex >= 0 && (size_t) piece.clipIndex < clipGains.size() ? clipGains[(size_t) piece.clipIndex] : 1.0f;
+    if (firstPiece) ramp.reset(gain); else ramp.setTarget(gain, rampSamples);
+    firstPiece = false;
+    for (int64_t pos = piece.start; pos < piece.end; pos += kBlock) {
+      if (cancel.load()) return;
+      const int n = (int) std::min<int64_t>(kBlock, piece.end - pos);
+      if (!reader->read(planes.data(), channels, pos, n)) { fail("Read error while rendering"); return; }
+      if (job.strips) chain.process(planes.data(), channels, 0, n, job.strips->forClip(piece.clipIndex), job.strips->anySolo);
+      ramp.process(planes.data(), channels, 0, n);
+      if (!writer.write(planes.data(), n)) { fail("Write error while rendering"); return; }
+      framesDone += n;
+      jobs::reportProgress((double) framesDone / (double) totalFrames);
+    }
+  }
+  const uint64_t frames = writer.framesWritten();
+  if (!writer.close()) { fail("Unable to finalise output file"); return; }
+
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"renderComplete\",\"id\":\"" << g.id << "\",\"status\":\"ok\""
+      << ",\"path\":\"" << jsonEscape(job.outputPath) << "\""
+      << ",\"normalized\":" << (job.normalize ? "true" : "false")
+      << ",\"durationSec\":" << (double) frames / sampleRate
+      << ",\"elapsedMs\":" << elapsedMs << "}";
+  emit(evt.str());
+}
+
+// --- Noise reduction ---
+template <typename Extract>
+static DenoiseParams denoiseParamsFromCommand(const Extract& extract) {
+  DenoiseParams params;
+  params.reductionDb = std::clamp(numberOr(extract("reductionDb"), params.reductionDb), 0.0, 60.0);
+  params.thresholdDb = std::clamp(numberOr(extract("thresholdDb"), params.thresholdDb), 0.0, 30.0);
+  params.releaseMs = std::clamp(numberOr(extract("releaseMs"), params.releaseMs), 5.0, 1000.0);
+  params.fftSize = denoise::validFftSize((int) numberOr(extract("fftSize"), params.fftSize));
+  params.threads = (int) std::clamp(numberOr(extract("threads"), 0.0), 0.0, 64.0);
+  return params;
+}
+
+// Processed copies are artifacts of the source content and the parameters,
+// so the same audio is never processed twice, whatever it is called.
+static std::string denoiseCachePath(const std::string& content, const DenoiseParams& params) {
+  std::ostringstream key;
+  key << params.reductionDb << "|" << params.thresholdDb << "|" << params.releaseMs << "|" << params.fftSize;
+  return gArtifacts.pathFor(content, "denoise", key.str(), "wav");
+}
+
+// Learns the noise profile (from noiseRanges, else from the quietest frames),
+// writes the processed copy and calls onReady with its path. Progress and the
+// result are reported as denoiseProgress / denoiseComplete events.
+static void runDenoise(const std::string& sourcePath,
+                       const SampleReaderFactory& factory,
+                       const std::vector<std::pair<double, double>>& noiseRanges,
+                       const DenoiseParams& params,
+                       const std::atomic<bool>& cancel,
+                       const std::function<void(const std::string&)>& onReady) {
+  auto finish = [&](const std::string& status, const std::string& message) {
+    emit("{\"type\":\"denoiseComplete\",\"id\":\"" + g.id + "\",\"status\":\"" + status + "\"" +
+         (message.empty() ? std::string() : ",\"message\":\"" + jsonEscape(message) + "\"") + "}");
+    if (status == "error") jobs::reportFailure();
+  };
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> source = factory();
+  const std::string content = gFingerprints.of(sourcePath);
+  if (!source || content.empty()) { finish("error", "Unable to read source audio"); return; }
+  const std::string cachePath = denoiseCachePath(content, params);
+
+  bool cached = false;
+  {
+    WavFileReader existing(cachePath);
+    cached = existing.isOpen() && existing.lengthInSamples() == source->lengthInSamples() &&
+             existing.numChannels() == source->numChannels();
+  }
+  if (cached) gArtifacts.touch(cachePath);
+  else gArtifacts.noteMiss();
+  NoiseProfile profile;
+  std::string profileSource = "spacers";
+  DenoiseResult result;
+  if (!cached) {
+    profile = denoise::learnProfile(factory, noiseRanges, params.fftSize, &cancel);
+    if (!profile.usable() && !cancel.load()) {
+      const SilenceResult frames = silenceFor(sourcePath, factory, SilenceParams(), cancel);
+      profile = denoise::learnProfile(factory, denoise::quietestRanges(frames), params.fftSize, &cancel);
+      profileSource = "quietest";
+    }
+    if (cancel.load()) { finish("cancelled", ""); return; }
+    if (!profile.usable()) { finish("error", "No noise regions found"); return; }
+
+    const std::string partPath = cachePath + ".part";
+    result = denoise::processToFile(factory, profile, params, partPath, [](double fraction) {
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << "{\"type\":\"denoiseProgress\",\"id\":\"" << g.id << "\",\"fraction\":" << fraction << "}";
+      emit(evt.str());
+      jobs::reportProgress(fraction);
+    }, cancel);
+    if (!result.ok || std::rename(partPath.c_str(), cachePath.c_str()) != 0) {
+      std::remove(partPath.c_str());
+      if (result.cancelled) finish("cancelled", "");
+      else finish("error", "Noise reduction failed");
+      return;
+    }
+    gArtifacts.commit(cachePath);
+  }
+
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  const double durationSec = source->sampleRate() > 0.0 ? (double) source->lengthInSamples() / source->sampleRate() : 0.0;
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"denoiseComplete\",\"id\":\"" << g.id << "\",\"status\":\"ok\""
+      << ",\"path\":\"" << jsonEscape(cachePath) << "\""
+      << ",\"cached\":" << (cached ? "true" : "false");
+  if (!cached) {
+    evt << ",\"profileSource\":\"" << profileSource << "\""
+        << ",\"noiseSec\":" << profile.seconds
+        << ",\"threads\":" << result.threads;
+  }
+  evt << ",\"durationSec\":" << durationSec
+      << ",\"elapsedMs\":" << elapsedMs
+      << ",\"realtimeFactor\":" << (elapsedMs > 0.0 ? durationSec * 1000.0 / elapsedMs : 0.0) << "}";
+  juceDLog("[JUCE] denoise: " + cachePath + (cached ? " (cached)" : "") + " in " + std::to_string(elapsedMs) + " ms");
+  emit(evt.str());
+  if (onReady) onReady(cachePath);
+}
+
+// --- Spectrogram ---
+// Tiles are artifacts of the source content, one file per tile.
+static std::string spectrogramTilePath(const std::string& content, const spectrogram::TileKey& key) {
+  std::ostringstream params;
+  params << spectrogram::kFftSize << "|" << spectrogram::kColumns << "x" << spectrogram::kRows << "|L" << key.level
+         << "|" << key.index;
+  return gArtifacts.pathFor(content, "spectrogram", params.str(), "spg");
+}
+
+// Accounts for the tiles just written (each was a miss when the render looked
+// for it) and marks the reused ones as used.
+static void recordSpectrogramTiles(const std::vector<spectrogram::TileKey>& keys,
+                                   const spectrogram::RenderResult& result,
+                                   const std::function<std::string(const spectrogram::TileKey&)>& pathFor,
+                                   bool touchReused) {
+  for (const auto& key : keys) {
+    const bool written = std::find(result.written.begin(), result.written.end(), key) != result.written.end();
+    if (written) {
+      gArtifacts.noteMiss();
+      gArtifacts.commit(pathFor(key));
+    } else if (touchReused) {
+      gArtifacts.touch(pathFor(key));
+    }
+  }
+}
+
+// Finest level at which the original duration fits in maxColumns columns.
+static int spectrogramLevelFor(double originalSec, double sampleRate, int maxColumns) {
+  for (int level = 0; level < spectrogram::kLevels; ++level) {
+    if (originalSec * sampleRate / (double) spectrogram::columnHop(level) <= (double) maxColumns) return level;
+  }
+  return spectrogram::kLevels - 1;
+}
+
+// Makes the tiles behind an edited range (spans come from the EDL) and
+// answers with spectrogramTiles: the spans, and the cached tile files that
+// cover their original ranges. level < 0 picks one from maxColumns.
+static void runSpectrogramTiles(const std::string& sourcePath,
+                                const SampleReaderFactory& factory,
+                                const std::vector<TimelineSpan>& spans,
+                                double startSec,
+                                double endSec,
+                                int level,
+                                int maxColumns,
+                                const std::atomic<bool>& cancel) {
+  const auto started = std::chrono::steady_clock::now();
+  auto fail = [](const std::string& message) {
+    emit("{\"type\":\"error\",\"message\":\"" + message + "\"}");
+    jobs::reportFailure();
+  };
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0) {
+    fail("Unable to read source audio");
+    return;
+  }
+  const double rate = probe->sampleRate();
+  probe.reset();
+  double originalSec = 0.0;
+  for (const auto& span : spans) originalSec += span.originalEnd - span.originalStart;
+  if (level < 0) level = spectrogramLevelFor(originalSec, rate, maxColumns);
+  level = std::clamp(level, 0, spectrogram::kLevels - 1);
+
+  std::vector<spectrogram::TileKey> keys;
+  for (const auto& span : spans) {
+    const auto covering = spectrogram::tilesCovering(level, (int64_t) std::floor(span.originalStart * rate),
+                                                     (int64_t) std::ceil(span.originalEnd * rate));
+    for (const auto& key : covering) {
+      if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+    }
+  }
+  const std::string content = gFingerprints.of(sourcePath);
+  if (content.empty()) {
+    fail("Unable to read source audio");
+    return;
+  }
+  const auto pathFor = [&content](const spectrogram::TileKey& key) { return spectrogramTilePath(content, key); };
+  const auto result = spectrogram::renderTiles(factory, keys, pathFor, analysisThreadCount(), cancel);
+  recordSpectrogramTiles(keys, result, pathFor, true);
+  if (cancel.load()) return; // superseded by a newer view
+  if (!result.ok) {
+    fail("Spectrogram failed");
+    return;
+  }
+
+  const double tileSec = (double) spectrogram::tileSamples(level) / rate;
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"spectrogramTiles\",\"id\":\"" << g.id << "\",\"startSec\":" << startSec << ",\"endSec\":" << endSec
+      << ",\"level\":" << level
+      << ",\"columnSec\":" << std::setprecision(6) << (double) spectrogram::columnHop(level) / rate << std::setprecision(3)
+      << ",\"columns\":" << spectrogram::kColumns << ",\"rows\":" << spectrogram::kRows
+      << ",\"fftSize\":" << spectrogram::kFftSize << ",\"sampleRate\":" << rate
+      << ",\"minDb\":" << spectrogram::kMinDb << ",\"maxDb\":" << spectrogram::kMaxDb << ",\"spans\":[";
+  for (size_t i = 0; i < spans.size(); ++i) {
+    if (i) evt << ",";
+    evt << "{\"editedStart\":" << spans[i].editedStart << ",\"editedEnd\":" << spans[i].editedEnd
+        << ",\"originalStart\":" << spans[i].originalStart << ",\"originalEnd\":" << spans[i].originalEnd << "}";
+  }
+  evt << "],\"tiles\":[";
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i) evt << ",";
+    evt << "{\"index\":" << keys[i].index << ",\"originalStart\":" << (double) keys[i].index * tileSec
+        << ",\"originalEnd\":" << (double) (keys[i].index + 1) * tileSec
+        << ",\"path\":\"" << jsonEscape(pathFor(keys[i])) << "\"}";
+  }
+  evt << "],\"computed\":" << result.computed << ",\"cached\":" << result.cached << ",\"elapsedMs\":" << elapsedMs << "}";
+  emit(evt.str());
+}
+
+// Fills the cache for the whole file, coarsest level first, down to
+// minLevel, a batch of tiles at a time. It runs as a background job, so the
+// tiles of a visible-range request (interactive) are taken ahead of its own
+// between any two tiles.
+static void runSpectrogramFill(const std::string& sourcePath,
+                               const SampleReaderFactory& factory,
+                               int minLevel,
+                               const std::atomic<bool>& cancel) {
+  const auto started = std::chrono::steady_clock::now();
+  auto finish = [&](const std::string& status, size_t computed, size_t cached) {
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(3);
+    evt << "{\"type\":\"spectrogramComplete\",\"id\":\"" << g.id << "\",\"status\":\"" << status << "\""
+        << ",\"minLevel\":" << minLevel << ",\"computed\":" << computed << ",\"cached\":" << cached
+        << ",\"elapsedMs\":" << elapsedMs << "}";
+    emit(evt.str());
+    if (status == "error") jobs::reportFailure();
+  };
+  std::unique_ptr<SampleReader> probe = factory();
+  if (!probe || probe->sampleRate() <= 0.0) { finish("error", 0, 0); return; }
+  const int64_t length = probe->lengthInSamples();
+  probe.reset();
+
+  std::vector<spectrogram::TileKey> keys;
+  for (int level = spectrogram::kLevels - 1; level >= minLevel; --level) {
+    const auto covering = spectrogram::tilesCovering(level, 0, length);
+    keys.insert(keys.end(), covering.begin(), covering.end());
+  }
+  const std::string content = gFingerprints.of(sourcePath);
+  if (content.empty()) { finish("error", 0, 0); return; }
+  const auto pathFor = [&content](const spectrogram::TileKey& key) { return spectrogramTilePath(content, key); };
+  const int threads = analysisThreadCount();
+  const size_t batch = (size_t) threads * 2;
+  size_t computed = 0, cached = 0;
+  for (size_t first = 0; first < keys.size(); first += batch) {
+    if (cancel.load()) { finish("cancelled", computed, cached); return; }
+    const std::vector<spectrogram::TileKey> part(keys.begin() + (std::ptrdiff_t) first,
+                                                 keys.begin() + (std::ptrdiff_t) std::min(keys.size(), first + batch));
+    const auto result = spectrogram::renderTiles(factory, part, pathFor, threads, cancel);
+    recordSpectrogramTiles(part, result, pathFor, false);
+    computed += result.computed;
+    cached += result.cached;
+    if (!result.ok) {
+      finish(cancel.load() ? "cancelled" : "error", computed, cached);
+      return;
+    }
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(3);
+    evt << "{\"type\":\"spectrogramProgress\",\"id\":\"" << g.id << "\",\"fraction\":"
+        << (double) std::min(keys.size(), first + batch) / (double) keys.size() << "}";
+    emit(evt.str());
+    jobs::reportProgress((double) std::min(keys.size(), first + batch) / (double) keys.size());
+  }
+  finish("ok", computed, cached);
+}
+
+// --- Project sidecar ---
+static constexpr uint32_t kPeaksArtifactTag = 0x314b4550;    // "PEK1"
+static constexpr uint32_t kTimelineArtifactTag = 0x314c4d54; // "TML1"
+static constexpr uint32_t kSidecarMetaTag = 0x3154454d;      // "MET1"
+
+static std::string encodePeaks(const peaks::Pyramid& pyramid) {
+  artifacts::BlobWriter out(kPeaksArtifactTag);
+  out.put(pyramid.sampleRate);
+  out.put(pyramid.lengthInSamples);
+  out.put((int32_t) pyramid.channels);
+  out.put(pyramid.elapsedMs);
+  out.put((int32_t) pyramid.threads);
+  out.put((uint32_t) pyramid.levels.size());
+  for (const auto& level : pyramid.levels) {
+    out.put(level.samplesPerBucket);
+    out.putVector(level.minMax);
+  }
+  return out.data();
+}
+
+static std::shared_ptr<const peaks::Pyramid> decodePeaks(std::string_view bytes) {
+  artifacts::BlobReader in(bytes, kPeaksArtifactTag);
+  auto pyramid = std::make_shared<peaks::Pyramid>();
+  int32_t channels = 0, threads = 0;
+  uint32_t levels = 0;
+  in.get(pyramid->sampleRate);
+  in.get(pyramid->lengthInSamples);
+  in.get(channels);
+  in.get(pyramid->elapsedMs);
+  in.get(threads);
+  in.get(levels);
+  for (uint32_t i = 0; i < levels && in.good(); ++i) {
+    peaks::Level level;
+    in.get(level.samplesPerBucket);
+    in.getVector(level.minMax);
+    pyramid->levels.push_back(std::move(level));
+  }
+  if (!in.good() || pyramid->levels.empty()) return nullptr;
+  pyramid->channels = channels;
+  pyramid->threads = threads;
+  return pyramid;
+}
+
+// Peak pyramid for the file at path, from the project sidecar or the
+// artifact cache when the same audio was seen before.
+static std::shared_ptr<const peaks::Pyramid> peaksFor(const std::string& path,
+                                                      const SampleReaderFactory& factory,
+                                                      const std::atomic<bool>& cancel,
+                                                      bool* cachedOut = nullptr) {
+  if (cachedOut) *cachedOut = true;
+  const std::string content = gFingerprints.of(path);
+  std::string artifact;
+  if (!content.empty()) {
+    std::string_view mapped;
+    if (auto side = gSidecar.forContent(content)) {
+      if (side->payload("PEAK", "minmax", mapped)) {
+        if (auto stored = decodePeaks(mapped)) return stored;
+      }
+    }
+    artifact = gArtifacts.pathFor(content, "peaks", "minmax", "bin");
+    std::string bytes;
+    if (gArtifacts.read(artifact, bytes)) {
+      if (auto stored = decodePeaks(bytes)) return stored;
+    }
+  }
+  if (cachedOut) *cachedOut = false;
+  auto pyramid = peaks::build(factory, 0, &cancel);
+  if (pyramid && !cancel.load() && !artifact.empty()) gArtifacts.write(artifact, encodePeaks(*pyramid));
+  return pyramid;
+}
+
+static std::string encodeTimeline(const CompiledTimeline& timeline) {
+  artifacts::BlobWriter out(kTimelineArtifactTag);
+  out.putVector(timeline.all());
+  return out.data();
+}
+
+static bool decodeTimeline(std::string_view bytes, std::vector<TimelineSpan>& spans) {
+  artifacts::BlobReader in(bytes, kTimelineArtifactTag);
+  in.getVector(spans);
+  return in.good();
+}
+
+// What a sidecar was written for.
+struct SidecarMeta {
+  std::string fingerprint;
+  std::string sourcePath;
+  double sampleRate = 0.0;
+  double durationSec = 0.0;
+  int channels = 0;
+  int64_t savedAt = 0; // Unix seconds
+};
+
+static std::string encodeSidecarMeta(const SidecarMeta& meta) {
+  artifacts::BlobWriter out(kSidecarMetaTag);
+  out.putString(meta.fingerprint);
+  out.putString(meta.sourcePath);
+  out.put(meta.sampleRate);
+  out.put(meta.durationSec);
+  out.put((int32_t) meta.channels);
+  out.put(meta.savedAt);
+  return out.data();
+}
+
+static bool decodeSidecarMeta(std::string_view bytes, SidecarMeta& meta) {
+  artifacts::BlobReader in(bytes, kSidecarMetaTag);
+  int32_t channels = 0;
+  in.getString(meta.fingerprint);
+  in.getString(meta.sourcePath);
+  in.get(meta.sampleRate);
+  in.get(meta.durationSec);
+  in.get(channels);
+  in.get(meta.savedAt);
+  meta.channels = channels;
+  return in.good();
+}
+
+static bool readSidecarMeta(const sidecar::Reader& reader, SidecarMeta& meta) {
+  std::string_view bytes;
+  return reader.payload("META", "", bytes) && decodeSidecarMeta(bytes, meta);
+}
+
+struct SidecarJob {
+  std::string path;
+  std::string sourcePath;
+  SampleReaderFactory factory;
+  std::shared_ptr<const CompiledTimeline> timeline;
+  SilenceParams silence;
+};
+
+// Gathers the source's artifacts (computing the missing ones) with the
+// current timeline and saves them into the sidecar; replies sidecarSaved.
+static void runSaveSidecar(const SidecarJob& job, const std::atomic<bool>& cancel) {
+  const auto started = std::chrono::steady_clock::now();
+  auto fail = [&](const std::string& message) {
+    emit("{\"type\":\"sidecarSaved\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"path\":\"" + jsonEscape(job.path) +
+         "\",\"message\":\"" + jsonEscape(message) + "\"}");
+    jobs::reportFailure();
+  };
+  SidecarMeta meta;
+  meta.fingerprint = gFingerprints.of(job.sourcePath);
+  if (meta.fingerprint.empty()) { fail("Unable to read source audio"); return; }
+  const auto analysis = loudnessAnalysisFor(job.sourcePath, job.factory, 0, cancel);
+  const SilenceResult silence = silenceFor(job.sourcePath, job.factory, job.silence, cancel);
+  const auto pyramid = peaksFor(job.sourcePath, job.factory, cancel);
+  if (cancel.load()) return;
+  if (!analysis || !silence.ok || !pyramid) { fail("Unable to read source audio"); return; }
+
+  meta.sourcePath = job.sourcePath;
+  meta.sampleRate = pyramid->sampleRate;
+  meta.durationSec = analysis->durationSec;
+  meta.channels = pyramid->channels;
+  meta.savedAt = (int64_t) std::time(nullptr);
+  std::vector<sidecar::Chunk> chunks;
+  chunks.push_back({ "META", "", encodeSidecarMeta(meta) });
+  chunks.push_back({ "LOUD", "steps", encodeLoudness(*analysis) });
+  chunks.push_back({ "SILN", silenceParamsKey(job.silence), encodeSilence(silence) });
+  chunks.push_back({ "PEAK", "minmax", encodePeaks(*pyramid) });
+  if (job.timeline) chunks.push_back({ "TIML", "", encodeTimeline(*job.timeline) });
+  const sidecar::SaveResult saved = sidecar::save(job.path, chunks);
+  if (!saved.ok) { fail(saved.error); return; }
+
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"sidecarSaved\",\"id\":\"" << g.id << "\",\"status\":\"ok\",\"path\":\"" << jsonEscape(job.path)
+      << "\",\"fingerprint\":\"" << meta.fingerprint << "\",\"generation\":" << saved.generation
+      << ",\"bytes\":" << saved.fileBytes << ",\"appendedBytes\":" << saved.appendedBytes
+      << ",\"compacted\":" << (saved.compacted ? "true" : "false") << ",\"chunks\":[";
+  for (size_t i = 0; i < saved.chunks.size(); ++i) {
+    const auto& entry = saved.chunks[i].first;
+    if (i) evt << ",";
+    evt << "{\"tag\":\"" << jsonEscape(entry.tag) << "\",\"name\":\"" << jsonEscape(entry.name)
+        << "\",\"bytes\":" << entry.length << ",\"written\":" << (saved.chunks[i].second ? "true" : "false") << "}";
+  }
+  evt << "],\"elapsedMs\":" << elapsedMs << "}";
+  juceDLog("[JUCE] sidecar saved: " + job.path + " generation " + std::to_string(saved.generation));
+  emit(evt.str());
+}
+
+// Maps the sidecar at path; its artifacts serve the audio it was written
+// for from then on. Replies sidecarOpened, with matches saying whether that
+// is the audio loaded now.
+static void openProjectSidecar(const std::string& path, const std::string& sourcePath) {
+  auto reader = std::make_shared<sidecar::Reader>();
+  std::string error;
+  SidecarMeta meta;
+  if (!reader->open(path, error) || !readSidecarMeta(*reader, meta)) {
+    if (error.empty()) error = "sidecar has no readable META chunk";
+    emit("{\"type\":\"sidecarOpened\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"path\":\"" + jsonEscape(path) +
+         "\",\"message\":\"" + jsonEscape(error) + "\"}");
+    return;
+  }
+  const std::string content = sourcePath.empty() ? std::string() : gFingerprints.of(sourcePath);
+  gSidecar.set(reader, meta.fingerprint);
+  std::ostringstream evt;
+  evt << "{\"type\":\"sidecarOpened\",\"id\":\"" << g.id << "\",\"status\":\"ok\",\"path\":\"" << jsonEscape(path)
+      << "\",\"version\":" << reader->version() << ",\"generation\":" << reader->generation()
+      << ",\"fingerprint\":\"" << meta.fingerprint << "\",\"matches\":" << (content == meta.fingerprint ? "true" : "false")
+      << ",\"damagedTrailers\":" << reader->damagedTrailers() << ",\"chunks\":[";
+  const auto& entries = reader->entries();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i) evt << ",";
+    evt << "{\"tag\":\"" << jsonEscape(entries[i].tag) << "\",\"name\":\"" << jsonEscape(entries[i].name)
+        << "\",\"bytes\":" << entries[i].length << "}";
+  }
+  evt << "]}";
+  emit(evt.str());
+}
+
+// juce-backend --dump-sidecar <path>: prints the sidecar's layout and a
+// summary of each chunk as one sidecarDump line. Exit code 1 if the file
+// cannot be read or a chunk fails its hash.
+static int dumpSidecar(const std::string& path) {
+  sidecar::Reader reader;
+  std::string error;
+  if (!reader.open(path, error)) {
+    std::cout << "{\"type\":\"sidecarDump\",\"status\":\"error\",\"path\":\"" << jsonEscape(path)
+              << "\",\"message\":\"" << jsonEscape(error) << "\"}" << std::endl;
+    return 1;
+  }
+  bool intact = true;
+  std::ostringstream out;
+  out.setf(std::ios::fixed);
+  out << std::setprecision(3);
+  out << "{\"type\":\"sidecarDump\",\"status\":\"ok\",\"path\":\"" << jsonEscape(path) << "\",\"version\":" << reader.version()
+      << ",\"generation\":" << reader.generation() << ",\"mapped\":" << (reader.mapped() ? "true" : "false")
+      << ",\"committedBytes\":" << reader.committedBytes() << ",\"totalBytes\":" << reader.totalBytes()
+      << ",\"liveBytes\":" << reader.liveBytes() << ",\"damagedTrailers\":" << reader.damagedTrailers() << ",\"chunks\":[";
+  const auto& entries = reader.entries();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const auto& entry = entries[i];
+    std::string_view bytes;
+    const bool hashOk = reader.payload(entry, bytes);
+    intact = intact && hashOk;
+    if (i) out << ",";
+    out << "{\"tag\":\"" << jsonEscape(entry.tag) << "\",\"name\":\"" << jsonEscape(entry.name) << "\",\"offset\":" << entry.offset
+        << ",\"bytes\":" << entry.length << ",\"hashOk\":" << (hashOk ? "true" : "false");
+    if (hashOk && entry.tag == "META") {
+      SidecarMeta meta;
+      if (decodeSidecarMeta(bytes, meta)) {
+        out << ",\"fingerprint\":\"" << meta.fingerprint << "\",\"source\":\"" << jsonEscape(meta.sourcePath)
+            << "\",\"sampleRate\":" << meta.sampleRate << ",\"durationSec\":" << meta.durationSec
+            << ",\"channels\":" << meta.channels << ",\"savedAt\":" << meta.savedAt;
+      }
+    } else if (hashOk && entry.tag == "LOUD") {
+      if (auto analysis = decodeLoudness(bytes)) {
+        const loudness::Summary whole = loudness::summarise(*analysis, loudness::wholeSource(*analysis));
+        out << ",\"steps\":" << analysis->stepPower.size() << ",\"integratedLufs\":"
+            << (std::isfinite(whole.integratedLufs) ? whole.integratedLufs : -120.0)
+            << ",\"truePeakDbtp\":" << whole.truePeakDbtp;
+      }
+    } else if (hashOk && entry.tag == "SILN") {
+      SilenceResult silence;
+      if (decodeSilence(bytes, silence)) {
+        out << ",\"intervals\":" << silence.intervals.size() << ",\"frames\":" << silence.frameDb.size()
+            << ",\"frameSec\":" << silence.frameSec;
+      }
+    } else if (hashOk && entry.tag == "PEAK") {
+      if (auto pyramid = decodePeaks(bytes)) {
+        out << ",\"levels\":[";
+        for (size_t l = 0; l < pyramid->levels.size(); ++l) {
+          if (l) out << ",";
+          out << "{\"samplesPerBucket\":" << pyramid->levels[l].samplesPerBucket
+              << ",\"buckets\":" << pyramid->levels[l].buckets() << "}";
+        }
+        out << "]";
+      }
+    } else if (hashOk && entry.tag == "TIML") {
+      std::vector<TimelineSpan> spans;
+      if (decodeTimeline(bytes, spans)) {
+        out << ",\"spans\":" << spans.size() << ",\"editedDurationSec\":" << (spans.empty() ? 0.0 : spans.back().editedEnd);
+      }
+    }
+    out << "}";
+  }
+  out << "]}";
+  std::cout << out.str() << std::endl;
+  return intact ? 0 : 1;
+}
+
+// --- EDL model ---
+// Shared by the JUCE engine and the mock, so both parse, compile and map an
+// EDL identically.
+// Individual word or spacer within a clip
+struct Segment {
+  std::string type;        // "word" or "spacer"
+  double start;            // Start time
+  double end;              // End time
+  double dur;              // Duration
+  std::string text;        // Text content (for words, empty for spacers)
+  double originalStart = -1; // Original timing (if provided)
+  double originalEnd = -1;   // Original timing (if provided)
+  int clipIndex = -1;        // Owning clip in the flattened timeline
+  int indexInClip = -1;      // Position in the owning clip's segments, as sent in the EDL
+
+  bool hasOriginal() const { return originalStart >= 0 && originalEnd >= 0; }
+};
+
+// Clip container holding segments (words and spacers)
+struct Clip {
+  std::string id;
+  double startSec;         // Clip start in EDL timeline
+  double endSec;           // Clip end in EDL timeline
+  double originalStartSec = -1; // Original audio position
+  double originalEndSec = -1;   // Original audio position
+  std::string speaker;
+  std::string type;        // "speech", etc.
+  std::vector<Segment> segments; // Words and spacers within this clip
+
+  double duration() const { return endSec - startSec; }
+  bool hasOriginal() const { return originalStartSec >= 0 && originalEndSec >= 0; }
+  size_t segmentCount() const { return segments.size(); }
+};
+
+// Everything built from one EDL payload: the parsed clips, the flattened
+// segments and the compiled lookups. Immutable once activated, so a revision
+// can stay in the RevisionCache and be switched back to by pointer.
+struct EdlRevision {
+  std::vector<Clip> clips;
+  std::vector<Segment> segments; // Flattened segments for playback (legacy compatibility)
+  bool contiguous = false;
+  size_t wordSegments = 0;
+  size_t spacerSegments = 0;
+  size_t totalSegments = 0;
+  std::shared_ptr<const CompiledTimeline> timeline;
+  std::shared_ptr<const TextIndex> textIndex;
+  size_t byteSize = 0; // bytes(), computed once when the revision is built
+
+  // Approximate heap footprint, for the cache budget.
+  size_t bytes() const {
+    size_t total = sizeof(EdlRevision) + clips.capacity() * sizeof(Clip) + segments.capacity() * sizeof(Segment);
+    auto segmentBytes = [](const Segment& seg) { return seg.type.capacity() + seg.text.capacity(); };
+    for (const auto& clip : clips) {
+      total += clip.id.capacity() + clip.speaker.capacity() + clip.type.capacity();
+      total += clip.segments.capacity() * sizeof(Segment);
+      for (const auto& seg : clip.segments) total += segmentBytes(seg);
+    }
+    for (const auto& seg : segments) total += segmentBytes(seg);
+    if (timeline) total += timeline->size() * sizeof(TimelineSpan) + timeline->indexBytes();
+    if (textIndex) total += textIndex->memoryBytes();
+    return total;
+  }
+};
+
+static void logParseDiagnostic(const std::string& message) {
+  juceDLog(std::string("[JUCE][EDL][parse] ") + message);
+}
+
+// Contents of the payload's "clips" array: [aStart, aEnd).
+static bool findClipsArray(std::string_view json, size_t& aStart, size_t& aEnd) {
+  size_t key = json.find("\"clips\"");
+  if (key == std::string::npos) return false;
+  size_t colon = json.find(':', key);
+  if (colon == std::string::npos) return false;
+  size_t lb = json.find('[', colon);
+  if (lb == std::string::npos) return false;
+  // Brackets are sparse (one segments array per clip), so jump between them
+  // with find() instead of stepping through every byte.
+  int depth = 1;
+  size_t open = json.find('[', lb + 1);
+  size_t close = json.find(']', lb + 1);
+  while (close != std::string::npos) {
+    if (open < close) {
+      depth++;
+      open = json.find('[', open + 1);
+    } else {
+      if (--depth == 0) break;
+      close = json.find(']', close + 1);
+    }
+  }
+  if (depth != 0) return false;
+  aStart = lb + 1;
+  aEnd = close;
+  return true;
+}
+
+// Revision-cache key of an EDL payload. Only the clips array feeds the
+// compile, so a resend under a new revision number still matches. Hashing
+// it is linear in the payload: a resent EDL skips parsing and compiling, not
+// reading; activateRevision is the lookup that needs no payload.
+static EdlContentKey edlContentKey(std::string_view json) {
+  size_t aStart = 0;
+  size_t aEnd = 0;
+  if (!findClipsArray(json, aStart, aEnd)) return {};
+  return EdlContentKey::of(json.data() + aStart, aEnd - aStart);
+}
+
+// Top-level "revision" of a payload, or 0.
+static int edlPayloadRevision(std::string_view json) {
+  const size_t p = json.find("\"revision\"");
+  if (p == std::string::npos) return 0;
+  const size_t c = json.find(':', p);
+  if (c == std::string::npos) return 0;
+  const size_t e = json.find_first_of(",}\n", c + 1);
+  return (int) numberOr(std::string(json.substr(c + 1, (e == std::string::npos ? json.size() : e) - (c + 1))), 0.0);
+}
+
+// Parses in place: clip and segment objects are views into json, and only
+// the field values are copied out.
+static bool parseClipsFromJsonPayload(std::string_view json, std::vector<Clip>& clipsOut, int* revisionOut = nullptr) {
+  metrics::ScopeTimer timing(&gMetrics.edlParseUs);
+  gMetrics.edlPayloadBytes.store(json.size(), std::memory_order_relaxed);
+  clipsOut.clear();
+
+  size_t aStart = 0;
+  size_t aEnd = 0;
+  if (!findClipsArray(json, aStart, aEnd)) {
+    logParseDiagnostic("Failed to locate clips array in payload");
+    return false;
+  }
+
+  logParseDiagnostic("clips array located: start=" + std::to_string(aStart) + ", end=" + std::to_string(aEnd));
+
+  std::vector<std::string_view> itemStrings;
+  size_t cursor = aStart;
+  size_t maxIterations = 0;
+  while (cursor < aEnd) {
+    if (++maxIterations > 1000000) {
+      logParseDiagnostic("Aborting clip extraction after 1M iterations (possible malformed JSON)");
+      return false;
+    }
+
+    while (cursor < aEnd && (json[cursor] == ' ' || json[cursor] == ',' || json[cursor] == '\n' || json[cursor] == '\r' || json[cursor] == '\t')) cursor++;
+    if (cursor >= aEnd) break;
+    if (json[cursor] != '{') {
+      cursor++;
+      continue;
+    }
+
+    int depth = 1;
+    size_t objStart = cursor;
+    cursor++;
+    while (cursor < aEnd && depth > 0) {
+      if (json[cursor] == '{') depth++;
+      else if (json[cursor] == '}') depth--;
+      cursor++;
+    }
+
+    if (depth != 0) {
+      logParseDiagnostic("Unbalanced braces while scanning clip object at index " + std::to_string(itemStrings.size()));
+      return false;
+    }
+
+    size_t objEnd = cursor;
+    if (objEnd <= objStart) {
+      logParseDiagnostic("Invalid clip bounds: start=" + std::to_string(objStart) + ", end=" + std::to_string(objEnd));
+      return false;
+    }
+
+    const size_t length = objEnd - objStart;
+    if (length > json.size()) {
+      logParseDiagnostic("Clip length overflow detected (" + std::to_string(length) + ")");
+      return false;
+    }
+
+    itemStrings.push_back(json.substr(objStart, length));
+  }
+
+  logParseDiagnostic("Found " + std::to_string(itemStrings.size()) + " clip objects");
+
+  auto extractNumber = [&](std::string_view s, const char* key) -> double {
+    size_t p = s.find(key);
     if (p == std::string::npos) return std::numeric_limits<double>::quiet_NaN();
     size_t c = s.find(':', p);
     if (c == std::string::npos) return std::numeric_limits<double>::quiet_NaN();
     size_t e = s.find_first_of(",}\n", c + 1);
-    std::string token = s.substr(c + 1, (e == std::string::npos ? s.size() : e) - (c + 1));
+    const std::string token(s.substr(c + 1, (e == std::string::npos ? s.size() : e) - (c + 1)));
+    try {
+      return std::stod(token);
+    } catch (...) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+  };
+
+  auto extractString = [&](std::string_view s, const char* key) -> std::string {
+    size_t p = s.find(key);
+    if (p == std::string::npos) return {};
+    size_t c = s.find(':', p);
+    if (c == std::string::npos) return {};
+    size_t qs = s.find('"', c);
+    if (qs == std::string::npos) return {};
+    size_t qe = s.find('"', qs + 1);
+    if (qe == std::string::npos) return {};
+    return std::string(s.substr(qs + 1, qe - (qs + 1)));
+  };
+
+  if (revisionOut) {
+    double revValue = extractNumber(json, "\"revision\"");
+    if (revValue == revValue) {
+      *revisionOut = static_cast<int>(revValue);
+    }
+  }
+
+  size_t clipIndex = 0;
+  for (const auto& clipJson : itemStrings) {
+    Clip clip;
+    clip.id = extractString(clipJson, "\"id\"");
+
+    const double startSecRaw = extractNumber(clipJson, "\"startSec\"");
+    const double endSecRaw = extractNumber(clipJson, "\"endSec\"");
+    clip.startSec = sanitizeTime(startSecRaw);
+    clip.endSec = sanitizeTime(endSecRaw, clip.startSec);
+
+    const double clipDur = sanitizeDuration(clip.endSec - clip.startSec);
+    if (clipDur <= 0.0) {
+      clipIndex++;
+      continue;
+    }
+
+    clip.originalStartSec = extractNumber(clipJson, "\"originalStartSec\"");
+    clip.originalEndSec = extractNumber(clipJson, "\"originalEndSec\"");
+    if (!(clip.originalStartSec == clip.originalStartSec && clip.originalEndSec == clip.originalEndSec)) {
+      clip.originalStartSec = -1;
+      clip.originalEndSec = -1;
+    } else {
+      clip.originalStartSec = sanitizeTime(clip.originalStartSec, clip.startSec);
+      clip.originalEndSec = sanitizeTime(clip.originalEndSec, clip.originalStartSec);
+      if (sanitizeDuration(clip.originalEndSec - clip.originalStartSec) <= 0.0) {
+        clip.originalStartSec = -1;
+        clip.originalEndSec = -1;
+      }
+    }
+
+    clip.speaker = extractString(clipJson, "\"speaker\"");
+    clip.type = extractString(clipJson, "\"type\"");
+
+    size_t segStart = clipJson.find("\"segments\"");
+    if (segStart != std::string::npos) {
+      size_t segArrayStart = clipJson.find('[', segStart);
+      if (segArrayStart != std::string::npos) {
+        int segDepth = 1;
+        size_t segCursor = segArrayStart + 1;
+        while (segCursor < clipJson.size() && segDepth > 0) {
+          if (clipJson[segCursor] == '[') segDepth++;
+          else if (clipJson[segCursor] == ']') segDepth--;
+          segCursor++;
+        }
+
+        if (segDepth == 0) {
+          if (segCursor <= segArrayStart + 1) {
+            logParseDiagnostic("Clip " + std::to_string(clipIndex) + " has empty or malformed segment array bounds");
+          } else {
+            const size_t segLength = segCursor - segArrayStart - 1;
+            if (segLength > clipJson.size()) {
+              logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment array length overflow: " + std::to_string(segLength));
+              return false;
+            }
+
+            const std::string_view segArrayContent = clipJson.substr(segArrayStart + 1, segLength - 1);
+            size_t segPos = 0;
+            size_t segIterations = 0;
+            while (segPos < segArrayContent.size()) {
+              if (++segIterations > 1000000) {
+                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " exceeded 1M segment iterations");
+                return false;
+              }
+
+              while (segPos < segArrayContent.size() && (segArrayContent[segPos] == ' ' || segArrayContent[segPos] == ',' || segArrayContent[segPos] == '\n' || segArrayContent[segPos] == '\r' || segArrayContent[segPos] == '\t')) segPos++;
+              if (segPos >= segArrayContent.size()) break;
+              if (segArrayContent[segPos] != '{') {
+                segPos++;
+                continue;
+              }
+
+              int segDepth2 = 1;
+              size_t segObjStart = segPos;
+              segPos++;
+              while (segPos < segArrayContent.size() && segDepth2 > 0) {
+                if (segArrayContent[segPos] == '{') segDepth2++;
+                else if (segArrayContent[segPos] == '}') segDepth2--;
+                segPos++;
+              }
+
+              if (segDepth2 != 0) {
+                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment braces unbalanced");
+                return false;
+              }
+
+              if (segPos <= segObjStart) {
+                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment bounds invalid");
+                return false;
+              }
+
+              const size_t segObjLen = segPos - segObjStart;
+              if (segObjLen > segArrayContent.size()) {
+                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment length overflow: " + std::to_string(segObjLen));
+                return false;
+              }
+
+              const std::string_view segJson = segArrayContent.substr(segObjStart, segObjLen);
+              Segment segment;
+              segment.type = extractString(segJson, "\"type\"");
+
+              const double segStartRaw = extractNumber(segJson, "\"startSec\"");
+              const double segEndRaw = extractNumber(segJson, "\"endSec\"");
+              if (!(segStartRaw == segStartRaw && segEndRaw == segEndRaw)) {
+                continue;
+              }
+
+              const double segStartSafe = sanitizeTime(segStartRaw);
+              const double segEndSafe = sanitizeTime(segEndRaw, segStartSafe);
+              const double segDurSafe = sanitizeDuration(segEndSafe - segStartSafe);
+              if (segDurSafe <= 0.0) {
+                continue;
+              }
+
+              segment.start = segStartSafe;
+              segment.end = segStartSafe + segDurSafe;
+              segment.dur = segDurSafe;
+              segment.text = extractString(segJson, "\"text\"");
+
+              segment.originalStart = extractNumber(segJson, "\"originalStartSec\"");
+              segment.originalEnd = extractNumber(segJson, "\"originalEndSec\"");
+              if (segment.originalStart == segment.originalStart && segment.originalEnd == segment.originalEnd) {
+                segment.originalStart = sanitizeTime(segment.originalStart, 0.0);
+                segment.originalEnd = sanitizeTime(segment.originalEnd, segment.originalStart);
+                if (sanitizeDuration(segment.originalEnd - segment.originalStart) <= 0.0) {
+                  segment.originalStart = -1;
+                  segment.originalEnd = -1;
+                }
+              } else {
+                segment.originalStart = -1;
+                segment.originalEnd = -1;
+              }
+
+              clip.segments.push_back(segment);
+            }
+            logParseDiagnostic("Clip " + std::to_string(clipIndex) + " parsed " + std::to_string(clip.segments.size()) + " segments");
+          }
+        }
+      }
+    }
+
+    if (!clip.segments.empty()) {
+      clipsOut.push_back(clip);
+    }
+
+    clipIndex++;
+    if ((clipIndex % 1000) == 0) {
+      logParseDiagnostic("Processed " + std::to_string(clipIndex) + " clips so far");
+    }
+  }
+
+  return true;
+}
+
+// Edited-timeline playback range, in edited seconds.
+struct PlayRange {
+  bool active = false;
+  bool loop = false;
+  bool seekToStart = false; // playRange jumps to the start; setLoop keeps the playhead
+  double startSec = 0.0;
+  double endSec = 0.0;
+  double crossfadeSec = 0.0; // loops only
+};
+
+// Builds the edited/original lookup and the word index from a revision's
+// flattened segments.
+static void compileRevision(EdlRevision& rev) {
+  auto compiled = std::make_shared<CompiledTimeline>();
+  for (size_t i = 0; i < rev.segments.size(); ++i) {
+    const auto& s = rev.segments[i];
+    const double os = s.hasOriginal() ? sanitizeTime(s.originalStart, s.start) : sanitizeTime(s.start);
+    const double oe = s.hasOriginal() ? sanitizeTime(s.originalEnd, s.end) : sanitizeTime(s.end);
+    const double odur = sanitizeDuration(oe - os);
+    const double edur = sanitizeDuration(s.dur);
+    if (odur <= 0.0 || edur <= 0.0) continue;
+    compiled->add(edur, os, os + odur, s.clipIndex, (int) i);
+  }
+  compiled->finish();
+  auto index = std::make_shared<TextIndex>();
+  for (const auto& span : compiled->all()) {
+    const Segment& seg = rev.segments[(size_t) span.segmentIndex];
+    if (seg.type == "word" && !seg.text.empty()) index->add(seg.text, span);
+  }
+  index->finish();
+  rev.timeline = compiled;
+  rev.textIndex = index;
+}
+
+// The EDL in force before any updateEdl: one segment over the whole file.
+static std::shared_ptr<EdlRevision> fullFileRevision(double durationSec) {
+  auto rev = std::make_shared<EdlRevision>();
+  if (durationSec > 0.0) {
+    Segment fullSegment;
+    fullSegment.type = "speech";
+    fullSegment.start = 0.0;
+    fullSegment.end = durationSec;
+    fullSegment.dur = durationSec;
+    rev->segments.push_back(fullSegment);
+  }
+  compileRevision(*rev);
+  rev->byteSize = rev->bytes();
+  return rev;
+}
+
+// Flattens parsed clips into playback segments and compiles the lookups.
+// Shared by the JUCE engine and the mock, so both apply an EDL identically.
+static std::shared_ptr<EdlRevision> buildRevision(std::vector<Clip> newClips, int revision) {
+  const auto compileStarted = std::chrono::steady_clock::now();
+  auto next = std::make_shared<EdlRevision>();
+  auto& clips = next->clips;
+  auto& segments = next->segments;
+  clips = std::move(newClips);
+
+  // Count total segments across all clips
+  size_t totalSegments = 0;
+  size_t spacerSegments = 0;
+  size_t wordSegments = 0;
+  for (const auto& clip : clips) {
+    totalSegments += clip.segments.size();
+    for (const auto& segment : clip.segments) {
+      if (segment.type == "spacer") spacerSegments++;
+      else wordSegments++;
+    }
+  }
+  next->wordSegments = wordSegments;
+  next->spacerSegments = spacerSegments;
+  next->totalSegments = totalSegments;
+
+  {
+    std::ostringstream oss;
+    oss << "[JUCE] Parsed EDL revision " << revision
+        << ": clips=" << clips.size()
+        << ", words=" << wordSegments
+        << ", spacers=" << spacerSegments
+        << ", total=" << totalSegments
+        << ", mode=" << (next->contiguous ? "contiguous" : "standard");
+    juceDLog(oss.str());
+  }
+
+  // Enhanced debug logging - write to file to see what JUCE receives
+  std::ofstream debugFile(juceDebugPath(), std::ios::app);
+  debugFile << "[JUCE] updateEdl received revision " << revision
+            << " with " << clips.size() << " clips containing "
+            << totalSegments << " segments (" << wordSegments << " words / "
+            << spacerSegments << " spacers) at " << std::time(nullptr) << std::endl;
+  // Log clip and segment details
+  debugFile << "[JUCE] Clip details:" << std::endl;
+  for (size_t c = 0; c < clips.size(); c++) {
+    const auto& clip = clips[c];
+    debugFile << "  [JUCE] Clip[" << c << "]: id=" << clip.id
+              << ", " << clip.segments.size() << " segments ("
+              << std::fixed << std::setprecision(2) << clip.duration() << "s)" << std::endl;
+
+    // Log first few segments of each clip
+    for (size_t s = 0; s < std::min(clip.segments.size(), size_t(5)); s++) {
+      const auto& segment = clip.segments[s];
+      debugFile << "    [JUCE] Segment[" << s << "]: "
+                << segment.type << " " << segment.start << "-" << segment.end << "s";
+      if (segment.type == "word" && !segment.text.empty()) {
+        debugFile << " \"" << segment.text << "\"";
+      }
+      debugFile << std::endl;
+    }
+    if (clip.segments.size() > 5) {
+      debugFile << "    [JUCE] ... (" << (clip.segments.size() - 5) << " more segments)" << std::endl;
+    }
+  }
+  debugFile.flush();
+
+  // Detect contiguous timeline by checking if clips are perfectly aligned
+  next->contiguous = false;
+  if (clips.size() > 1) {
+    int consecutiveMatches = 0;
+    for (size_t i = 1; i < clips.size() && i < 5; i++) {
+      double gap = clips[i].startSec - clips[i-1].endSec;
+      if (std::abs(gap) < 0.01) { // 10ms tolerance
+        consecutiveMatches++;
+      }
+    }
+
+    if (consecutiveMatches >= 2) {
+      next->contiguous = true;
+      debugFile << "[JUCE] CONTIGUOUS TIMELINE DETECTED for revision " << revision << std::endl;
+    } else {
+      debugFile << "[JUCE] Standard timeline (gap matches: " << consecutiveMatches << ") for revision " << revision << std::endl;
+    }
+  }
+
+  // Create flattened segments array for playback
+  segments.clear();
+  for (size_t clipIndex = 0; clipIndex < clips.size(); ++clipIndex) {
+    const auto& clip = clips[clipIndex];
+    const double clipTimelineStart = sanitizeTime(clip.startSec);
+    const double clipTimelineEnd = sanitizeTime(clip.endSec, clipTimelineStart);
+    const double clipTimelineDur = sanitizeDuration(clipTimelineEnd - clipTimelineStart);
+    if (clipTimelineDur <= 0.0) {
+      debugFile << "[JUCE] Skipping clip with invalid duration: " << clip.id << std::endl;
+      continue;
+    }
+
+    const bool clipHasOriginal = clip.hasOriginal();
+    const double clipOriginalStart = clipHasOriginal ? sanitizeTime(clip.originalStartSec, clipTimelineStart) : 0.0;
+    const double clipOriginalEnd = clipHasOriginal ? sanitizeTime(clip.originalEndSec, clipOriginalStart) : 0.0;
+    const double clipOriginalDur = clipHasOriginal ? sanitizeDuration(clipOriginalEnd - clipOriginalStart) : 0.0;
+
+    for (size_t segIndex = 0; segIndex < clip.segments.size(); ++segIndex) {
+      const auto& seg = clip.segments[segIndex];
+      const double segDur = sanitizeDuration(seg.dur);
+      if (segDur <= 0.0) {
+        continue;
+      }
+
+      Segment flatSeg;
+      flatSeg.type = seg.type;
+      flatSeg.text = seg.text;
+      flatSeg.clipIndex = (int) clipIndex;
+      flatSeg.indexInClip = (int) segIndex;
+
+      const double segStartTimeline = sanitizeTime(clipTimelineStart + seg.start, clipTimelineStart);
+      const double segEndTimeline = sanitizeTime(segStartTimeline + segDur, segStartTimeline + segDur);
+      const double segTimelineDur = sanitizeDuration(segEndTimeline - segStartTimeline);
+      if (segTimelineDur <= 0.0) {
+        continue;
+      }
+
+      flatSeg.start = segStartTimeline;
+      flatSeg.end = segStartTimeline + segTimelineDur;
+      flatSeg.dur = segTimelineDur;
+
+      if (seg.hasOriginal()) {
+        const double segOrigStart = sanitizeTime(seg.originalStart, segStartTimeline);
+        const double segOrigEnd = sanitizeTime(seg.originalEnd, segOrigStart);
+        const double segOrigDur = sanitizeDuration(segOrigEnd - segOrigStart);
+        if (segOrigDur > 0.0) {
+          flatSeg.originalStart = segOrigStart;
+          flatSeg.originalEnd = segOrigStart + segOrigDur;
+        } else {
+          flatSeg.originalStart = segStartTimeline;
+          flatSeg.originalEnd = segEndTimeline;
+        }
+      } else if (clipHasOriginal && clipOriginalDur > 0.0) {
+        const double ratio = std::min(1.0, std::max(0.0, seg.start / clipTimelineDur));
+        const double mappedStart = clipOriginalStart + ratio * clipOriginalDur;
+        flatSeg.originalStart = sanitizeTime(mappedStart, clipOriginalStart);
+        flatSeg.originalEnd = sanitizeTime(flatSeg.originalStart + segTimelineDur, flatSeg.originalStart + segTimelineDur);
+      } else {
+        flatSeg.originalStart = segStartTimeline;
+        flatSeg.originalEnd = segEndTimeline;
+      }
+
+      if (sanitizeDuration(flatSeg.originalEnd - flatSeg.originalStart) <= 0.0) {
+        flatSeg.originalStart = segStartTimeline;
+        flatSeg.originalEnd = segEndTimeline;
+      }
+
+      segments.push_back(flatSeg);
+    }
+  }
+
+  if (!segments.empty()) {
+    std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+      if (a.start == b.start) return a.end < b.end;
+      return a.start < b.start;
+    });
+  }
+
+  debugFile << "[JUCE] Created " << segments.size() << " flattened segments for playback" << std::endl;
+
+  // Safety check: Verify we have segments before enabling contiguous mode
+  if (next->contiguous && segments.empty()) {
+    debugFile << "[JUCE] WARNING: Contiguous timeline detected but no segments received" << std::endl;
+    debugFile << "[JUCE] Falling back to standard timeline mode" << std::endl;
+    next->contiguous = false;
+
+    // Create a default full-file segment to prevent playback failure
+    if (g.durationSec > 0) {
+      Segment fullSegment;
+      fullSegment.type = "speech";
+      fullSegment.start = 0.0;
+      fullSegment.end = g.durationSec;
+      fullSegment.dur = g.durationSec;
+      fullSegment.originalStart = 0.0;
+      fullSegment.originalEnd = g.durationSec;
+      segments.push_back(fullSegment);
+      debugFile << "[JUCE] Created fallback full-file segment: 0.0-" << g.durationSec << "s" << std::endl;
+    }
+  }
+
+  const std::string mode = next->contiguous ? "contiguous" : "standard";
+
+  debugFile << "[JUCE] updateEdl segment breakdown complete for revision " << revision
+            << ", mode=" << mode << std::endl;
+  debugFile << "[JUCE] Emitting edlApplied event (status=ok)" << std::endl;
+  debugFile << "        id=" << g.id
+            << ", revision=" << revision
+            << ", words=" << wordSegments
+            << ", spacers=" << spacerSegments
+            << ", totalSegments=" << totalSegments
+            << ", mode=" << mode << std::endl;
+  debugFile.flush();
+
+  compileRevision(*next);
+  next->byteSize = next->bytes();
+  gMetrics.edlCompileUs.record(std::chrono::steady_clock::now() - compileStarted);
+  gMetrics.edlSegments.store(segments.size(), std::memory_order_relaxed);
+  return next;
+}
+
+// edlApplied for a revision that was just activated, compiled or from the cache.
+static void emitRevisionApplied(const EdlRevision& rev, int revision, bool cacheHit) {
+  const std::string mode = rev.contiguous ? "contiguous" : "standard";
+  std::ostringstream diag;
+  diag << "mode=" << mode
+       << ", clips=" << rev.clips.size()
+       << ", words=" << rev.wordSegments
+       << ", spacers=" << rev.spacerSegments
+       << ", totalSegments=" << rev.totalSegments;
+  if (cacheHit) diag << ", cache=hit";
+  emitEdlAppliedEvent(revision, rev.wordSegments, rev.spacerSegments, rev.totalSegments, mode, "ok", diag.str());
+}
+
+static double revisionEditedToOriginal(const EdlRevision& rev, double ed) {
+  if (!rev.timeline || rev.timeline->empty()) {
+    if (rev.segments.empty()) return sanitizeTime(ed);
+    const auto& last = rev.segments.back();
+    return last.hasOriginal() ? sanitizeTime(last.originalEnd, last.end) : sanitizeTime(last.end);
+  }
+  return rev.timeline->editedToOriginal(sanitizeTime(ed));
+}
+
+// Length of the edited timeline, or the file when nothing is compiled.
+static double revisionDuration(const EdlRevision& rev) {
+  return rev.timeline && !rev.timeline->empty() ? rev.timeline->editedDuration() : g.durationSec;
+}
+
+// The edited range [startSec, endSec) as original-file spans, clipped to the
+// range; neighbours that continue in the file are merged.
+static std::vector<TimelineSpan> editedRangeSpans(const EdlRevision& rev, double startSec, double endSec) {
+  std::vector<TimelineSpan> out;
+  if (!rev.timeline || rev.timeline->empty()) {
+    TimelineSpan span;
+    span.editedStart = span.originalStart = std::clamp(startSec, 0.0, g.durationSec);
+    span.editedEnd = span.originalEnd = std::clamp(endSec, 0.0, g.durationSec);
+    if (span.editedEnd > span.editedStart) out.push_back(span);
+    return out;
+  }
+  const CompiledTimeline& timeline = *rev.timeline;
+  for (size_t i = timeline.spanAtEdited(startSec); i < timeline.size() && timeline[i].editedStart < endSec; ++i) {
+    TimelineSpan span = timeline[i];
+    const double scale = (span.originalEnd - span.originalStart) / (span.editedEnd - span.editedStart);
+    const double from = std::max(startSec, span.editedStart), to = std::min(endSec, span.editedEnd);
+    if (!(to > from)) continue;
+    span.originalStart += (from - span.editedStart) * scale;
+    span.originalEnd = span.originalStart + (to - from) * scale;
+    span.editedStart = from;
+    span.editedEnd = to;
+    if (!out.empty() && std::abs(out.back().originalEnd - span.originalStart) < 1e-6 &&
+        std::abs(out.back().editedEnd - span.editedStart) < 1e-6) {
+      out.back().originalEnd = span.originalEnd;
+      out.back().editedEnd = span.editedEnd;
+      continue;
+    }
+    out.push_back(span);
+  }
+  return out;
+}
+
+static void emitPositionFor(const EdlRevision& rev) {
+  const double es = sanitizeTime(g.editedSec.load());
+  const double os = sanitizeTime(revisionEditedToOriginal(rev, es));
+  emitPositionJson(std::string("{") +
+       "\"type\":\"position\",\"id\":\"" + g.id + "\",\"editedSec\":" + std::to_string(es) +
+        ",\"originalSec\":" + std::to_string(os) + "}");
+}
+
+// Clamps and validates a range against the edited duration; emits the error
+// for an empty one.
+static bool makePlayRange(double duration, double startSec, double endSec, bool loop, double crossfadeSec,
+                          bool seekToStart, PlayRange& range) {
+  range = PlayRange();
+  range.active = true;
+  range.loop = loop;
+  range.seekToStart = seekToStart;
+  range.startSec = std::clamp(sanitizeTime(startSec), 0.0, duration);
+  range.endSec = std::clamp(sanitizeTime(endSec, duration), 0.0, duration);
+  range.crossfadeSec = std::clamp(std::isfinite(crossfadeSec) ? crossfadeSec : 0.0, 0.0, 0.1);
+  if (sanitizeDuration(range.endSec - range.startSec) <= 0.0) {
+    emit("{\"type\":\"error\",\"message\":\"Invalid range\"}");
+    return false;
+  }
+  return true;
+}
+
+// --- Transcript queries ---
+static void writeWordsJson(std::ostringstream& evt, const EdlRevision& rev, size_t first, size_t count) {
+  const TextIndex& index = *rev.textIndex;
+  const TextWord& a = index[first];
+  const TextWord& b = index[first + count - 1];
+  const Segment& seg = rev.segments[a.segmentIndex];
+  std::string text;
+  for (size_t w = first; w < first + count; ++w) {
+    if (w > first && index[w].segmentIndex == index[w - 1].segmentIndex) continue;
+    if (!text.empty()) text += " ";
+    text += rev.segments[index[w].segmentIndex].text;
+  }
+  const std::string clipId = a.clipIndex >= 0 && (size_t) a.clipIndex < rev.clips.size() ? rev.clips[(size_t) a.clipIndex].id : "";
+  evt << "{\"segmentIndex\":" << a.segmentIndex
+      << ",\"clipId\":\"" << jsonEscape(clipId) << "\""
+      << ",\"indexInClip\":" << seg.indexInClip
+      << ",\"text\":\"" << jsonEscape(text) << "\""
+      << ",\"editedStart\":" << a.editedStart << ",\"editedEnd\":" << b.editedEnd
+      << ",\"originalStart\":" << a.originalStart << ",\"originalEnd\":" << b.originalEnd << "}";
+}
+
+// Matches come back in edited order with edited and original times, and the
+// clip id / segment position the EDL used for the first word.
+static void emitFindTextResult(const EdlRevision& rev, const std::string& query, bool prefix, double fromSec, double toSec,
+                               size_t maxResults) {
+  const auto started = std::chrono::steady_clock::now();
+  size_t total = 0;
+  std::vector<TextMatch> matches;
+  if (rev.textIndex) matches = rev.textIndex->find(query, prefix, fromSec, toSec, maxResults, &total);
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"findTextResult\",\"id\":\"" << g.id << "\",\"query\":\"" << jsonEscape(query) << "\""
+      << ",\"total\":" << total << ",\"matches\":[";
+  for (size_t i = 0; i < matches.size(); ++i) {
+    if (i) evt << ",";
+    writeWordsJson(evt, rev, matches[i].first, matches[i].count);
+  }
+  const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+  evt << "],\"elapsedUs\":" << elapsedUs << "}";
+  emit(evt.str());
+}
+
+// Words overlapping the edited range, one entry per word.
+static void emitWordsInRange(const EdlRevision& rev, double startSec, double endSec, size_t maxResults) {
+  std::pair<size_t, size_t> range { 0, 0 };
+  if (rev.textIndex) range = rev.textIndex->wordsInRange(startSec, endSec);
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"wordsInRange\",\"id\":\"" << g.id << "\",\"startSec\":" << startSec << ",\"endSec\":" << endSec
+      << ",\"total\":" << (range.second - range.first) << ",\"words\":[";
+  const size_t last = std::min(range.second, range.first + maxResults);
+  for (size_t w = range.first; w < last; ++w) {
+    if (w > range.first) evt << ",";
+    writeWordsJson(evt, rev, w, 1);
+  }
+  evt << "]}";
+  emit(evt.str());
+}
+
+// Edited start of a word: by flattened segment index, or the occurrence-th
+// match of text at or after fromSec. Negative when there is none.
+static double wordStartSec(const EdlRevision& rev, int segmentIndex, const std::string& text, size_t occurrence,
+                           double fromSec) {
+  if (!rev.textIndex) return -1.0;
+  const TextIndex& index = *rev.textIndex;
+  if (segmentIndex >= 0) {
+    const size_t w = index.wordForSegment((size_t) segmentIndex);
+    return w < index.size() ? index[w].editedStart : -1.0;
+  }
+  if (text.empty()) return -1.0;
+  const auto matches = index.find(text, false, fromSec, std::numeric_limits<double>::infinity(), occurrence + 1);
+  return matches.size() > occurrence ? index[matches[occurrence].first].editedStart : -1.0;
+}
+
+// --- Cut refinement ---
+template <typename Extract>
+static CutRefineParams cutRefineParamsFromCommand(const Extract& extract) {
+  CutRefineParams params;
+  const std::string mode = extract("mode");
+  if (mode == "zeroCrossing") params.mode = CutSnapMode::ZeroCrossing;
+  else if (mode == "energy") params.mode = CutSnapMode::Energy;
+  params.windowSec = std::clamp(numberOr(extract("windowMs"), params.windowSec * 1000.0), 0.1, 50.0) / 1000.0;
+  params.frameSec = std::clamp(numberOr(extract("frameMs"), params.frameSec * 1000.0), 0.1, 20.0) / 1000.0;
+  params.threads = (int) std::clamp(numberOr(extract("threads"), 0.0), 0.0, 64.0);
+  return params;
+}
+
+static const char* cutSnapModeName(CutSnapMode mode) {
+  switch (mode) {
+    case CutSnapMode::ZeroCrossing: return "zeroCrossing";
+    case CutSnapMode::Energy: return "energy";
+    default: return "auto";
+  }
+}
+
+struct RefineCutsJob {
+  std::string sourcePath;
+  SampleReaderFactory factory;
+  std::shared_ptr<const EdlRevision> rev; // the EDL the cuts come from
+  CutRefineParams params;
+  bool apply = false;
+  int revision = 0; // applied as this revision
+};
+
+// Makes clips the EDL as job.revision, unless the EDL is no longer job.rev;
+// false in that case.
+using ApplyRefinedEdl = std::function<bool(std::vector<Clip>, int)>;
+
+// Snaps every segment boundary of the EDL in the original audio and answers
+// with cutsRefined: the segments whose original range moved, by clip id and
+// position in the clip. Boundaries shared by neighbouring segments snap to
+// the same sample, so audio that was contiguous stays contiguous. With apply,
+// the adjusted EDL replaces the current one.
+static void runRefineCuts(const RefineCutsJob& job, const ApplyRefinedEdl& apply, const std::atomic<bool>& cancel) {
+  const auto started = std::chrono::steady_clock::now();
+  auto fail = [&](const std::string& message) {
+    emit("{\"type\":\"cutsRefined\",\"id\":\"" + g.id + "\",\"status\":\"error\",\"message\":\"" + jsonEscape(message) + "\"}");
+    jobs::reportFailure();
+  };
+  const EdlRevision& rev = *job.rev;
+  std::vector<double> points;
+  points.reserve(rev.segments.size() * 2);
+  for (const auto& seg : rev.segments) {
+    if (seg.clipIndex < 0 || !seg.hasOriginal()) continue;
+    points.push_back(seg.originalStart);
+    points.push_back(seg.originalEnd);
+  }
+  if (points.empty()) { fail("No EDL cuts to refine"); return; }
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  const CutRefineResult result = refineCutPoints(job.factory, points, job.params, &cancel);
+  if (cancel.load()) return;
+  if (!result.ok) { fail("Unable to read source audio"); return; }
+  auto refined = [&](double sec) {
+    return result.refinedSec[(size_t) (std::lower_bound(points.begin(), points.end(), sec) - points.begin())];
+  };
+
+  struct Change {
+    size_t segment;
+    double originalStart;
+    double originalEnd;
+  };
+  std::vector<Change> changes;
+  for (size_t i = 0; i < rev.segments.size(); ++i) {
+    const Segment& seg = rev.segments[i];
+    if (seg.clipIndex < 0 || !seg.hasOriginal()) continue;
+    const double start = refined(seg.originalStart), end = refined(seg.originalEnd);
+    if (!(end > start) || (start == seg.originalStart && end == seg.originalEnd)) continue;
+    changes.push_back({ i, start, end });
+  }
+
+  bool applied = false;
+  if (job.apply && !changes.empty()) {
+    std::vector<Clip> clips = rev.clips;
+    for (const Change& change : changes) {
+      const Segment& seg = rev.segments[change.segment];
+      Segment& target = clips[(size_t) seg.clipIndex].segments[(size_t) seg.indexInClip];
+      target.originalStart = change.originalStart;
+      target.originalEnd = change.originalEnd;
+    }
+    // The adjusted clips are rev's. If another EDL was applied while the
+    // search ran, they would overwrite it, so nothing is applied.
+    if (!apply(std::move(clips), job.revision)) {
+      fail("The EDL changed while refining; nothing was applied");
+      return;
+    }
+    applied = true;
+  }
+
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << "{\"type\":\"cutsRefined\",\"id\":\"" << g.id << "\",\"status\":\"ok\",\"mode\":\"" << cutSnapModeName(job.params.mode) << "\""
+      << ",\"windowMs\":" << job.params.windowSec * 1000.0 << ",\"boundaries\":" << points.size()
+      << ",\"moved\":" << result.moved << ",\"meanShiftMs\":" << result.meanShiftSec * 1000.0
+      << ",\"maxShiftMs\":" << result.maxShiftSec * 1000.0 << ",\"applied\":" << (applied ? "true" : "false");
+  if (applied) evt << ",\"revision\":" << job.revision;
+  evt << ",\"threads\":" << result.threads << ",\"elapsedMs\":" << elapsedMs << ",\"segments\":[" << std::setprecision(6);
+  for (size_t i = 0; i < changes.size(); ++i) {
+    const Segment& seg = rev.segments[changes[i].segment];
+    if (i) evt << ",";
+    evt << "{\"clipId\":\"" << jsonEscape(rev.clips[(size_t) seg.clipIndex].id) << "\",\"index\":" << seg.indexInClip
+        << ",\"originalStartSec\":" << changes[i].originalStart << ",\"originalEndSec\":" << changes[i].originalEnd << "}";
+  }
+  evt << "]}";
+  emit(evt.str());
+}
+
+// --- Batch export ---
+// Stems (one file per speaker, on the edited timeline, silent where anyone
+// else speaks) and clip files (one per EDL clip) are made in one pass: the
+// edited timeline is read once, in batches, and each batch is fanned out to
+// all the output files on worker threads while the next one is read.
+struct ExportFile {
+  std::string name; // speaker, or clip id
+  std::string path;
+};
+
+struct ExportJob {
+  bool stems = true;             // false: one file per clip
+  RenderJob render;              // source, pieces in edited order, clips, gains, format; outputPath unused
+  std::vector<ExportFile> files;
+  std::vector<int> fileForClip;  // render.clips index -> files index, -1 when the clip is not exported
+  int threads = 0;
+};
+
+// Index into revisionLoudnessClips(rev) of the clip seg belongs to.
+static int revisionLoudnessClipIndex(const EdlRevision& rev, const Segment& seg) {
+  return rev.clips.empty() ? 0 : seg.clipIndex;
+}
+
+// Per-clip original ranges, in clip order; a single "source" clip when the
+// revision has none.
+static std::vector<LoudnessClip> revisionLoudnessClips(const EdlRevision& rev) {
+  std::vector<LoudnessClip> regions(rev.clips.empty() ? 1 : rev.clips.size());
+  if (rev.clips.empty()) regions[0].id = "source";
+  for (size_t i = 0; i < rev.clips.size(); ++i) {
+    regions[i].id = rev.clips[i].id;
+    regions[i].speaker = rev.clips[i].speaker;
+  }
+  for (const auto& seg : rev.segments) {
+    const int index = revisionLoudnessClipIndex(rev, seg);
+    if (index < 0 || (size_t) index >= regions.size()) continue;
+    const double os = seg.hasOriginal() ? seg.originalStart : seg.start;
+    const double oe = seg.hasOriginal() ? seg.originalEnd : seg.end;
+    regions[(size_t) index].originalRanges.emplace_back(os, oe);
+  }
+  return regions;
+}
+
+// The edited timeline as original-sample pieces, as renderEdited plays it.
+// Neighbours that continue in the file within the same clip are merged.
+static std::vector<RenderPiece> revisionRenderPieces(const EdlRevision& rev, double sampleRate) {
+  std::vector<RenderPiece> pieces;
+  for (const auto& seg : rev.segments) {
+    const double os = seg.hasOriginal() ? seg.originalStart : seg.start;
+    const double oe = seg.hasOriginal() ? seg.originalEnd : seg.end;
+    RenderPiece piece;
+    piece.start = (int64_t) std::llround(os * sampleRate);
+    piece.end = (int64_t) std::llround(oe * sampleRate);
+    piece.clipIndex = revisionLoudnessClipIndex(rev, seg);
+    if (piece.end <= piece.start) continue;
+    if (!pieces.empty() && pieces.back().end == piece.start && pieces.back().clipIndex == piece.clipIndex) {
+      pieces.back().end = piece.end;
+    } else {
+      pieces.push_back(piece);
+    }
+  }
+  return pieces;
+}
+
+// Spacer segments of the revision in both timelines, for silence refinement.
+static std::vector<SpacerSpan> revisionSpacers(const EdlRevision& rev) {
+  std::vector<SpacerSpan> spacers;
+  for (size_t i = 0; i < rev.segments.size(); ++i) {
+    const auto& seg = rev.segments[i];
+    if (seg.type != "spacer") continue;
+    SpacerSpan span;
+    span.index = i;
+    span.startSec = seg.start;
+    span.endSec = seg.end;
+    span.originalStartSec = seg.hasOriginal() ? seg.originalStart : seg.start;
+    span.originalEndSec = seg.hasOriginal() ? seg.originalEnd : seg.end;
+    spacers.push_back(span);
+  }
+  return spacers;
+}
+
+// Speaker name or clip id made safe for a file name.
+static std::string exportFileStem(const std::string& name, const char* fallback) {
+  std::string stem;
+  for (const char c : name) {
+    const bool safe = std::isalnum((unsigned char) c) || c == '-' || c == '_' || c == '.';
+    stem += safe ? c : '_';
+  }
+  if (stem.empty() || stem.find_first_not_of('.') == std::string::npos) stem = fallback;
+  return stem;
+}
+
+// Output files for rev: <directory>/<speaker>.wav per speaker with audio on
+// the edited timeline, or <directory>/<NNN>_<clip id>.wav per clip, NNN
+// being the clip's position in the EDL. Clashing names get a -2, -3 suffix.
+static ExportJob exportJobFor(const EdlRevision& rev, double sampleRate, bool stems, const std::string& directory) {
+  ExportJob job;
+  job.stems = stems;
+  job.render.clips = revisionLoudnessClips(rev);
+  job.render.pieces = revisionRenderPieces(rev, sampleRate);
+  job.fileForClip.assign(job.render.clips.size(), -1);
+  std::vector<bool> heard(job.render.clips.size(), false);
+  for (const auto& piece : job.render.pieces) {
+    if (piece.clipIndex >= 0 && (size_t) piece.clipIndex < heard.size()) heard[(size_t) piece.clipIndex] = true;
+  }
+  std::map<std::string, int> speakerFiles;
+  std::map<std::string, int> stemUses;
+  auto addFile = [&](const std::string& name, std::string stem) {
+    const int uses = ++stemUses[stem];
+    if (uses > 1) stem += "-" + std::to_string(uses);
+    job.files.push_back({ name, directory + "/" + stem + ".wav" });
+    return (int) job.files.size() - 1;
+  };
+  for (size_t i = 0; i < job.render.clips.size(); ++i) {
+    if (!heard[i]) continue;
+    const LoudnessClip& clip = job.render.clips[i];
+    if (stems) {
+      auto found = speakerFiles.find(clip.speaker);
+      if (found == speakerFiles.end()) {
+        found = speakerFiles.emplace(clip.speaker, addFile(clip.speaker, exportFileStem(clip.speaker, "unassigned"))).first;
+      }
+      job.fileForClip[i] = found->second;
+    } else {
+      char number[24]; // any size_t, the underscore and the terminator
+      std::snprintf(number, sizeof(number), "%03zu_", i + 1);
+      job.fileForClip[i] = addFile(clip.id, number + exportFileStem(clip.id, "clip"));
+    }
+  }
+  return job;
+}
+
+static void runExport(const ExportJob& job, const SampleReaderFactory& factory, const std::atomic<bool>& cancel) {
+  const std::string kind = job.stems ? "stems" : "clips";
+  const std::string head = "{\"type\":\"export";
+  const std::string tail = "\",\"id\":\"" + g.id + "\",\"kind\":\"" + kind + "\"";
+  auto fail = [&](const std::string& message) {
+    emit(head + "Complete" + tail + ",\"status\":\"error\",\"message\":\"" + jsonEscape(message) + "\"}");
+    jobs::reportFailure();
+  };
+  const auto started = std::chrono::steady_clock::now();
+  std::unique_ptr<SampleReader> reader = factory();
+  if (!reader) { fail("Unable to read source audio"); return; }
+  if (job.files.empty()) { fail("Nothing to export"); return; }
+  const int channels = reader->numChannels();
+  const double sampleRate = reader->sampleRate();
+  std::vector<float> clipGains;
+  if (!renderClipGains(job.render, factory, cancel, clipGains)) {
+    if (!cancel.load()) fail("Unable to analyse loudness");
+    return;
+  }
+  const std::vector<RenderPiece>& pieces = job.render.pieces;
+  auto fileFor = [&](const RenderPiece& piece) {
+    return piece.clipIndex >= 0 && (size_t) piece.clipIndex < job.fileForClip.size() ? job.fileForClip[(size_t) piece.clipIndex] : -1;
+  };
+
+  // Per-file state. A file is handled by one worker at a time, so none of
+  // this is shared. Writers are opened on first use and closed after the
+  // file's last piece, so a clip export keeps few files open at once.
+  struct Output {
+    std::unique_ptr<WavFileWriter> writer;
+    ClipChain chain;
+    dsp::GainRamp ramp;
+    size_t currentPiece = SIZE_MAX;
+    size_t lastPiece = 0;
+    bool closed = false;
+    std::string error;
+  };
+  std::vector<std::unique_ptr<Output>> outputs(job.files.size());
+  for (auto& out : outputs) {
+    out = std::make_unique<Output>();
+    out->chain.prepare(sampleRate, channels);
+  }
+  int64_t totalFrames = 0;
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    totalFrames += pieces[i].end - pieces[i].start;
+    const int file = fileFor(pieces[i]);
+    if (job.stems) {
+      for (auto& out : outputs) out->lastPiece = i;
+    } else if (file >= 0) {
+      outputs[(size_t) file]->lastPiece = i;
+    }
+  }
+
+  constexpr int kBatch = 1 << 16; // frames read per batch
+  constexpr int kWrite = 8192;    // frames per write, bounds each writer's buffer
+  const int rampSamples = std::max(1, (int) std::lround(0.01 * sampleRate));
+  struct Run {
+    int offset = 0;
+    int n = 0;
+    size_t piece = 0;
+  };
+  struct Batch {
+    std::vector<float> storage;
+    std::vector<Run> runs;
+    int frames = 0;
+    size_t piecesDone = 0; // pieces fully read once this batch is written
+  };
+  Batch batches[2];
+  for (auto& batch : batches) batch.storage.resize((size_t) channels * kBatch);
+  auto plane = [&](Batch& batch, int ch) { return batch.storage.data() + (size_t) ch * kBatch; };
+
+  size_t nextPiece = 0;
+  int64_t piecePos = pieces.empty() ? 0 : pieces[0].start;
+  std::vector<float*> readPtrs((size_t) channels);
+  auto fill = [&](Batch& batch) {
+    batch.runs.clear();
+    batch.frames = 0;
+    while (batch.frames < kBatch && nextPiece < pieces.size()) {
+      const int n = (int) std::min<int64_t>(kBatch - batch.frames, pieces[nextPiece].end - piecePos);
+      for (int ch = 0; ch < channels; ++ch) readPtrs[(size_t) ch] = plane(batch, ch) + batch.frames;
+      if (!reader->read(readPtrs.data(), channels, piecePos, n)) return false;
+      batch.runs.push_back({ batch.frames, n, nextPiece });
+      batch.frames += n;
+      piecePos += n;
+      if (piecePos >= pieces[nextPiece].end && ++nextPiece < pieces.size()) piecePos = pieces[nextPiece].start;
+    }
+    batch.piecesDone = nextPiece;
+    return true;
+  };
+
+  // Writes batch's share of file index: its clips' audio through their
+  // strips and gains, and for stems silence for everyone else's.
+  auto deliver = [&](Batch& batch, size_t index, std::vector<float>& scratch) {
+    Output& out = *outputs[index];
+    if (out.closed || !out.error.empty()) return;
+    std::vector<float*> planes((size_t) channels);
+    for (int ch = 0; ch < channels; ++ch) planes[(size_t) ch] = scratch.data() + (size_t) ch * kWrite;
+    for (const Run& run : batch.runs) {
+      const RenderPiece& piece = pieces[run.piece];
+      const bool mine = fileFor(piece) == (int) index;
+      if (!mine && !job.stems) continue;
+      if (!out.writer) {
+        out.writer = std::make_unique<WavFileWriter>(job.files[index].path, sampleRate, channels, job.render.bitsPerSample);
+        if (!out.writer->isOpen()) { out.error = "Unable to create " + job.files[index].path; return; }
+      }
+      if (mine && run.piece != out.currentPiece) {
+        const float gain = (size_t) piece.clipIndex < clipGains.size() ? clipGains[(size_t) piece.clipIndex] : 1.0f;
+        if (out.currentPiece == SIZE_MAX) out.ramp.reset(gain); else out.ramp.setTarget(gain, rampSamples);
+        out.currentPiece = run.piece;
+      }
+      for (int done = 0; done < run.n; done += kWrite) {
+        const int n = std::min(kWrite, run.n - done);
+        for (int ch = 0; ch < channels; ++ch) {
+          if (mine) std::copy_n(plane(batch, ch) + run.offset + done, n, planes[(size_t) ch]);
+          else std::fill_n(planes[(size_t) ch], n, 0.0f);
+        }
+        if (mine) {
+          if (job.render.strips) {
+            out.chain.process(planes.data(), channels, 0, n, job.render.strips->forClip(piece.clipIndex), job.render.strips->anySolo);
+          }
+          out.ramp.process(planes.data(), channels, 0, n);
+        }
+        if (!out.writer->write(planes.data(), n)) { out.error = "Write error on " + job.files[index].path; return; }
+      }
+    }
+  };
+
+  const int threads = std::max(1, std::min(analysisThreadCount(job.threads), (int) outputs.size()));
+  if (!fill(batches[0])) { fail("Read error while exporting"); return; }
+  int64_t framesDone = 0;
+  int reportedPercent = 0;
+  size_t filesDone = 0;
+  for (int current = 0; batches[current].frames > 0; current ^= 1) {
+    if (cancel.load()) return;
+    jobs::ParallelLoop writes(outputs.size(), [&](size_t index) {
+      thread_local std::vector<float> scratch;
+      scratch.resize((size_t) channels * kWrite);
+      deliver(batches[current], index, scratch);
+      return true;
+    }, threads + 1);
+    const bool readOk = fill(batches[current ^ 1]); // overlaps the writes
+    writes.wait();
+    if (!readOk) { fail("Read error while exporting"); return; }
+    for (const auto& out : outputs) {
+      if (!out->error.empty()) { fail(out->error); return; }
+    }
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      Output& out = *outputs[i];
+      if (out.closed || out.lastPiece >= batches[current].piecesDone) continue;
+      const uint64_t frames = out.writer ? out.writer->framesWritten() : 0;
+      if (!out.writer || !out.writer->close()) { fail("Unable to finalise " + job.files[i].path); return; }
+      out.closed = true;
+      ++filesDone;
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << head << "FileComplete" << tail << ",\"name\":\"" << jsonEscape(job.files[i].name) << "\""
+          << ",\"path\":\"" << jsonEscape(job.files[i].path) << "\",\"durationSec\":" << (double) frames / sampleRate << "}";
+      emit(evt.str());
+    }
+    framesDone += batches[current].frames;
+    if (totalFrames > 0) jobs::reportProgress((double) framesDone / (double) totalFrames);
+    const int percent = totalFrames > 0 ? (int) (100 * framesDone / totalFrames) : 100;
+    if (percent > reportedPercent && framesDone < totalFrames) {
+      reportedPercent = percent;
+      std::ostringstream evt;
+      evt.setf(std::ios::fixed);
+      evt << std::setprecision(3);
+      evt << head << "Progress" << tail << ",\"fraction\":" << (double) framesDone / (double) totalFrames
+          << ",\"filesDone\":" << filesDone << ",\"files\":" << outputs.size() << "}";
+      emit(evt.str());
+    }
+  }
+
+  const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(3);
+  evt << head << "Complete" << tail << ",\"status\":\"ok\",\"files\":" << filesDone
+      << ",\"normalized\":" << (job.render.normalize ? "true" : "false")
+      << ",\"durationSec\":" << (double) totalFrames / sampleRate
+      << ",\"threads\":" << threads << ",\"elapsedMs\":" << elapsedMs << "}";
+  emit(evt.str());
+}
+
+// --- EDL commands ---
+// Shared by both command routers. Engine is the JUCE Backend or the mock:
+// applyCachedEdl(key, revision) re-activates a cached compile and returns
+// false on a miss, updateEdl(clips, revision, key) applies a parsed payload.
+// The payload arrives by path or, on POSIX, as an inherited descriptor
+// (fdString) that is closed once read. Either way it is mapped and parsed in
+// place where possible; gMetrics.edlCopiedBytes records what was copied.
+template <typename Engine>
+static void applyEdlFromFile(Engine& engine, const std::string& pathValue, const std::string& fdString,
+                             const std::string& revisionString, const std::string& generationString) {
+  int requestedRevision = 0;
+  try {
+    if (!revisionString.empty()) {
+      requestedRevision = std::stoi(revisionString);
+    }
+  } catch (...) {}
+
+  juceDLog(std::string("[JUCE] updateEdlFromFile command received: path=") + pathValue + ", fd=" + fdString +
+            ", requestedRevision=" + std::to_string(requestedRevision) +
+            ", generation=" + generationString);
+  {
+    std::ofstream debugFile(juceDebugPath(), std::ios::app);
+    debugFile << "[JUCE] updateEdlFromFile received" << std::endl;
+    debugFile << "        path=" << pathValue << std::endl;
+    debugFile << "        requestedRevision=" << requestedRevision << std::endl;
+    if (!generationString.empty()) {
+      debugFile << "        generation=" << generationString << std::endl;
+    }
+    debugFile.flush();
+  }
+
+  auto cleanupTempFile = [&]() {
+    if (!pathValue.empty()) {
+      std::remove(pathValue.c_str());
+    }
+  };
+
+  auto emitFailure = [&](const std::string& message, int revisionHint, const std::string& diagnostic = std::string()) {
+    const std::string combined = diagnostic.empty() ? message : (message + " | " + diagnostic);
+    juceDLog("[JUCE] updateEdlFromFile failure: " + combined);
     try {
-      return std::stod(token);
-    } catch (...) {
-      return std::numeric_limits<double>::quiet_NaN();
+      std::ofstream debugFile(juceDebugPath(), std::ios::app);
+      debugFile << "[JUCE] updateEdlFromFile failure" << std::endl;
+      debugFile << "        message=" << message << std::endl;
+      if (!diagnostic.empty()) {
+        debugFile << "        diagnostic=" << diagnostic << std::endl;
+      }
+      debugFile.flush();
+    } catch (...) {}
+    emitEdlAppliedEvent(revisionHint, 0, 0, 0, "", "error", combined);
+    cleanupTempFile();
+  };
+
+  if (pathValue.empty() && fdString.empty()) {
+    emitFailure("Missing EDL file path", requestedRevision);
+    return;
+  }
+
+  MappedFile mapped;
+  std::string openError;
+  bool opened = false;
+  if (!pathValue.empty()) {
+    opened = mapped.open(pathValue, openError);
+  } else {
+#if defined(_WIN32)
+    openError = "descriptor handoff is not supported on this platform";
+#else
+    const int fd = (int) numberOr(fdString, -1.0);
+    if (fd >= 0) opened = mapped.adopt(fd, openError);
+    else openError = "invalid descriptor";
+#endif
+  }
+  if (!opened) {
+    emitFailure("Unable to read EDL file", requestedRevision, openError);
+    return;
+  }
+  const std::string_view payload = mapped.view();
+  gMetrics.edlCopiedBytes.store(mapped.copiedBytes(), std::memory_order_relaxed);
+
+  {
+    std::ofstream debugFile(juceDebugPath(), std::ios::app);
+    debugFile << "[JUCE] updateEdlFromFile reading payload" << std::endl;
+    debugFile << "        bytes=" << payload.size() << std::endl;
+    debugFile << "        mapped=" << (mapped.mapped() ? "yes" : "no") << ", copied=" << mapped.copiedBytes() << std::endl;
+    debugFile.flush();
+  }
+
+  const EdlContentKey key = edlContentKey(payload);
+  const int payloadRevision = edlPayloadRevision(payload);
+  if (engine.applyCachedEdl(key, payloadRevision > 0 ? payloadRevision : requestedRevision)) {
+    juceDLog("[JUCE] updateEdlFromFile re-activated cached compile for revision " + std::to_string(requestedRevision));
+    cleanupTempFile();
+    return;
+  }
+
+  std::vector<Clip> clips;
+  int parsedRevision = 0;
+  bool parsedOk = false;
+  try {
+    parsedOk = parseClipsFromJsonPayload(payload, clips, &parsedRevision);
+  } catch (const std::exception& ex) {
+    emitFailure("Exception parsing EDL payload", requestedRevision, ex.what());
+    return;
+  } catch (...) {
+    emitFailure("Unknown exception parsing EDL payload", requestedRevision);
+    return;
+  }
+
+  if (!parsedOk) {
+    emitFailure("Invalid EDL file contents", requestedRevision, std::string("bytes=") + std::to_string(payload.size()));
+    return;
+  }
+
+  if (parsedRevision > 0 && parsedRevision != requestedRevision) {
+    juceDLog("[JUCE] updateEdlFromFile revision mismatch: command=" + std::to_string(requestedRevision) +
+             ", parsed=" + std::to_string(parsedRevision));
+  }
+
+  const int revision = parsedRevision > 0 ? parsedRevision : requestedRevision;
+
+  juceDLog("[JUCE] updateEdlFromFile parsed " + std::to_string(clips.size()) +
+           " clips for revision " + std::to_string(revision));
+  {
+    std::ofstream debugFile(juceDebugPath(), std::ios::app);
+    debugFile << "[JUCE] updateEdlFromFile parsed payload" << std::endl;
+    debugFile << "        revision=" << revision << std::endl;
+    debugFile << "        clipCount=" << clips.size() << std::endl;
+    debugFile.flush();
+  }
+
+  try {
+    engine.updateEdl(std::move(clips), revision, key);
+    juceDLog("[JUCE] updateEdlFromFile completed successfully for revision " + std::to_string(revision));
+  } catch (const std::exception& ex) {
+    emitFailure("Exception applying EDL", revision, ex.what());
+    return;
+  } catch (...) {
+    emitFailure("Unknown exception applying EDL", revision);
+    return;
+  }
+
+  cleanupTempFile();
+}
+
+template <typename Engine>
+static void applyEdlInline(Engine& engine, const std::string& line) {
+  gMetrics.edlCopiedBytes.store(0, std::memory_order_relaxed);
+  const EdlContentKey key = edlContentKey(line);
+  if (engine.applyCachedEdl(key, edlPayloadRevision(line))) return;
+  std::vector<Clip> clips;
+  int revision = 0;
+  if (!parseClipsFromJsonPayload(line, clips, &revision)) {
+    const std::string message = "Invalid EDL payload";
+    juceDLog("[JUCE] updateEdl inline parse failure: " + message);
+    emitEdlAppliedEvent(revision, 0, 0, 0, "", "error", message);
+    return;
+  }
+
+  juceDLog("[JUCE] updateEdl inline parsed " + std::to_string(clips.size()) +
+           " clips for revision " + std::to_string(revision));
+  engine.updateEdl(std::move(clips), revision, key);
+}
+
+// --- Meters ---
+// One publish interval of output levels, as the meter event reports them.
+struct MeterFrame {
+  static constexpr int kMaxChannels = 8;
+  int channels = 0;
+  float peak[kMaxChannels] = {};
+  float rms[kMaxChannels] = {};
+  float truePeak[kMaxChannels] = {};
+  uint32_t clipped[kMaxChannels] = {};
+  float costAvgPct = 0.0f; // metering time / block duration, averaged over the frame
+  float costMaxPct = 0.0f;
+};
+
+static void emitMeterFrame(const MeterFrame& frame) {
+  std::ostringstream evt;
+  evt.setf(std::ios::fixed);
+  evt << std::setprecision(2);
+  auto writeArray = [&](const char* key, auto valueAt) {
+    evt << ",\"" << key << "\":[";
+    for (int ch = 0; ch < frame.channels; ++ch) {
+      if (ch) evt << ",";
+      evt << valueAt(ch);
+    }
+    evt << "]";
+  };
+  evt << "{\"type\":\"meter\",\"id\":\"" << g.id << "\",\"channels\":" << frame.channels;
+  writeArray("peakDb", [&](int ch) { return dsp::gainToDb(frame.peak[ch]); });
+  writeArray("rmsDb", [&](int ch) { return dsp::gainToDb(frame.rms[ch]); });
+  writeArray("truePeakDb", [&](int ch) { return dsp::gainToDb(frame.truePeak[ch]); });
+  writeArray("clipped", [&](int ch) { return frame.clipped[ch]; });
+  evt << ",\"costPct\":" << frame.costAvgPct << ",\"costMaxPct\":" << frame.costMaxPct << "}";
+  gEvents.pushCoalesced(CoalesceKey::Meter, evt.str());
+}
+
+// --- Mock engine ---
+// Stands in for the JUCE engine in builds without USE_JUCE. EDLs go through
+// the same buildRevision / TextIndex / range code as the real engine and the
+// command handlers emit the same events in the same order; only the audio is
+// missing. Playback follows a virtual clock: by default it keeps wall time,
+// but it can run faster (setClock rate, JUCE_MOCK_CLOCK_RATE) or stop and be
+// stepped explicitly (setClock manual, advanceClock), so test suites and
+// replays do not wait on real time.
+class MockEngine {
+public:
+  static constexpr double kTickSec = 0.033; // the JUCE position timer period
+
+  bool load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+      emit("{\"type\":\"error\",\"message\":\"Audio file not found\"}");
+      return false;
+    }
+    // Only WAV can be probed here; anything else plays as a minute of silence.
+    double sampleRate = 48000.0;
+    int channels = 2;
+    double duration = 60.0;
+    if (auto reader = makeWavReaderFactory(path)()) {
+      sampleRate = reader->sampleRate();
+      channels = reader->numChannels();
+      duration = (double) reader->lengthInSamples() / sampleRate;
+    }
+    loaded = true;
+    loadedPath = path;
+    meterReader = makeWavReaderFactory(path)();
+    resetMeter();
+    loudnessAnalysis.reset();
+    g.durationSec = sanitizeTime(duration);
+    playbackRate = 1.0;
+    range = PlayRange();
+    scrubbing = false;
+    revisionCache.clear();
+    edlState = fullFileRevision(g.durationSec);
+    g.editedSec = 0.0;
+    g.playing = false;
+    emitLoaded(sampleRate, channels);
+    emitState();
+    gFingerprints.prefetch(path);
+    return true;
+  }
+
+  void play() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    g.playing = true;
+    emitState();
+  }
+
+  void pause() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    g.playing = false;
+    emitState();
+  }
+
+  void stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    g.editedSec = 0.0;
+    g.playing = false;
+    emitState();
+    emitPositionFor(*edlState);
+  }
+
+  void seek(double editedSec) {
+    if (scrubbing) {
+      scrubTo(editedSec);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    seekLocked(editedSec);
+    emitPositionFor(*edlState);
+  }
+
+  void queryState() {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitState();
+    emitPositionFor(*edlState);
+  }
+
+  void playRange(double startSec, double endSec, bool loop, double crossfadeSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    PlayRange next;
+    if (!makePlayRange(revisionDuration(*edlState), startSec, endSec, loop, crossfadeSec, true, next)) return;
+    range = next;
+    g.editedSec = range.startSec;
+    g.playing = true;
+    emitState();
+  }
+
+  void setLoop(bool enabled, double startSec, double endSec, double crossfadeSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled) {
+      range = PlayRange();
+      return;
+    }
+    PlayRange next;
+    if (makePlayRange(revisionDuration(*edlState), startSec, endSec, true, crossfadeSec, false, next)) range = next;
+  }
+
+  void scrubStart() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requireLoaded()) return;
+    if (scrubbing) return;
+    scrubbing = true;
+    scrubTargets = 0;
+    resumeAfterScrub = g.playing.load();
+    g.playing = false;
+    emitState();
+  }
+
+  void scrubTo(double editedSec) {
+    if (!scrubbing) return;
+    g.editedSec = sanitizeTime(editedSec);
+    ++scrubTargets;
+  }
+
+  // No grains are rendered, so every target counts as consumed and latency
+  // is zero.
+  void scrubEnd(double editedSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!scrubbing) return;
+    scrubbing = false;
+    g.editedSec = sanitizeTime(std::isfinite(editedSec) ? editedSec : g.editedSec.load());
+    if (resumeAfterScrub) g.playing = true;
+    resumeAfterScrub = false;
+    emit("{\"type\":\"scrubStats\",\"id\":\"" + g.id + "\",\"targets\":" + std::to_string(scrubTargets.load()) +
+         ",\"consumed\":" + std::to_string(scrubTargets.load()) +
+         ",\"dropped\":0,\"grains\":0,\"gaps\":0,\"latencyAvgMs\":0.00,\"latencyMaxMs\":0.00,\"outputLatencyMs\":0.00}");
+    emitState();
+    emitPositionFor(*edlState);
+  }
+
+  void setRate(double rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    double safeRate = std::isfinite(rate) ? rate : 1.0;
+    if (safeRate <= 0.0) safeRate = 1.0;
+    playbackRate = std::clamp(safeRate, 0.25, 4.0);
+  }
+
+  void setVolume(double gain) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const double safeGain = std::isfinite(gain) ? gain : 1.0;
+    volume = std::clamp(safeGain, 0.0, 2.0);
+  }
+
+  void setMeterRate(double hz) {
+    std::lock_guard<std::mutex> lock(mutex);
+    meterRateHz = std::clamp(std::isfinite(hz) ? hz : 0.0, 0.0, 60.0);
+    resetMeter();
+  }
+
+  // As the JUCE engine: spacers of the current EDL refined against the scan
+  // when asked for.
+  void analyzeSilence(const SilenceParams& params, bool refineSpacers, double maxShiftSec) {
+    std::vector<SpacerSpan> spacers;
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      path = loadedPath;
+      if (refineSpacers) spacers = revisionSpacers(*edlState);
+    }
+    const SampleReaderFactory factory = makeWavReaderFactory(path);
+    gAnalysis.start("silence", [path, factory, params, spacers = std::move(spacers), maxShiftSec](const std::atomic<bool>& cancel) {
+      runSilenceAnalysis(path, factory, params, spacers, maxShiftSec, cancel);
+    });
+  }
+
+  // Whole file plus each EDL clip and speaker.
+  void analyzeLoudness(const LoudnessOptions& options) {
+    std::string path;
+    std::vector<LoudnessClip> regions;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      path = loadedPath;
+      regions = revisionLoudnessClips(*edlState);
+    }
+    startLoudnessAnalysis(path, options, std::move(regions));
+  }
+
+  // The clip gains only show in meter events here; with no analysis yet one
+  // is run, as the JUCE engine does.
+  void setLoudnessNormalization(bool enabled, double targetLufs, double ceilingDbtp) {
+    std::string path;
+    std::vector<LoudnessClip> regions;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      normalizeEnabled = enabled;
+      normalizeTargetLufs = targetLufs;
+      normalizeCeilingDbtp = ceilingDbtp;
+      refreshClipGains();
+      if (!enabled || loudnessAnalysis || !loaded) return;
+      path = loadedPath;
+      regions = revisionLoudnessClips(*edlState);
+    }
+    LoudnessOptions options;
+    options.targetLufs = targetLufs;
+    options.ceilingDbtp = ceilingDbtp;
+    startLoudnessAnalysis(path, options, std::move(regions));
+  }
+
+  // The edited timeline with per-clip strips and gains, as the JUCE engine
+  // renders it; WAV sources only.
+  void renderEdited(const std::string& outputPath, bool normalize, const LoudnessOptions& options, int bitsPerSample) {
+    RenderJob job;
+    {
+      std::lock_guard<std::mutex> lock(gMutex);
+      job.sourcePath = g.denoiseEnabled && !g.denoisedPath.empty() ? g.denoisedPath : g.path;
+    }
+    const SampleReaderFactory factory = makeWavReaderFactory(job.sourcePath);
+    const auto probe = factory();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      job.clips = revisionLoudnessClips(*edlState);
+      job.pieces = revisionRenderPieces(*edlState, probe ? probe->sampleRate() : 48000.0);
+    }
+    if (!g.strips.empty()) job.strips = g.strips.bankFor(job.clips);
+    job.outputPath = outputPath;
+    job.normalize = normalize;
+    job.targetLufs = options.targetLufs;
+    job.ceilingDbtp = options.ceilingDbtp;
+    job.bitsPerSample = bitsPerSample;
+    gAnalysis.start("render", [job = std::move(job), factory](const std::atomic<bool>& cancel) {
+      runRender(job, factory, cancel);
+    });
+  }
+
+  void updateEdl(std::vector<Clip> newClips, int revision, const EdlContentKey& key = {}) {
+    auto next = buildRevision(std::move(newClips), revision);
+    std::lock_guard<std::mutex> lock(mutex);
+    revisionCache.insert(revision, key, next, next->byteSize);
+    swapRevision(next);
+    emitRevisionApplied(*next, revision, false);
+  }
+
+  // updateEdl, unless the EDL is no longer base (an edit arrived meanwhile).
+  bool updateEdlFrom(const std::shared_ptr<const EdlRevision>& base, std::vector<Clip> newClips, int revision) {
+    auto next = buildRevision(std::move(newClips), revision);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (edlState != base) return false;
+    swapRevision(next);
+    emitRevisionApplied(*next, revision, false);
+    return true;
+  }
+
+  bool applyCachedEdl(const EdlContentKey& key, int revision) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!key.valid()) return false;
+    auto rev = revisionCache.findContent(key);
+    if (!rev) return false;
+    revisionCache.addRevision(revision, key);
+    swapRevision(std::move(rev));
+    emitRevisionApplied(*edlState, revision, true);
+    return true;
+  }
+
+  void activateCachedRevision(int revision) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto rev = revisionCache.findRevision(revision);
+    if (!rev) {
+      emitEdlAppliedEvent(revision, 0, 0, 0, "", "error", "Revision not cached");
+      return;
+    }
+    swapRevision(std::move(rev));
+    emitRevisionApplied(*edlState, revision, true);
+  }
+
+  void getRevisionCacheStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitRevisionCacheStats(revisionCache.stats());
+  }
+
+  void setRevisionCacheLimit(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    revisionCache.setMaxBytes(maxBytes);
+    gMetrics.revisionCacheBytes.store(revisionCache.stats().bytes, std::memory_order_relaxed);
+    emitRevisionCacheStats(revisionCache.stats());
+  }
+
+  void findText(const std::string& query, bool prefix, double fromSec, double toSec, size_t maxResults) {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitFindTextResult(*edlState, query, prefix, fromSec, toSec, maxResults);
+  }
+
+  void getWordsInRange(double startSec, double endSec, size_t maxResults) {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitWordsInRange(*edlState, startSec, endSec, maxResults);
+  }
+
+  void seekToWord(int segmentIndex, const std::string& text, size_t occurrence, double fromSec) {
+    double target = -1.0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      target = wordStartSec(*edlState, segmentIndex, text, occurrence, fromSec);
+    }
+    if (target < 0.0) {
+      emit("{\"type\":\"error\",\"message\":\"Word not found\"}");
+      return;
+    }
+    seek(target);
+  }
+
+  // Spectrogram tiles for an edited range, mapped through the current EDL.
+  void getSpectrogramTiles(double startSec, double endSec, int level, int maxColumns) {
+    std::vector<TimelineSpan> spans;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      spans = editedRangeSpans(*edlState, startSec, endSec);
+    }
+    const std::string path = g.path;
+    gAnalysis.start("spectrogram", [=](const std::atomic<bool>& cancel) {
+      runSpectrogramTiles(path, makeWavReaderFactory(path), spans, startSec, endSec, level, maxColumns, cancel);
+    });
+  }
+
+  void computeSpectrogram(int minLevel) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+    }
+    const std::string path = g.path;
+    gAnalysis.start("spectrogramFill", [path, minLevel](const std::atomic<bool>& cancel) {
+      runSpectrogramFill(path, makeWavReaderFactory(path), minLevel, cancel);
+    });
+  }
+
+  // Same files as the JUCE engine; WAV sources only.
+  void exportAudio(bool stems, const std::string& directory, bool normalize, const LoudnessOptions& options, int bitsPerSample) {
+    if (directory.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"Export directory required\"}");
+      return;
+    }
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(gMutex);
+      path = g.denoiseEnabled && !g.denoisedPath.empty() ? g.denoisedPath : g.path;
+    }
+    const SampleReaderFactory factory = makeWavReaderFactory(path);
+    const auto probe = factory();
+    ExportJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      job = exportJobFor(*edlState, probe ? probe->sampleRate() : 48000.0, stems, directory);
+    }
+    job.render.sourcePath = path;
+    if (!g.strips.empty()) job.render.strips = g.strips.bankFor(job.render.clips);
+    job.render.normalize = normalize;
+    job.render.targetLufs = options.targetLufs;
+    job.render.ceilingDbtp = options.ceilingDbtp;
+    job.render.bitsPerSample = bitsPerSample;
+    job.threads = options.threads;
+    gAnalysis.start(stems ? "exportStems" : "exportClips", [job = std::move(job), factory](const std::atomic<bool>& cancel) {
+      runExport(job, factory, cancel);
+    });
+  }
+
+  // Artifacts of the original file (not a denoised copy) and the current
+  // timeline, into the project sidecar at path.
+  void saveSidecar(const std::string& path, const SilenceParams& silence) {
+    if (path.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"Sidecar path required\"}");
+      return;
+    }
+    SidecarJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      job.timeline = edlState->timeline;
+    }
+    {
+      std::lock_guard<std::mutex> lock(gMutex);
+      job.sourcePath = g.path;
+    }
+    job.path = path;
+    job.factory = makeWavReaderFactory(job.sourcePath);
+    job.silence = silence;
+    gAnalysis.start("sidecar", [job = std::move(job)](const std::atomic<bool>& cancel) { runSaveSidecar(job, cancel); });
+  }
+
+  // Snaps the current EDL's cut points; with apply, the result becomes
+  // revision.
+  void refineCuts(const CutRefineParams& params, bool apply, int revision) {
+    RefineCutsJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!requireLoaded()) return;
+      job.rev = edlState;
+    }
+    {
+      std::lock_guard<std::mutex> lock(gMutex);
+      job.sourcePath = g.path;
+    }
+    job.factory = makeWavReaderFactory(job.sourcePath);
+    job.params = params;
+    job.apply = apply;
+    job.revision = revision;
+    gAnalysis.start("refineCuts", [this, job = std::move(job)](const std::atomic<bool>& cancel) {
+      runRefineCuts(job, [this, base = job.rev](std::vector<Clip> clips, int revision) {
+        return updateEdlFrom(base, std::move(clips), revision);
+      }, cancel);
+    });
+  }
+
+  void openSidecar(const std::string& path) {
+    bool hasSource = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      hasSource = loaded;
+    }
+    std::string source;
+    if (hasSource) {
+      std::lock_guard<std::mutex> lock(gMutex);
+      source = g.path;
+    }
+    openProjectSidecar(path, source);
+  }
+
+  // --- Virtual clock ---
+  void setClock(double rate, bool manual) {
+    clockRate = std::clamp(std::isfinite(rate) && rate > 0.0 ? rate : 1.0, 0.01, 1000.0);
+    clockManual = manual;
+  }
+
+  void emitClock() {
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(3);
+    evt << "{\"type\":\"clockState\",\"id\":\"" << g.id << "\",\"rate\":" << clockRate.load()
+        << ",\"manual\":" << (clockManual ? "true" : "false") << ",\"clockSec\":" << clockSec.load() << "}";
+    emit(evt.str());
+  }
+
+  double tickSeconds() const { return kTickSec * clockRate.load(); }
+  bool isClockManual() const { return clockManual.load(); }
+
+  // Steps the clock in timer-sized ticks, emitting what the timer would have.
+  // Remainders shorter than a tick carry over to the next call.
+  void advanceClock(double seconds) {
+    const double step = std::clamp(std::isfinite(seconds) ? seconds : 0.0, 0.0, 24.0 * 60.0 * 60.0);
+    clockTargetSec = std::max(clockTargetSec, clockSec.load()) + step;
+    advanceClockTo(clockTargetSec);
+  }
+
+  void advanceClockTo(double targetSec) {
+    while (clockSec.load() + kTickSec <= targetSec + 1e-9) tick(kTickSec);
+  }
+
+  // One timer tick of dtSec virtual seconds: range ends, loop wraps, the end
+  // of the timeline and position reports, as hiResTimerCallback reports them.
+  void tick(double dtSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    clockSec.store(clockSec.load() + dtSec);
+    if (!g.playing) return;
+    double next = g.editedSec.load() + dtSec * playbackRate;
+    if (range.active && next >= range.endSec) {
+      if (range.loop) {
+        const double length = range.endSec - range.startSec;
+        g.editedSec = range.startSec + std::fmod(next - range.startSec, length);
+      } else {
+        g.editedSec = range.endSec;
+        g.playing = false;
+        std::ostringstream evt;
+        evt << "{\"type\":\"rangeEnded\",\"id\":\"" << g.id << "\",\"startSec\":" << range.startSec
+            << ",\"endSec\":" << range.endSec << "}";
+        emit(evt.str());
+        range = PlayRange();
+        emitState();
+      }
+      emitPositionFor(*edlState);
+      return;
+    }
+    const double duration = revisionDuration(*edlState);
+    if (next >= duration) {
+      g.editedSec = duration;
+      emitPositionFor(*edlState);
+      g.playing = false;
+      emit("{\"type\":\"ended\",\"id\":\"" + g.id + "\"}");
+      return;
+    }
+    const double from = g.editedSec.load();
+    g.editedSec = next;
+    emitPositionFor(*edlState);
+    meterTick(from, next, dtSec);
+  }
+
+private:
+  // Requires mutex.
+  bool requireLoaded() {
+    if (loaded) return true;
+    emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+    return false;
+  }
+
+  // A seek out of a one-shot range cancels it, as EdlAudioSource does.
+  // Requires mutex.
+  void seekLocked(double editedSec) {
+    const double target = sanitizeTime(editedSec);
+    if (range.active && !range.loop && (target < range.startSec || target >= range.endSec)) range = PlayRange();
+    g.editedSec = target;
+  }
+
+  // An EDL change on an open file: the playhead follows the audio it was on,
+  // as EdlAudioSource does. Requires mutex.
+  void swapRevision(std::shared_ptr<const EdlRevision> rev) {
+    const auto before = edlState->timeline;
+    activateRevision(std::move(rev));
+    if (before && edlState->timeline) g.editedSec = edlState->timeline->remapEdited(*before, g.editedSec.load());
+  }
+
+  // Requires mutex.
+  void activateRevision(std::shared_ptr<const EdlRevision> rev) {
+    edlState = std::move(rev);
+    gMetrics.edlBytes.store(edlState->byteSize, std::memory_order_relaxed);
+    gMetrics.revisionCacheBytes.store(revisionCache.stats().bytes, std::memory_order_relaxed);
+    refreshClipGains();
+  }
+
+  void startLoudnessAnalysis(const std::string& path, const LoudnessOptions& options, std::vector<LoudnessClip> regions) {
+    const SampleReaderFactory factory = makeWavReaderFactory(path);
+    gAnalysis.start("loudness", [this, path, factory, options, regions = std::move(regions)](const std::atomic<bool>& cancel) {
+      runLoudnessAnalysis(path, factory, options, regions, cancel,
+                          [this, path](std::shared_ptr<const loudness::Analysis> analysis) { loudnessReady(path, std::move(analysis)); });
+    });
+  }
+
+  void loudnessReady(const std::string& path, std::shared_ptr<const loudness::Analysis> analysis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path != loadedPath) return;
+    loudnessAnalysis = std::move(analysis);
+    refreshClipGains();
+  }
+
+  // Linear normalisation gain per loudness clip, empty when off. Requires mutex.
+  void refreshClipGains() {
+    clipGains.clear();
+    if (!normalizeEnabled || !loudnessAnalysis) return;
+    for (const double db : clipNormalisationGains(*loudnessAnalysis, revisionLoudnessClips(*edlState),
+                                                  normalizeTargetLufs, normalizeCeilingDbtp)) {
+      clipGains.push_back((float) std::pow(10.0, db / 20.0));
+    }
+  }
+
+  void resetMeter() {
+    meter = MeterFrame();
+    meterSumSquares.fill(0.0);
+    meterSamples = 0;
+    meterElapsedSec = 0.0;
+    for (auto& detector : meterTruePeak) detector.reset();
+  }
+
+  // Levels of the edited audio [fromSec, toSec) just played, after the volume
+  // and normalisation gains, published as a meter event once 1 / meterRateHz
+  // of output has gone by. The source is the loaded WAV, before any denoise or
+  // strip processing. Requires mutex.
+  void meterTick(double fromSec, double toSec, double dtSec) {
+    if (meterRateHz <= 0.0 || !meterReader) return;
+    const int channels = std::min(meterReader->numChannels(), MeterFrame::kMaxChannels);
+    const double rateHz = meterReader->sampleRate();
+    std::vector<std::vector<float>> buffers((size_t) channels);
+    std::vector<float*> pointers((size_t) channels);
+    for (const auto& span : editedRangeSpans(*edlState, fromSec, toSec)) {
+      const int64_t start = (int64_t) std::llround(span.originalStart * rateHz);
+      const int n = (int) std::max<int64_t>(0, (int64_t) std::llround(span.originalEnd * rateHz) - start);
+      if (n == 0) continue;
+      for (int ch = 0; ch < channels; ++ch) {
+        buffers[(size_t) ch].assign((size_t) n, 0.0f);
+        pointers[(size_t) ch] = buffers[(size_t) ch].data();
+      }
+      if (!meterReader->read(pointers.data(), channels, start, n)) continue;
+      const int clip = edlState->clips.empty() ? 0 : span.clipIndex;
+      const float gain = (float) volume * (clip >= 0 && (size_t) clip < clipGains.size() ? clipGains[(size_t) clip] : 1.0f);
+      for (int ch = 0; ch < channels; ++ch) {
+        float* data = pointers[(size_t) ch];
+        for (int i = 0; i < n; ++i) data[i] *= gain;
+        meter.peak[ch] = std::max(meter.peak[ch], dsp::peakAbs(data, n));
+        meterSumSquares[(size_t) ch] += dsp::sumSquares(data, n);
+        meter.truePeak[ch] = std::max(meter.truePeak[ch], meterTruePeak[ch].process(data, n));
+        meter.clipped[ch] += (uint32_t) dsp::countClipped(data, n);
+      }
+      meterSamples += n;
+    }
+    meterElapsedSec += dtSec;
+    if (meterElapsedSec < 1.0 / meterRateHz) return;
+    meter.channels = channels;
+    for (int ch = 0; ch < channels; ++ch) {
+      meter.rms[ch] = meterSamples > 0 ? (float) std::sqrt(meterSumSquares[(size_t) ch] / (double) meterSamples) : 0.0f;
+    }
+    emitMeterFrame(meter);
+    resetMeter();
+  }
+
+  std::mutex mutex;
+  bool loaded = false;
+  std::string loadedPath;
+  std::shared_ptr<const EdlRevision> edlState = std::make_shared<const EdlRevision>();
+  RevisionCache<EdlRevision> revisionCache;
+  PlayRange range;
+  double playbackRate = 1.0;
+  std::atomic<bool> scrubbing{false};
+  std::atomic<uint64_t> scrubTargets{0};
+  bool resumeAfterScrub = false;
+  std::atomic<double> clockRate{1.0};
+  std::atomic<bool> clockManual{false};
+  std::atomic<double> clockSec{0.0}; // virtual seconds elapsed; written under mutex
+  double clockTargetSec = 0.0;       // command thread only
+  double volume = 1.0;
+  std::shared_ptr<const loudness::Analysis> loudnessAnalysis; // for loadedPath
+  bool normalizeEnabled = false;
+  double normalizeTargetLufs = -16.0;
+  double normalizeCeilingDbtp = -1.0;
+  std::vector<float> clipGains;
+  double meterRateHz = 0.0;
+  std::unique_ptr<SampleReader> meterReader;
+  MeterFrame meter; // accumulating; rms is filled in on publish
+  std::array<double, MeterFrame::kMaxChannels> meterSumSquares{};
+  dsp::TruePeakDetector meterTruePeak[MeterFrame::kMaxChannels];
+  int64_t meterSamples = 0;
+  double meterElapsedSec = 0.0;
+};
+
+static MockEngine gMock;
+
+// Ticks the mock's virtual clock at the JUCE timer period. A manual clock
+// only moves on advanceClock (or, in a replay, on each command's timestamp).
+static void timerThread() {
+  using namespace std::chrono_literals;
+  while (g.running) {
+    const auto tickStart = std::chrono::steady_clock::now();
+    if (!gMock.isClockManual()) gMock.tick(gMock.tickSeconds());
+    gMetrics.timerTickUs.record(std::chrono::steady_clock::now() - tickStart);
+    std::this_thread::sleep_for(33ms);
+  }
+}
+
+static void handleLine(const std::string& line) {
+  // Extremely simple command parsing to avoid JSON dependencies
+  auto contains = [&](const char* s) { return line.find(s) != std::string::npos; };
+  auto extract = [&](const char* key) -> std::string {
+    // extract value for key in a very naive way: "key":"value" or numeric
+    std::string k = std::string("\"") + key + "\":";
+    size_t p = line.find(k);
+    if (p == std::string::npos) return {};
+    p += k.size();
+    if (p >= line.size()) return {};
+    if (line[p] == '"') {
+      size_t end = line.find('"', p + 1);
+      if (end == std::string::npos) return {};
+      return line.substr(p + 1, end - (p + 1));
+    } else {
+      size_t end = line.find_first_of(",}\n", p);
+      if (end == std::string::npos) end = line.size();
+      return line.substr(p, end - p);
+    }
+  };
+
+  if (contains("\"type\":\"scrub\"")) {
+    // Latest target wins; position is reported once scrubbing ends.
+    gMock.scrubTo(numberOr(extract("timeSec"), g.editedSec.load()));
+    return;
+  }
+  if (contains("\"type\":\"load\"")) {
+    const std::string path = extract("path");
+    g.id = extract("id");
+    if (gMock.load(path)) {
+      std::lock_guard<std::mutex> lock(gMutex);
+      g.path = path;
+      g.denoisedPath.clear();
+    }
+    return;
+  }
+  if (contains("\"type\":\"play\"")) {
+    gMock.play();
+    return;
+  }
+  if (contains("\"type\":\"pause\"")) {
+    gMock.pause();
+    return;
+  }
+  if (contains("\"type\":\"stop\"")) {
+    gMock.stop();
+    return;
+  }
+  if (contains("\"type\":\"seek\"")) {
+    try { gMock.seek(std::stod(extract("timeSec"))); } catch (...) {}
+    return;
+  }
+  if (contains("\"type\":\"queryState\"")) {
+    gMock.queryState();
+    return;
+  }
+  if (contains("\"type\":\"scrubStart\"")) {
+    gMock.scrubStart();
+    return;
+  }
+  if (contains("\"type\":\"playRange\"")) {
+    gMock.playRange(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                    extract("loop") == "true", numberOr(extract("crossfadeMs"), 0.0) / 1000.0);
+    return;
+  }
+  if (contains("\"type\":\"setLoop\"")) {
+    gMock.setLoop(extract("enabled") != "false", numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                  numberOr(extract("crossfadeMs"), 0.0) / 1000.0);
+    return;
+  }
+  if (contains("\"type\":\"scrubEnd\"")) {
+    gMock.scrubEnd(numberOr(extract("timeSec"), std::numeric_limits<double>::quiet_NaN()));
+    return;
+  }
+  if (contains("\"type\":\"setRate\"")) {
+    try { gMock.setRate(std::stod(extract("rate"))); } catch (...) {}
+    return;
+  }
+  if (contains("\"type\":\"setClock\"")) {
+    gMock.setClock(numberOr(extract("rate"), 1.0), extract("manual") == "true");
+    gMock.emitClock();
+    return;
+  }
+  if (contains("\"type\":\"advanceClock\"")) {
+    gMock.advanceClock(numberOr(extract("seconds"), 0.0));
+    gMock.emitClock();
+    return;
+  }
+  if (contains("\"type\":\"getOutputStats\"")) {
+    emitOutputStats();
+    return;
+  }
+  if (contains("\"type\":\"getPrerollStats\"")) {
+    // The mock plays nothing, so there is nothing to cache.
+    emit("{\"type\":\"prerollStats\",\"id\":\"" + g.id + "\",\"revision\":0,\"requested\":0,\"cached\":0,"
+         "\"regions\":0,\"bytes\":0,\"fillMs\":0,\"hits\":0,\"misses\":0,\"hitRate\":0}");
+    return;
+  }
+  if (contains("\"type\":\"analyzeSilence\"")) {
+    gMock.analyzeSilence(silenceParamsFromCommand(extract), extract("refineSpacers") == "true",
+                         std::clamp(numberOr(extract("maxShiftSec"), 0.2), 0.0, 2.0));
+    return;
+  }
+  if (contains("\"type\":\"analyzeLoudness\"")) {
+    gMock.analyzeLoudness(loudnessOptionsFromCommand(extract));
+    return;
+  }
+  if (contains("\"type\":\"setLoudnessNormalization\"")) {
+    const LoudnessOptions options = loudnessOptionsFromCommand(extract);
+    gMock.setLoudnessNormalization(extract("enabled") != "false", options.targetLufs, options.ceilingDbtp);
+    return;
+  }
+  if (contains("\"type\":\"renderEdited\"")) {
+    const int bits = (int) numberOr(extract("bitsPerSample"), 32.0);
+    gMock.renderEdited(extract("path"), extract("normalize") == "true", loudnessOptionsFromCommand(extract), bits);
+    return;
+  }
+  if (contains("\"type\":\"exportStems\"") || contains("\"type\":\"exportClips\"")) {
+    const int bits = (int) numberOr(extract("bitsPerSample"), 32.0);
+    gMock.exportAudio(contains("\"type\":\"exportStems\""), extract("directory"), extract("normalize") == "true",
+                      loudnessOptionsFromCommand(extract), bits);
+    return;
+  }
+  if (contains("\"type\":\"saveSidecar\"")) {
+    gMock.saveSidecar(extract("path"), silenceParamsFromCommand(extract));
+    return;
+  }
+  if (contains("\"type\":\"openSidecar\"")) {
+    gMock.openSidecar(extract("path"));
+    return;
+  }
+  if (contains("\"type\":\"refineCuts\"")) {
+    const bool apply = extract("apply") == "true";
+    const std::string revision = extract("revision");
+    if (apply && revision.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"refineCuts apply requires a revision\"}");
+      return;
+    }
+    gMock.refineCuts(cutRefineParamsFromCommand(extract), apply, (int) numberOr(revision, 0.0));
+    return;
+  }
+  if (contains("\"type\":\"findText\"")) {
+    gMock.findText(extract("text"), extract("prefix") == "true",
+                   numberOr(extract("fromSec"), -std::numeric_limits<double>::infinity()),
+                   numberOr(extract("toSec"), std::numeric_limits<double>::infinity()),
+                   (size_t) std::clamp(numberOr(extract("maxResults"), 100.0), 1.0, 10000.0));
+    return;
+  }
+  if (contains("\"type\":\"getWordsInRange\"")) {
+    gMock.getWordsInRange(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                          (size_t) std::clamp(numberOr(extract("maxResults"), 1000.0), 1.0, 100000.0));
+    return;
+  }
+  if (contains("\"type\":\"seekToWord\"")) {
+    gMock.seekToWord((int) numberOr(extract("segmentIndex"), -1.0), extract("text"),
+                     (size_t) std::max(0.0, numberOr(extract("occurrence"), 0.0)),
+                     numberOr(extract("fromSec"), -std::numeric_limits<double>::infinity()));
+    return;
+  }
+  if (contains("\"type\":\"getSpectrogramTiles\"")) {
+    gMock.getSpectrogramTiles(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                              (int) numberOr(extract("level"), -1.0),
+                              (int) std::clamp(numberOr(extract("maxColumns"), 2048.0), 16.0, 65536.0));
+    return;
+  }
+  if (contains("\"type\":\"computeSpectrogram\"")) {
+    gMock.computeSpectrogram((int) std::clamp(numberOr(extract("minLevel"), 1.0), 0.0, (double) spectrogram::kLevels - 1));
+    return;
+  }
+  if (contains("\"type\":\"denoise\"")) {
+    // The profile always comes from the quietest frames here.
+    const DenoiseParams params = denoiseParamsFromCommand(extract);
+    const std::string path = g.path;
+    gAnalysis.start("denoise", [path, params](const std::atomic<bool>& cancel) {
+      runDenoise(path, makeWavReaderFactory(path), {}, params, cancel, [path](const std::string& cachePath) {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (g.path == path) g.denoisedPath = cachePath;
+      });
+    });
+    return;
+  }
+  if (contains("\"type\":\"cancelDenoise\"")) {
+    gAnalysis.cancel("denoise");
+    return;
+  }
+  if (contains("\"type\":\"cancel\"")) {
+    cancelJobFromCommand(extract("jobId"));
+    return;
+  }
+  if (contains("\"type\":\"getJobs\"")) {
+    gAnalysis.emitJobs();
+    return;
+  }
+  if (contains("\"type\":\"setDenoise\"")) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    g.denoiseEnabled = extract("enabled") != "false";
+    emit(std::string("{\"type\":\"denoiseState\",\"id\":\"") + g.id + "\",\"enabled\":" +
+         (g.denoiseEnabled ? "true" : "false") + ",\"active\":" +
+         (g.denoiseEnabled && !g.denoisedPath.empty() ? "true" : "false") + "}");
+    return;
+  }
+  if (contains("\"type\":\"setStrip\"")) {
+    if (!g.strips.set(extract("scope"), extract("target"), stripSettingsFromCommand(extract))) {
+      emit("{\"type\":\"error\",\"message\":\"setStrip scope must be speaker or clip\"}");
+    }
+    return;
+  }
+  if (contains("\"type\":\"clearStrips\"")) {
+    g.strips.clear();
+    return;
+  }
+  if (contains("\"type\":\"updateEdlFromFile\"")) {
+    applyEdlFromFile(gMock, extract("path"), extract("fd"), extract("revision"), extract("generationId"));
+    return;
+  }
+  if (contains("\"type\":\"updateEdl\"")) {
+    applyEdlInline(gMock, line);
+    return;
+  }
+  if (contains("\"type\":\"getMetrics\"")) {
+    emitMetrics();
+    if (extract("reset") == "true") gMetrics.reset();
+    return;
+  }
+  if (contains("\"type\":\"setMetricsInterval\"")) {
+    gMetricsReporter.setIntervalMs((int) numberOr(extract("intervalMs"), 0.0));
+    return;
+  }
+  if (contains("\"type\":\"getRtSafety\"")) {
+    emitRtSafety(extract("reset") == "true");
+    return;
+  }
+  if (contains("\"type\":\"startCapture\"")) {
+    startCapture(extract("path"));
+    return;
+  }
+  if (contains("\"type\":\"stopCapture\"")) {
+    stopCapture();
+    return;
+  }
+  if (contains("\"type\":\"activateRevision\"")) {
+    gMock.activateCachedRevision((int) numberOr(extract("revision"), 0.0));
+    return;
+  }
+  if (contains("\"type\":\"getRevisionCacheStats\"")) {
+    gMock.getRevisionCacheStats();
+    return;
+  }
+  if (contains("\"type\":\"setRevisionCache\"")) {
+    gMock.setRevisionCacheLimit((size_t) std::max(0.0, numberOr(extract("maxBytes"), (double) RevisionCache<EdlRevision>::kDefaultMaxBytes)));
+    return;
+  }
+  if (contains("\"type\":\"getArtifactCacheStats\"")) {
+    emitArtifactCacheStats();
+    return;
+  }
+  if (contains("\"type\":\"setArtifactCache\"")) {
+    gArtifacts.setMaxBytes((uint64_t) std::max(0.0, numberOr(extract("maxBytes"), (double) artifactCacheLimit())));
+    emitArtifactCacheStats();
+    return;
+  }
+  if (contains("\"type\":\"setVolume\"")) {
+    try { gMock.setVolume(std::stod(extract("value"))); } catch (...) {}
+    return;
+  }
+  if (contains("\"type\":\"setMeterRate\"")) {
+    try { gMock.setMeterRate(std::stod(extract("hz"))); } catch (...) {}
+    return;
+  }
+  emit("{\"type\":\"error\",\"message\":\"unknown command\"}");
+}
+
+#ifdef USE_JUCE
+// --- JUCE Implementation ---
+
+// Renders the edited timeline in the audio callback. Positions seen by the
+// transport are edited-timeline samples (at the file rate); each block is
+// stitched together from the original-file spans of the current
+// CompiledTimeline, so segment boundaries, range ends and loop points are all
+// sample-accurate and nothing depends on the 33 ms timer. Seeks, timelines
+// and ranges are posted by the control thread and picked up at the start of
+// the next block.
+class EdlAudioSource : public juce::PositionableAudioSource {
+public:
+  void setInput(juce::PositionableAudioSource* newInput) { input = newInput; }
+  void setSourceSampleRate(double rate) { sourceRate.store(rate > 0.0 ? rate : 48000.0); }
+  void publishTimeline(std::shared_ptr<const CompiledTimeline> timeline) { timelines.publish(std::move(timeline)); }
+  void setRange(const PlayRange& range) { ranges.write(range); }
+  // nullptr bypasses the per-clip strips entirely.
+  void publishStrips(std::shared_ptr<const StripBank> bank) { strips.publish(std::move(bank)); }
+  bool hasStrips() const { return strips.current() != nullptr; }
+
+  // Timer thread: true once per range that played to its end.
+  bool takeRangeEnded() { return rangeEnded.exchange(false); }
+  bool hasFinished() const { return finished.load(); }
+  double getEditedSeconds() const { return (double) getNextReadPosition() / sourceRate.load(); }
+
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+    const double rate = sourceRate.load();
+    tail.setSize(kMaxChannels, (int) std::ceil(kMaxCrossfadeSec * rate) + 1);
+    fadeRemaining = 0;
+    chain.prepare(rate, kMaxChannels);
+    if (input) input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+  }
+
+  void releaseResources() override {
+    if (input) input->releaseResources();
+  }
+
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    if (!input) { info.clearActiveBufferRegion(); return; }
+    rate = sourceRate.load();
+    bank = strips.acquire();
+    const CompiledTimeline* latest = timelines.acquire();
+    const juce::int64 pending = pendingSeek.exchange(kNoSeek);
+    if (latest != timeline) {
+      // A seek in the same block decides the position by itself.
+      if (pending != kNoSeek) timeline = latest;
+      else swapTimeline(latest);
+      refreshRangeEnd();
+    }
+    if (pending != kNoSeek) {
+      const double sec = (double) pending / rate;
+      locate(sec);
+      holding = false;
+      fadeRemaining = 0;
+      chain.reset();
+      if (range.active && !range.loop && (sec < range.startSec || sec >= range.endSec)) range.active = false;
+    }
+    const uint32_t version = ranges.version();
+    if (version != rangeVersion) {
+      PlayRange next;
+      if (ranges.read(next)) {
+        rangeVersion = version;
+        range = next;
+        holding = false;
+        if (range.active && range.seekToStart) locate(range.startSec);
+        refreshRangeEnd();
+      }
+    }
+
+    for (int done = 0; done < info.numSamples;) {
+      if (holding) {
+        info.buffer->clear(info.startSample + done, info.numSamples - done);
+        break;
+      }
+      int want = info.numSamples - done;
+      if (range.active) {
+        const juce::int64 left = samplesToRangeEnd();
+        if (left <= 0) {
+          onRangeEnd();
+          continue;
+        }
+        want = (int) std::min<juce::int64>(want, left);
+      }
+      const int rendered = render(*info.buffer, info.startSample + done, want);
+      applyLoopFade(*info.buffer, info.startSample + done, rendered);
+      done += rendered;
+      if (rendered < want) {
+        info.buffer->clear(info.startSample + done, info.numSamples - done);
+        finished.store(true);
+        break;
+      }
+    }
+    publishedPosition.store((juce::int64) std::llround(editedSeconds() * rate));
+  }
+
+  void setNextReadPosition(juce::int64 newPosition) override {
+    pendingSeek.store(newPosition);
+    finished.store(false);
+  }
+
+  juce::int64 getNextReadPosition() const override {
+    const juce::int64 pending = pendingSeek.load();
+    return pending != kNoSeek ? pending : publishedPosition.load();
+  }
+
+  juce::int64 getTotalLength() const override { return totalLength.load(); }
+  void setTotalLengthSeconds(double sec) { totalLength.store((juce::int64) std::llround(sec * sourceRate.load())); }
+  bool isLooping() const override { return false; }
+
+private:
+  static constexpr juce::int64 kNoSeek = std::numeric_limits<juce::int64>::min();
+  static constexpr int kMaxChannels = 8;
+  static constexpr double kMaxCrossfadeSec = 0.1;
+  static constexpr double kSwapCrossfadeSec = 0.005;
+
+  juce::int64 spanStart(const TimelineSpan& s) const { return (juce::int64) std::llround(s.originalStart * rate); }
+  juce::int64 spanEnd(const TimelineSpan& s) const { return (juce::int64) std::llround(s.originalEnd * rate); }
+
+  double editedSeconds() const {
+    if (!timeline || timeline->empty()) return (double) cursor / rate;
+    if (span >= timeline->size()) return timeline->editedDuration();
+    const TimelineSpan& s = (*timeline)[span];
+    const double r = std::clamp(((double) cursor / rate - s.originalStart) / (s.originalEnd - s.originalStart), 0.0, 1.0);
+    return s.editedStart + r * (s.editedEnd - s.editedStart);
+  }
+
+  // Positions the cursor (and the input) at edited time sec.
+  void locate(double sec) {
+    finished.store(false);
+    if (!timeline || timeline->empty()) {
+      span = 0;
+      cursor = 0;
+      finished.store(timeline != nullptr);
+      input->setNextReadPosition(cursor);
+      return;
+    }
+    span = timeline->spanAtEdited(std::max(0.0, sec));
+    if (span >= timeline->size()) {
+      finished.store(true);
+      return;
+    }
+    const TimelineSpan& s = (*timeline)[span];
+    const double r = std::clamp((sec - s.editedStart) / (s.editedEnd - s.editedStart), 0.0, 1.0);
+    cursor = (juce::int64) std::llround((s.originalStart + r * (s.originalEnd - s.originalStart)) * rate);
+    input->setNextReadPosition(cursor);
+  }
+
+  // New EDL mid-playback, at a block boundary: keep playing the same
+  // original sample, or the next material that survived the edit, and fade
+  // over from the old timeline if that moves the read position. Costs a few
+  // binary searches plus kSwapCrossfadeSec of extra reading.
+  void swapTimeline(const CompiledTimeline* next) {
+    const bool placed = timeline && next && !timeline->empty() && span < timeline->size();
+    TimelinePlayhead at;
+    if (placed) at = next->follow(*timeline, span, (double) cursor / rate, editedSeconds());
+    if (!placed || at.span >= next->size()) {
+      // Nothing to follow: stay at the same edited time.
+      const double sec = editedSeconds();
+      timeline = next;
+      locate(sec);
+      return;
+    }
+    const juce::int64 target = at.originalSec == (double) cursor / rate ? cursor : (juce::int64) std::llround(at.originalSec * rate);
+    if (target != cursor) {
+      fadeLength = (int) std::min<double>(kSwapCrossfadeSec * rate, (double) tail.getNumSamples());
+      if (fadeLength > 0) {
+        tail.clear();
+        juce::AudioBuffer<float> view(tail.getArrayOfWritePointers(), tail.getNumChannels(), fadeLength);
+        render(view, 0, fadeLength);
+        fadeRemaining = fadeLength;
+      }
+      cursor = target;
+      input->setNextReadPosition(cursor);
+    }
+    timeline = next;
+    span = at.span;
+    finished.store(false);
+  }
+
+  // Moves past exhausted spans; false at the end of the timeline.
+  bool settle() {
+    if (!timeline) return false;
+    while (span < timeline->size() && cursor >= spanEnd((*timeline)[span])) {
+      if (++span < timeline->size()) {
+        cursor = spanStart((*timeline)[span]);
+        input->setNextReadPosition(cursor);
+      }
     }
-  };
+    return span < timeline->size();
+  }
 
-  auto extractString = [&](const std::string& s, const char* key) -> std::string {
-    size_t p = s.find(key);
-    if (p == std::string::npos) return {};
-    size_t c = s.find(':', p);
-    if (c == std::string::npos) return {};
-    size_t qs = s.find('"', c);
-    if (qs == std::string::npos) return {};
-    size_t qe = s.find('"', qs + 1);
-    if (qe == std::string::npos) return {};
-    return s.substr(qs + 1, qe - (qs + 1));
-  };
+  // Reads up to n samples of the edited timeline into buffer; fewer only at
+  // the end of the timeline.
+  int render(juce::AudioBuffer<float>& buffer, int start, int n) {
+    int done = 0;
+    while (done < n && settle()) {
+      const int k = (int) std::min<juce::int64>(n - done, spanEnd((*timeline)[span]) - cursor);
+      juce::AudioSourceChannelInfo sub(&buffer, start + done, k);
+      input->getNextAudioBlock(sub);
+      if (bank) {
+        chain.process(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start + done, k,
+                      bank->forClip((*timeline)[span].clipIndex), bank->anySolo);
+      }
+      cursor += k;
+      done += k;
+    }
+    return done;
+  }
 
-  if (revisionOut) {
-    double revValue = extractNumber(json, "\"revision\"");
-    if (revValue == revValue) {
-      *revisionOut = static_cast<int>(revValue);
+  void refreshRangeEnd() {
+    rangeEndSpan = std::numeric_limits<size_t>::max();
+    if (!range.active || !timeline || timeline->empty()) return;
+    rangeEndSpan = timeline->spanAtEdited(range.endSec);
+    if (rangeEndSpan >= timeline->size()) {
+      rangeEndSpan = timeline->size() - 1;
+      rangeEndSample = spanEnd((*timeline)[rangeEndSpan]);
+      return;
     }
+    const TimelineSpan& s = (*timeline)[rangeEndSpan];
+    const double r = std::clamp((range.endSec - s.editedStart) / (s.editedEnd - s.editedStart), 0.0, 1.0);
+    rangeEndSample = (juce::int64) std::llround((s.originalStart + r * (s.originalEnd - s.originalStart)) * rate);
   }
 
-  size_t clipIndex = 0;
-  for (const auto& clipJson : itemStrings) {
-    Clip clip;
-    clip.id = extractString(clipJson, "\"id\"");
+  // Samples that may be rendered before the range end, never crossing a span.
+  juce::int64 samplesToRangeEnd() {
+    if (!settle()) return std::numeric_limits<juce::int64>::max();
+    if (span < rangeEndSpan) return spanEnd((*timeline)[span]) - cursor;
+    if (span == rangeEndSpan) return rangeEndSample - cursor;
+    return std::numeric_limits<juce::int64>::max();
+  }
 
-    const double startSecRaw = extractNumber(clipJson, "\"startSec\"");
-    const double endSecRaw = extractNumber(clipJson, "\"endSec\"");
-    clip.startSec = sanitizeTime(startSecRaw);
-    clip.endSec = sanitizeTime(endSecRaw, clip.startSec);
+  void onRangeEnd() {
+    if (!range.loop) {
+      range.active = false;
+      holding = true;
+      rangeEnded.store(true);
+      return;
+    }
+    // Loop: keep the audio just past the end and fade it out over the start.
+    const double rangeSec = std::max(0.0, range.endSec - range.startSec);
+    fadeLength = (int) std::min<double>({ range.crossfadeSec * rate, 0.5 * rangeSec * rate, (double) tail.getNumSamples() });
+    if (fadeLength > 0) {
+      tail.clear();
+      juce::AudioBuffer<float> view(tail.getArrayOfWritePointers(), tail.getNumChannels(), fadeLength);
+      render(view, 0, fadeLength);
+      fadeRemaining = fadeLength;
+    }
+    locate(range.startSec);
+    if (!settle()) holding = true;
+  }
 
-    const double clipDur = sanitizeDuration(clip.endSec - clip.startSec);
-    if (clipDur <= 0.0) {
-      clipIndex++;
-      continue;
+  void applyLoopFade(juce::AudioBuffer<float>& buffer, int start, int n) {
+    if (fadeRemaining <= 0 || n <= 0) return;
+    const int m = std::min(n, fadeRemaining);
+    const int offset = fadeLength - fadeRemaining;
+    const double halfPi = 1.57079632679489661923;
+    const int channels = std::min(buffer.getNumChannels(), tail.getNumChannels());
+    for (int ch = 0; ch < channels; ++ch) {
+      float* out = buffer.getWritePointer(ch, start);
+      const float* old = tail.getReadPointer(ch, offset);
+      for (int i = 0; i < m; ++i) {
+        const double t = (offset + i + 0.5) / fadeLength;
+        out[i] = (float) (out[i] * std::sin(t * halfPi) + old[i] * std::cos(t * halfPi));
+      }
     }
+    fadeRemaining -= m;
+  }
 
-    clip.originalStartSec = extractNumber(clipJson, "\"originalStartSec\"");
-    clip.originalEndSec = extractNumber(clipJson, "\"originalEndSec\"");
-    if (!(clip.originalStartSec == clip.originalStartSec && clip.originalEndSec == clip.originalEndSec)) {
-      clip.originalStartSec = -1;
-      clip.originalEndSec = -1;
-    } else {
-      clip.originalStartSec = sanitizeTime(clip.originalStartSec, clip.startSec);
-      clip.originalEndSec = sanitizeTime(clip.originalEndSec, clip.originalStartSec);
-      if (sanitizeDuration(clip.originalEndSec - clip.originalStartSec) <= 0.0) {
-        clip.originalStartSec = -1;
-        clip.originalEndSec = -1;
+  juce::PositionableAudioSource* input = nullptr;
+  SnapshotExchange<CompiledTimeline> timelines;
+  SeqLockSlot<PlayRange> ranges;
+  SnapshotExchange<StripBank> strips;
+  std::atomic<double> sourceRate{48000.0};
+  std::atomic<juce::int64> pendingSeek{kNoSeek};
+  std::atomic<juce::int64> publishedPosition{0};
+  std::atomic<juce::int64> totalLength{0};
+  std::atomic<bool> rangeEnded{false};
+  std::atomic<bool> finished{false};
+
+  // Audio thread only.
+  const CompiledTimeline* timeline = nullptr;
+  const StripBank* bank = nullptr;
+  ClipChain chain;
+  double rate = 48000.0;
+  size_t span = 0;
+  juce::int64 cursor = 0;
+  bool holding = false;
+  PlayRange range;
+  uint32_t rangeVersion = 0;
+  size_t rangeEndSpan = 0;
+  juce::int64 rangeEndSample = 0;
+  juce::AudioBuffer<float> tail;
+  int fadeLength = 0;
+  int fadeRemaining = 0;
+};
+
+// SampleReader over a JUCE AudioFormatReader, so the offline analysis passes
+// get every codec JUCE was built with. One instance per worker thread.
+class JuceSampleReader : public SampleReader {
+public:
+  explicit JuceSampleReader(std::unique_ptr<juce::AudioFormatReader> r) : reader(std::move(r)) {}
+
+  int numChannels() const override { return (int) reader->numChannels; }
+  double sampleRate() const override { return reader->sampleRate; }
+  int64_t lengthInSamples() const override { return (int64_t) reader->lengthInSamples; }
+
+  bool read(float* const* dest, int channels, int64_t start, int numSamples) override {
+    return reader->read(dest, channels, (juce::int64) start, numSamples);
+  }
+
+  static SampleReaderFactory factoryFor(const std::string& path) {
+    return [path]() -> std::unique_ptr<SampleReader> {
+      juce::AudioFormatManager formats;
+      formats.registerBasicFormats();
+      std::unique_ptr<juce::AudioFormatReader> r(formats.createReaderFor(juce::File{ juce::String(path) }));
+      if (!r) return nullptr;
+      return std::unique_ptr<SampleReader>(new JuceSampleReader(std::move(r)));
+    };
+  }
+
+private:
+  std::unique_ptr<juce::AudioFormatReader> reader;
+};
+
+// Output level metering. Runs in the audio callback on the final signal (after
+// EDL playback, gain and rate conversion) so the meters show exactly what the
+// device receives. Per-block reductions accumulate until the configured publish
+// interval has elapsed, then a snapshot goes into a seqlock slot for the timer
+// thread. The cost of the metering itself is timed against the block budget.
+class MeteringAudioSource : public juce::AudioSource {
+public:
+  void setInput(juce::AudioSource* newInput) { input = newInput; }
+
+  // 0 disables metering entirely (no per-block cost).
+  void setPublishRateHz(double hz) { publishRateHz.store(std::clamp(hz, 0.0, 60.0)); }
+  double getPublishRateHz() const { return publishRateHz.load(); }
+
+  uint32_t frameVersion() const { return slot.version(); }
+  bool readFrame(MeterFrame& out) const { return slot.read(out); }
+
+  void prepareToPlay(int samplesPerBlockExpected, double newSampleRate) override {
+    if (input) input->prepareToPlay(samplesPerBlockExpected, newSampleRate);
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 48000.0;
+    resetAccumulators();
+    for (auto& detector : truePeak) detector.reset();
+  }
+
+  void releaseResources() override {
+    if (input) input->releaseResources();
+  }
+
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    // Last stage before the device, so this times the whole callback.
+    metrics::CallbackTimer timing(gMetrics, info.numSamples, sampleRate);
+    rt::ScopedRealtime realtime;
+    if (input) input->getNextAudioBlock(info);
+    else info.clearActiveBufferRegion();
+
+    const double rateHz = publishRateHz.load(std::memory_order_relaxed);
+    if (rateHz <= 0.0 || info.buffer == nullptr || info.numSamples <= 0) return;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const int channels = std::min(info.buffer->getNumChannels(), MeterFrame::kMaxChannels);
+    for (int ch = 0; ch < channels; ++ch) {
+      const float* data = info.buffer->getReadPointer(ch, info.startSample);
+      accPeak[ch] = std::max(accPeak[ch], dsp::peakAbs(data, info.numSamples));
+      accSumSquares[ch] += dsp::sumSquares(data, info.numSamples);
+      accTruePeak[ch] = std::max(accTruePeak[ch], truePeak[ch].process(data, info.numSamples));
+      accClipped[ch] += (uint32_t) dsp::countClipped(data, info.numSamples);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+
+    const double costNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    const double budgetNs = (double) info.numSamples / sampleRate * 1e9;
+    const double costPct = budgetNs > 0.0 ? 100.0 * costNs / budgetNs : 0.0;
+    accCostPct += costPct;
+    accCostMaxPct = std::max(accCostMaxPct, costPct);
+    accBlocks++;
+    accChannels = channels;
+    accSamples += info.numSamples;
+
+    if ((double) accSamples >= sampleRate / rateHz) publish();
+  }
+
+private:
+  void publish() {
+    MeterFrame frame;
+    frame.channels = accChannels;
+    for (int ch = 0; ch < accChannels; ++ch) {
+      frame.peak[ch] = accPeak[ch];
+      frame.rms[ch] = accSamples > 0 ? (float) std::sqrt(accSumSquares[ch] / (double) accSamples) : 0.0f;
+      frame.truePeak[ch] = accTruePeak[ch];
+      frame.clipped[ch] = accClipped[ch];
+    }
+    frame.costAvgPct = accBlocks > 0 ? (float) (accCostPct / accBlocks) : 0.0f;
+    frame.costMaxPct = (float) accCostMaxPct;
+    slot.write(frame);
+    resetAccumulators();
+  }
+
+  void resetAccumulators() {
+    std::fill(std::begin(accPeak), std::end(accPeak), 0.0f);
+    std::fill(std::begin(accSumSquares), std::end(accSumSquares), 0.0);
+    std::fill(std::begin(accTruePeak), std::end(accTruePeak), 0.0f);
+    std::fill(std::begin(accClipped), std::end(accClipped), 0u);
+    accCostPct = 0.0;
+    accCostMaxPct = 0.0;
+    accBlocks = 0;
+    accSamples = 0;
+  }
+
+  juce::AudioSource* input = nullptr;
+  std::atomic<double> publishRateHz{0.0};
+  double sampleRate = 48000.0;
+  SeqLockSlot<MeterFrame> slot;
+  dsp::TruePeakDetector truePeak[MeterFrame::kMaxChannels];
+  float accPeak[MeterFrame::kMaxChannels] = {};
+  double accSumSquares[MeterFrame::kMaxChannels] = {};
+  float accTruePeak[MeterFrame::kMaxChannels] = {};
+  uint32_t accClipped[MeterFrame::kMaxChannels] = {};
+  double accCostPct = 0.0;
+  double accCostMaxPct = 0.0;
+  int accBlocks = 0;
+  int accChannels = 0;
+  int64_t accSamples = 0;
+};
+
+// Selects between the original file and its noise-reduced copy (same rate and
+// length) while playing. A swap carries the read position over under a spin
+// lock held only for the pointer exchange, so the callback never waits on
+// anything slower than that and never reads a half-switched source.
+class SourceSwitch : public juce::PositionableAudioSource {
+public:
+  // Control thread.
+  void setInput(juce::PositionableAudioSource* newInput) {
+    if (newInput && prepared) newInput->prepareToPlay(blockSize, sampleRate);
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (newInput && input) newInput->setNextReadPosition(input->getNextReadPosition());
+    input = newInput;
+  }
+
+  void prepareToPlay(int samplesPerBlockExpected, double newSampleRate) override {
+    blockSize = samplesPerBlockExpected;
+    sampleRate = newSampleRate;
+    prepared = true;
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (input) input->prepareToPlay(samplesPerBlockExpected, newSampleRate);
+  }
+
+  void releaseResources() override {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (input) input->releaseResources();
+  }
+
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (input) input->getNextAudioBlock(info);
+    else info.clearActiveBufferRegion();
+  }
+
+  void setNextReadPosition(juce::int64 newPosition) override {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (input) input->setNextReadPosition(newPosition);
+  }
+
+  juce::int64 getNextReadPosition() const override {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    return input ? input->getNextReadPosition() : 0;
+  }
+
+  juce::int64 getTotalLength() const override {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    return input ? input->getTotalLength() : 0;
+  }
+
+  bool isLooping() const override { return false; }
+
+private:
+  mutable juce::SpinLock lock;
+  juce::PositionableAudioSource* input = nullptr;
+  std::atomic<bool> prepared{false};
+  std::atomic<int> blockSize{512};
+  std::atomic<double> sampleRate{48000.0};
+};
+
+// Serves reads that land on a cached word/clip start from memory. Seeks only
+// post the new position; the audio thread applies it at the next block, and
+// on a hit the (possibly cold) seek of the file reader is deferred until the
+// cached audio runs out, by which point playback is already under way.
+class PrerollCacheSource : public juce::PositionableAudioSource {
+public:
+  void setInput(juce::PositionableAudioSource* newInput) { input = newInput; }
+  void publish(std::shared_ptr<const PrerollSet> set) { sets.publish(std::move(set)); }
+
+  uint64_t hitCount() const { return hits.load(); }
+  uint64_t missCount() const { return misses.load(); }
+
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+    if (input) input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+  }
+
+  void releaseResources() override {
+    if (input) input->releaseResources();
+  }
+
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    if (!input) { info.clearActiveBufferRegion(); return; }
+    const PrerollSet* set = sets.acquire();
+    if (set != servingSet) stopServing();
+    const juce::int64 pending = pendingSeek.exchange(kNoSeek);
+    if (pending != kNoSeek) applySeek(set, pending);
+
+    int done = 0;
+    if (serving) {
+      const int k = (int) std::min<juce::int64>(info.numSamples, serving->start + serving->length - position);
+      const int numChannels = info.buffer->getNumChannels();
+      for (int ch = 0; ch < numChannels; ++ch) {
+        const float* src = set->channel(*serving, ch) + (position - serving->start);
+        std::copy(src, src + k, info.buffer->getWritePointer(ch, info.startSample));
       }
+      position += k;
+      done = k;
+      if (position >= serving->start + serving->length) stopServing();
     }
+    if (done < info.numSamples) {
+      juce::AudioSourceChannelInfo rest(info.buffer, info.startSample + done, info.numSamples - done);
+      input->getNextAudioBlock(rest);
+      position += rest.numSamples;
+    }
+    publishedPosition.store(position);
+  }
 
-    clip.speaker = extractString(clipJson, "\"speaker\"");
-    clip.type = extractString(clipJson, "\"type\"");
+  void setNextReadPosition(juce::int64 newPosition) override {
+    pendingSeek.store(newPosition);
+    publishedPosition.store(newPosition);
+  }
 
-    size_t segStart = clipJson.find("\"segments\"");
-    if (segStart != std::string::npos) {
-      size_t segArrayStart = clipJson.find('[', segStart);
-      if (segArrayStart != std::string::npos) {
-        int segDepth = 1;
-        size_t segCursor = segArrayStart + 1;
-        while (segCursor < clipJson.size() && segDepth > 0) {
-          if (clipJson[segCursor] == '[') segDepth++;
-          else if (clipJson[segCursor] == ']') segDepth--;
-          segCursor++;
-        }
+  juce::int64 getNextReadPosition() const override {
+    const juce::int64 pending = pendingSeek.load();
+    return pending != kNoSeek ? pending : publishedPosition.load();
+  }
+  juce::int64 getTotalLength() const override { return input ? input->getTotalLength() : 0; }
+  bool isLooping() const override { return input && input->isLooping(); }
+  void setLooping(bool shouldLoop) override { if (input) input->setLooping(shouldLoop); }
 
-        if (segDepth == 0) {
-          if (segCursor <= segArrayStart + 1) {
-            logParseDiagnostic("Clip " + std::to_string(clipIndex) + " has empty or malformed segment array bounds");
-          } else {
-            const size_t segLength = segCursor - segArrayStart - 1;
-            if (segLength > clipJson.size()) {
-              logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment array length overflow: " + std::to_string(segLength));
-              return false;
-            }
+private:
+  static constexpr juce::int64 kNoSeek = std::numeric_limits<juce::int64>::min();
+
+  void applySeek(const PrerollSet* set, juce::int64 target) {
+    position = target;
+    serving = set ? set->find((int64_t) target) : nullptr;
+    servingSet = serving ? set : nullptr;
+    if (serving) {
+      hits.fetch_add(1);
+    } else {
+      misses.fetch_add(1);
+      input->setNextReadPosition(target);
+    }
+  }
 
-            std::string segArrayContent = clipJson.substr(segArrayStart + 1, segLength - 1);
-            size_t segPos = 0;
-            size_t segIterations = 0;
-            while (segPos < segArrayContent.size()) {
-              if (++segIterations > 1000000) {
-                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " exceeded 1M segment iterations");
-                return false;
-              }
+  // Hands playback back to the file reader at the current position.
+  void stopServing() {
+    if (!serving) { servingSet = nullptr; return; }
+    serving = nullptr;
+    servingSet = nullptr;
+    input->setNextReadPosition(position);
+  }
 
-              while (segPos < segArrayContent.size() && (segArrayContent[segPos] == ' ' || segArrayContent[segPos] == ',' || segArrayContent[segPos] == '\n' || segArrayContent[segPos] == '\r' || segArrayContent[segPos] == '\t')) segPos++;
-              if (segPos >= segArrayContent.size()) break;
-              if (segArrayContent[segPos] != '{') {
-                segPos++;
-                continue;
-              }
+  juce::PositionableAudioSource* input = nullptr;
+  SnapshotExchange<PrerollSet> sets;
+  std::atomic<juce::int64> pendingSeek{kNoSeek};
+  std::atomic<juce::int64> publishedPosition{0};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+
+  // Audio thread only.
+  juce::int64 position = 0;
+  const PrerollRegion* serving = nullptr;
+  const PrerollSet* servingSet = nullptr;
+};
 
-              int segDepth2 = 1;
-              size_t segObjStart = segPos;
-              segPos++;
-              while (segPos < segArrayContent.size() && segDepth2 > 0) {
-                if (segArrayContent[segPos] == '{') segDepth2++;
-                else if (segArrayContent[segPos] == '}') segDepth2--;
-                segPos++;
-              }
+// Linear gain per original-sample region, sorted by start and non-overlapping.
+// Built on the control thread and read by ClipGainSource in the callback.
+struct GainMap {
+  std::vector<int64_t> starts;
+  std::vector<int64_t> ends;
+  std::vector<float> gains;
+
+  // Gain at pos and the number of samples until the gain may change.
+  float gainAt(int64_t pos, int64_t& runLength) const {
+    const auto it = std::upper_bound(starts.begin(), starts.end(), pos);
+    const size_t next = (size_t) (it - starts.begin());
+    if (next > 0 && pos < ends[next - 1]) {
+      runLength = ends[next - 1] - pos;
+      return gains[next - 1];
+    }
+    runLength = next < starts.size() ? starts[next] - pos : std::numeric_limits<int64_t>::max();
+    return 1.0f;
+  }
+};
 
-              if (segDepth2 != 0) {
-                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment braces unbalanced");
-                return false;
-              }
+// Applies per-clip normalisation gain in the original timeline, between the
+// file reader and the transport, so EDL jumps pick up the right clip's gain.
+// Gain changes are ramped over 10 ms.
+class ClipGainSource : public juce::PositionableAudioSource {
+public:
+  void setInput(juce::PositionableAudioSource* newInput) { input = newInput; }
+  void publish(std::shared_ptr<const GainMap> map) { maps.publish(std::move(map)); }
 
-              if (segPos <= segObjStart) {
-                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment bounds invalid");
-                return false;
-              }
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+    rampSamples = std::max(1, (int) std::lround(0.01 * sampleRate));
+    ramp.reset();
+    if (input) input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+  }
 
-              const size_t segObjLen = segPos - segObjStart;
-              if (segObjLen > segArrayContent.size()) {
-                logParseDiagnostic("Clip " + std::to_string(clipIndex) + " segment length overflow: " + std::to_string(segObjLen));
-                return false;
-              }
+  void releaseResources() override {
+    if (input) input->releaseResources();
+  }
 
-              std::string segJson = segArrayContent.substr(segObjStart, segObjLen);
-              Segment segment;
-              segment.type = extractString(segJson, "\"type\"");
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    if (!input) { info.clearActiveBufferRegion(); return; }
+    const juce::int64 blockStart = input->getNextReadPosition();
+    input->getNextAudioBlock(info);
+    const GainMap* map = maps.acquire();
+    if (!map) {
+      ramp.setTarget(1.0f, rampSamples);
+      if (ramp.currentGain() == 1.0f) return;
+    }
+    float* const* channels = info.buffer->getArrayOfWritePointers();
+    const int numChannels = info.buffer->getNumChannels();
+    for (int done = 0; done < info.numSamples;) {
+      int64_t runLength = info.numSamples - done;
+      const float gain = map ? map->gainAt((int64_t) blockStart + done, runLength) : 1.0f;
+      const int n = (int) std::min<int64_t>(runLength, info.numSamples - done);
+      ramp.setTarget(gain, rampSamples);
+      ramp.process(channels, numChannels, info.startSample + done, n);
+      done += n;
+    }
+  }
 
-              const double segStartRaw = extractNumber(segJson, "\"startSec\"");
-              const double segEndRaw = extractNumber(segJson, "\"endSec\"");
-              if (!(segStartRaw == segStartRaw && segEndRaw == segEndRaw)) {
-                continue;
-              }
+  void setNextReadPosition(juce::int64 position) override { if (input) input->setNextReadPosition(position); }
+  juce::int64 getNextReadPosition() const override { return input ? input->getNextReadPosition() : 0; }
+  juce::int64 getTotalLength() const override { return input ? input->getTotalLength() : 0; }
+  bool isLooping() const override { return input && input->isLooping(); }
+  void setLooping(bool shouldLoop) override { if (input) input->setLooping(shouldLoop); }
 
-              const double segStartSafe = sanitizeTime(segStartRaw);
-              const double segEndSafe = sanitizeTime(segEndRaw, segStartSafe);
-              const double segDurSafe = sanitizeDuration(segEndSafe - segStartSafe);
-              if (segDurSafe <= 0.0) {
-                continue;
-              }
+private:
+  juce::PositionableAudioSource* input = nullptr;
+  SnapshotExchange<GainMap> maps;
+  dsp::GainRamp ramp;
+  int rampSamples = 480;
+};
 
-              segment.start = segStartSafe;
-              segment.end = segStartSafe + segDurSafe;
-              segment.dur = segDurSafe;
-              segment.text = extractString(segJson, "\"text\"");
+// The one rate conversion between the transport and the device. The
+// transport and everything feeding it run at the file's sample rate; this
+// stage takes that to the device rate and applies the playback rate in the
+// same polyphase pass (Resampler.h), for up to kMaxChannels channels.
+// Filters are designed on the control thread and handed over as snapshots,
+// so a rate change never allocates in the callback.
+class PolyphaseResamplingSource : public juce::AudioSource {
+public:
+  static constexpr int kMaxChannels = 8;
+  static constexpr int kMaxInputPerCall = 4096;
 
-              segment.originalStart = extractNumber(segJson, "\"originalStartSec\"");
-              segment.originalEnd = extractNumber(segJson, "\"originalEndSec\"");
-              if (segment.originalStart == segment.originalStart && segment.originalEnd == segment.originalEnd) {
-                segment.originalStart = sanitizeTime(segment.originalStart, 0.0);
-                segment.originalEnd = sanitizeTime(segment.originalEnd, segment.originalStart);
-                if (sanitizeDuration(segment.originalEnd - segment.originalStart) <= 0.0) {
-                  segment.originalStart = -1;
-                  segment.originalEnd = -1;
-                }
-              } else {
-                segment.originalStart = -1;
-                segment.originalEnd = -1;
-              }
+  explicit PolyphaseResamplingSource(juce::AudioSource* source) : input(source) {
+    resampler.prepare(kMaxChannels, kMaxInputPerCall);
+    updateFilter();
+  }
 
-              clip.segments.push_back(segment);
-            }
-            logParseDiagnostic("Clip " + std::to_string(clipIndex) + " parsed " + std::to_string(clip.segments.size()) + " segments");
-          }
-        }
+  // Control thread. Re-prepares the input at the new rate and drops the
+  // history, so nothing of the previous file is heard in the next.
+  void setSourceSampleRate(double rate) {
+    sourceRate.store(rate > 0.0 ? rate : 48000.0);
+    if (prepared) input->prepareToPlay(blockSize, sourceRate.load());
+    flush.store(true);
+    updateFilter();
+  }
+
+  // Control thread. 2.0 plays twice as fast (and an octave up).
+  void setPlaybackRate(double rate) {
+    playbackRate.store(rate);
+    updateFilter();
+  }
+
+  // Input (file) samples consumed per output (device) sample.
+  double getRatio() const { return ratio.load(); }
+
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+    blockSize = samplesPerBlockExpected;
+    deviceRate.store(sampleRate > 0.0 ? sampleRate : 48000.0);
+    prepared = true;
+    input->prepareToPlay(samplesPerBlockExpected, sourceRate.load());
+    flush.store(true);
+    updateFilter();
+  }
+
+  void releaseResources() override { input->releaseResources(); }
+
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    const dsp::PolyphaseFilter* filter = filters.acquire();
+    if (flush.exchange(false)) resampler.reset();
+    const double r = ratio.load();
+    const int numChannels = std::min(info.buffer->getNumChannels(), kMaxChannels);
+    float* in[kMaxChannels];
+    float* out[kMaxChannels];
+    for (int ch = 0; ch < numChannels; ++ch) in[ch] = resampler.input(ch);
+    for (int done = 0; done < info.numSamples;) {
+      const int n = std::min(info.numSamples - done, resampler.maxOutput(r));
+      const int need = resampler.inputNeeded(n, r);
+      if (need > 0) {
+        juce::AudioBuffer<float> view(in, numChannels, need);
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo(&view, 0, need));
       }
+      for (int ch = 0; ch < numChannels; ++ch) out[ch] = info.buffer->getWritePointer(ch, info.startSample + done);
+      resampler.process(*filter, need, out, numChannels, n, r);
+      done += n;
+    }
+    for (int ch = numChannels; ch < info.buffer->getNumChannels(); ++ch) {
+      info.buffer->clear(ch, info.startSample, info.numSamples);
+    }
+  }
+
+private:
+  // Control side (command thread, or the device thread via prepareToPlay).
+  void updateFilter() {
+    std::lock_guard<std::mutex> lock(designMutex);
+    const double r = sourceRate.load() * playbackRate.load() / deviceRate.load();
+    int taps = 0;
+    double cutoff = 1.0;
+    dsp::PolyphaseResampler::filterShape(dsp::kStandardResampling, r, taps, cutoff);
+    if (taps != designedTaps || cutoff != designedCutoff) {
+      filters.publish(dsp::designPolyphaseFilter(taps, cutoff, dsp::kStandardResampling.beta));
+      designedTaps = taps;
+      designedCutoff = cutoff;
+    }
+    ratio.store(r);
+  }
+
+  juce::AudioSource* input;
+  dsp::PolyphaseResampler resampler;
+  SnapshotExchange<dsp::PolyphaseFilter> filters;
+  std::mutex designMutex;
+  int designedTaps = 0;
+  double designedCutoff = 0.0;
+  std::atomic<double> sourceRate{48000.0};
+  std::atomic<double> deviceRate{48000.0};
+  std::atomic<double> playbackRate{1.0};
+  std::atomic<double> ratio{1.0};
+  std::atomic<bool> flush{false};
+  std::atomic<bool> prepared{false};
+  std::atomic<int> blockSize{512};
+};
+
+// Scrub mode. The command thread drops edited-time targets into a seqlock
+// slot; the audio thread only ever sees the newest one, so a burst of drag
+// events collapses to a single position without touching the Backend mutex.
+// Output is a stream of Hann-windowed grains (40 ms, 50% overlap) taken from
+// the scrub position, either at normal speed from each target or, with
+// velocity following, at the pointer's speed and direction.
+//
+// The callback never reads the file. A feeder thread owns the reader and
+// keeps a few seconds of source audio around the newest target (or, between
+// targets, around where the grains have got to) in a window it hands over
+// through a SnapshotExchange. A grain whose samples are not in the window
+// yet is left silent and tried again on the next block.
+struct ScrubTarget {
+  double editedSec = 0.0;
+  int64_t receivedNs = 0; // steady clock, when the command was read
+  uint64_t sequence = 0;
+};
+
+struct ScrubStats {
+  uint64_t submitted = 0;
+  uint64_t consumed = 0;
+  uint64_t grains = 0;
+  uint64_t gaps = 0; // grains left silent because the window was not ready
+  double latencyAvgMs = 0.0;
+  double latencyMaxMs = 0.0;
+  double outputLatencyMs = 0.0;
+};
+
+static int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class ScrubAudioSource : public juce::AudioSource {
+public:
+  ScrubAudioSource() : feeder([this] { feed(); }) {}
+
+  ~ScrubAudioSource() override {
+    {
+      std::lock_guard<std::mutex> lock(feedMutex);
+      stopping = true;
     }
+    feedWake.notify_one();
+    feeder.join();
+  }
 
-    if (!clip.segments.empty()) {
-      clipsOut.push_back(clip);
+  void setInput(juce::AudioSource* newInput) { input = newInput; }
+
+  // Control thread. The reader moves to the feeder thread, which may still be
+  // reading the old one; the old reader is returned so callers holding other
+  // locks can drop their reference after releasing them, and whichever thread
+  // lets go of it last closes the file.
+  std::shared_ptr<juce::AudioFormatReader> setReader(std::unique_ptr<juce::AudioFormatReader> newReader) {
+    std::shared_ptr<juce::AudioFormatReader> old;
+    {
+      std::lock_guard<std::mutex> lock(feedMutex);
+      old = std::exchange(reader, std::shared_ptr<juce::AudioFormatReader>(std::move(newReader)));
+      sourceRate.store(reader && reader->sampleRate > 0.0 ? reader->sampleRate : 48000.0);
+      // Windows cut from the old file stop matching before the new one is read.
+      readerGeneration.fetch_add(1);
+      feedPending = true;
     }
+    feedWake.notify_one();
+    return old;
+  }
 
-    clipIndex++;
-    if ((clipIndex % 1000) == 0) {
-      logParseDiagnostic("Processed " + std::to_string(clipIndex) + " clips so far");
+  void publishTimeline(std::shared_ptr<const CompiledTimeline> timeline) {
+    {
+      std::lock_guard<std::mutex> lock(feedMutex);
+      feedTimeline = timeline;
     }
+    timelines.publish(std::move(timeline));
   }
 
-  return true;
-}
+  void setOutputLatencySamples(int samples) { outputLatencySamples.store(std::max(0, samples)); }
+
+  void begin(bool followVelocity) {
+    velocityFollow.store(followVelocity);
+    submitted.store(0);
+    consumed.store(0);
+    grains.store(0);
+    gaps.store(0);
+    latencySumUs.store(0);
+    latencyCount.store(0);
+    latencyMaxUs.store(0);
+    servedSequence.store(0);
+    active.store(true);
+    wakeFeeder();
+  }
 
-// Custom AudioSource that handles Edit Decision List (EDL) playback
-class EdlAudioSource : public juce::PositionableAudioSource {
-public:
-  EdlAudioSource(juce::AudioFormatReaderSource* readerSource) : reader(readerSource) {}
-  
-  void updateSegments(const std::vector<Segment>& newSegments, bool isContiguous) {
-    segments = newSegments;
-    contiguousMode = isContiguous;
-    currentSegmentIndex = 0;
-    editedPosition = 0.0;
+  void end() { active.store(false); }
+  bool isActive() const { return active.load(); }
+
+  // Command thread. Never waits on the audio thread or on the file: the
+  // feeder holds feedMutex only to pick up its inputs.
+  void submit(double editedSec) {
+    ScrubTarget t;
+    t.editedSec = editedSec;
+    t.receivedNs = steadyNowNs();
+    t.sequence = submitted.fetch_add(1) + 1;
+    target.write(t);
+    lastEditedSec.store(editedSec);
+    wakeFeeder();
   }
-  
-  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
-    if (reader) reader->prepareToPlay(samplesPerBlockExpected, sampleRate);
 
-    // Safety check and logging for dynamic sample rate
-    if (sampleRate <= 0.0) {
-      juceDLog("[JUCE] WARNING: Invalid sample rate in prepareToPlay: " + std::to_string(sampleRate));
-      this->sampleRate = 48000.0; // Fallback to reasonable default
-    } else {
-      this->sampleRate = sampleRate;
-    }
+  double lastTargetEditedSec() const { return lastEditedSec.load(); }
+
+  ScrubStats stats() const {
+    ScrubStats s;
+    s.submitted = submitted.load();
+    s.consumed = consumed.load();
+    s.grains = grains.load();
+    s.gaps = gaps.load();
+    const uint64_t count = latencyCount.load();
+    s.latencyAvgMs = count ? (double) latencySumUs.load() / (double) count / 1000.0 : 0.0;
+    s.latencyMaxMs = (double) latencyMaxUs.load() / 1000.0;
+    s.outputLatencyMs = outputRate > 0.0 ? 1000.0 * outputLatencySamples.load() / outputRate : 0.0;
+    return s;
+  }
 
-    juceDLog("[JUCE] EdlAudioSource prepared with sample rate: " + std::to_string(this->sampleRate));
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
+    outputRate = sampleRate > 0.0 ? sampleRate : 48000.0;
+    grainLength = std::max(64, (int) std::lround(kGrainSec * outputRate)) & ~1;
+    hop = grainLength / 2;
+    window.resize((size_t) grainLength);
+    const double pi = 3.14159265358979323846;
+    for (int i = 0; i < grainLength; ++i) window[(size_t) i] = (float) (0.5 - 0.5 * std::cos(2.0 * pi * i / grainLength));
+    for (auto& grain : grainSlots) {
+      grain.samples.setSize(kChannels, grainLength);
+      grain.live = false;
+    }
+    hopCountdown = 0;
+    if (input) input->prepareToPlay(samplesPerBlockExpected, sampleRate);
   }
-  
+
   void releaseResources() override {
-    if (reader) reader->releaseResources();
+    if (input) input->releaseResources();
   }
-  
-  void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override {
-    bufferToFill.clearActiveBufferRegion();
 
-    if (!reader || segments.empty()) {
-      juceDLog("[JUCE] getNextAudioBlock: reader=" + std::to_string(reader != nullptr) +
-               ", segments.size=" + std::to_string(segments.size()));
+  void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override {
+    if (!active.load()) {
+      wasActive = false;
+      if (input) input->getNextAudioBlock(info); else info.clearActiveBufferRegion();
       return;
     }
-
-    // Safety check for sample rate before calculations
-    if (sampleRate <= 1.0) {  // Must be at least 1Hz
-      juceDLog("[JUCE] ERROR: Invalid sample rate in getNextAudioBlock: " + std::to_string(sampleRate));
-      return;
+    info.clearActiveBufferRegion();
+    if (!wasActive) {
+      wasActive = true;
+      lastSequence = 0;
+      idleSamples = std::numeric_limits<int64_t>::max() / 2;
+      rate = 0.0;
+      for (auto& grain : grainSlots) grain.live = false;
+      hopCountdown = 0;
     }
-    
-    int samplesNeeded = bufferToFill.numSamples;
-    int samplesWritten = 0;
-    
-    while (samplesNeeded > 0 && currentSegmentIndex < segments.size()) {
-      // Bounds check for segment access
-      if (currentSegmentIndex >= segments.size()) {
-        juceDLog("[JUCE] ERROR: currentSegmentIndex out of bounds: " + std::to_string(currentSegmentIndex) +
-                 "/" + std::to_string(segments.size()));
-        break;
-      }
-      const auto& segment = segments[currentSegmentIndex];
-      
-      // Calculate positions in samples
-      int64_t segmentStartSample, segmentEndSample;
-      double segmentDuration;
-      
-      if (contiguousMode && segment.hasOriginal()) {
-        // For reordered clips, use original audio positions
-        segmentStartSample = (int64_t)(segment.originalStart * sampleRate);
-        segmentEndSample = (int64_t)(segment.originalEnd * sampleRate);
-        segmentDuration = segment.originalEnd - segment.originalStart;
-      } else {
-        // For normal clips, use regular positions  
-        segmentStartSample = (int64_t)(segment.start * sampleRate);
-        segmentEndSample = (int64_t)(segment.end * sampleRate);
-        segmentDuration = segment.dur;
-      }
-      
-      // Calculate relative position within this segment (in edited timeline)
-      double relativeEditedPos = editedPosition - segment.start;
-      if (relativeEditedPos < 0) relativeEditedPos = 0;
-      
-      // Map to original audio position
-      double relativeProgress = relativeEditedPos / (segment.end - segment.start);
-      int64_t currentOriginalSample = segmentStartSample + (int64_t)(relativeProgress * (segmentEndSample - segmentStartSample));
-      
-      // How many samples left in this segment?
-      int64_t samplesLeftInSegment = segmentEndSample - currentOriginalSample;
-      int samplesToRead = std::min(samplesNeeded, (int)samplesLeftInSegment);
-      
-      if (samplesToRead > 0) {
-        // Read from original position
-        reader->setNextReadPosition(currentOriginalSample);
-        
-        juce::AudioSourceChannelInfo segmentInfo;
-        segmentInfo.buffer = bufferToFill.buffer;
-        segmentInfo.startSample = bufferToFill.startSample + samplesWritten;
-        segmentInfo.numSamples = samplesToRead;
-        
-        reader->getNextAudioBlock(segmentInfo);
-        
-        samplesWritten += samplesToRead;
-        samplesNeeded -= samplesToRead;
-
-        // Advance edited position using duration ratio to handle gap-filled segments
-        double originalTimeAdvanced = (double)samplesToRead / sampleRate;
-
-        // Calculate the ratio between edited and original durations for this segment
-        double editedDuration = segment.end - segment.start;
-        double originalDuration = segment.hasOriginal() ?
-          (segment.originalEnd - segment.originalStart) : segment.dur;
-
-        // Handle potential division by zero and invalid durations
-        if (originalDuration > 1e-9 && editedDuration > 1e-9) {  // Use epsilon instead of 0.0
-          double durationRatio = editedDuration / originalDuration;
-          // Clamp ratio to reasonable bounds to prevent overflow
-          durationRatio = std::max(0.01, std::min(100.0, durationRatio));
-          editedPosition += originalTimeAdvanced * durationRatio;
-
-          // Log ratio-based advancement for debugging
-          juceDLog("[JUCE] Position advanced: original=" + std::to_string(originalTimeAdvanced) +
-                   "s, ratio=" + std::to_string(durationRatio) +
-                   ", edited=" + std::to_string(originalTimeAdvanced * durationRatio) + "s");
-        } else {
-          // Fallback to original method if duration is invalid
-          editedPosition += originalTimeAdvanced;
-          juceDLog("[JUCE] Position advanced (fallback): " + std::to_string(originalTimeAdvanced) +
-                   "s, originalDur=" + std::to_string(originalDuration) +
-                   ", editedDur=" + std::to_string(editedDuration) + "s");
-        }
+    const ScrubWindow* fed = windows.acquire();
+    if (fed && fed->generation != readerGeneration.load()) fed = nullptr;
+    consumeTarget();
+
+    const int outChannels = std::min(info.buffer->getNumChannels(), kChannels);
+    for (int done = 0; done < info.numSamples;) {
+      if (hopCountdown == 0) {
+        // On a miss, try again at the start of the next block.
+        hopCountdown = spawnGrain(fed, done) ? hop : info.numSamples - done;
       }
-      
-      // Check if we've reached the end of current segment
-      if (editedPosition >= segment.end - 0.001) { // Small tolerance
-        currentSegmentIndex++;
-        if (currentSegmentIndex < segments.size()) {
-          editedPosition = segments[currentSegmentIndex].start;
+      const int n = std::min(info.numSamples - done, hopCountdown);
+      for (auto& grain : grainSlots) {
+        if (!grain.live) continue;
+        const int k = std::min(n, grainLength - grain.offset);
+        for (int ch = 0; ch < outChannels; ++ch) {
+          info.buffer->addFrom(ch, info.startSample + done, grain.samples, ch, grain.offset, k);
         }
+        grain.offset += k;
+        if (grain.offset >= grainLength) grain.live = false;
       }
-      
-      if (samplesToRead <= 0) break; // Avoid infinite loop
+      hopCountdown -= n;
+      done += n;
     }
+    idleSamples += info.numSamples;
+    playPosition.store(position);
   }
-  
-  void setNextReadPosition(int64_t newPosition) override {
-    // Convert sample position to edited timeline position
-    editedPosition = (double)newPosition / sampleRate;
-    
-    // Find which segment contains this edited position
-    currentSegmentIndex = 0;
-    for (size_t i = 0; i < segments.size(); i++) {
-      if (editedPosition >= segments[i].start && editedPosition < segments[i].end) {
-        currentSegmentIndex = i;
-        break;
-      } else if (editedPosition < segments[i].start) {
-        currentSegmentIndex = i;
-        editedPosition = segments[i].start;
-        break;
+
+private:
+  static constexpr int kChannels = 2;
+  static constexpr double kGrainSec = 0.04;
+  static constexpr double kIdleSec = 0.25;   // keep playing this long after the last target
+  static constexpr double kMaxRate = 4.0;    // velocity-following speed limit
+  static constexpr double kWindowSec = 4.0;  // source audio held around the scrub position
+  static constexpr auto kFeedPoll = std::chrono::milliseconds(5);
+
+  struct Grain {
+    juce::AudioBuffer<float> samples; // windowed, output rate
+    int offset = 0;
+    bool live = false;
+  };
+
+  // Source samples [start, start + samples.getNumSamples()), kChannels wide
+  // (mono files are doubled), from the reader of `generation`.
+  struct ScrubWindow {
+    juce::int64 start = 0;
+    uint64_t generation = 0;
+    juce::AudioBuffer<float> samples;
+  };
+
+  void wakeFeeder() {
+    {
+      std::lock_guard<std::mutex> lock(feedMutex);
+      feedPending = true;
+    }
+    feedWake.notify_one();
+  }
+
+  // Feeder thread. Re-reads the window when the position it has to cover is
+  // within a quarter window of either edge, or the reader changed. Only this
+  // thread touches the reader, and it reads without holding feedMutex.
+  void feed() {
+    std::shared_ptr<const ScrubWindow> fed;
+    std::unique_lock<std::mutex> lock(feedMutex);
+    for (;;) {
+      const auto woken = [this] { return feedPending || stopping; };
+      if (active.load()) feedWake.wait_for(lock, kFeedPoll, woken); else feedWake.wait(lock, woken);
+      if (stopping) return;
+      feedPending = false;
+      if (!active.load() || !reader) continue;
+      const std::shared_ptr<juce::AudioFormatReader> source = reader;
+      const std::shared_ptr<const CompiledTimeline> timeline = feedTimeline;
+      const uint64_t generation = readerGeneration.load();
+      lock.unlock();
+
+      const double rateHz = sourceRate.load();
+      double wanted = playPosition.load();
+      if (submitted.load() > servedSequence.load()) {
+        // A target the audio thread has not reached yet: be there first.
+        const double editedSec = lastEditedSec.load();
+        wanted = std::max(0.0, (timeline && !timeline->empty() ? timeline->editedToOriginal(editedSec) : editedSec) * rateHz);
+      }
+      const int frames = (int) (kWindowSec * rateHz);
+      const bool covered = fed && fed->generation == generation && wanted - (double) fed->start >= frames / 4 &&
+                           (double) (fed->start + fed->samples.getNumSamples()) - wanted >= frames / 4;
+      if (!covered) {
+        auto next = std::make_shared<ScrubWindow>();
+        next->start = std::max<juce::int64>(0, (juce::int64) wanted - frames / 2);
+        next->generation = generation;
+        next->samples.setSize(kChannels, frames);
+        const int readerChannels = std::clamp<int>((int) source->numChannels, 1, kChannels);
+        if (source->read(next->samples.getArrayOfWritePointers(), readerChannels, next->start, frames)) {
+          for (int ch = readerChannels; ch < kChannels; ++ch) next->samples.copyFrom(ch, 0, next->samples, 0, 0, frames);
+          fed = std::move(next);
+          windows.publish(fed);
+        }
       }
+      lock.lock();
     }
   }
-  
-  int64_t getNextReadPosition() const override {
-    if (sampleRate <= 0.0) return 0;
-    return (int64_t)(editedPosition * sampleRate);
+
+  void consumeTarget() {
+    ScrubTarget t;
+    if (!target.read(t) || t.sequence == lastSequence) return;
+    const bool first = lastSequence == 0;
+    lastSequence = t.sequence;
+    servedSequence.store(t.sequence);
+    consumed.fetch_add(1);
+
+    const double rateHz = sourceRate.load();
+    const CompiledTimeline* timeline = timelines.acquire();
+    const double originalSec = timeline && !timeline->empty() ? timeline->editedToOriginal(t.editedSec) : t.editedSec;
+    const double newPosition = std::max(0.0, originalSec * rateHz);
+    if (velocityFollow.load() && !first && t.receivedNs > lastReceivedNs) {
+      const double seconds = (double) (t.receivedNs - lastReceivedNs) * 1e-9;
+      const double v = (newPosition - lastTargetPosition) / (seconds * rateHz);
+      rate = std::clamp(v, -kMaxRate, kMaxRate);
+    } else {
+      rate = 1.0;
+    }
+    lastTargetPosition = newPosition;
+    lastReceivedNs = t.receivedNs;
+    position = newPosition;
+    pendingReceivedNs = t.receivedNs;
+    idleSamples = 0;
+    // Start the new grain now rather than at the next hop.
+    hopCountdown = 0;
   }
-  
-  int64_t getTotalLength() const override {
-    if (segments.empty() || sampleRate <= 0.0) return 0;
-    return (int64_t)(segments.back().end * sampleRate);
+
+  // Returns false when the grain's samples are not in `fed`; the position
+  // stays put so the grain plays from there once they are.
+  bool spawnGrain(const ScrubWindow* fed, int offsetInBlock) {
+    const bool following = velocityFollow.load();
+    if (following) {
+      if (idleSamples > (int64_t) (kIdleSec * outputRate * 0.2)) rate *= 0.5; // pointer stopped: decay
+      if (std::abs(rate) < 0.05) return true;
+    } else if (idleSamples > (int64_t) (kIdleSec * outputRate)) {
+      return true;
+    }
+
+    // Source samples per output sample.
+    const double step = rate * sourceRate.load() / outputRate;
+    const double last = position + step * (grainLength - 1);
+    const juce::int64 lo = (juce::int64) std::floor(std::min(position, last));
+    const int span = (int) (std::ceil(std::max(position, last)) - (double) lo) + 2;
+    if (!fed || lo < fed->start || lo + span > fed->start + fed->samples.getNumSamples()) {
+      gaps.fetch_add(1);
+      return false;
+    }
+
+    Grain* slot = &grainSlots[0];
+    for (auto& grain : grainSlots) {
+      if (!grain.live) { slot = &grain; break; }
+      if (grain.offset > slot->offset) slot = &grain;
+    }
+    for (int ch = 0; ch < kChannels; ++ch) {
+      const float* src = fed->samples.getReadPointer(ch, (int) (lo - fed->start));
+      float* dst = slot->samples.getWritePointer(ch);
+      for (int i = 0; i < grainLength; ++i) {
+        const double p = position + step * i - (double) lo;
+        const int j = std::clamp((int) p, 0, span - 2);
+        const float frac = (float) (p - j);
+        dst[i] = window[(size_t) i] * (src[j] + frac * (src[j + 1] - src[j]));
+      }
+    }
+    slot->offset = 0;
+    slot->live = true;
+    position = std::max(0.0, position + step * hop);
+    grains.fetch_add(1);
+
+    if (pendingReceivedNs != 0) {
+      // Pointer-to-ear latency: command receipt until this grain leaves the device.
+      const double aheadNs = 1e9 * (offsetInBlock + outputLatencySamples.load()) / outputRate;
+      const int64_t latencyUs = (int64_t) ((double) (steadyNowNs() - pendingReceivedNs) + aheadNs) / 1000;
+      latencySumUs.fetch_add((uint64_t) std::max<int64_t>(0, latencyUs));
+      latencyCount.fetch_add(1);
+      atomicStoreMax(latencyMaxUs, (uint64_t) std::max<int64_t>(0, latencyUs));
+      pendingReceivedNs = 0;
+    }
+    return true;
   }
-  
-  bool isLooping() const override { return false; }
 
-private:
-  juce::AudioFormatReaderSource* reader;
-  std::vector<Segment> segments;
-  bool contiguousMode = false;
-  size_t currentSegmentIndex = 0;
-  double editedPosition = 0.0;
-  double sampleRate = 48000.0; // Default fallback, set dynamically in prepareToPlay
+  juce::AudioSource* input = nullptr;
+  double outputRate = 48000.0;
+  SnapshotExchange<CompiledTimeline> timelines;
+  SnapshotExchange<ScrubWindow> windows; // published by the feeder only
+  SeqLockSlot<ScrubTarget> target;
+  std::atomic<double> sourceRate{48000.0};
+  std::atomic<uint64_t> readerGeneration{0};
+  std::atomic<double> playPosition{0.0};      // source samples, where the grains have got to
+  std::atomic<uint64_t> servedSequence{0};    // newest target the audio thread has taken
+  std::atomic<bool> active{false};
+  std::atomic<bool> velocityFollow{false};
+  std::atomic<double> lastEditedSec{0.0};
+  std::atomic<int> outputLatencySamples{0};
+  std::atomic<uint64_t> submitted{0};
+  std::atomic<uint64_t> consumed{0};
+  std::atomic<uint64_t> grains{0};
+  std::atomic<uint64_t> gaps{0};
+  std::atomic<uint64_t> latencySumUs{0};
+  std::atomic<uint64_t> latencyCount{0};
+  std::atomic<uint64_t> latencyMaxUs{0};
+
+  // Feeder inputs, under feedMutex.
+  std::mutex feedMutex;
+  std::condition_variable feedWake;
+  std::shared_ptr<juce::AudioFormatReader> reader;
+  std::shared_ptr<const CompiledTimeline> feedTimeline;
+  bool feedPending = false;
+  bool stopping = false;
+
+  // Audio thread only.
+  bool wasActive = false;
+  uint64_t lastSequence = 0;
+  int64_t lastReceivedNs = 0;
+  int64_t pendingReceivedNs = 0;
+  int64_t idleSamples = 0;
+  double lastTargetPosition = 0.0;
+  double position = 0.0;
+  double rate = 1.0;
+  int grainLength = 1920;
+  int hop = 960;
+  int hopCountdown = 0;
+  std::vector<float> window;
+  Grain grainSlots[3];
+
+  std::thread feeder; // last, so everything it uses exists before it starts
 };
 
 class Backend : public juce::HighResolutionTimer {
@@ -737,24 +5434,240 @@ private:
   juce::AudioSourcePlayer player;
   juce::AudioFormatManager formatManager;
   juce::AudioTransportSource transportSource;
-  juce::ResamplingAudioSource resampler{ &transportSource, false, 2 };
+  PolyphaseResamplingSource resampler{ &transportSource };
+  MeteringAudioSource meter;
+  PrerollCacheSource preroll;
+  std::shared_ptr<const PrerollSet> prerollSet;
+  ClipGainSource clipGain;
+  EdlAudioSource edl;
+  PlayRange activeRange; // last range sent to edl, for rangeEnded
+  StripStore strips;
+  ScrubAudioSource scrub;
+  std::shared_ptr<const CompiledTimeline> timeline;
+  bool resumeAfterScrub = false;
+  uint32_t lastMeterVersion = 0;
   bool useResampler { true };
   bool timerIsRunning { false };
+  const bool headless;              // no device: audio is pulled by advanceHeadless()
+  juce::AudioBuffer<float> headlessBuffer;
+  int64_t headlessSamples = 0;      // rendered so far
+  int64_t headlessNextTick = 0;     // sample at which the position timer runs next
   double playbackRate { 1.0 };
   std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+  std::unique_ptr<juce::AudioFormatReaderSource> denoisedSource; // noise-reduced copy of loadedPath
+  std::string denoisedPath;
+  bool denoiseEnabled = true;
+  SourceSwitch sourceSwitch;
+  std::string loadedPath;
+  double loadedSampleRate = 48000.0;
+  std::shared_ptr<const loudness::Analysis> loudnessAnalysis; // for loadedPath
+  bool normalizeEnabled = false;
+  double normalizeTargetLufs = -16.0;
+  double normalizeCeilingDbtp = -1.0;
   std::mutex mutex;
-  std::vector<Clip> clips;
-  std::vector<Segment> segments; // Flattened segments for playback (legacy compatibility)
-  bool isContiguousTimeline = false;
-  bool contiguousInitialized = false;
+  std::shared_ptr<const EdlRevision> edlState = std::make_shared<const EdlRevision>(); // active EDL
+  RevisionCache<EdlRevision> revisionCache;
   int currentRevision = 0;
-  size_t lastWordSegments = 0;
-  size_t lastSpacerSegments = 0;
   // Forward declaration for use in earlier methods
   void endPlayback();
-  void handleStandardTimelinePlayback();
-  void handleContiguousTimelinePlayback();
-  void emitPositionContiguous();
+
+  // Per-clip original ranges for loudness; a single "source" clip when no
+  // EDL has been applied. Requires mutex.
+  std::vector<LoudnessClip> loudnessClips() const { return revisionLoudnessClips(*edlState); }
+
+  int loudnessClipIndex(const Segment& seg) const { return revisionLoudnessClipIndex(*edlState, seg); }
+
+  void startLoudnessAnalysis(const std::string& path, const LoudnessOptions& options, std::vector<LoudnessClip> regions) {
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    gAnalysis.start("loudness", [this, path, factory, options, regions = std::move(regions)](const std::atomic<bool>& cancel) {
+      runLoudnessAnalysis(path, factory, options, regions, cancel,
+                          [this, path](std::shared_ptr<const loudness::Analysis> analysis) { loudnessReady(path, std::move(analysis)); });
+    });
+  }
+
+  void loudnessReady(const std::string& path, std::shared_ptr<const loudness::Analysis> analysis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path != loadedPath) return;
+    loudnessAnalysis = std::move(analysis);
+    publishGainMap();
+  }
+
+  // Resolves the strip settings against the current clips and hands them to
+  // the audio thread; nothing is published until a strip has been set, so the
+  // chain costs nothing by default. Requires mutex.
+  void publishStrips() {
+    if (strips.empty() && !edl.hasStrips()) return;
+    edl.publishStrips(strips.bankFor(edlState->clips));
+  }
+
+  // Rebuilds the per-clip gain map from the current EDL and hands it to the
+  // audio thread. Requires mutex.
+  void publishGainMap() {
+    if (!normalizeEnabled || !loudnessAnalysis) {
+      clipGain.publish(nullptr);
+      return;
+    }
+    const auto regions = loudnessClips();
+    const auto gainsDb = clipNormalisationGains(*loudnessAnalysis, regions, normalizeTargetLufs, normalizeCeilingDbtp);
+    struct Region { int64_t start, end; float gain; };
+    std::vector<Region> spans;
+    for (const auto& seg : edlState->segments) {
+      const int index = loudnessClipIndex(seg);
+      if (index < 0 || (size_t) index >= gainsDb.size()) continue;
+      const double os = seg.hasOriginal() ? seg.originalStart : seg.start;
+      const double oe = seg.hasOriginal() ? seg.originalEnd : seg.end;
+      Region r { (int64_t) std::llround(os * loadedSampleRate), (int64_t) std::llround(oe * loadedSampleRate),
+                 (float) std::pow(10.0, gainsDb[(size_t) index] / 20.0) };
+      if (r.end > r.start) spans.push_back(r);
+    }
+    std::sort(spans.begin(), spans.end(), [](const Region& a, const Region& b) { return a.start < b.start; });
+    auto map = std::make_shared<GainMap>();
+    for (const auto& r : spans) {
+      // Original ranges used twice keep the first clip's gain.
+      const int64_t start = map->ends.empty() ? r.start : std::max(r.start, map->ends.back());
+      if (start >= r.end) continue;
+      if (!map->ends.empty() && map->ends.back() == start && map->gains.back() == r.gain) {
+        map->ends.back() = r.end;
+        continue;
+      }
+      map->starts.push_back(start);
+      map->ends.push_back(r.end);
+      map->gains.push_back(r.gain);
+    }
+    clipGain.publish(std::move(map));
+  }
+
+  // Refills the pre-roll cache for the current EDL in the background: clip
+  // starts first, then word starts in edited order, within the memory budget.
+  // Requires mutex.
+  void startPrerollFill() {
+    if (!readerSource || loadedPath.empty() || !timeline) return;
+    static constexpr double kPrerollSec = 0.15;
+    static constexpr size_t kPrerollBudgetBytes = 32u << 20;
+    std::vector<int64_t> clipStarts;
+    std::vector<int64_t> wordStarts;
+    int lastClip = std::numeric_limits<int>::min();
+    for (const auto& span : timeline->all()) {
+      const int64_t start = (int64_t) std::floor(span.originalStart * loadedSampleRate);
+      if (span.clipIndex != lastClip) clipStarts.push_back(start);
+      else if (span.segmentIndex >= 0 && edlState->segments[(size_t) span.segmentIndex].type == "word") wordStarts.push_back(start);
+      lastClip = span.clipIndex;
+    }
+    clipStarts.insert(clipStarts.end(), wordStarts.begin(), wordStarts.end());
+    const int length = (int) std::lround(kPrerollSec * loadedSampleRate);
+    const std::string path = playbackPath();
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    const int revision = currentRevision;
+    gAnalysis.start("preroll", [this, factory, path, revision, length, starts = std::move(clipStarts)](const std::atomic<bool>& cancel) {
+      auto set = buildPrerollSet(factory, starts, length, kPrerollBudgetBytes, cancel);
+      if (set && !cancel.load()) prerollReady(path, revision, std::move(set), cancel);
+      else if (!cancel.load()) jobs::reportFailure();
+    });
+  }
+
+  // Called on the fill worker.
+  void prerollReady(const std::string& path, int revision, std::shared_ptr<const PrerollSet> set,
+                    const std::atomic<bool>& cancel) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancel.load()) return;
+    if (path != playbackPath() || revision != currentRevision) return;
+    prerollSet = std::move(set);
+    preroll.publish(prerollSet);
+    gMetrics.prerollBytes.store(prerollSet->bytes(), std::memory_order_relaxed);
+    emitPrerollStats();
+  }
+
+  // The file playback, scrubbing, pre-roll and render read from: the
+  // noise-reduced copy when there is one and it is enabled. Requires mutex.
+  std::string playbackPath() const {
+    return denoiseEnabled && denoisedSource ? denoisedPath : loadedPath;
+  }
+
+  // Points playback at playbackPath() without stopping the transport. The
+  // pre-roll cache holds audio from the other file, so it is dropped and
+  // refilled. scrubReader reads playbackPath(); it is opened by the caller
+  // before taking the mutex. Returns the replaced scrub reader, for the
+  // caller to destroy after releasing the mutex. Requires mutex.
+  std::shared_ptr<juce::AudioFormatReader> applyPlaybackSource(std::unique_ptr<juce::AudioFormatReader> scrubReader) {
+    prerollSet.reset();
+    preroll.publish(nullptr);
+    gMetrics.prerollBytes.store(0, std::memory_order_relaxed);
+    sourceSwitch.setInput(denoiseEnabled && denoisedSource ? denoisedSource.get() : readerSource.get());
+    auto previous = scrub.setReader(std::move(scrubReader));
+    startPrerollFill();
+    return previous;
+  }
+
+  // File-system I/O, so never called with the mutex held: the timer and
+  // every transport command take it.
+  std::unique_ptr<juce::AudioFormatReader> openReader(const std::string& path) {
+    return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(juce::File{ juce::String(path) }));
+  }
+
+  // Called on the denoise worker. The readers and source are built before
+  // the mutex is taken, and whatever they replace is destroyed after it is
+  // released; under the mutex they are only swapped in.
+  void denoiseReady(const std::string& path, const std::string& cachePath, const std::atomic<bool>& cancel) {
+    juce::int64 length = 0;
+    double sampleRate = 0.0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (cancel.load() || path != loadedPath || !readerSource) return;
+      length = readerSource->getTotalLength();
+      sampleRate = loadedSampleRate;
+    }
+    std::unique_ptr<juce::AudioFormatReader> reader = openReader(cachePath);
+    if (!reader || reader->lengthInSamples != length || reader->sampleRate != sampleRate) return;
+    auto source = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+    std::unique_ptr<juce::AudioFormatReader> scrubReader = openReader(cachePath);
+    std::unique_ptr<juce::AudioFormatReaderSource> previous;
+    std::shared_ptr<juce::AudioFormatReader> previousScrub;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancel.load() || path != loadedPath || !readerSource) return;
+    previous = std::move(denoisedSource);
+    denoisedSource = std::move(source);
+    denoisedPath = cachePath;
+    // While disabled, playback stays on the original and nothing changes.
+    if (denoiseEnabled) previousScrub = applyPlaybackSource(std::move(scrubReader));
+    emitDenoiseState();
+  }
+
+  // Requires mutex.
+  void refreshDeviceXruns() {
+    auto* device = deviceManager.getCurrentAudioDevice();
+    gMetrics.deviceXruns.store(device ? device->getXRunCount() : -1, std::memory_order_relaxed);
+  }
+
+  void emitDenoiseState() {
+    emit(std::string("{\"type\":\"denoiseState\",\"id\":\"") + g.id + "\",\"enabled\":" +
+         (denoiseEnabled ? "true" : "false") + ",\"active\":" + (denoiseEnabled && denoisedSource ? "true" : "false") + "}");
+  }
+
+  void emitPrerollStats() {
+    const uint64_t hits = preroll.hitCount();
+    const uint64_t misses = preroll.missCount();
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(3);
+    evt << "{\"type\":\"prerollStats\",\"id\":\"" << g.id << "\""
+        << ",\"revision\":" << currentRevision
+        << ",\"requested\":" << (prerollSet ? prerollSet->requestedStarts : 0)
+        << ",\"cached\":" << (prerollSet ? prerollSet->cachedStarts : 0)
+        << ",\"regions\":" << (prerollSet ? prerollSet->regions.size() : 0)
+        << ",\"bytes\":" << (prerollSet ? prerollSet->bytes() : 0)
+        << ",\"fillMs\":" << (prerollSet ? prerollSet->fillMs : 0.0)
+        << ",\"hits\":" << hits << ",\"misses\":" << misses
+        << ",\"hitRate\":" << (hits + misses ? (double) hits / (double) (hits + misses) : 0.0) << "}";
+    emit(evt.str());
+  }
+
+  bool setRangeLocked(double startSec, double endSec, bool loop, double crossfadeSec, bool seekToStart) {
+    PlayRange range;
+    if (!makePlayRange(revisionDuration(*edlState), startSec, endSec, loop, crossfadeSec, seekToStart, range)) return false;
+    activeRange = range;
+    edl.setRange(range);
+    return true;
+  }
 
   juce::AudioSource& transportOrResampler() {
     if (useResampler) return resampler; else return transportSource;
@@ -762,84 +5675,95 @@ private:
 
   static void emitState() { ::emitState(); }
   static void emitLoaded(double sampleRate = 48000.0, int channels = 2) { ::emitLoaded(sampleRate, channels); }
-  void emitPositionFromTransport() {
-    const double es = sanitizeTime(g.editedSec.load());
-    const double os = sanitizeTime(editedToOriginal(es));
-    emit(std::string("{") +
-         "\"type\":\"position\",\"id\":\"" + g.id + "\",\"editedSec\":" + std::to_string(es) +
-          ",\"originalSec\":" + std::to_string(os) + "}");
-  }
-
-  // EDL mapping helpers
-  int segmentFor(double orig) const {
-    const double pos = sanitizeTime(orig);
-    for (size_t i = 0; i < segments.size(); ++i) {
-      const auto& s = segments[i];
-      const double os = s.hasOriginal() ? sanitizeTime(s.originalStart, s.start) : sanitizeTime(s.start);
-      const double oe = s.hasOriginal() ? sanitizeTime(s.originalEnd, s.end) : sanitizeTime(s.end);
-      const double span = sanitizeDuration(oe - os);
-      if (span <= 0.0) continue;
-      if (pos >= os && pos < (os + span)) return (int)i;
-    }
-    return -1;
-  }
-  double originalToEdited(double orig) const {
-    if (segments.empty()) return sanitizeTime(orig);
-    const double pos = sanitizeTime(orig);
-    double accEdited = 0.0;
-    for (const auto& s : segments) {
-      const double os = s.hasOriginal() ? sanitizeTime(s.originalStart, s.start) : sanitizeTime(s.start);
-      const double oe = s.hasOriginal() ? sanitizeTime(s.originalEnd, s.end) : sanitizeTime(s.end);
-      const double odur = sanitizeDuration(oe - os);
-      const double edur = sanitizeDuration(s.dur);
-      if (odur <= 0.0 || edur <= 0.0) {
-        continue;
-      }
-      if (pos < os) return accEdited;
-      if (pos < os + odur) {
-        const double r = std::clamp((pos - os) / odur, 0.0, 1.0);
-        return accEdited + r * edur;
-      }
-      accEdited += edur;
-    }
-    return accEdited;
-  }
-  double editedToOriginal(double ed) const {
-    if (segments.empty()) return sanitizeTime(ed);
-    const double target = sanitizeTime(ed);
-    double accEdited = 0.0;
-    for (const auto& s : segments) {
-      const double os = s.hasOriginal() ? sanitizeTime(s.originalStart, s.start) : sanitizeTime(s.start);
-      const double oe = s.hasOriginal() ? sanitizeTime(s.originalEnd, s.end) : sanitizeTime(s.end);
-      const double odur = sanitizeDuration(oe - os);
-      const double edur = sanitizeDuration(s.dur);
-      if (odur <= 0.0 || edur <= 0.0) {
-        continue;
-      }
-      if (target <= accEdited + edur) {
-        const double r = std::clamp((target - accEdited) / edur, 0.0, 1.0);
-        return os + r * odur;
-      }
-      accEdited += edur;
-    }
-    const auto& last = segments.back();
-    return last.hasOriginal() ? sanitizeTime(last.originalEnd, last.end) : sanitizeTime(last.end);
+  void emitPositionFromTransport() { emitPositionFor(*edlState); }
+
+  double editedToOriginal(double ed) const { return revisionEditedToOriginal(*edlState, ed); }
+
+  // An EDL change on an open file. While playing, EdlAudioSource carries the
+  // playhead across at its next block; otherwise it is remapped here, so the
+  // next position report and play() agree with it. Requires mutex.
+  void swapRevision(std::shared_ptr<const EdlRevision> rev) {
+    const auto before = timeline;
+    activateRevision(std::move(rev));
+    if (g.playing || scrub.isActive() || !before) return;
+    const double sec = timeline->remapEdited(*before, edl.getEditedSeconds());
+    transportSource.setPosition(sec);
+    g.editedSec = sec;
+  }
+
+  // Makes rev the active EDL and hands everything derived from it to the
+  // audio-thread consumers. Requires mutex.
+  void activateRevision(std::shared_ptr<const EdlRevision> rev) {
+    edlState = std::move(rev);
+    timeline = edlState->timeline;
+    edl.setTotalLengthSeconds(timeline->editedDuration());
+    edl.publishTimeline(timeline);
+    scrub.publishTimeline(timeline);
+    publishGainMap();
+    publishStrips();
+    startPrerollFill();
+    gMetrics.edlBytes.store(edlState->byteSize, std::memory_order_relaxed);
+    gMetrics.revisionCacheBytes.store(revisionCache.stats().bytes, std::memory_order_relaxed);
+  }
+
+  // Headless runs tick the timer from advanceHeadless() instead, in step
+  // with the audio they render.
+  void startPositionTimer() {
+    if (timerIsRunning) return;
+    timerIsRunning = true;
+    if (headless) headlessNextTick = headlessSamples + kHeadlessTickSamples;
+    else startTimer(33);
   }
 
 public:
-  Backend() {
+  static constexpr double kHeadlessRate = 48000.0;
+  static constexpr int kHeadlessBlock = 512;
+  static constexpr int64_t kHeadlessTickSamples = 1584; // 33 ms
+
+  explicit Backend(bool headlessMode = false) : headless(headlessMode) {
     formatManager.registerBasicFormats();
-    deviceManager.initialise(0, 2, nullptr, true);
-    player.setSource(&transportOrResampler());
-    deviceManager.addAudioCallback(&player);
+    if (!headless) deviceManager.initialise(0, 2, nullptr, true);
+    scrub.setInput(&transportOrResampler());
+    meter.setInput(&scrub);
+    if (headless) {
+      headlessBuffer.setSize(2, kHeadlessBlock);
+      meter.prepareToPlay(kHeadlessBlock, kHeadlessRate);
+    } else {
+      player.setSource(&meter);
+      deviceManager.addAudioCallback(&player);
+    }
   }
   ~Backend() override {
     stopTimer();
-    player.setSource(nullptr);
-    deviceManager.removeAudioCallback(&player);
+    if (headless) {
+      meter.releaseResources();
+    } else {
+      player.setSource(nullptr);
+      deviceManager.removeAudioCallback(&player);
+    }
     transportSource.setSource(nullptr);
   }
 
+  // Headless only: renders the output up to toSec of virtual time, feeding
+  // every block to hash, and runs the position timer every 33 ms of rendered
+  // audio as the device clock would. Command thread.
+  void advanceHeadless(double toSec, AudioHash& hash) {
+    if (!headless) return;
+    const int64_t target = (int64_t) std::llround(toSec * kHeadlessRate);
+    while (headlessSamples < target) {
+      const int n = (int) std::min<int64_t>(kHeadlessBlock, target - headlessSamples);
+      const juce::AudioSourceChannelInfo info(&headlessBuffer, 0, n);
+      info.clearActiveBufferRegion();
+      meter.getNextAudioBlock(info);
+      for (int ch = 0; ch < headlessBuffer.getNumChannels(); ++ch) hash.add(headlessBuffer.getReadPointer(ch), (size_t) n);
+      headlessSamples += n;
+      while (timerIsRunning && headlessSamples >= headlessNextTick) {
+        hiResTimerCallback();
+        headlessNextTick += kHeadlessTickSamples;
+      }
+    }
+  }
+
   void load(const std::string& id, const std::string& path) {
     std::lock_guard<std::mutex> lock(mutex);
     g.id = id;
@@ -868,26 +5792,46 @@ public:
     const double duration = (reader->lengthInSamples > 0 && sr > 0.0)
       ? (double) reader->lengthInSamples / sr : 0.0;
     juceDLog("[JUCE] Audio info: " + std::to_string(sr) + "Hz, " + std::to_string(duration) + "s");
+    transportSource.setSource(nullptr);
+    clipGain.setInput(nullptr);
+    sourceSwitch.setInput(nullptr);
+    denoisedSource.reset();
+    denoisedPath.clear();
     readerSource.reset(new juce::AudioFormatReaderSource(reader, true));
-    transportSource.setSource(readerSource.get(), 0, nullptr, sr);
+    loadedPath = path;
+    loadedSampleRate = sr;
+    loudnessAnalysis.reset();
+    clipGain.publish(nullptr);
+    prerollSet.reset();
+    preroll.publish(nullptr);
+    gMetrics.prerollBytes.store(0, std::memory_order_relaxed);
+    sourceSwitch.setInput(readerSource.get());
+    preroll.setInput(&sourceSwitch);
+    clipGain.setInput(&preroll);
+    edl.setInput(&clipGain);
+    edl.setSourceSampleRate(sr);
+    activeRange = PlayRange();
+    edl.setRange(activeRange);
+    // The transport runs at the file's rate; resampler is the only
+    // conversion to the device rate.
+    resampler.setSourceSampleRate(sr);
+    transportSource.setSource(&edl);
     juceDLog("[JUCE] Transport source configured successfully");
     g.durationSec = sanitizeTime(duration);
     playbackRate = 1.0;
-    resampler.setResamplingRatio(1.0);
-    // Default EDL: single full-file segment
-    segments.clear();
-    if (duration > 0.0) {
-      Segment fullSegment;
-      fullSegment.type = "speech";
-      fullSegment.start = 0.0;
-      fullSegment.end = duration;
-      fullSegment.dur = duration;
-      segments.push_back(fullSegment);
-    }
+    resampler.setPlaybackRate(1.0);
+    // Default EDL: single full-file segment. Cached revisions may carry a
+    // fallback segment sized for the previous file, so they go too.
+    auto rev = fullFileRevision(duration);
+    revisionCache.clear();
+    activateRevision(rev);
+    scrub.end();
+    scrub.setReader(std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file)));
     g.editedSec = 0.0;
     g.playing = false;
     emitLoaded(sr, reader->numChannels);
     emitState();
+    gFingerprints.prefetch(path);
   }
 
   void play() {
@@ -903,11 +5847,11 @@ public:
     transportSource.start();
     g.playing = true;
     emitState();
-    if (!timerIsRunning) { startTimer(33); timerIsRunning = true; }
-    juceDLog(std::string("[JUCE] Playback mode: ") + (isContiguousTimeline ? "contiguous" : "standard") +
+    startPositionTimer();
+    juceDLog(std::string("[JUCE] Playback mode: ") + (edlState->contiguous ? "contiguous" : "standard") +
              " timeline, revision=" + std::to_string(currentRevision) +
-             ", words=" + std::to_string(lastWordSegments) +
-             ", spacers=" + std::to_string(lastSpacerSegments));
+             ", words=" + std::to_string(edlState->wordSegments) +
+             ", spacers=" + std::to_string(edlState->spacerSegments));
   }
 
   void pause() {
@@ -942,6 +5886,11 @@ public:
   }
 
   void seek(double editedSec) {
+    // While scrubbing, seeks are scrub targets: no mutex, latest one wins.
+    if (scrub.isActive()) {
+      scrubTo(editedSec);
+      return;
+    }
     std::lock_guard<std::mutex> lock(mutex);
 
     if (!readerSource) {
@@ -952,18 +5901,170 @@ public:
 
     const double orig = editedToOriginal(editedSec);
     juceDLog(std::string("[JUCE] seek edited=") + std::to_string(editedSec) + " -> original=" + std::to_string(orig));
-    transportSource.setPosition(orig);
+    transportSource.setPosition(editedSec); // the EDL source works in edited time
     g.editedSec = editedSec;
     emitPositionFromTransport();
   }
 
+  // Transcript search over the current timeline.
+  void findText(const std::string& query, bool prefix, double fromSec, double toSec, size_t maxResults) {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitFindTextResult(*edlState, query, prefix, fromSec, toSec, maxResults);
+  }
+
+  void getWordsInRange(double startSec, double endSec, size_t maxResults) {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitWordsInRange(*edlState, startSec, endSec, maxResults);
+  }
+
+  // Seeks to the start of a word: by flattened segment index, or by the
+  // occurrence-th match of text at or after fromSec.
+  void seekToWord(int segmentIndex, const std::string& text, size_t occurrence, double fromSec) {
+    double target = -1.0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      target = wordStartSec(*edlState, segmentIndex, text, occurrence, fromSec);
+    }
+    if (target < 0.0) {
+      emit("{\"type\":\"error\",\"message\":\"Word not found\"}");
+      return;
+    }
+    seek(target);
+  }
+
+  // Spectrogram tiles for an edited range, mapped through the current EDL.
+  // Tiles show the original file, not the noise-reduced copy.
+  void getSpectrogramTiles(double startSec, double endSec, int level, int maxColumns) {
+    std::string path;
+    std::vector<TimelineSpan> spans;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
+      }
+      path = loadedPath;
+      spans = editedRangeSpans(*edlState, startSec, endSec);
+    }
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    gAnalysis.start("spectrogram", [=](const std::atomic<bool>& cancel) {
+      runSpectrogramTiles(path, factory, spans, startSec, endSec, level, maxColumns, cancel);
+    });
+  }
+
+  void computeSpectrogram(int minLevel) {
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
+      }
+      path = loadedPath;
+    }
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    gAnalysis.start("spectrogramFill", [path, factory, minLevel](const std::atomic<bool>& cancel) {
+      runSpectrogramFill(path, factory, minLevel, cancel);
+    });
+  }
+
+  // Plays [startSec, endSec) of the edited timeline once (or looped) and stops
+  // at the end sample in the audio callback.
+  void playRange(double startSec, double endSec, bool loop, double crossfadeSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!readerSource) {
+      emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+      return;
+    }
+    if (!setRangeLocked(startSec, endSec, loop, crossfadeSec, true)) return;
+    g.editedSec = activeRange.startSec;
+    transportSource.start();
+    g.playing = true;
+    emitState();
+    startPositionTimer();
+  }
+
+  // Loops [startSec, endSec) without moving the playhead; enabled=false
+  // clears any loop or range.
+  void setLoop(bool enabled, double startSec, double endSec, double crossfadeSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled) {
+      activeRange = PlayRange();
+      edl.setRange(activeRange);
+      return;
+    }
+    setRangeLocked(startSec, endSec, true, crossfadeSec, false);
+  }
+
+  // Enters scrub mode: the transport pauses and the audio thread plays grains
+  // at the targets sent with scrub (or seek) until scrubEnd.
+  void scrubStart(bool followVelocity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!readerSource) {
+      emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+      return;
+    }
+    if (scrub.isActive()) return;
+    resumeAfterScrub = g.playing.load();
+    transportSource.stop();
+    g.playing = false;
+    if (auto* device = deviceManager.getCurrentAudioDevice()) {
+      scrub.setOutputLatencySamples(device->getOutputLatencyInSamples());
+    }
+    scrub.begin(followVelocity);
+    scrub.submit(g.editedSec.load());
+    emitState();
+  }
+
+  // Command thread hot path: wait-free, never takes the mutex.
+  void scrubTo(double editedSec) {
+    if (!scrub.isActive()) return;
+    const double safe = sanitizeTime(editedSec);
+    scrub.submit(safe);
+    g.editedSec = safe;
+  }
+
+  // Leaves scrub mode at the last target (or timeSec when given) and resumes
+  // playback if it was running when scrubbing started.
+  void scrubEnd(double editedSec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!scrub.isActive()) return;
+    scrub.end();
+    const double finalSec = sanitizeTime(std::isfinite(editedSec) ? editedSec : scrub.lastTargetEditedSec());
+    transportSource.setPosition(finalSec);
+    g.editedSec = finalSec;
+    if (resumeAfterScrub) {
+      transportSource.start();
+      g.playing = true;
+      startPositionTimer();
+    }
+    resumeAfterScrub = false;
+
+    const ScrubStats stats = scrub.stats();
+    std::ostringstream evt;
+    evt.setf(std::ios::fixed);
+    evt << std::setprecision(2);
+    evt << "{\"type\":\"scrubStats\",\"id\":\"" << g.id << "\""
+        << ",\"targets\":" << stats.submitted
+        << ",\"consumed\":" << stats.consumed
+        << ",\"dropped\":" << (stats.submitted - std::min(stats.submitted, stats.consumed))
+        << ",\"grains\":" << stats.grains
+        << ",\"gaps\":" << stats.gaps
+        << ",\"latencyAvgMs\":" << stats.latencyAvgMs
+        << ",\"latencyMaxMs\":" << stats.latencyMaxMs
+        << ",\"outputLatencyMs\":" << stats.outputLatencyMs << "}";
+    emit(evt.str());
+    emitState();
+    emitPositionFromTransport();
+  }
+
   void setRate(double rate) {
     std::lock_guard<std::mutex> lock(mutex);
     double safeRate = std::isfinite(rate) ? rate : 1.0;
     if (safeRate <= 0.0) safeRate = 1.0;
     safeRate = std::clamp(safeRate, 0.25, 4.0);
     playbackRate = safeRate;
-    resampler.setResamplingRatio(safeRate);
+    resampler.setPlaybackRate(safeRate);
   }
 
   void setVolume(double gain) {
@@ -973,222 +6074,373 @@ public:
     transportSource.setGain((float) safeGain);
   }
 
-  void queryState() {
-    std::lock_guard<std::mutex> lock(mutex);
-    emitState();
-    emitPositionFromTransport();
+  void setMeterRate(double hz) {
+    const double safeHz = std::isfinite(hz) ? hz : 0.0;
+    meter.setPublishRateHz(safeHz);
+    juceDLog("[JUCE] meter publish rate set to " + std::to_string(meter.getPublishRateHz()) + " Hz");
   }
 
-  void updateEdl(std::vector<Clip> newClips, int revision) {
-    std::lock_guard<std::mutex> lock(mutex);
-    clips = std::move(newClips);
-    currentRevision = revision;
+  // Scans the loaded file for silence on worker threads. With refineSpacers the
+  // spacer segments of the current EDL are matched against the result.
+  void analyzeSilence(const SilenceParams& params, bool refineSpacers, double maxShiftSec) {
+    std::vector<SpacerSpan> spacers;
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
+      }
+      path = loadedPath;
+      if (refineSpacers) spacers = revisionSpacers(*edlState);
+    }
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    gAnalysis.start("silence", [path, factory, params, spacers = std::move(spacers), maxShiftSec](const std::atomic<bool>& cancel) {
+      runSilenceAnalysis(path, factory, params, spacers, maxShiftSec, cancel);
+    });
+  }
 
-    // Count total segments across all clips
-    size_t totalSegments = 0;
-    size_t spacerSegments = 0;
-    size_t wordSegments = 0;
-    for (const auto& clip : clips) {
-      totalSegments += clip.segments.size();
-      for (const auto& segment : clip.segments) {
-        if (segment.type == "spacer") spacerSegments++;
-        else wordSegments++;
+  // Loudness for the whole file plus each EDL clip and speaker. With no EDL
+  // loaded the whole file counts as a single clip.
+  void analyzeLoudness(const LoudnessOptions& options) {
+    std::string path;
+    std::vector<LoudnessClip> regions;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
+      path = loadedPath;
+      regions = loudnessClips();
     }
-    lastWordSegments = wordSegments;
-    lastSpacerSegments = spacerSegments;
+    startLoudnessAnalysis(path, options, std::move(regions));
+  }
 
+  void setLoudnessNormalization(bool enabled, double targetLufs, double ceilingDbtp) {
+    std::string path;
+    std::vector<LoudnessClip> regions;
     {
-      std::ostringstream oss;
-      oss << "[JUCE] Parsed EDL revision " << revision
-          << ": clips=" << clips.size()
-          << ", words=" << wordSegments
-          << ", spacers=" << spacerSegments
-          << ", total=" << totalSegments
-          << ", mode=" << (isContiguousTimeline ? "contiguous" : "standard");
-      juceDLog(oss.str());
+      std::lock_guard<std::mutex> lock(mutex);
+      normalizeEnabled = enabled;
+      normalizeTargetLufs = targetLufs;
+      normalizeCeilingDbtp = ceilingDbtp;
+      juceDLog(std::string("[JUCE] loudness normalisation ") + (enabled ? "on" : "off") +
+               ", target=" + std::to_string(targetLufs) + " LUFS");
+      publishGainMap();
+      if (!enabled || loudnessAnalysis || !readerSource) return;
+      path = loadedPath;
+      regions = loudnessClips();
     }
+    // No analysis yet: run one; the gain map follows when it completes.
+    LoudnessOptions options;
+    options.targetLufs = targetLufs;
+    options.ceilingDbtp = ceilingDbtp;
+    startLoudnessAnalysis(path, options, std::move(regions));
+  }
 
-    // Enhanced debug logging - write to file to see what JUCE receives
-    std::ofstream debugFile(juceDebugPath(), std::ios::app);
-    debugFile << "[JUCE] updateEdl received revision " << revision
-              << " with " << clips.size() << " clips containing "
-              << totalSegments << " segments (" << wordSegments << " words / "
-              << spacerSegments << " spacers) at " << std::time(nullptr) << std::endl;
-    // Log clip and segment details
-    debugFile << "[JUCE] Clip details:" << std::endl;
-    for (size_t c = 0; c < clips.size(); c++) {
-      const auto& clip = clips[c];
-      debugFile << "  [JUCE] Clip[" << c << "]: id=" << clip.id
-                << ", " << clip.segments.size() << " segments ("
-                << std::fixed << std::setprecision(2) << clip.duration() << "s)" << std::endl;
-
-      // Log first few segments of each clip
-      for (size_t s = 0; s < std::min(clip.segments.size(), size_t(5)); s++) {
-        const auto& segment = clip.segments[s];
-        debugFile << "    [JUCE] Segment[" << s << "]: "
-                  << segment.type << " " << segment.start << "-" << segment.end << "s";
-        if (segment.type == "word" && !segment.text.empty()) {
-          debugFile << " \"" << segment.text << "\"";
-        }
-        debugFile << std::endl;
+  // Offline render of the edited timeline to a WAV file.
+  void renderEdited(const std::string& outputPath, bool normalize, const LoudnessOptions& options, int bitsPerSample) {
+    RenderJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
-      if (clip.segments.size() > 5) {
-        debugFile << "    [JUCE] ... (" << (clip.segments.size() - 5) << " more segments)" << std::endl;
+      job.sourcePath = playbackPath();
+      job.clips = loudnessClips();
+      if (!strips.empty()) job.strips = strips.bankFor(job.clips);
+      job.pieces = revisionRenderPieces(*edlState, loadedSampleRate);
+    }
+    job.outputPath = outputPath;
+    job.normalize = normalize;
+    job.targetLufs = options.targetLufs;
+    job.ceilingDbtp = options.ceilingDbtp;
+    job.bitsPerSample = bitsPerSample;
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(job.sourcePath);
+    gAnalysis.start("render", [job = std::move(job), factory](const std::atomic<bool>& cancel) {
+      runRender(job, factory, cancel);
+    });
+  }
+
+  // Stems per speaker (stems) or one file per clip of the current EDL,
+  // written into directory in a single pass over the source.
+  void exportAudio(bool stems, const std::string& directory, bool normalize, const LoudnessOptions& options, int bitsPerSample) {
+    if (directory.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"Export directory required\"}");
+      return;
+    }
+    ExportJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
+      job = exportJobFor(*edlState, loadedSampleRate, stems, directory);
+      job.render.sourcePath = playbackPath();
+      if (!strips.empty()) job.render.strips = strips.bankFor(job.render.clips);
     }
-    debugFile.flush();
+    job.render.normalize = normalize;
+    job.render.targetLufs = options.targetLufs;
+    job.render.ceilingDbtp = options.ceilingDbtp;
+    job.render.bitsPerSample = bitsPerSample;
+    job.threads = options.threads;
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(job.render.sourcePath);
+    gAnalysis.start(stems ? "exportStems" : "exportClips", [job = std::move(job), factory](const std::atomic<bool>& cancel) {
+      runExport(job, factory, cancel);
+    });
+  }
 
-    // Detect contiguous timeline by checking if clips are perfectly aligned
-    isContiguousTimeline = false;
-    if (clips.size() > 1) {
-      int consecutiveMatches = 0;
-      for (size_t i = 1; i < clips.size() && i < 5; i++) {
-        double gap = clips[i].startSec - clips[i-1].endSec;
-        if (std::abs(gap) < 0.01) { // 10ms tolerance
-          consecutiveMatches++;
-        }
+  // Artifacts of the loaded file (not a denoised copy) and the current
+  // timeline, into the project sidecar at path.
+  void saveSidecar(const std::string& path, const SilenceParams& silence) {
+    if (path.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"Sidecar path required\"}");
+      return;
+    }
+    SidecarJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
+      job.sourcePath = loadedPath;
+      job.timeline = edlState->timeline;
+    }
+    job.path = path;
+    job.factory = JuceSampleReader::factoryFor(job.sourcePath);
+    job.silence = silence;
+    gAnalysis.start("sidecar", [job = std::move(job)](const std::atomic<bool>& cancel) { runSaveSidecar(job, cancel); });
+  }
 
-      if (consecutiveMatches >= 2) {
-        isContiguousTimeline = true;
-        debugFile << "[JUCE] CONTIGUOUS TIMELINE DETECTED for revision " << revision << std::endl;
-      } else {
-        debugFile << "[JUCE] Standard timeline (gap matches: " << consecutiveMatches << ") for revision " << revision << std::endl;
+  // Snaps the current EDL's cut points; with apply, the result becomes
+  // revision.
+  void refineCuts(const CutRefineParams& params, bool apply, int revision) {
+    RefineCutsJob job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
+      job.sourcePath = loadedPath;
+      job.rev = edlState;
     }
+    job.factory = JuceSampleReader::factoryFor(job.sourcePath);
+    job.params = params;
+    job.apply = apply;
+    job.revision = revision;
+    gAnalysis.start("refineCuts", [this, job = std::move(job)](const std::atomic<bool>& cancel) {
+      runRefineCuts(job, [this, base = job.rev](std::vector<Clip> clips, int revision) {
+        return updateEdlFrom(base, std::move(clips), revision);
+      }, cancel);
+    });
+  }
 
-    // Reset initialization for contiguous timeline
-    if (isContiguousTimeline) {
-      contiguousInitialized = false;
+  void openSidecar(const std::string& path) {
+    std::string source;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      source = loadedPath;
     }
+    openProjectSidecar(path, source);
+  }
 
-    // Create flattened segments array for playback
-    segments.clear();
-    for (const auto& clip : clips) {
-      const double clipTimelineStart = sanitizeTime(clip.startSec);
-      const double clipTimelineEnd = sanitizeTime(clip.endSec, clipTimelineStart);
-      const double clipTimelineDur = sanitizeDuration(clipTimelineEnd - clipTimelineStart);
-      if (clipTimelineDur <= 0.0) {
-        debugFile << "[JUCE] Skipping clip with invalid duration: " << clip.id << std::endl;
-        continue;
+  // Learns a noise profile from the EDL's spacers (or the quietest part of
+  // the file) and builds the noise-reduced copy on worker threads. Playback
+  // switches to it when it is ready.
+  void denoise(const DenoiseParams& params) {
+    std::string path;
+    std::vector<std::pair<double, double>> noise;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!readerSource || loadedPath.empty()) {
+        emit("{\"type\":\"error\",\"message\":\"No audio loaded\"}");
+        return;
       }
+      path = loadedPath;
+      for (const auto& seg : edlState->segments) {
+        if (seg.type != "spacer") continue;
+        noise.emplace_back(seg.hasOriginal() ? seg.originalStart : seg.start, seg.hasOriginal() ? seg.originalEnd : seg.end);
+      }
+    }
+    const SampleReaderFactory factory = JuceSampleReader::factoryFor(path);
+    gAnalysis.start("denoise", [this, path, factory, params, noise = std::move(noise)](const std::atomic<bool>& cancel) {
+      runDenoise(path, factory, noise, params, cancel,
+                 [this, &path, &cancel](const std::string& cachePath) { denoiseReady(path, cachePath, cancel); });
+    });
+  }
 
-      const bool clipHasOriginal = clip.hasOriginal();
-      const double clipOriginalStart = clipHasOriginal ? sanitizeTime(clip.originalStartSec, clipTimelineStart) : 0.0;
-      const double clipOriginalEnd = clipHasOriginal ? sanitizeTime(clip.originalEndSec, clipOriginalStart) : 0.0;
-      const double clipOriginalDur = clipHasOriginal ? sanitizeDuration(clipOriginalEnd - clipOriginalStart) : 0.0;
-
-      for (const auto& seg : clip.segments) {
-        const double segDur = sanitizeDuration(seg.dur);
-        if (segDur <= 0.0) {
-          continue;
-        }
-
-        Segment flatSeg;
-        flatSeg.type = seg.type;
-        flatSeg.text = seg.text;
-
-        const double segStartTimeline = sanitizeTime(clipTimelineStart + seg.start, clipTimelineStart);
-        const double segEndTimeline = sanitizeTime(segStartTimeline + segDur, segStartTimeline + segDur);
-        const double segTimelineDur = sanitizeDuration(segEndTimeline - segStartTimeline);
-        if (segTimelineDur <= 0.0) {
-          continue;
-        }
-
-        flatSeg.start = segStartTimeline;
-        flatSeg.end = segStartTimeline + segTimelineDur;
-        flatSeg.dur = segTimelineDur;
-
-        if (seg.hasOriginal()) {
-          const double segOrigStart = sanitizeTime(seg.originalStart, segStartTimeline);
-          const double segOrigEnd = sanitizeTime(seg.originalEnd, segOrigStart);
-          const double segOrigDur = sanitizeDuration(segOrigEnd - segOrigStart);
-          if (segOrigDur > 0.0) {
-            flatSeg.originalStart = segOrigStart;
-            flatSeg.originalEnd = segOrigStart + segOrigDur;
-          } else {
-            flatSeg.originalStart = segStartTimeline;
-            flatSeg.originalEnd = segEndTimeline;
-          }
-        } else if (clipHasOriginal && clipOriginalDur > 0.0) {
-          const double ratio = std::min(1.0, std::max(0.0, seg.start / clipTimelineDur));
-          const double mappedStart = clipOriginalStart + ratio * clipOriginalDur;
-          flatSeg.originalStart = sanitizeTime(mappedStart, clipOriginalStart);
-          flatSeg.originalEnd = sanitizeTime(flatSeg.originalStart + segTimelineDur, flatSeg.originalStart + segTimelineDur);
-        } else {
-          flatSeg.originalStart = segStartTimeline;
-          flatSeg.originalEnd = segEndTimeline;
+  void setDenoise(bool enabled) {
+    // The scrub reader for the new file is opened without the mutex; if the
+    // files changed meanwhile, it is opened again.
+    std::unique_ptr<juce::AudioFormatReader> scrubReader;
+    std::shared_ptr<juce::AudioFormatReader> previousScrub;
+    std::string opened;
+    bool attempted = false;
+    for (;;) {
+      std::string target;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (enabled == denoiseEnabled || !denoisedSource) {
+          denoiseEnabled = enabled;
+          emitDenoiseState();
+          return;
         }
-
-        if (sanitizeDuration(flatSeg.originalEnd - flatSeg.originalStart) <= 0.0) {
-          flatSeg.originalStart = segStartTimeline;
-          flatSeg.originalEnd = segEndTimeline;
+        target = enabled ? denoisedPath : loadedPath;
+        if (attempted && opened == target) {
+          denoiseEnabled = enabled;
+          previousScrub = applyPlaybackSource(std::move(scrubReader));
+          emitDenoiseState();
+          return;
         }
-
-        segments.push_back(flatSeg);
       }
+      scrubReader = openReader(target);
+      opened = target;
+      attempted = true;
     }
+  }
 
-    if (!segments.empty()) {
-      std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
-        if (a.start == b.start) return a.end < b.end;
-        return a.start < b.start;
-      });
+  void setStrip(const std::string& scope, const std::string& target, const StripSettings& settings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!strips.set(scope, target, settings)) {
+      emit("{\"type\":\"error\",\"message\":\"setStrip scope must be speaker or clip\"}");
+      return;
     }
+    juceDLog("[JUCE] strip set: " + scope + " '" + target + "'");
+    publishStrips();
+  }
+
+  void clearStrips() {
+    std::lock_guard<std::mutex> lock(mutex);
+    strips.clear();
+    publishStrips(); // neutral bank, so active processing ramps out
+  }
+
+  void getPrerollStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitPrerollStats();
+  }
 
-    debugFile << "[JUCE] Created " << segments.size() << " flattened segments for playback" << std::endl;
+  void queryState() {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitState();
+    emitPositionFromTransport();
+  }
 
-    // Safety check: Verify we have segments before enabling contiguous mode
-    if (isContiguousTimeline && segments.empty()) {
-      debugFile << "[JUCE] WARNING: Contiguous timeline detected but no segments received" << std::endl;
-      debugFile << "[JUCE] Falling back to standard timeline mode" << std::endl;
-      isContiguousTimeline = false;
+  // key identifies the payload for the revision cache.
+  void updateEdl(std::vector<Clip> newClips, int revision, const EdlContentKey& key = {}) {
+    // Compiled before taking the lock, so the control lane never waits on it.
+    auto next = buildRevision(std::move(newClips), revision);
+    std::lock_guard<std::mutex> lock(mutex);
+    currentRevision = revision;
+    revisionCache.insert(revision, key, next, next->byteSize);
+    swapRevision(next);
+    emitRevisionApplied(*next, revision, false);
+  }
 
-      // Create a default full-file segment to prevent playback failure
-      if (g.durationSec > 0) {
-        Segment fullSegment;
-        fullSegment.type = "speech";
-        fullSegment.start = 0.0;
-        fullSegment.end = g.durationSec;
-        fullSegment.dur = g.durationSec;
-        fullSegment.originalStart = 0.0;
-        fullSegment.originalEnd = g.durationSec;
-        segments.push_back(fullSegment);
-        debugFile << "[JUCE] Created fallback full-file segment: 0.0-" << g.durationSec << "s" << std::endl;
-      }
+  // updateEdl, unless the EDL is no longer base (an edit arrived meanwhile).
+  bool updateEdlFrom(const std::shared_ptr<const EdlRevision>& base, std::vector<Clip> newClips, int revision) {
+    auto next = buildRevision(std::move(newClips), revision);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (edlState != base) return false;
+    currentRevision = revision;
+    swapRevision(next);
+    emitRevisionApplied(*next, revision, false);
+    return true;
+  }
+
+  // Re-activates a cached compile of an identical payload (typically undo or
+  // redo resending an earlier EDL) without parsing it. Returns false on a
+  // miss; the caller then parses and calls updateEdl.
+  bool applyCachedEdl(const EdlContentKey& key, int revision) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!key.valid()) return false;
+    auto rev = revisionCache.findContent(key);
+    if (!rev) return false;
+    revisionCache.addRevision(revision, key);
+    currentRevision = revision;
+    swapRevision(std::move(rev));
+    emitRevisionApplied(*edlState, revision, true);
+    return true;
+  }
+
+  // Switches back to a revision by number alone. A revision that is no
+  // longer cached reports an edlApplied error so the client resends it.
+  void activateCachedRevision(int revision) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto rev = revisionCache.findRevision(revision);
+    if (!rev) {
+      emitEdlAppliedEvent(revision, 0, 0, 0, "", "error", "Revision not cached");
+      return;
     }
+    currentRevision = revision;
+    swapRevision(std::move(rev));
+    emitRevisionApplied(*edlState, revision, true);
+  }
 
-    const std::string mode = isContiguousTimeline ? "contiguous" : "standard";
+  void getMetrics(bool reset) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      refreshDeviceXruns();
+    }
+    emitMetrics();
+    if (reset) gMetrics.reset();
+  }
 
-    debugFile << "[JUCE] updateEdl segment breakdown complete for revision " << revision
-              << ", mode=" << mode << std::endl;
-    debugFile << "[JUCE] Emitting edlApplied event (status=ok)" << std::endl;
-    debugFile << "        id=" << g.id
-              << ", revision=" << revision
-              << ", words=" << wordSegments
-              << ", spacers=" << spacerSegments
-              << ", totalSegments=" << totalSegments
-              << ", mode=" << mode << std::endl;
-    debugFile.flush();
+  void getRevisionCacheStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    emitRevisionCacheStats(revisionCache.stats());
+  }
 
-    std::ostringstream successDiag;
-    successDiag << "mode=" << mode
-                << ", clips=" << clips.size()
-                << ", words=" << wordSegments
-                << ", spacers=" << spacerSegments
-                << ", totalSegments=" << totalSegments;
-    emitEdlAppliedEvent(revision, wordSegments, spacerSegments, totalSegments, mode, "ok", successDiag.str());
+  void setRevisionCacheLimit(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    revisionCache.setMaxBytes(maxBytes);
+    gMetrics.revisionCacheBytes.store(revisionCache.stats().bytes, std::memory_order_relaxed);
+    emitRevisionCacheStats(revisionCache.stats());
   }
 
+
+  // Position reporting only: segment boundaries, range ends and the end of
+  // the timeline are handled sample-accurately by EdlAudioSource.
   void hiResTimerCallback() override {
+    metrics::ScopeTimer tick(&gMetrics.timerTickUs);
     std::lock_guard<std::mutex> lock(mutex);
+    refreshDeviceXruns();
     if (!g.playing) return;
-    
-    // With edited/original mapping fixed, both modes operate correctly.
-    // Prefer contiguous handler if detected, else standard.
-    if (isContiguousTimeline) handleContiguousTimelinePlayback();
-    else handleStandardTimelinePlayback();
+
+    g.editedSec = sanitizeTime(edl.getEditedSeconds());
+    if (edl.takeRangeEnded()) {
+      transportSource.stop();
+      g.playing = false;
+      std::ostringstream evt;
+      evt << "{\"type\":\"rangeEnded\",\"id\":\"" << g.id << "\",\"startSec\":" << activeRange.startSec
+          << ",\"endSec\":" << activeRange.endSec << "}";
+      emit(evt.str());
+      activeRange = PlayRange();
+      emitState();
+      emitPositionFromTransport();
+      return;
+    }
+    if (edl.hasFinished()) {
+      emitPositionFromTransport();
+      endPlayback();
+      return;
+    }
+    emitPositionFromTransport();
+    emitMeterIfReady();
+  }
+
+  void emitMeterIfReady() {
+    const uint32_t version = meter.frameVersion();
+    if (version == lastMeterVersion) return;
+    MeterFrame frame;
+    if (!meter.readFrame(frame)) return;
+    lastMeterVersion = version;
+    emitMeterFrame(frame);
   }
   
 };
@@ -1200,274 +6452,340 @@ void Backend::endPlayback() {
   emit("{\"type\":\"ended\",\"id\":\"" + g.id + "\"}");
 }
 
-void Backend::handleStandardTimelinePlayback() {
-  double pos = sanitizeTime(transportSource.getCurrentPosition()); // original domain
-  {
-    std::ostringstream oss; oss.setf(std::ios::fixed); oss << std::setprecision(3);
-    oss << "[JUCE][STD] pos=" << pos;
-    if (!segments.empty()) {
-      const auto& s0 = segments[0];
-      const double os0 = s0.hasOriginal() ? s0.originalStart : s0.start;
-      const double oe0 = s0.hasOriginal() ? s0.originalEnd   : s0.end;
-      oss << " firstOrig=" << os0 << "-" << oe0;
-    }
-    juceDLog(oss.str());
-  }
+#endif // USE_JUCE
 
-  if (!segments.empty()) {
-    // Robustly advance across any number of boundaries with loop protection
-    int loopCount = 0;
-    const int maxLoops = 10; // Prevent infinite loops
-
-    while (loopCount < maxLoops) {
-      loopCount++;
-      int segIdx = segmentFor(pos);
-
-      if (segIdx < 0) {
-        // Position is not in any segment
-        {
-          const double firstOs = segments.front().hasOriginal()
-            ? sanitizeTime(segments.front().originalStart, segments.front().start)
-            : sanitizeTime(segments.front().start);
-          const double firstOe = segments.front().hasOriginal()
-            ? sanitizeTime(segments.front().originalEnd, segments.front().end)
-            : sanitizeTime(segments.front().end, firstOs);
-          if (pos < firstOs) {
-            // Before first segment - jump to first segment start
-            double newPos = firstOs;
-            transportSource.setPosition(newPos);
-            pos = newPos;
-            {
-              std::ostringstream oss; oss.setf(std::ios::fixed); oss << std::setprecision(3);
-              oss << "[JUCE][STD] Jump to first os=" << pos;
-              juceDLog(oss.str());
-            }
-            continue;
-          } else {
-            // After last segment - find which segment to jump to or end
-            bool foundNext = false;
-            for (size_t i = 0; i < segments.size(); ++i) {
-              const double os = segments[i].hasOriginal()
-                ? sanitizeTime(segments[i].originalStart, segments[i].start)
-                : sanitizeTime(segments[i].start);
-              if (pos < os) {
-                // Found a segment that starts after our position
-                double newPos = os;
-                transportSource.setPosition(newPos);
-                pos = newPos;
-                foundNext = true;
-                {
-                  std::ostringstream oss; oss.setf(std::ios::fixed); oss << std::setprecision(3);
-                  oss << "[JUCE][STD] Jump to next idx=" << i << " os=" << pos;
-                  juceDLog(oss.str());
-                }
-                break;
-              }
-            }
-            if (!foundNext) {
-              // No more segments ahead - end playback
-              endPlayback();
-              return;
-            }
-            continue;
-          }
-        }
+// --- Replay ---
+// Feeds a capture back through the command router instead of stdin:
+//   juce-backend --replay session.capture [--fast] [--expect previous.jsonl]
+// Paced replays wait for each command's original arrival time; --fast sends
+// them back to back. Either way the JUCE build runs headless, rendering audio
+// against a virtual clock that advances to each command's timestamp before
+// the command runs, so the rendered audio does not depend on pacing. The run
+// ends with a metrics event (per-command latency) and a replayComplete event
+// with the audio and event hashes; --expect compares those with the
+// replayComplete line of an earlier run and exits 1 on a difference.
+struct ReplayOptions {
+  std::string capturePath;
+  std::string expectPath;
+  bool fast = false;
+};
 
-        // Position is within a segment
-        const auto& s = segments[segIdx];
-        {
-          const double se = s.hasOriginal()
-            ? sanitizeTime(s.originalEnd, s.end)
-            : sanitizeTime(s.end);
-          if (pos >= se - 1e-6) {
-            // At or past end of current segment
-            if (segIdx + 1 < (int)segments.size()) {
-              // Jump to next segment
-              const auto& sn = segments[segIdx + 1];
-              double newPos = sn.hasOriginal()
-                ? sanitizeTime(sn.originalStart, sn.start)
-                : sanitizeTime(sn.start);
-              transportSource.setPosition(newPos);
-              pos = newPos;
-              {
-                std::ostringstream oss; oss.setf(std::ios::fixed); oss << std::setprecision(3);
-                oss << "[JUCE][STD] Boundary advance to idx=" << (segIdx+1) << " os=" << pos;
-                juceDLog(oss.str());
-              }
-              continue;
-            } else {
-              // No more segments - end playback
-              endPlayback();
-              return;
-            }
-          }
+class ReplaySession {
+public:
+  explicit ReplaySession(const ReplayOptions& o) : options(o) {}
 
-          // Position is valid within current segment - exit loop
-          break;
-        }
-      }
+  // Called with the virtual time, in seconds, before each command runs.
+  std::function<void(double, AudioHash&)> advance;
+
+  bool open() {
+    std::string error;
+    if (!reader.open(options.capturePath, error)) {
+      emit("{\"type\":\"error\",\"message\":\"" + jsonEscape(error + ": " + options.capturePath) + "\"}");
+      return false;
+    }
+    wallStart = std::chrono::steady_clock::now();
+    gEventTally.enabled.store(true);
+    return true;
+  }
 
-      if (loopCount >= maxLoops) {
-        if (const char* debug = getenv("VITE_AUDIO_DEBUG")) {
-          if (strcmp(debug, "true") == 0) {
-            std::cerr << "[JUCE] Loop limit reached in boundary handling" << std::endl;
+  // Next command to run, after staging its attachments, waiting for its
+  // time (unless fast) and advancing the audio clock to it.
+  bool next(std::string& line) {
+    CaptureRecord record;
+    std::string error;
+    while (reader.next(record, error)) {
+      lastUs = record.tUs;
+      switch (record.kind) {
+        case CaptureRecord::Kind::Attachment: stage(record); break;
+        case CaptureRecord::Kind::Media: checkMedia(record); break;
+        case CaptureRecord::Kind::End: advanceTo(record.tUs); return false;
+        case CaptureRecord::Kind::Command:
+          advanceTo(record.tUs);
+          line = std::move(record.text);
+          for (const auto& staged : stagedFiles) {
+            const std::string from = "\"path\":\"" + staged.first + "\"";
+            const size_t p = line.find(from);
+            if (p != std::string::npos) line.replace(p, from.size(), "\"path\":\"" + staged.second + "\"");
           }
-        }
-        // Fallback: end playback to prevent infinite loop
-        endPlayback();
-        return;
+          stagedFiles.clear();
+          ++commands;
+          return true;
       }
     }
-  } else if (pos >= g.durationSec) {
-    endPlayback();
-    return;
+    if (!error.empty()) {
+      failed = true;
+      emit("{\"type\":\"error\",\"message\":\"" + jsonEscape(error) + "\"}");
+    }
+    advanceTo(lastUs);
+    return false;
   }
 
-  g.editedSec = originalToEdited(pos);
-  emitPositionFromTransport();
-}
-
-void Backend::handleContiguousTimelinePlayback() {
-  double pos = sanitizeTime(transportSource.getCurrentPosition()); // original audio time
-
-  // Safety check for segments
-  if (segments.empty()) {
-    juceDLog("[JUCE] CONTIGUOUS: No segments available");
-    endPlayback();
-    return;
+  // Emits the summary; returns the process exit code.
+  int finish() {
+    gAnalysis.waitIdle();
+    gEventTally.enabled.store(false);
+    emitMetrics();
+    std::map<std::string, uint64_t> counts;
+    {
+      std::lock_guard<std::mutex> lock(gEventTally.mutex);
+      counts = gEventTally.counts;
+    }
+    uint64_t eventsHash = 1469598103934665603ull;
+    for (const auto& entry : counts) {
+      for (char c : entry.first + "=" + std::to_string(entry.second) + ";") eventsHash = (eventsHash ^ (unsigned char) c) * 1099511628211ull;
+    }
+    const std::string audioHex = hex(audio.value());
+    const std::string eventsHex = hex(eventsHash);
+    const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::ostringstream evt;
+    evt << "{\"type\":\"replayComplete\",\"id\":\"" << g.id << "\",\"capture\":\"" << jsonEscape(options.capturePath)
+        << "\",\"mode\":\"" << (options.fast ? "fast" : "paced") << "\",\"commands\":" << commands
+        << ",\"capturedSec\":" << lastUs / 1e6 << ",\"wallMs\":" << std::llround(wallMs)
+        << ",\"audioSamples\":" << audio.samples() << ",\"audioHash\":\"" << audioHex << "\""
+        << ",\"eventsHash\":\"" << eventsHex << "\",\"events\":{";
+    bool first = true;
+    for (const auto& entry : counts) {
+      evt << (first ? "" : ",") << "\"" << jsonEscape(entry.first) << "\":" << entry.second;
+      first = false;
+    }
+    evt << "},\"mediaMismatches\":" << mediaMismatches;
+    bool match = !failed;
+    if (!options.expectPath.empty()) {
+      std::string expectedAudio, expectedEvents;
+      readExpectation(expectedAudio, expectedEvents);
+      const bool audioMatch = expectedAudio == audioHex;
+      const bool eventsMatch = expectedEvents == eventsHex;
+      match = match && audioMatch && eventsMatch;
+      evt << ",\"expected\":{\"audioHash\":\"" << jsonEscape(expectedAudio) << "\",\"eventsHash\":\""
+          << jsonEscape(expectedEvents) << "\"},\"audioMatch\":" << (audioMatch ? "true" : "false")
+          << ",\"eventsMatch\":" << (eventsMatch ? "true" : "false");
+    }
+    evt << ",\"match\":" << (match ? "true" : "false") << "}";
+    emit(evt.str());
+    return match ? 0 : 1;
   }
 
-  if (!contiguousInitialized && !segments.empty() && segments[0].hasOriginal()) {
-    // Initialize to the current edited position's corresponding original time,
-    // to respect any user seek that happened just before playback.
-    const double targetOrig = sanitizeTime(editedToOriginal(g.editedSec.load()));
-    transportSource.setPosition(targetOrig);
-    contiguousInitialized = true;
-
-    std::ofstream debugFile("/tmp/juce_debug.log", std::ios::app);
-    debugFile << "[JUCE] CONTIGUOUS: Initialized at edited=" << g.editedSec.load() << " -> orig=" << targetOrig << std::endl;
-    debugFile.flush();
-
-    emitPositionFromTransport();
-    return; // Avoid using stale 'pos' from before setPosition
+private:
+  // Jobs started by earlier commands finish first, so their events and
+  // any audio they feed (pre-roll, denoise) do not depend on thread timing.
+  void advanceTo(uint64_t tUs) {
+    gAnalysis.waitIdle();
+    if (!options.fast) std::this_thread::sleep_until(wallStart + std::chrono::microseconds(tUs));
+    if (advance) advance((double) tUs / 1e6, audio);
   }
 
-  // Find which segment we're currently playing (by original position)
-  int segIdx = -1;
-  for (size_t i = 0; i < segments.size(); i++) {
-    // Bounds check before accessing segment
-    if (i >= segments.size()) {
-      juceDLog("[JUCE] CONTIGUOUS: Segment index out of bounds: " + std::to_string(i));
-      break;
-    }
-
-    const auto& seg = segments[i];
-    if (seg.hasOriginal()) {
-      const double oStart = sanitizeTime(seg.originalStart, seg.start);
-      const double oEnd = sanitizeTime(seg.originalEnd, seg.end);
-      const double oDur = sanitizeDuration(oEnd - oStart);
-      if (oDur <= 0.0) {
-        continue;
-      }
-      if (pos >= oStart && pos < oStart + oDur) {
-        segIdx = (int)i;
-        break;
-      }
-    }
+  // Writes an attachment where the next command will find it.
+  void stage(const CaptureRecord& record) {
+    std::ostringstream path;
+    path << cacheDirectory() << "/replay-" << std::hex << EdlContentKey::of(record.text.data(), record.text.size()).hash
+         << ".json";
+    std::ofstream out(path.str(), std::ios::binary | std::ios::trunc);
+    out.write(record.text.data(), (std::streamsize) record.text.size());
+    stagedFiles.emplace_back(record.path, path.str());
   }
 
-  if (segIdx >= 0) {
-    // We're in a valid segment - calculate contiguous time position
-    const auto& seg = segments[segIdx];
-    const double oStart = sanitizeTime(seg.originalStart, seg.start);
-    const double oEnd = sanitizeTime(seg.originalEnd, seg.end);
-    const double oDur = sanitizeDuration(oEnd - oStart);
-    if (oDur <= 0.0) {
-      endPlayback();
-      return;
-    }
+  void checkMedia(const CaptureRecord& record) {
+    std::ifstream file(record.path, std::ios::binary | std::ios::ate);
+    const uint64_t bytes = file.good() ? (uint64_t) std::max<std::streamoff>(0, file.tellg()) : 0;
+    if (bytes == record.bytes) return;
+    ++mediaMismatches;
+    juceDLog("[JUCE] replay: media differs from capture: " + record.path + " (" + std::to_string(bytes) +
+             " bytes, captured " + std::to_string(record.bytes) + ")");
+  }
 
-    const double cStart = sanitizeTime(seg.start);
-    const double cEnd = sanitizeTime(seg.end, cStart);
-    const double cDur = sanitizeDuration(cEnd - cStart);
-    if (cDur <= 0.0) {
-      endPlayback();
-      return;
+  // The last replayComplete line of the expectation file.
+  void readExpectation(std::string& audioHash, std::string& eventsHash) const {
+    std::ifstream in(options.expectPath);
+    std::string line, summary;
+    while (std::getline(in, line)) {
+      if (line.find("\"type\":\"replayComplete\"") != std::string::npos) summary = line;
     }
+    auto field = [&](const char* key) -> std::string {
+      const std::string k = std::string("\"") + key + "\":\"";
+      const size_t p = summary.find(k);
+      if (p == std::string::npos) return {};
+      const size_t end = summary.find('"', p + k.size());
+      return end == std::string::npos ? std::string() : summary.substr(p + k.size(), end - (p + k.size()));
+    };
+    audioHash = field("audioHash");
+    eventsHash = field("eventsHash");
+  }
 
-    const double relativePos = std::clamp((pos - oStart) / oDur, 0.0, 1.0);
-    const double contiguousTime = cStart + relativePos * cDur;
-    g.editedSec.store(contiguousTime);
+  static std::string hex(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", (unsigned long long) value);
+    return text;
+  }
 
-    // Check if we're near the end of current segment
-    if (pos >= oStart + oDur - 0.05) { // 50ms tolerance
-      if (segIdx + 1 < (int)segments.size() && segments[segIdx + 1].hasOriginal()) {
-        // Jump to next reordered segment's original position
-        double nextOriginalStart = sanitizeTime(segments[segIdx + 1].originalStart, segments[segIdx + 1].start);
-        transportSource.setPosition(nextOriginalStart);
+  ReplayOptions options;
+  CaptureReader reader;
+  AudioHash audio;
+  std::vector<std::pair<std::string, std::string>> stagedFiles; // captured path -> staged copy
+  std::chrono::steady_clock::time_point wallStart;
+  uint64_t lastUs = 0;
+  uint64_t commands = 0;
+  uint64_t mediaMismatches = 0;
+  bool failed = false;
+};
 
-        std::ofstream debugFile("/tmp/juce_debug.log", std::ios::app);
-        debugFile << "[JUCE] CONTIGUOUS: Advanced to segment " << (segIdx + 1)
-                  << " orig=" << nextOriginalStart << std::endl;
-        debugFile.flush();
-      } else {
-        // No more segments - end playback
-        endPlayback();
-        return;
-      }
-    }
-  } else {
-    // Not in any segment - find next segment or end
-    bool foundNext = false;
-    for (size_t i = 0; i < segments.size(); i++) {
-      if (!segments[i].hasOriginal()) continue;
-      const double nextOrigStart = sanitizeTime(segments[i].originalStart, segments[i].start);
-      if (pos < nextOrigStart) {
-        transportSource.setPosition(nextOrigStart);
-        g.editedSec.store(sanitizeTime(segments[i].start));
-        foundNext = true;
-
-        std::ofstream debugFile("/tmp/juce_debug.log", std::ios::app);
-        debugFile << "[JUCE] CONTIGUOUS: Jumped to segment " << i
-                  << " orig=" << nextOrigStart << std::endl;
-        debugFile.flush();
-        break;
-      }
-    }
+#ifdef USE_JUCE
+// Minimal command router for the JUCE backend; runs on whichever lane the
+// command was given (see CommandLanes).
+static void handleLine(Backend& backend, const std::string& line) {
+  auto contains = [&](const char* s) { return line.find(s) != std::string::npos; };
+  auto extract = [&](const char* key) -> std::string {
+    std::string k = std::string("\"") + key + "\":";
+    size_t p = line.find(k);
+    if (p == std::string::npos) return {};
+    p += k.size();
+    if (p >= line.size()) return {};
+    if (line[p] == '"') { size_t end = line.find('"', p + 1); if (end == std::string::npos) return {}; return line.substr(p + 1, end - (p + 1)); }
+    size_t end = line.find_first_of(",}\n", p); if (end == std::string::npos) end = line.size(); return line.substr(p, end - p);
+  };
 
-    if (!foundNext) {
-      endPlayback();
+  // Scrub targets first: they arrive in bursts and must not queue behind
+  // the other matches.
+  if (contains("\"type\":\"scrub\"")) { backend.scrubTo(numberOr(extract("timeSec"), g.editedSec.load())); return; }
+  if (contains("\"type\":\"load\"")) {
+    g.id = extract("id");
+    backend.load(g.id, extract("path"));
+    return;
+  }
+  if (contains("\"type\":\"updateEdlFromFile\"")) {
+    applyEdlFromFile(backend, extract("path"), extract("fd"), extract("revision"), extract("generationId"));
+    return;
+  }
+  if (contains("\"type\":\"updateEdl\"")) {
+    applyEdlInline(backend, line);
+    return;
+  }
+  if (contains("\"type\":\"getMetrics\"")) { backend.getMetrics(extract("reset") == "true"); return; }
+  if (contains("\"type\":\"setMetricsInterval\"")) {
+    gMetricsReporter.setIntervalMs((int) numberOr(extract("intervalMs"), 0.0));
+    return;
+  }
+  if (contains("\"type\":\"getRtSafety\"")) { emitRtSafety(extract("reset") == "true"); return; }
+  if (contains("\"type\":\"startCapture\"")) { startCapture(extract("path")); return; }
+  if (contains("\"type\":\"stopCapture\"")) { stopCapture(); return; }
+  if (contains("\"type\":\"activateRevision\"")) { backend.activateCachedRevision((int) numberOr(extract("revision"), 0.0)); return; }
+  if (contains("\"type\":\"getRevisionCacheStats\"")) { backend.getRevisionCacheStats(); return; }
+  if (contains("\"type\":\"setRevisionCache\"")) {
+    backend.setRevisionCacheLimit((size_t) std::max(0.0, numberOr(extract("maxBytes"), (double) RevisionCache<EdlRevision>::kDefaultMaxBytes)));
+    return;
+  }
+  if (contains("\"type\":\"getArtifactCacheStats\"")) { emitArtifactCacheStats(); return; }
+  if (contains("\"type\":\"setArtifactCache\"")) {
+    gArtifacts.setMaxBytes((uint64_t) std::max(0.0, numberOr(extract("maxBytes"), (double) artifactCacheLimit())));
+    emitArtifactCacheStats();
+    return;
+  }
+  if (contains("\"type\":\"play\"")) { backend.play(); return; }
+  if (contains("\"type\":\"pause\"")) { backend.pause(); return; }
+  if (contains("\"type\":\"stop\"")) { backend.stop(); return; }
+  if (contains("\"type\":\"seek\"")) { try { backend.seek(std::stod(extract("timeSec"))); } catch (...) {} return; }
+  if (contains("\"type\":\"setRate\"")) { try { backend.setRate(std::stod(extract("rate"))); } catch (...) {} return; }
+  if (contains("\"type\":\"setVolume\"")) { try { backend.setVolume(std::stod(extract("value"))); } catch (...) {} return; }
+  if (contains("\"type\":\"queryState\"")) { backend.queryState(); return; }
+  if (contains("\"type\":\"getOutputStats\"")) { emitOutputStats(); return; }
+  if (contains("\"type\":\"getPrerollStats\"")) { backend.getPrerollStats(); return; }
+  if (contains("\"type\":\"analyzeSilence\"")) {
+    const SilenceParams params = silenceParamsFromCommand(extract);
+    const bool refine = extract("refineSpacers") == "true";
+    const double maxShift = std::clamp(numberOr(extract("maxShiftSec"), 0.2), 0.0, 2.0);
+    backend.analyzeSilence(params, refine, maxShift);
+    return;
+  }
+  if (contains("\"type\":\"playRange\"")) {
+    backend.playRange(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                      extract("loop") == "true", numberOr(extract("crossfadeMs"), 0.0) / 1000.0);
+    return;
+  }
+  if (contains("\"type\":\"setLoop\"")) {
+    backend.setLoop(extract("enabled") != "false", numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                    numberOr(extract("crossfadeMs"), 0.0) / 1000.0);
+    return;
+  }
+  if (contains("\"type\":\"scrubStart\"")) { backend.scrubStart(extract("velocity") == "true"); return; }
+  if (contains("\"type\":\"scrubEnd\"")) {
+    backend.scrubEnd(numberOr(extract("timeSec"), std::numeric_limits<double>::quiet_NaN()));
+    return;
+  }
+  if (contains("\"type\":\"analyzeLoudness\"")) { backend.analyzeLoudness(loudnessOptionsFromCommand(extract)); return; }
+  if (contains("\"type\":\"setLoudnessNormalization\"")) {
+    const LoudnessOptions options = loudnessOptionsFromCommand(extract);
+    backend.setLoudnessNormalization(extract("enabled") != "false", options.targetLufs, options.ceilingDbtp);
+    return;
+  }
+  if (contains("\"type\":\"renderEdited\"")) {
+    const int bits = (int) numberOr(extract("bitsPerSample"), 32.0);
+    backend.renderEdited(extract("path"), extract("normalize") == "true", loudnessOptionsFromCommand(extract), bits);
+    return;
+  }
+  if (contains("\"type\":\"exportStems\"") || contains("\"type\":\"exportClips\"")) {
+    const int bits = (int) numberOr(extract("bitsPerSample"), 32.0);
+    backend.exportAudio(contains("\"type\":\"exportStems\""), extract("directory"), extract("normalize") == "true",
+                        loudnessOptionsFromCommand(extract), bits);
+    return;
+  }
+  if (contains("\"type\":\"saveSidecar\"")) { backend.saveSidecar(extract("path"), silenceParamsFromCommand(extract)); return; }
+  if (contains("\"type\":\"openSidecar\"")) { backend.openSidecar(extract("path")); return; }
+  if (contains("\"type\":\"refineCuts\"")) {
+    const bool apply = extract("apply") == "true";
+    const std::string revision = extract("revision");
+    if (apply && revision.empty()) {
+      emit("{\"type\":\"error\",\"message\":\"refineCuts apply requires a revision\"}");
       return;
     }
+    backend.refineCuts(cutRefineParamsFromCommand(extract), apply, (int) numberOr(revision, 0.0));
+    return;
   }
-
-  emitPositionFromTransport();
-}
-
-void Backend::emitPositionContiguous() {
-  // For contiguous timeline, editedSec is correct, but we need to calculate originalSec
-  const double es = g.editedSec.load();
-  double os = es; // Default fallback
-
-  // Find which contiguous segment we're in
-  for (size_t i = 0; i < segments.size(); i++) {
-    if (es >= segments[i].start && es < segments[i].end) {
-      // We're in segment i - but segments[i] contains contiguous times
-      // We need to reverse-engineer what original time this corresponds to
-      // For now, we'll use a placeholder approach
-      os = es; // This needs proper mapping - will be improved next
-      break;
-    }
+  if (contains("\"type\":\"findText\"")) {
+    backend.findText(extract("text"), extract("prefix") == "true",
+                     numberOr(extract("fromSec"), -std::numeric_limits<double>::infinity()),
+                     numberOr(extract("toSec"), std::numeric_limits<double>::infinity()),
+                     (size_t) std::clamp(numberOr(extract("maxResults"), 100.0), 1.0, 10000.0));
+    return;
   }
-
-  emit(std::string("{") +
-       "\"type\":\"position\",\"id\":\"" + g.id + "\",\"editedSec\":" + std::to_string(es) +
-       ",\"originalSec\":" + std::to_string(os) + "}");
+  if (contains("\"type\":\"getWordsInRange\"")) {
+    backend.getWordsInRange(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                            (size_t) std::clamp(numberOr(extract("maxResults"), 1000.0), 1.0, 100000.0));
+    return;
+  }
+  if (contains("\"type\":\"seekToWord\"")) {
+    backend.seekToWord((int) numberOr(extract("segmentIndex"), -1.0), extract("text"),
+                       (size_t) std::max(0.0, numberOr(extract("occurrence"), 0.0)),
+                       numberOr(extract("fromSec"), -std::numeric_limits<double>::infinity()));
+    return;
+  }
+  if (contains("\"type\":\"getSpectrogramTiles\"")) {
+    backend.getSpectrogramTiles(numberOr(extract("startSec"), 0.0), numberOr(extract("endSec"), 0.0),
+                                (int) numberOr(extract("level"), -1.0),
+                                (int) std::clamp(numberOr(extract("maxColumns"), 2048.0), 16.0, 65536.0));
+    return;
+  }
+  if (contains("\"type\":\"computeSpectrogram\"")) {
+    backend.computeSpectrogram((int) std::clamp(numberOr(extract("minLevel"), 1.0), 0.0, (double) spectrogram::kLevels - 1));
+    return;
+  }
+  if (contains("\"type\":\"denoise\"")) { backend.denoise(denoiseParamsFromCommand(extract)); return; }
+  if (contains("\"type\":\"cancelDenoise\"")) { gAnalysis.cancel("denoise"); return; }
+  if (contains("\"type\":\"cancel\"")) { cancelJobFromCommand(extract("jobId")); return; }
+  if (contains("\"type\":\"getJobs\"")) { gAnalysis.emitJobs(); return; }
+  if (contains("\"type\":\"setDenoise\"")) { backend.setDenoise(extract("enabled") != "false"); return; }
+  if (contains("\"type\":\"setStrip\"")) {
+    backend.setStrip(extract("scope"), extract("target"), stripSettingsFromCommand(extract));
+    return;
+  }
+  if (contains("\"type\":\"clearStrips\"")) { backend.clearStrips(); return; }
+  if (contains("\"type\":\"setMeterRate\"")) { try { backend.setMeterRate(std::stod(extract("hz"))); } catch (...) {} return; }
+  // updateEdl ignored for now (full-file playback)
+  // unrecognized
+  emit("{\"type\":\"error\",\"message\":\"unknown command\"}");
 }
+#endif
 
-#endif // USE_JUCE
-
-int main() {
+int main(int argc, char** argv) {
   std::ios::sync_with_stdio(false);
   std::cin.tie(nullptr);
 
@@ -1478,193 +6796,85 @@ int main() {
     buf->pubsetbuf(stdinBuffer.get(), BUFFER_SIZE);
   }
 
+  ReplayOptions replayOptions;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--dump-sidecar" && i + 1 < argc) return dumpSidecar(argv[i + 1]);
+    if (arg == "--replay" && i + 1 < argc) replayOptions.capturePath = argv[++i];
+    else if (arg == "--expect" && i + 1 < argc) replayOptions.expectPath = argv[++i];
+    else if (arg == "--fast") replayOptions.fast = true;
+  }
+  const bool replaying = !replayOptions.capturePath.empty();
+
   juceDLog("[JUCE] Main process starting with enhanced stdin buffer (1MB)...");
+  rt::init();
+  gEvents.start();
+  gFingerprints.setInline(replaying);
+  // Replays start from an empty artifact cache of their own, so whether an
+  // analysis is computed or answered from the cache does not depend on
+  // earlier runs.
+  std::string replayArtifacts;
+  if (replaying) {
+    replayArtifacts = cacheDirectory() + "/replay-artifacts-" +
+                      std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    gArtifacts.relocate(replayArtifacts);
+  }
 
 #ifdef USE_JUCE
-  Backend backend;
+  Backend backend(replaying);
 #else
+  // Replays step the clock to each command's timestamp themselves.
+  const char* clockRate = std::getenv("JUCE_MOCK_CLOCK_RATE");
+  gMock.setClock(clockRate && *clockRate ? numberOr(clockRate, 1.0) : 1.0, replaying);
   std::thread t(timerThread);
 #endif
 
-  std::string line;
-  while (std::getline(std::cin, line)) {
-    if (line.empty()) continue;
-#ifdef USE_JUCE
-    // Minimal command router for JUCE backend
-    auto contains = [&](const char* s) { return line.find(s) != std::string::npos; };
-    auto extract = [&](const char* key) -> std::string {
-      std::string k = std::string("\"") + key + "\":";
-      size_t p = line.find(k);
-      if (p == std::string::npos) return {};
-      p += k.size();
-      if (p >= line.size()) return {};
-      if (line[p] == '"') { size_t end = line.find('"', p + 1); if (end == std::string::npos) return {}; return line.substr(p + 1, end - (p + 1)); }
-      size_t end = line.find_first_of(",}\n", p); if (end == std::string::npos) end = line.size(); return line.substr(p, end - p);
-    };
-
-    if (contains("\"type\":\"load\"")) {
-      g.id = extract("id");
-      backend.load(g.id, extract("path"));
-      continue;
-    }
-    if (contains("\"type\":\"updateEdlFromFile\"")) {
-      std::string pathValue = extract("path");
-      std::string revisionString = extract("revision");
-      std::string generationString = extract("generationId");
-      int requestedRevision = 0;
-      try {
-        if (!revisionString.empty()) {
-          requestedRevision = std::stoi(revisionString);
-        }
-      } catch (...) {}
-
-      juceDLog(std::string("[JUCE] updateEdlFromFile command received: path=") + pathValue +
-                ", requestedRevision=" + std::to_string(requestedRevision) +
-                ", generation=" + generationString);
-      {
-        std::ofstream debugFile(juceDebugPath(), std::ios::app);
-        debugFile << "[JUCE] updateEdlFromFile received" << std::endl;
-        debugFile << "        path=" << pathValue << std::endl;
-        debugFile << "        requestedRevision=" << requestedRevision << std::endl;
-        if (!generationString.empty()) {
-          debugFile << "        generation=" << generationString << std::endl;
-        }
-        debugFile.flush();
-      }
-
-      auto cleanupTempFile = [&]() {
-        if (!pathValue.empty()) {
-          std::remove(pathValue.c_str());
-        }
-      };
-
-      auto emitFailure = [&](const std::string& message, int revisionHint, const std::string& diagnostic = std::string()) {
-        const std::string combined = diagnostic.empty() ? message : (message + " | " + diagnostic);
-        juceDLog("[JUCE] updateEdlFromFile failure: " + combined);
-        try {
-          std::ofstream debugFile(juceDebugPath(), std::ios::app);
-          debugFile << "[JUCE] updateEdlFromFile failure" << std::endl;
-          debugFile << "        message=" << message << std::endl;
-          if (!diagnostic.empty()) {
-            debugFile << "        diagnostic=" << diagnostic << std::endl;
-          }
-          debugFile.flush();
-        } catch (...) {}
-        emitEdlAppliedEvent(revisionHint, 0, 0, 0, "", "error", combined);
-        cleanupTempFile();
-      };
-
-      if (pathValue.empty()) {
-        emitFailure("Missing EDL file path", requestedRevision);
-        continue;
-      }
-
-      std::ifstream edlFile(pathValue, std::ios::binary | std::ios::ate);
-      if (!edlFile.good()) {
-        emitFailure("Unable to read EDL file", requestedRevision, std::string("path=") + pathValue);
-        continue;
-      }
-
-      const std::streampos fileSizePos = edlFile.tellg();
-      const long long fileSize = fileSizePos >= 0 ? static_cast<long long>(fileSizePos) : -1;
-      edlFile.seekg(0, std::ios::beg);
-
-      {
-        std::ofstream debugFile(juceDebugPath(), std::ios::app);
-        debugFile << "[JUCE] updateEdlFromFile reading payload" << std::endl;
-        debugFile << "        bytes=" << fileSize << std::endl;
-        debugFile.flush();
-      }
-
-      std::stringstream buffer;
-      buffer << edlFile.rdbuf();
-      edlFile.close();
-      const std::string payload = buffer.str();
-
-      std::vector<Clip> clips;
-      int parsedRevision = 0;
-      bool parsedOk = false;
-      try {
-        parsedOk = parseClipsFromJsonPayload(payload, clips, &parsedRevision);
-      } catch (const std::exception& ex) {
-        emitFailure("Exception parsing EDL payload", requestedRevision, ex.what());
-        continue;
-      } catch (...) {
-        emitFailure("Unknown exception parsing EDL payload", requestedRevision);
-        continue;
-      }
-
-      if (!parsedOk) {
-        emitFailure("Invalid EDL file contents", requestedRevision, std::string("bytes=") + std::to_string(payload.size()));
-        continue;
-      }
-
-      if (parsedRevision > 0 && parsedRevision != requestedRevision) {
-        juceDLog("[JUCE] updateEdlFromFile revision mismatch: command=" + std::to_string(requestedRevision) +
-                 ", parsed=" + std::to_string(parsedRevision));
-      }
-
-      const int revision = parsedRevision > 0 ? parsedRevision : requestedRevision;
-
-      juceDLog("[JUCE] updateEdlFromFile parsed " + std::to_string(clips.size()) +
-               " clips for revision " + std::to_string(revision));
-      {
-        std::ofstream debugFile(juceDebugPath(), std::ios::app);
-        debugFile << "[JUCE] updateEdlFromFile parsed payload" << std::endl;
-        debugFile << "        revision=" << revision << std::endl;
-        debugFile << "        clipCount=" << clips.size() << std::endl;
-        debugFile.flush();
-      }
-
-      try {
-        backend.updateEdl(std::move(clips), revision);
-        juceDLog("[JUCE] updateEdlFromFile completed successfully for revision " + std::to_string(revision));
-      } catch (const std::exception& ex) {
-        emitFailure("Exception applying EDL", revision, ex.what());
-        continue;
-      } catch (...) {
-        emitFailure("Unknown exception applying EDL", revision);
-        continue;
-      }
-
-      cleanupTempFile();
-      continue;
-    }
-
+  gMetricsReporter.start();
 
-    if (contains("\"type\":\"updateEdl\"")) {
-      std::vector<Clip> clips;
-      int revision = 0;
-      if (!parseClipsFromJsonPayload(line, clips, &revision)) {
-        const std::string message = "Invalid EDL payload";
-        juceDLog("[JUCE] updateEdl inline parse failure: " + message);
-        emitEdlAppliedEvent(revision, 0, 0, 0, "", "error", message);
-        continue;
-      }
+  ReplaySession replay(replayOptions);
+  int exitCode = 0;
+  if (replaying) {
+#ifdef USE_JUCE
+    replay.advance = [&backend](double sec, AudioHash& hash) { backend.advanceHeadless(sec, hash); };
+#else
+    replay.advance = [](double sec, AudioHash&) { gMock.advanceClockTo(sec); };
+#endif
+    if (!replay.open()) exitCode = 1;
+  } else if (const char* capturePath = std::getenv("JUCE_CAPTURE_FILE")) {
+    if (*capturePath) startCapture(capturePath);
+  }
+  auto nextLine = [&](std::string& out) -> bool {
+    if (replaying) return exitCode == 0 && replay.next(out);
+    if (!std::getline(std::cin, out)) return false;
+    if (gCapture.isOpen() && !out.empty()) captureCommand(out);
+    return true;
+  };
 
-      juceDLog("[JUCE] updateEdl inline parsed " + std::to_string(clips.size()) +
-               " clips for revision " + std::to_string(revision));
-      backend.updateEdl(std::move(clips), revision);
-      continue;
-    }
-    if (contains("\"type\":\"play\"")) { backend.play(); continue; }
-    if (contains("\"type\":\"pause\"")) { backend.pause(); continue; }
-    if (contains("\"type\":\"stop\"")) { backend.stop(); continue; }
-    if (contains("\"type\":\"seek\"")) { try { backend.seek(std::stod(extract("timeSec"))); } catch (...) {} continue; }
-    if (contains("\"type\":\"setRate\"")) { try { backend.setRate(std::stod(extract("rate"))); } catch (...) {} continue; }
-    if (contains("\"type\":\"setVolume\"")) { try { backend.setVolume(std::stod(extract("value"))); } catch (...) {} continue; }
-    if (contains("\"type\":\"queryState\"")) { backend.queryState(); continue; }
-    // updateEdl ignored for now (full-file playback)
-    // unrecognized
-    emit("{\"type\":\"error\",\"message\":\"unknown command\"}");
+#ifdef USE_JUCE
+  CommandLanes lanes([&backend](const std::string& command) { handleLine(backend, command); }, replaying);
 #else
-    handleLine(line);
+  CommandLanes lanes([](const std::string& command) { handleLine(command); }, replaying);
 #endif
+  std::string line;
+  while (nextLine(line)) {
+    if (line.empty()) continue;
+    lanes.submit(line);
   }
+  lanes.stop();
+
+  if (replaying && exitCode == 0) exitCode = replay.finish();
+  gCapture.close();
 
 #ifndef USE_JUCE
   g.running = false;
   t.join();
 #endif
-  return 0;
+  gMetricsReporter.stop();
+  gAnalysis.stopAll();
+  if (!replayArtifacts.empty()) {
+    std::error_code ec;
+    std::filesystem::remove_all(replayArtifacts, ec);
+  }
+  gEvents.stop();
+  return exitCode;
 }
@@ -0,0 +1,34 @@
+// Minimal check harness for the native tests: each test is its own
+// executable, registered with ctest, that prints every failed CHECK and
+// exits non-zero if there were any.
+#pragma once
+
+#include <cstdio>
+
+namespace check {
+
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline void fail(const char* file, int line, const char* expr) {
+  std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+  ++failures();
+}
+
+inline int finish(const char* name) {
+  if (failures() == 0) {
+    std::printf("%s: ok\n", name);
+    return 0;
+  }
+  std::printf("%s: %d check(s) failed\n", name, failures());
+  return 1;
+}
+
+} // namespace check
+
+#define CHECK(expr) \
+  do { \
+    if (!(expr)) check::fail(__FILE__, __LINE__, #expr); \
+  } while (0)
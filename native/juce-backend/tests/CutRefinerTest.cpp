@@ -0,0 +1,135 @@
+// src/CutRefiner.h: cut points on synthetic signals snap to the zero
+// crossing or quiet stretch they were placed next to, and points at or past
+// the ends of the file come back unchanged.
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Check.h"
+#include "CutRefiner.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRate = 48000.0;
+
+// A signal computed sample by sample, the same on every channel.
+class SyntheticReader : public SampleReader {
+public:
+  SyntheticReader(int channels, int64_t frames, std::function<float(int64_t)> fn)
+      : channels(channels), frames(frames), fn(std::move(fn)) {}
+
+  int numChannels() const override { return channels; }
+  double sampleRate() const override { return kRate; }
+  int64_t lengthInSamples() const override { return frames; }
+
+  bool read(float* const* dest, int destChannels, int64_t start, int numSamples) override {
+    for (int ch = 0; ch < destChannels; ++ch) {
+      for (int i = 0; i < numSamples; ++i) {
+        const int64_t n = start + i;
+        dest[ch][i] = n >= 0 && n < frames ? fn(n) : 0.0f;
+      }
+    }
+    return true;
+  }
+
+private:
+  int channels;
+  int64_t frames;
+  std::function<float(int64_t)> fn;
+};
+
+SampleReaderFactory synthetic(int channels, int64_t frames, std::function<float(int64_t)> fn) {
+  return [=]() -> std::unique_ptr<SampleReader> { return std::make_unique<SyntheticReader>(channels, frames, fn); };
+}
+
+// 100 Hz, a quarter sample ahead so no sample sits exactly on a crossing:
+// crossings fall between samples 240k - 1 and 240k, nearer the latter.
+float tone(int64_t n) { return (float) std::sin(2.0 * kPi * 100.0 * ((double) n + 0.25) / kRate); }
+
+float noise(int64_t n) {
+  uint32_t x = (uint32_t) n * 2654435761u + 12345u;
+  x ^= x >> 15;
+  x *= 2246822519u;
+  x ^= x >> 13;
+  return (float) ((int32_t) x) / 2147483648.0f * 0.5f;
+}
+
+CutRefineResult refine(const SampleReaderFactory& factory, CutSnapMode mode, std::vector<double> points) {
+  CutRefineParams params;
+  params.mode = mode;
+  params.threads = 2;
+  return refineCutPoints(factory, points, params);
+}
+
+int64_t sampleOf(double sec) { return (int64_t) std::llround(sec * kRate); }
+
+void snapsToZeroCrossing() {
+  const auto factory = synthetic(2, 48000, tone);
+  // 30 samples after the crossing at 4800, 40 before the one at 5040.
+  const auto result = refine(factory, CutSnapMode::ZeroCrossing, { 4830 / kRate, 5000 / kRate });
+  CHECK(result.ok);
+  CHECK(result.refinedSec.size() == 2);
+  // Of the two samples around each crossing, the one nearer zero.
+  CHECK(sampleOf(result.refinedSec[0]) == 4800);
+  CHECK(sampleOf(result.refinedSec[1]) == 5040);
+  CHECK(result.moved == 2);
+  CHECK(std::fabs(result.maxShiftSec - 40 / kRate) < 1e-9);
+}
+
+void snapsToEnergyMinimum() {
+  // Noise with a silent gap at [10000, 10400).
+  const auto factory = synthetic(1, 48000, [](int64_t n) { return n >= 10000 && n < 10400 ? 0.0f : noise(n); });
+  const auto result = refine(factory, CutSnapMode::Energy, { 9700 / kRate, 10700 / kRate });
+  CHECK(result.ok);
+  // The first frames, from either side, that lie wholly in the gap.
+  const int64_t half = std::lround(CutRefineParams().frameSec * kRate * 0.5);
+  CHECK(sampleOf(result.refinedSec[0]) == 10000 + half);
+  CHECK(sampleOf(result.refinedSec[1]) == 10399 - half);
+}
+
+void autoIsQuietAndOnACrossing() {
+  // A loud tone that drops 40 dB over [20000, 21000).
+  auto signal = [](int64_t n) { return (n >= 20000 && n < 21000 ? 0.01f : 1.0f) * tone(n); };
+  const auto factory = synthetic(2, 48000, signal);
+  const auto result = refine(factory, CutSnapMode::Auto, { 19700 / kRate });
+  CHECK(result.ok);
+  const int64_t at = sampleOf(result.refinedSec[0]);
+  CHECK(at >= 20000 && at < 21000);
+  CHECK((signal(at - 1) < 0.0f) != (signal(at) < 0.0f) || (signal(at) < 0.0f) != (signal(at + 1) < 0.0f));
+  CHECK(std::fabs(signal(at)) < 0.001f);
+}
+
+void pointsAtOrPastTheEnds() {
+  const int64_t frames = 48000;
+  const auto factory = synthetic(1, frames, tone);
+  const std::vector<double> points = { -1.0, 0.0, frames / kRate, frames / kRate + 0.5 };
+  for (const auto mode : { CutSnapMode::Auto, CutSnapMode::ZeroCrossing, CutSnapMode::Energy }) {
+    const auto result = refine(factory, mode, points);
+    CHECK(result.ok);
+    CHECK(result.refinedSec == points);
+    CHECK(result.moved == 0);
+  }
+  // Just inside either end the search window is clamped to the file.
+  const auto result = refine(factory, CutSnapMode::Auto, { 5 / kRate, (frames - 5) / kRate });
+  CHECK(result.ok);
+  for (const double sec : result.refinedSec) CHECK(sec >= 0.0 && sec < frames / kRate);
+}
+
+void unreadableFileFails() {
+  const SampleReaderFactory none = []() -> std::unique_ptr<SampleReader> { return nullptr; };
+  CHECK(!refine(none, CutSnapMode::Auto, { 1.0 }).ok);
+}
+
+} // namespace
+
+int main() {
+  snapsToZeroCrossing();
+  snapsToEnergyMinimum();
+  autoIsQuietAndOnACrossing();
+  pointsAtOrPastTheEnds();
+  unreadableFileFails();
+  return check::finish("cut-refiner");
+}
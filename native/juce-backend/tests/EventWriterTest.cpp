@@ -0,0 +1,156 @@
+// src/LockFree.h and src/EventWriter.h: the bounded queue keeps each
+// producer's order and refuses rather than waits when full; the writer
+// skips superseded position events, refuses coalescable events past the
+// high-water mark and counts other events lost instead of blocking.
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "EventWriter.h"
+
+namespace {
+
+std::vector<std::string> lines(const std::string& text) {
+  std::vector<std::string> out;
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) out.push_back(line);
+  return out;
+}
+
+void queueFullAndEmpty() {
+  BoundedMpmcQueue<int> queue(5);
+  CHECK(queue.capacity() == 8);
+  int value = 0;
+  CHECK(!queue.tryPop(value));
+  for (int i = 0; i < 8; ++i) {
+    value = i;
+    CHECK(queue.tryPush(value));
+  }
+  value = 99;
+  CHECK(!queue.tryPush(value));
+  CHECK(value == 99); // left untouched
+  CHECK(queue.approxSize() == 8);
+  for (int i = 0; i < 8; ++i) {
+    CHECK(queue.tryPop(value));
+    CHECK(value == i);
+  }
+  CHECK(!queue.tryPop(value));
+  CHECK(queue.approxSize() == 0);
+}
+
+// Four producers and two consumers through a small queue: nothing is lost
+// or duplicated, and each consumer sees every producer's items in order.
+void queueOrderAcrossThreads() {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 2;
+  constexpr uint32_t kPerProducer = 20000;
+  BoundedMpmcQueue<uint64_t> queue(64);
+  std::atomic<uint64_t> popped{0};
+  std::vector<std::vector<uint32_t>> last(kConsumers, std::vector<uint32_t>(kProducers, 0));
+  std::vector<uint64_t> count(kProducers * (size_t) kPerProducer + 1, 0);
+  std::atomic<bool> ordered{true};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&queue, p] {
+      for (uint32_t i = 1; i <= kPerProducer; ++i) {
+        uint64_t item = ((uint64_t) p << 32) | i;
+        while (!queue.tryPush(item)) std::this_thread::yield();
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&, c] {
+      uint64_t item = 0;
+      while (popped.load() < (uint64_t) kProducers * kPerProducer) {
+        if (!queue.tryPop(item)) {
+          std::this_thread::yield();
+          continue;
+        }
+        const int p = (int) (item >> 32);
+        const uint32_t i = (uint32_t) item;
+        if (i <= last[(size_t) c][(size_t) p]) ordered.store(false);
+        last[(size_t) c][(size_t) p] = i;
+        ++count[(size_t) p * kPerProducer + i];
+        popped.fetch_add(1);
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  CHECK(ordered.load());
+  bool once = true;
+  for (int p = 0; p < kProducers; ++p) {
+    for (uint32_t i = 1; i <= kPerProducer; ++i) once = once && count[(size_t) p * kPerProducer + i] == 1;
+  }
+  CHECK(once);
+}
+
+// Events pushed before the writer starts are all queued when it drains, so
+// only the newest position survives; the others keep their order.
+void coalescing() {
+  std::ostringstream out;
+  EventWriter writer(out);
+  writer.push("a");
+  writer.pushCoalesced(CoalesceKey::Position, "p1");
+  writer.pushCoalesced(CoalesceKey::Meter, "m1");
+  writer.push("b");
+  writer.pushCoalesced(CoalesceKey::Position, "p2");
+  writer.pushCoalesced(CoalesceKey::Position, "p3");
+  writer.push("c");
+  writer.start();
+  writer.stop();
+
+  CHECK(lines(out.str()) == std::vector<std::string>({ "a", "m1", "b", "p3", "c" }));
+  CHECK(writer.enqueued.load() == 7);
+  CHECK(writer.written.load() == 5);
+  CHECK(writer.coalesced.load() == 2);
+  CHECK(writer.dropped.load() == 0);
+  CHECK(writer.lost.load() == 0);
+}
+
+// With no writer running the queue fills: coalescable events are refused
+// from three quarters full, the rest only when it is full, and neither
+// waits for room.
+void refusedWhenFull() {
+  std::ostringstream out;
+  EventWriter writer(out);
+  const size_t reserve = EventWriter::kCapacity - EventWriter::kCoalescedHighWater;
+  for (size_t i = 0; i < EventWriter::kCoalescedHighWater; ++i) writer.push("e" + std::to_string(i));
+  writer.pushCoalesced(CoalesceKey::Position, "late position");
+  CHECK(writer.dropped.load() == 1);
+
+  const auto started = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reserve + 10; ++i) writer.push("r" + std::to_string(i));
+  CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(500));
+  CHECK(writer.lost.load() == 10);
+  CHECK(writer.depth() == EventWriter::kCapacity);
+  CHECK(writer.highWater.load() == EventWriter::kCapacity);
+
+  writer.start();
+  writer.stop();
+  const auto written = lines(out.str());
+  CHECK(written.size() == EventWriter::kCapacity);
+  CHECK(written.front() == "e0");
+  CHECK(written.back() == "r" + std::to_string(reserve - 1));
+  CHECK(writer.depth() == 0);
+
+  // Once drained, positions go through again.
+  writer.pushCoalesced(CoalesceKey::Position, "position");
+  CHECK(writer.dropped.load() == 1);
+  CHECK(writer.depth() == 1);
+}
+
+} // namespace
+
+int main() {
+  queueFullAndEmpty();
+  queueOrderAcrossThreads();
+  coalescing();
+  refusedWhenFull();
+  return check::finish("event-writer");
+}
@@ -0,0 +1,256 @@
+// src/JobSystem.h: workers run their own newest task first and steal the
+// others' oldest, interactive before background; loops run every index
+// once, stop on failure or cancel and report progress in twentieths; jobs
+// of one kind supersede each other and end as ok, cancelled or error.
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "JobSystem.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Waits up to two seconds for done() to hold.
+template <typename F>
+bool eventually(F done) {
+  const auto deadline = std::chrono::steady_clock::now() + 2s;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+// A worker takes its own newest task first, interactive before background.
+void ownQueueOrder() {
+  jobs::Scheduler scheduler(1);
+  std::mutex mutex;
+  std::vector<std::string> order;
+  std::atomic<int> ran{0};
+  auto task = [&](std::string name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(name);
+      ++ran;
+    };
+  };
+  scheduler.submit([&] {
+    scheduler.submit(task("b1"), jobs::Priority::Background);
+    scheduler.submit(task("i1"), jobs::Priority::Interactive);
+    scheduler.submit(task("b2"), jobs::Priority::Background);
+    scheduler.submit(task("i2"), jobs::Priority::Interactive);
+  }, jobs::Priority::Interactive);
+  CHECK(eventually([&] { return ran.load() == 4; }));
+  CHECK(order == std::vector<std::string>({ "i2", "i1", "b2", "b1" }));
+  CHECK(scheduler.stats().stolen == 0);
+}
+
+// Tasks queued by a worker that then stays busy are stolen by the others.
+void stealing() {
+  jobs::Scheduler scheduler(4);
+  std::atomic<int> ran{0};
+  std::atomic<bool> ranOnSelf{false};
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  scheduler.submit([&] {
+    const auto self = std::this_thread::get_id();
+    for (int i = 0; i < 8; ++i) {
+      scheduler.submit([&, self] {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::this_thread::get_id() == self) ranOnSelf.store(true);
+        threads.insert(std::this_thread::get_id());
+        ++ran;
+      }, jobs::Priority::Background);
+    }
+    eventually([&] { return ran.load() == 8; });
+  }, jobs::Priority::Background);
+  CHECK(eventually([&] { return ran.load() == 8; }));
+  CHECK(!ranOnSelf.load()); // the worker that queued them stayed busy
+  CHECK(scheduler.stats().stolen >= 8);
+  CHECK(eventually([&] { return scheduler.stats().executed == 9; }));
+  CHECK(scheduler.stats().queued == 0);
+}
+
+void loops() {
+  std::vector<std::atomic<int>> hits(1000);
+  CHECK(jobs::parallelFor(hits.size(), [&](size_t i) {
+    ++hits[i];
+    return true;
+  }));
+  bool once = true;
+  for (const auto& h : hits) once = once && h.load() == 1;
+  CHECK(once);
+
+  // A failed index stops the loop from claiming more.
+  std::atomic<int> ran{0};
+  CHECK(!jobs::parallelFor(1000, [&](size_t i) {
+    ++ran;
+    return i != 10;
+  }, 1));
+  CHECK(ran.load() == 11);
+
+  // So does cancelling it.
+  std::atomic<bool> cancel{false};
+  ran.store(0);
+  CHECK(!jobs::parallelFor(1000, [&](size_t i) {
+    ++ran;
+    if (i == 10) cancel.store(true);
+    return true;
+  }, 1, &cancel));
+  CHECK(ran.load() == 11);
+
+  CHECK(jobs::parallelFor(0, [](size_t) { return false; }));
+}
+
+void progressAndFailure() {
+  jobs::Job job;
+  std::vector<double> reported;
+  job.onProgress = [&](const jobs::Job&, double fraction) { reported.push_back(fraction); };
+  {
+    jobs::JobScope scope(&job);
+    CHECK(jobs::currentJob() == &job);
+    CHECK(jobs::parallelFor(100, [](size_t) { return true; }, 1));
+    jobs::reportProgress(0.5); // never back
+  }
+  CHECK(jobs::currentJob() == nullptr);
+  CHECK(reported.size() == (size_t) jobs::Job::kSteps);
+  CHECK(reported.front() == 1.0 / jobs::Job::kSteps && reported.back() == 1.0);
+  CHECK(job.fraction() == 1.0);
+
+  // Failure is only recorded against a current job.
+  jobs::reportFailure();
+  CHECK(!job.failed.load());
+  {
+    jobs::JobScope scope(&job);
+    jobs::reportFailure();
+  }
+  CHECK(job.failed.load());
+}
+
+struct Finished {
+  uint64_t id;
+  std::string kind;
+  std::string status;
+};
+
+// Records what a runner reports.
+struct Recorder {
+  std::mutex mutex;
+  std::vector<uint64_t> started;
+  std::vector<Finished> finished;
+
+  jobs::RunnerEvents events() {
+    jobs::RunnerEvents events;
+    events.started = [this](const jobs::Job& job) {
+      std::lock_guard<std::mutex> lock(mutex);
+      started.push_back(job.id);
+    };
+    events.finished = [this](const jobs::Job& job, const char* status, double) {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.push_back({ job.id, job.kind, status });
+    };
+    return events;
+  }
+
+  std::string statusOf(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& f : finished) {
+      if (f.id == id) return f.status;
+    }
+    return "running";
+  }
+};
+
+// A new job of a kind cancels the running one and waits for it; one that is
+// superseded before its turn never runs.
+void superseding() {
+  Recorder recorder;
+  jobs::Runner runner(recorder.events());
+  std::atomic<bool> release{false};
+  std::atomic<bool> firstRunning{false};
+  std::atomic<bool> firstDone{false};
+  std::atomic<bool> secondRan{false};
+  std::atomic<bool> overlapped{false};
+  std::atomic<bool> firstWasCurrent{false};
+  std::atomic<bool> firstSawCancel{false};
+
+  const uint64_t first = runner.start("silence", jobs::Priority::Interactive, true, [&](const std::atomic<bool>& cancel) {
+    firstWasCurrent.store(jobs::currentJob() != nullptr && jobs::currentJob()->kind == "silence");
+    firstRunning.store(true);
+    while (!release.load()) std::this_thread::sleep_for(1ms);
+    firstSawCancel.store(cancel.load());
+    firstDone.store(true);
+  });
+  CHECK(eventually([&] { return firstRunning.load(); }));
+  const uint64_t second = runner.start("silence", jobs::Priority::Interactive, true, [&](const std::atomic<bool>&) {
+    secondRan.store(true);
+  });
+  const uint64_t third = runner.start("silence", jobs::Priority::Interactive, true, [&](const std::atomic<bool>&) {
+    if (!firstDone.load()) overlapped.store(true);
+  });
+  CHECK(first < second && second < third);
+
+  // Another kind runs alongside.
+  const uint64_t other = runner.start("render", jobs::Priority::Background, false, [](const std::atomic<bool>&) {});
+  CHECK(eventually([&] { return recorder.statusOf(other) == "ok"; }));
+  CHECK(recorder.statusOf(first) == "running");
+
+  const auto active = runner.active();
+  CHECK(active.size() == 1 && active[0].id == third && active[0].kind == "silence" && !active[0].cancelled);
+
+  release.store(true);
+  runner.waitIdle();
+  CHECK(firstWasCurrent.load() && firstSawCancel.load());
+  CHECK(recorder.statusOf(first) == "cancelled");
+  CHECK(recorder.statusOf(second) == "cancelled");
+  CHECK(!secondRan.load());
+  CHECK(recorder.statusOf(third) == "ok");
+  CHECK(!overlapped.load());
+  CHECK(recorder.started == std::vector<uint64_t>({ first, second, third, other }));
+  CHECK(runner.active().empty());
+}
+
+void cancelAndFailure() {
+  Recorder recorder;
+  jobs::Runner runner(recorder.events());
+  const auto untilCancelled = [](const std::atomic<bool>& cancel) {
+    while (!cancel.load()) std::this_thread::sleep_for(1ms);
+  };
+  const uint64_t byId = runner.start("denoise", jobs::Priority::Background, false, untilCancelled);
+  const uint64_t byKind = runner.start("loudness", jobs::Priority::Interactive, true, untilCancelled);
+  const uint64_t failing = runner.start("export", jobs::Priority::Background, false, [](const std::atomic<bool>&) {
+    jobs::reportFailure();
+  });
+  CHECK(runner.cancelJob(byId));
+  runner.cancel("loudness");
+  runner.waitIdle();
+  CHECK(recorder.statusOf(byId) == "cancelled");
+  CHECK(recorder.statusOf(byKind) == "cancelled");
+  CHECK(recorder.statusOf(failing) == "error");
+  CHECK(!runner.cancelJob(byId));
+  CHECK(!runner.cancelJob(999));
+
+  // Stopping cancels whatever is still running.
+  const uint64_t left = runner.start("denoise", jobs::Priority::Background, false, untilCancelled);
+  runner.stopAll();
+  CHECK(recorder.statusOf(left) == "cancelled");
+}
+
+} // namespace
+
+int main() {
+  ownQueueOrder();
+  stealing();
+  loops();
+  progressAndFailure();
+  superseding();
+  cancelAndFailure();
+  return check::finish("job-system");
+}
@@ -0,0 +1,177 @@
+// src/Loudness.h: integrated loudness and true peak of the EBU Tech 3341
+// reference signals, the absolute and relative gates, loudness over
+// original-time ranges, clips shorter than one block, and the
+// normalisation gain with its limits.
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "Loudness.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRate = 48000.0;
+
+// A signal computed sample by sample, the same on every channel.
+class SyntheticReader : public SampleReader {
+public:
+  SyntheticReader(int channels, int64_t frames, std::function<float(int64_t)> fn)
+      : channels(channels), frames(frames), fn(std::move(fn)) {}
+
+  int numChannels() const override { return channels; }
+  double sampleRate() const override { return kRate; }
+  int64_t lengthInSamples() const override { return frames; }
+
+  bool read(float* const* dest, int destChannels, int64_t start, int numSamples) override {
+    for (int ch = 0; ch < destChannels; ++ch) {
+      for (int i = 0; i < numSamples; ++i) {
+        const int64_t n = start + i;
+        dest[ch][i] = n >= 0 && n < frames ? fn(n) : 0.0f;
+      }
+    }
+    return true;
+  }
+
+private:
+  int channels;
+  int64_t frames;
+  std::function<float(int64_t)> fn;
+};
+
+std::shared_ptr<loudness::Analysis> analyse(double seconds, std::function<float(int64_t)> fn) {
+  const int64_t frames = (int64_t) std::llround(seconds * kRate);
+  const SampleReaderFactory factory = [=]() -> std::unique_ptr<SampleReader> {
+    return std::make_unique<SyntheticReader>(2, frames, fn);
+  };
+  return loudness::analyse(factory, 2);
+}
+
+double amplitude(double dbfs) { return std::pow(10.0, dbfs / 20.0); }
+
+// A 1 kHz sine whose peak level, in dBFS, follows `levelAt` (seconds).
+std::function<float(int64_t)> sine(std::function<double(double)> levelAt) {
+  return [=](int64_t n) {
+    const double t = (double) n / kRate;
+    return (float) (amplitude(levelAt(t)) * std::sin(2.0 * kPi * 1000.0 * t));
+  };
+}
+
+bool near(double a, double b, double tolerance) { return std::fabs(a - b) <= tolerance; }
+
+loudness::Summary whole(const loudness::Analysis& analysis) {
+  return loudness::summarise(analysis, loudness::wholeSource(analysis));
+}
+
+// Tech 3341 cases 1 and 2: steady stereo sines, integrated within 0.1 LU.
+void steadyTones() {
+  for (const double level : { -23.0, -33.0 }) {
+    const auto analysis = analyse(20.0, sine([=](double) { return level; }));
+    CHECK(analysis != nullptr);
+    CHECK(analysis->stepPower.size() == 200);
+    const auto summary = whole(*analysis);
+    CHECK(near(summary.integratedLufs, level, 0.1));
+    CHECK(near(summary.momentaryMaxLufs, level, 0.1));
+    CHECK(near(summary.shortTermMaxLufs, level, 0.1));
+    CHECK(near(summary.durationSec, 20.0, 1e-9));
+  }
+}
+
+// Tech 3341 cases 3 and 4: quieter stretches around a -23 dBFS one are
+// dropped by the relative gate, -72 dBFS ones by the absolute gate too.
+void gating() {
+  const auto three = analyse(80.0, sine([](double t) { return t >= 10.0 && t < 70.0 ? -23.0 : -36.0; }));
+  CHECK(near(whole(*three).integratedLufs, -23.0, 0.1));
+
+  const auto four = analyse(100.0, sine([](double t) {
+    if (t < 10.0 || t >= 90.0) return -72.0;
+    if (t < 20.0 || t >= 80.0) return -36.0;
+    return -23.0;
+  }));
+  CHECK(near(whole(*four).integratedLufs, -23.0, 0.1));
+
+  // Nothing above the absolute gate: no integrated loudness at all.
+  const auto quiet = analyse(5.0, sine([](double) { return -75.0; }));
+  CHECK(std::isinf(whole(*quiet).integratedLufs));
+  CHECK(loudness::normalisationGainDb(whole(*quiet), -16.0, -1.0) == 0.0);
+}
+
+// Tech 3341 true-peak case: a quarter-rate sine 45 degrees off the sample
+// grid peaks at -6 dBFS between samples of -3 dBTP; BS.1770 allows
+// +0.2 / -0.4 dB.
+void truePeak() {
+  const auto analysis = analyse(1.0, [](int64_t n) {
+    return (float) (amplitude(-3.0) * std::sin(kPi / 2.0 * (double) n + kPi / 4.0));
+  });
+  const auto summary = whole(*analysis);
+  CHECK(summary.truePeakDbtp <= -3.0 + 0.2);
+  CHECK(summary.truePeakDbtp >= -3.0 - 0.4);
+
+  // On the grid the sample peak is the true peak.
+  const auto onGrid = analyse(1.0, [](int64_t n) {
+    return (float) (amplitude(-6.0) * std::sin(kPi / 2.0 * (double) n + kPi / 2.0));
+  });
+  const double peak = whole(*onGrid).truePeakDbtp;
+  CHECK(peak <= -6.0 + 0.2 && peak >= -6.0 - 0.4);
+}
+
+// Loudness of original-time ranges uses only the steps inside them.
+void ranges() {
+  const auto analysis = analyse(30.0, sine([](double t) { return t < 10.0 ? -23.0 : t < 20.0 ? -43.0 : -33.0; }));
+  const auto runs = loudness::stepRunsFor(*analysis, { { 20.0, 30.0 }, { 0.0, 5.0 }, { 4.0, 6.0 }, { 7.0, 7.0 } });
+  CHECK(runs == std::vector<loudness::StepRun>({ { 0, 60 }, { 200, 300 } }));
+
+  const auto loud = loudness::summarise(*analysis, loudness::stepRunsFor(*analysis, { { 0.0, 10.0 } }));
+  CHECK(near(loud.integratedLufs, -23.0, 0.1));
+  CHECK(near(loud.durationSec, 10.0, 1e-9));
+  const auto soft = loudness::summarise(*analysis, loudness::stepRunsFor(*analysis, { { 20.0, 30.0 } }));
+  CHECK(near(soft.integratedLufs, -33.0, 0.1));
+  // Past the end of the source nothing is left.
+  CHECK(loudness::stepRunsFor(*analysis, { { 40.0, 50.0 } }).empty());
+}
+
+// A clip shorter than one 400 ms block reports its ungated level.
+void shortClip() {
+  const auto analysis = analyse(20.0, sine([](double) { return -23.0; }));
+  const auto summary = loudness::summarise(*analysis, loudness::stepRunsFor(*analysis, { { 5.0, 5.3 } }));
+  CHECK(near(summary.integratedLufs, -23.0, 0.1));
+  CHECK(std::isinf(summary.momentaryMaxLufs));
+}
+
+void normalisation() {
+  loudness::Summary summary;
+  summary.integratedLufs = -23.0;
+  summary.truePeakDbtp = -10.0;
+  CHECK(near(loudness::normalisationGainDb(summary, -16.0, -1.0), 7.0, 1e-9));
+  CHECK(near(loudness::normalisationGainDb(summary, -30.0, -1.0), -7.0, 1e-9));
+  // The true-peak ceiling wins over the target.
+  summary.truePeakDbtp = -4.0;
+  CHECK(near(loudness::normalisationGainDb(summary, -16.0, -1.0), 3.0, 1e-9));
+  // Boosts and cuts stay within maxGainDb.
+  summary.integratedLufs = -50.0;
+  summary.truePeakDbtp = -40.0;
+  CHECK(near(loudness::normalisationGainDb(summary, -16.0, -1.0), 20.0, 1e-9));
+  CHECK(near(loudness::normalisationGainDb(summary, -16.0, -1.0, 12.0), 12.0, 1e-9));
+}
+
+void unreadableFileFails() {
+  const SampleReaderFactory none = []() -> std::unique_ptr<SampleReader> { return nullptr; };
+  CHECK(loudness::analyse(none, 2) == nullptr);
+}
+
+} // namespace
+
+int main() {
+  steadyTones();
+  gating();
+  truePeak();
+  ranges();
+  shortClip();
+  normalisation();
+  unreadableFileFails();
+  return check::finish("loudness");
+}
@@ -0,0 +1,123 @@
+// src/Resampler.h: bit-exact bypass at a ratio of 1, the same latency for
+// every preset and ratio, and a floor on the residual for a test tone.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Check.h"
+#include "Resampler.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kBlock = 512;
+
+// Renders `frames` output samples of one channel from gen(inputIndex), in
+// blocks of kBlock like the playback callback.
+template <typename Gen>
+std::vector<float> render(const dsp::ResamplerQuality& quality, double ratio, int frames, Gen gen) {
+  int taps = 0;
+  double cutoff = 1.0;
+  dsp::PolyphaseResampler::filterShape(quality, ratio, taps, cutoff);
+  auto filter = dsp::designPolyphaseFilter(taps, cutoff, quality.beta);
+  dsp::PolyphaseResampler resampler;
+  resampler.prepare(1, 4096);
+  std::vector<float> out((size_t) frames);
+  int64_t consumed = 0;
+  for (int done = 0; done < frames;) {
+    const int n = std::min({ kBlock, frames - done, resampler.maxOutput(ratio) });
+    const int need = resampler.inputNeeded(n, ratio);
+    float* in = resampler.input(0);
+    for (int i = 0; i < need; ++i) in[i] = gen(consumed + i);
+    float* ptr = out.data() + done;
+    resampler.process(*filter, need, &ptr, 1, n, ratio);
+    consumed += need;
+    done += n;
+  }
+  return out;
+}
+
+float noise(int64_t i) {
+  uint32_t x = (uint32_t) i * 2654435761u + 12345u;
+  x ^= x >> 15;
+  x *= 2246822519u;
+  x ^= x >> 13;
+  return (float) ((int32_t) x) / 2147483648.0f;
+}
+
+void bypassIsExact() {
+  for (const auto* quality : { &dsp::kDraftResampling, &dsp::kStandardResampling, &dsp::kHighResampling }) {
+    const int frames = 10000;
+    auto out = render(*quality, 1.0, frames, noise);
+    bool exact = true;
+    for (int n = 0; n < frames; ++n) {
+      const int64_t i = n - dsp::PolyphaseResampler::kLatency;
+      const float expected = i < 0 ? 0.0f : noise(i);
+      if (out[(size_t) n] != expected) exact = false;
+    }
+    CHECK(exact);
+  }
+}
+
+// An impulse at input sample `at` peaks at output n where n * ratio = at +
+// kLatency, whichever preset and ratio.
+void latencyIsConstant() {
+  const int at = 1000;
+  for (const double ratio : { 0.5, 0.8, 1.25, 2.0 }) {
+    const double center = (at + dsp::PolyphaseResampler::kLatency) / ratio;
+    for (const auto* quality : { &dsp::kDraftResampling, &dsp::kStandardResampling, &dsp::kHighResampling }) {
+      auto out = render(*quality, ratio, (int) center + 200, [&](int64_t i) { return i == at ? 1.0f : 0.0f; });
+      const auto peak = std::max_element(out.begin(), out.end()) - out.begin();
+      CHECK(std::fabs((double) peak - center) <= 0.5);
+    }
+  }
+}
+
+// Residual after removing the best-fitting sine of frequency cycles/sample.
+double residualDb(const std::vector<float>& y, size_t skip, double cyclesPerSample) {
+  double cc = 0.0, ss = 0.0, cs = 0.0, yc = 0.0, ys = 0.0;
+  for (size_t n = skip; n < y.size(); ++n) {
+    const double w = 2.0 * kPi * cyclesPerSample * (double) n;
+    const double c = std::cos(w), s = std::sin(w);
+    cc += c * c;
+    ss += s * s;
+    cs += c * s;
+    yc += y[n] * c;
+    ys += y[n] * s;
+  }
+  const double det = cc * ss - cs * cs;
+  const double a = (yc * ss - ys * cs) / det;
+  const double b = (ys * cc - yc * cs) / det;
+  double err = 0.0, sig = 0.0;
+  for (size_t n = skip; n < y.size(); ++n) {
+    const double w = 2.0 * kPi * cyclesPerSample * (double) n;
+    const double fit = a * std::cos(w) + b * std::sin(w);
+    err += (y[n] - fit) * (y[n] - fit);
+    sig += fit * fit;
+  }
+  return 10.0 * std::log10(std::max(err, 1e-30) / std::max(sig, 1e-30));
+}
+
+// 1 kHz through the default preset for the common conversions.
+void snrAboveFloor() {
+  const struct {
+    double fileRate, deviceRate;
+  } conversions[] = { { 44100.0, 48000.0 }, { 48000.0, 44100.0 }, { 96000.0, 48000.0 } };
+  for (const auto& conv : conversions) {
+    const double ratio = conv.fileRate / conv.deviceRate;
+    const double step = 2.0 * kPi * 1000.0 / conv.fileRate;
+    auto out = render(dsp::kStandardResampling, ratio, 1 << 14,
+                      [&](int64_t i) { return (float) (0.5 * std::sin(step * (double) i)); });
+    CHECK(residualDb(out, 1024, 1000.0 / conv.deviceRate) < -100.0);
+  }
+}
+
+} // namespace
+
+int main() {
+  bypassIsExact();
+  latencyIsConstant();
+  snrAboveFloor();
+  return check::finish("resampler");
+}
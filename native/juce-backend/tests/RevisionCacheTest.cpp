@@ -0,0 +1,113 @@
+// src/RevisionCache.h: content keys, lookup by content and by revision
+// number, revisions resent under a new number, and least-recently-used
+// eviction within the byte budget.
+#include <memory>
+#include <string>
+
+#include "Check.h"
+#include "RevisionCache.h"
+
+namespace {
+
+EdlContentKey keyOf(const std::string& text) { return EdlContentKey::of(text.data(), text.size()); }
+
+std::shared_ptr<const std::string> value(const std::string& text) { return std::make_shared<const std::string>(text); }
+
+void contentKeys() {
+  // Long enough for the four lanes, an 8-byte tail and a byte tail.
+  const std::string clips(32 * 3 + 8 + 5, 'x');
+  CHECK(keyOf(clips) == keyOf(std::string(clips)));
+  CHECK(keyOf(clips).size == clips.size());
+  CHECK(keyOf(clips).valid());
+  CHECK(!keyOf("").valid());
+  // A change anywhere, or in length alone, gives another key.
+  for (const size_t at : { (size_t) 0, (size_t) 40, (size_t) 100, clips.size() - 1 }) {
+    std::string changed = clips;
+    changed[at] = 'y';
+    CHECK(!(keyOf(changed) == keyOf(clips)));
+  }
+  CHECK(!(keyOf(clips + "x") == keyOf(clips)));
+  CHECK(!(keyOf("[1]") == keyOf("[2]")));
+}
+
+void lookups() {
+  RevisionCache<std::string> cache(1000);
+  CHECK(cache.findContent(keyOf("a")) == nullptr);
+  CHECK(cache.findRevision(1) == nullptr);
+
+  cache.insert(1, keyOf("a"), value("A"), 10);
+  cache.insert(2, keyOf("b"), value("B"), 10);
+  CHECK(*cache.findContent(keyOf("a")) == "A");
+  CHECK(*cache.findRevision(2) == "B");
+  CHECK(cache.findRevision(3) == nullptr);
+  CHECK(cache.findContent(keyOf("c")) == nullptr);
+
+  // Identical content resent as revision 3 reaches the same entry.
+  cache.addRevision(3, keyOf("a"));
+  CHECK(cache.findRevision(3) == cache.findRevision(1));
+  // Unknown content gets no revision.
+  cache.addRevision(4, keyOf("c"));
+  CHECK(cache.findRevision(4) == nullptr);
+
+  const auto stats = cache.stats();
+  CHECK(stats.entries == 2);
+  CHECK(stats.bytes == 20);
+  CHECK(stats.maxBytes == 1000);
+  CHECK(stats.hits == 4);
+  CHECK(stats.misses == 5);
+  CHECK(stats.evictions == 0);
+
+  // Inserting the same content again replaces the entry and its revisions.
+  cache.insert(5, keyOf("a"), value("A2"), 30);
+  CHECK(*cache.findRevision(5) == "A2");
+  CHECK(cache.findRevision(1) == nullptr);
+  CHECK(cache.findRevision(3) == nullptr);
+  CHECK(cache.stats().entries == 2);
+  CHECK(cache.stats().bytes == 40);
+
+  cache.clear();
+  CHECK(cache.stats().entries == 0 && cache.stats().bytes == 0);
+  CHECK(cache.findContent(keyOf("b")) == nullptr);
+}
+
+void eviction() {
+  RevisionCache<std::string> cache(100);
+  cache.insert(1, keyOf("a"), value("A"), 40);
+  cache.insert(2, keyOf("b"), value("B"), 40);
+  // Using "a" makes "b" the least recently used.
+  CHECK(cache.findRevision(1) != nullptr);
+  cache.insert(3, keyOf("c"), value("C"), 40);
+  CHECK(cache.stats().evictions == 1);
+  CHECK(cache.stats().bytes == 80);
+  CHECK(cache.findContent(keyOf("b")) == nullptr);
+  CHECK(cache.findRevision(2) == nullptr);
+  CHECK(cache.findRevision(1) != nullptr);
+  CHECK(cache.findRevision(3) != nullptr);
+
+  // An entry larger than the budget is not kept and evicts nothing.
+  cache.insert(4, keyOf("d"), value("D"), 101);
+  CHECK(cache.findRevision(4) == nullptr);
+  CHECK(cache.stats().entries == 2);
+
+  // A smaller budget trims from the least recently used end.
+  cache.setMaxBytes(50);
+  CHECK(cache.stats().evictions == 2);
+  CHECK(cache.findRevision(1) == nullptr);
+  CHECK(*cache.findRevision(3) == "C");
+  CHECK(cache.stats().bytes == 40);
+
+  // Evicted values stay alive for whoever still holds them.
+  const auto held = cache.findRevision(3);
+  cache.setMaxBytes(0);
+  CHECK(cache.stats().entries == 0);
+  CHECK(*held == "C");
+}
+
+} // namespace
+
+int main() {
+  contentKeys();
+  lookups();
+  eviction();
+  return check::finish("revision-cache");
+}
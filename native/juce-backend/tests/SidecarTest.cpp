@@ -0,0 +1,215 @@
+// src/Sidecar.h: saving appends only what changed, tags shorter than four
+// characters are padded and found either way, a torn or damaged tail falls
+// back to the previous trailer, damaged payloads are refused and a file
+// mostly made of dead chunks is rewritten.
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Check.h"
+#include "Sidecar.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A fresh file name in the temp directory, removed when done.
+class TempPath {
+public:
+  TempPath() {
+    const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    path = (fs::temp_directory_path() / ("sidecar-test-" + std::to_string(stamp) + "-" + std::to_string(++serial))).string();
+  }
+  ~TempPath() {
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove(path + ".part", ec);
+  }
+
+  std::string path;
+
+private:
+  static inline int serial = 0;
+};
+
+std::string payloadOf(const sidecar::Reader& reader, std::string_view tag, std::string_view name) {
+  std::string_view bytes;
+  return reader.payload(tag, name, bytes) ? std::string(bytes) : std::string("<missing>");
+}
+
+bool readable(const std::string& path, sidecar::Reader& reader) {
+  std::string error;
+  return reader.open(path, error);
+}
+
+void overwriteByte(const std::string& path, uint64_t offset) {
+  std::FILE* f = std::fopen(path.c_str(), "r+b");
+  CHECK(f != nullptr);
+  std::fseek(f, (long) offset, SEEK_SET);
+  const int old = std::fgetc(f);
+  std::fseek(f, (long) offset, SEEK_SET);
+  std::fputc(old ^ 0x5a, f);
+  std::fclose(f);
+}
+
+void appendBytes(const std::string& path, const std::string& bytes) {
+  std::FILE* f = std::fopen(path.c_str(), "ab");
+  CHECK(f != nullptr);
+  std::fwrite(bytes.data(), 1, bytes.size(), f);
+  std::fclose(f);
+}
+
+void appends() {
+  TempPath temp;
+  auto first = sidecar::save(temp.path, { { "peak", "", "peaks v1" }, { "lufs", "-16", "loudness" } });
+  CHECK(first.ok);
+  CHECK(first.generation == 1);
+  CHECK(!first.compacted);
+  CHECK(first.chunks.size() == 2 && first.chunks[0].second && first.chunks[1].second);
+
+  sidecar::Reader reader;
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.version() == sidecar::kVersion);
+  CHECK(reader.generation() == 1);
+  CHECK(reader.entries().size() == 2);
+  CHECK(payloadOf(reader, "peak", "") == "peaks v1");
+  CHECK(payloadOf(reader, "lufs", "-16") == "loudness");
+  CHECK(reader.find("lufs", "-23") == nullptr);
+  CHECK(reader.committedBytes() == reader.totalBytes());
+
+  // Unchanged chunks are not written again; changed and new ones are
+  // appended and the rest kept where they were.
+  const uint64_t lufsOffset = reader.find("lufs", "-16")->offset;
+  const auto same = sidecar::save(temp.path, { { "peak", "", "peaks v1" } });
+  CHECK(same.ok && same.generation == 2);
+  CHECK(same.chunks.size() == 2 && !same.chunks[0].second && !same.chunks[1].second);
+  const auto changed = sidecar::save(temp.path, { { "peak", "", "peaks v2" }, { "lufs", "-23", "louder" } });
+  CHECK(changed.ok && changed.generation == 3);
+  CHECK(changed.appendedBytes < changed.fileBytes);
+
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.generation() == 3);
+  CHECK(reader.entries().size() == 3);
+  CHECK(payloadOf(reader, "peak", "") == "peaks v2");
+  CHECK(payloadOf(reader, "lufs", "-16") == "loudness");
+  CHECK(payloadOf(reader, "lufs", "-23") == "louder");
+  CHECK(reader.find("lufs", "-16")->offset == lufsOffset);
+  CHECK(reader.liveBytes() < reader.committedBytes());
+}
+
+void shortTags() {
+  CHECK(sidecar::tagKey("pk") == "pk  ");
+  CHECK(sidecar::tagKey("") == "    ");
+  CHECK(sidecar::tagKey("spectrogram") == "spec");
+
+  TempPath temp;
+  CHECK(sidecar::save(temp.path, { { "pk", "", "short" }, { "spectrogram", "1024", "long" } }).ok);
+  sidecar::Reader reader;
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.entries()[0].tag == "pk  ");
+  CHECK(payloadOf(reader, "pk", "") == "short");
+  CHECK(payloadOf(reader, "pk  ", "") == "short");
+  CHECK(payloadOf(reader, "spec", "1024") == "long");
+  CHECK(payloadOf(reader, "spectrogram", "1024") == "long");
+  CHECK(reader.find("pk", "x") == nullptr);
+
+  // Saving under the short tag again finds the padded chunk unchanged.
+  const auto again = sidecar::save(temp.path, { { "pk", "", "short" } });
+  CHECK(again.ok && again.chunks.size() == 2 && !again.chunks[0].second);
+}
+
+void tornTail() {
+  TempPath temp;
+  CHECK(sidecar::save(temp.path, { { "peak", "", "first" } }).ok);
+  const auto second = sidecar::save(temp.path, { { "peak", "", "second" } });
+  CHECK(second.ok);
+
+  // A save that stopped partway: bytes past the last trailer are skipped.
+  appendBytes(temp.path, std::string(50, 'j'));
+  sidecar::Reader reader;
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.generation() == 2);
+  CHECK(reader.committedBytes() == second.fileBytes);
+  CHECK(reader.totalBytes() > reader.committedBytes());
+  CHECK(payloadOf(reader, "peak", "") == "second");
+
+  // A trailer cut short leaves the previous one in use.
+  fs::resize_file(temp.path, second.fileBytes - 3);
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.generation() == 1);
+  CHECK(payloadOf(reader, "peak", "") == "first");
+
+  // The next save appends after the damage and is read from then on.
+  const auto third = sidecar::save(temp.path, { { "peak", "", "third" } });
+  CHECK(third.ok && third.generation == 2);
+  CHECK(readable(temp.path, reader));
+  CHECK(payloadOf(reader, "peak", "") == "third");
+
+  // An index that fails its hash is passed over for the trailer before it.
+  const uint64_t indexOffset = third.fileBytes - sidecar::kTrailerBytes - 8;
+  overwriteByte(temp.path, indexOffset);
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.damagedTrailers() == 1);
+  CHECK(payloadOf(reader, "peak", "") == "first");
+}
+
+void damagedPayload() {
+  TempPath temp;
+  CHECK(sidecar::save(temp.path, { { "peak", "", "payload bytes" } }).ok);
+  sidecar::Reader reader;
+  CHECK(readable(temp.path, reader));
+  const uint64_t offset = reader.find("peak")->offset;
+  overwriteByte(temp.path, offset + 2);
+  CHECK(readable(temp.path, reader));
+  std::string_view bytes;
+  CHECK(!reader.payload("peak", "", bytes));
+}
+
+void notASidecar() {
+  TempPath temp;
+  sidecar::Reader reader;
+  std::string error;
+  CHECK(!reader.open(temp.path, error));
+  CHECK(!error.empty());
+  appendBytes(temp.path, std::string(100, 'x'));
+  error.clear();
+  CHECK(!reader.open(temp.path, error));
+  CHECK(error.find("not a sidecar") != std::string::npos);
+}
+
+void compaction() {
+  TempPath temp;
+  const std::string big(1536 * 1024, 'a');
+  CHECK(sidecar::save(temp.path, { { "keep", "", "kept" }, { "big", "", big } }).ok);
+  bool compacted = false;
+  for (char c = 'b'; c < 'g' && !compacted; ++c) {
+    const auto result = sidecar::save(temp.path, { { "big", "", std::string(big.size(), c) } });
+    CHECK(result.ok);
+    compacted = result.compacted;
+  }
+  CHECK(compacted);
+  CHECK(!fs::exists(temp.path + ".part"));
+
+  sidecar::Reader reader;
+  CHECK(readable(temp.path, reader));
+  CHECK(reader.entries().size() == 2);
+  CHECK(payloadOf(reader, "keep", "") == "kept");
+  CHECK(payloadOf(reader, "big", "").size() == big.size());
+  CHECK(reader.committedBytes() < 2 * big.size());
+  CHECK(reader.totalBytes() == reader.committedBytes());
+}
+
+} // namespace
+
+int main() {
+  appends();
+  shortTags();
+  tornTail();
+  damagedPayload();
+  notASidecar();
+  compaction();
+  return check::finish("sidecar");
+}
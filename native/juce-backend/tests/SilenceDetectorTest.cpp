@@ -0,0 +1,150 @@
+// src/SilenceDetector.h: silent intervals of a synthetic signal, with the
+// hangover, minimum duration, threshold, loudest-channel rule and the ends
+// of the file, plus spacer refinement against the result.
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Check.h"
+#include "SilenceDetector.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRate = 48000.0;
+
+// A signal computed sample by sample for each channel.
+class SyntheticReader : public SampleReader {
+public:
+  SyntheticReader(int channels, int64_t frames, std::function<float(int, int64_t)> fn)
+      : channels(channels), frames(frames), fn(std::move(fn)) {}
+
+  int numChannels() const override { return channels; }
+  double sampleRate() const override { return kRate; }
+  int64_t lengthInSamples() const override { return frames; }
+
+  bool read(float* const* dest, int destChannels, int64_t start, int numSamples) override {
+    for (int ch = 0; ch < destChannels; ++ch) {
+      for (int i = 0; i < numSamples; ++i) {
+        const int64_t n = start + i;
+        dest[ch][i] = n >= 0 && n < frames ? fn(ch, n) : 0.0f;
+      }
+    }
+    return true;
+  }
+
+private:
+  int channels;
+  int64_t frames;
+  std::function<float(int, int64_t)> fn;
+};
+
+bool within(double t, double a, double b) { return t >= a && t < b; }
+
+// Ten seconds and 100 samples of stereo: a 100 Hz tone at -9 dBFS,
+// interrupted by
+//   [0, 0.5)     digital silence, at the start of the file
+//   [1, 2)       digital silence
+//   [3, 3.2)     digital silence, too short once the hangover is taken off
+//   [5, 6)       the tone at -63 dBFS
+//   [7, 8)       the left channel silent, the right still playing
+//   [8.5, 9)     the tone at -37 dBFS
+//   [9.5, end)   digital silence, to the end of the file
+constexpr int64_t kLength = 480000 + 100;
+
+float signal(int ch, int64_t n) {
+  const double t = (double) n / kRate;
+  double level = 0.5;
+  if (within(t, 0.0, 0.5) || within(t, 1.0, 2.0) || within(t, 3.0, 3.2) || t >= 9.5) level = 0.0;
+  else if (within(t, 5.0, 6.0)) level = 0.001;
+  else if (within(t, 7.0, 8.0) && ch == 0) level = 0.0;
+  else if (within(t, 8.5, 9.0)) level = 0.02;
+  return (float) (level * std::sin(2.0 * kPi * 100.0 * t));
+}
+
+SilenceResult detect(double thresholdDb) {
+  const SampleReaderFactory factory = []() -> std::unique_ptr<SampleReader> {
+    return std::make_unique<SyntheticReader>(2, kLength, signal);
+  };
+  SilenceParams params;
+  params.thresholdDb = thresholdDb;
+  params.threads = 2;
+  return detectSilence(factory, params);
+}
+
+bool near(double a, double b) { return std::fabs(a - b) < 1e-9; }
+
+bool matches(const std::vector<SilenceInterval>& intervals, const std::vector<SilenceInterval>& expected) {
+  if (intervals.size() != expected.size()) return false;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    if (!near(intervals[i].startSec, expected[i].startSec) || !near(intervals[i].endSec, expected[i].endSec)) return false;
+  }
+  return true;
+}
+
+void intervals() {
+  const SilenceResult result = detect(-45.0);
+  CHECK(result.ok);
+  CHECK(near(result.frameSec, 0.01));
+  CHECK(near(result.analysedSec, kLength / kRate));
+  CHECK(result.frameDb.size() == 1001); // the last frame is 100 samples
+  // Hangover (50 ms) comes off both sides, except at the ends of the file;
+  // the last interval ends at the end of the audio, not of its last frame.
+  CHECK(matches(result.intervals, {
+    { 0.0, 0.45 },
+    { 1.05, 1.95 },
+    { 5.05, 5.95 },
+    { 9.55, kLength / kRate },
+  }));
+  CHECK(result.frameDb[150] <= -120.0f);
+  CHECK(std::fabs(result.frameDb[550] - -63.0f) < 0.5f);
+  CHECK(std::fabs(result.frameDb[750] - -9.0f) < 0.5f);
+}
+
+void threshold() {
+  // At -30 dB the -37 dBFS stretch is silent as well.
+  const SilenceResult result = detect(-30.0);
+  CHECK(result.ok);
+  CHECK(matches(result.intervals, {
+    { 0.0, 0.45 },
+    { 1.05, 1.95 },
+    { 5.05, 5.95 },
+    { 8.55, 8.95 },
+    { 9.55, kLength / kRate },
+  }));
+  // At -70 dB only digital silence is.
+  CHECK(detect(-70.0).intervals.size() == 3);
+}
+
+void spacers() {
+  const SilenceResult result = detect(-45.0);
+  double start = 0.0, end = 0.0;
+  // The silence inside the spacer, moved at most 0.2 s.
+  CHECK(refineSpacerBounds(result.intervals, 0.9, 2.1, 0.2, start, end));
+  CHECK(near(start, 1.05) && near(end, 1.95));
+  // Clipped to the spacer grown by maxShiftSec.
+  CHECK(refineSpacerBounds(result.intervals, 0.9, 1.2, 0.1, start, end));
+  CHECK(near(start, 1.05) && near(end, 1.3));
+  // Of two overlapping silences, the one overlapping most.
+  CHECK(refineSpacerBounds(result.intervals, 0.3, 1.3, 0.0, start, end));
+  CHECK(near(start, 1.05) && near(end, 1.3));
+  // No silence near it.
+  CHECK(!refineSpacerBounds(result.intervals, 7.2, 7.8, 0.1, start, end));
+}
+
+void unreadableFileFails() {
+  const SampleReaderFactory none = []() -> std::unique_ptr<SampleReader> { return nullptr; };
+  CHECK(!detectSilence(none, SilenceParams()).ok);
+}
+
+} // namespace
+
+int main() {
+  intervals();
+  threshold();
+  spacers();
+  unreadableFileFails();
+  return check::finish("silence-detector");
+}
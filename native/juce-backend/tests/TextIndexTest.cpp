@@ -0,0 +1,135 @@
+// src/TextIndex.h: tokenising, word, phrase and prefix lookups, time
+// windows and result limits over a small transcript.
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TextIndex.h"
+
+namespace {
+
+// One segment per second; segment i is edited [i, i + 1), original
+// [10 + i, 11 + i).
+TextIndex transcript(const std::vector<std::string>& segments) {
+  TextIndex index;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    TimelineSpan span;
+    span.editedStart = (double) i;
+    span.editedEnd = (double) i + 1.0;
+    span.originalStart = 10.0 + (double) i;
+    span.originalEnd = 11.0 + (double) i;
+    span.clipIndex = 0;
+    span.segmentIndex = (int) i;
+    index.add(segments[i], span);
+  }
+  index.finish();
+  return index;
+}
+
+const std::vector<std::string> kSegments = {
+  "The", "cat", "sat", "on", "the", "mat.", "The", "car", "was", "red,", "the", "cat", "wasn't", "New York", "cats'",
+};
+
+// First words of the matches, checking each covers `count` words.
+std::vector<size_t> firsts(const std::vector<TextMatch>& matches, size_t count) {
+  std::vector<size_t> out;
+  for (const auto& m : matches) {
+    CHECK(m.count == count);
+    out.push_back(m.first);
+  }
+  return out;
+}
+
+using Words = std::vector<size_t>;
+constexpr double kAll = 1e9;
+
+void tokenising() {
+  CHECK(TextIndex::tokenise("Don't STOP, it\xE2\x80\x99s fine.") ==
+        std::vector<std::string>({ "don't", "stop", "it's", "fine" }));
+  CHECK(TextIndex::tokenise("'quoted' dogs' -- 42nd") == std::vector<std::string>({ "quoted", "dogs", "42nd" }));
+  CHECK(TextIndex::tokenise(" ,. ").empty());
+  CHECK(TextIndex::tokenise("caf\xC3\xA9") == std::vector<std::string>({ "caf\xC3\xA9" }));
+}
+
+void words() {
+  const TextIndex index = transcript(kSegments);
+  CHECK(index.size() == 16); // "New York" is two words
+  size_t total = 99;
+  CHECK(firsts(index.find("cat", false, -kAll, kAll, 10, &total), 1) == Words({ 1, 11 }));
+  CHECK(total == 2);
+  // Case and punctuation in the query do not matter; other words do.
+  CHECK(firsts(index.find(" CAT! ", false, -kAll, kAll, 10), 1) == Words({ 1, 11 }));
+  CHECK(firsts(index.find("wasn\xE2\x80\x99t", false, -kAll, kAll, 10), 1) == Words({ 12 }));
+  CHECK(firsts(index.find("cats", false, -kAll, kAll, 10), 1) == Words({ 15 }));
+  CHECK(index.find("dog", false, -kAll, kAll, 10, &total).empty());
+  CHECK(total == 0);
+  CHECK(index.find("", false, -kAll, kAll, 10, &total).empty());
+  CHECK(total == 0);
+
+  // The total counts past maxResults; the window is on the word's start.
+  CHECK(firsts(index.find("the", false, -kAll, kAll, 2, &total), 1) == Words({ 0, 4 }));
+  CHECK(total == 4);
+  CHECK(firsts(index.find("the", false, 4.0, 10.0, 10, &total), 1) == Words({ 4, 6 }));
+  CHECK(total == 2);
+}
+
+void phrases() {
+  const TextIndex index = transcript(kSegments);
+  size_t total = 0;
+  CHECK(firsts(index.find("the cat", false, -kAll, kAll, 10, &total), 2) == Words({ 0, 10 }));
+  CHECK(total == 2);
+  CHECK(firsts(index.find("cat sat on", false, -kAll, kAll, 10), 3) == Words({ 1 }));
+  // Anchored on the rarer "red", still reported from the first word.
+  CHECK(firsts(index.find("was red the", false, -kAll, kAll, 10), 3) == Words({ 8 }));
+  CHECK(firsts(index.find("the cat", false, 1.0, kAll, 10), 2) == Words({ 10 }));
+  CHECK(firsts(index.find("the cat", false, -kAll, 10.0, 10), 2) == Words({ 0 }));
+  CHECK(index.find("the dog", false, -kAll, kAll, 10, &total).empty());
+  CHECK(total == 0);
+  CHECK(index.find("cat the", false, -kAll, kAll, 10).empty());
+
+  // Words of one segment share its times; phrases run across segments.
+  const auto york = index.find("new york cats", false, -kAll, kAll, 10);
+  CHECK(firsts(york, 3) == Words({ 13 }));
+  CHECK(index[14].editedStart == 13.0 && index[15].editedStart == 14.0);
+  // A phrase running off the end of the transcript.
+  CHECK(index.find("york cats dog", false, -kAll, kAll, 10).empty());
+  CHECK(index.find("cats cats", false, -kAll, kAll, 10).empty());
+}
+
+void prefixes() {
+  const TextIndex index = transcript(kSegments);
+  size_t total = 0;
+  CHECK(firsts(index.find("ca", true, -kAll, kAll, 10, &total), 1) == Words({ 1, 7, 11, 15 }));
+  CHECK(total == 4);
+  CHECK(firsts(index.find("ca", true, -kAll, kAll, 3, &total), 1) == Words({ 1, 7, 11 }));
+  CHECK(total == 4);
+  CHECK(firsts(index.find("the ca", true, -kAll, kAll, 10, &total), 2) == Words({ 0, 6, 10 }));
+  CHECK(total == 3);
+  CHECK(firsts(index.find("the ca", true, 5.0, kAll, 10), 2) == Words({ 6, 10 }));
+  CHECK(index.find("the z", true, -kAll, kAll, 10, &total).empty());
+  CHECK(total == 0);
+  // A whole word is its own prefix.
+  CHECK(firsts(index.find("mat", true, -kAll, kAll, 10), 1) == Words({ 5 }));
+}
+
+void ranges() {
+  const TextIndex index = transcript(kSegments);
+  CHECK(index.wordsInRange(2.5, 5.0) == std::make_pair(size_t(2), size_t(5)));
+  CHECK(index.wordsInRange(13.5, 13.6) == std::make_pair(size_t(13), size_t(15)));
+  CHECK(index.wordsInRange(20.0, 30.0).first == index.size());
+  CHECK(index.wordForSegment(13) == 13);
+  CHECK(index.wordForSegment(14) == 15);
+  CHECK(index.wordForSegment(99) == index.size());
+  CHECK(index[12].originalStart == 22.0);
+}
+
+} // namespace
+
+int main() {
+  tokenising();
+  words();
+  phrases();
+  prefixes();
+  ranges();
+  return check::finish("text-index");
+}
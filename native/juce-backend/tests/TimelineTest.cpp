@@ -0,0 +1,120 @@
+// src/Timeline.h: carrying a playhead into a new EDL with follow() and
+// remapEdited(), including the lookahead limit, positions past the end and
+// material that plays more than once.
+#include <cmath>
+#include <vector>
+
+#include "Check.h"
+#include "Timeline.h"
+
+namespace {
+
+bool near(double a, double b) { return std::fabs(a - b) < 1e-9; }
+
+// One-second spans playing original [k, k + 1) for each k in `kept`, in order.
+CompiledTimeline seconds(const std::vector<int>& kept) {
+  CompiledTimeline timeline;
+  for (const int k : kept) timeline.add(1.0, k, k + 1.0, 0, k);
+  timeline.finish();
+  return timeline;
+}
+
+CompiledTimeline range(int count) {
+  std::vector<int> kept;
+  for (int k = 0; k < count; ++k) kept.push_back(k);
+  return seconds(kept);
+}
+
+void sameTimelineKeepsPosition() {
+  const auto timeline = range(10);
+  for (const double t : { 0.0, 0.25, 3.5, 9.75 }) CHECK(near(timeline.remapEdited(timeline, t), t));
+}
+
+void cutsShiftThePlayhead() {
+  const auto before = range(10);
+  const auto after = seconds({ 0, 1, 4, 5, 6, 7, 8, 9 });
+  // Material after the cut moves two seconds earlier.
+  CHECK(near(after.remapEdited(before, 6.5), 4.5));
+  // Material before it stays put.
+  CHECK(near(after.remapEdited(before, 1.5), 1.5));
+  // A playhead on cut material goes to the next surviving material.
+  CHECK(near(after.remapEdited(before, 2.5), 2.0));
+  CHECK(near(after.remapEdited(before, 3.0), 2.0));
+}
+
+// follow() looks at most kMaxFollowSpans spans of `before` ahead.
+void lookaheadIsBounded() {
+  const size_t limit = CompiledTimeline::kMaxFollowSpans;
+  const auto before = range(200);
+  const int from = 10;
+
+  const auto reachable = seconds({ 0, from + (int) limit - 1 });
+  TimelinePlayhead at = reachable.follow(before, from, from + 0.5, from + 0.5);
+  CHECK(at.span == 1);
+  CHECK(near(at.originalSec, from + (double) limit - 1));
+  CHECK(near(reachable.remapEdited(before, from + 0.5), 1.0));
+
+  const auto unreachable = seconds({ 0, from + (int) limit });
+  at = unreachable.follow(before, from, from + 0.5, from + 0.5);
+  CHECK(at.span == unreachable.size());
+  // remapEdited() then keeps the edited time, within the new duration.
+  CHECK(near(unreachable.remapEdited(before, from + 0.5), unreachable.editedDuration()));
+  CHECK(near(unreachable.remapEdited(before, 0.5), 0.5));
+}
+
+void pastTheLastSpan() {
+  const auto before = range(10);
+  const auto after = seconds({ 0, 1, 2 });
+  CHECK(before.spanAtEdited(10.5) == before.size());
+  CHECK(near(before.editedToOriginal(12.0), 10.0));
+  CHECK(near(after.remapEdited(before, 12.0), 3.0));
+  CHECK(near(after.remapEdited(before, 10.0), 3.0));
+  // From the last span, with nothing surviving, the playhead is clamped.
+  CHECK(after.follow(before, before.size(), 10.0, 10.0).span == after.size());
+  CHECK(near(after.remapEdited(before, 9.5), 3.0));
+  // Nothing to follow: clamped to the new duration.
+  CHECK(near(after.remapEdited(CompiledTimeline(), 7.0), 3.0));
+  CHECK(near(CompiledTimeline().remapEdited(before, 7.0), 0.0));
+}
+
+// A region looped in the EDL: the same original seconds play at several
+// edited times, and the use nearest the old edited time wins.
+void loopedMaterial() {
+  CompiledTimeline before;
+  before.add(2.0, 0.0, 2.0, 0, 0); // A, edited [0, 2)
+  before.add(0.5, 2.0, 2.5, 1, 0); // B, edited [2, 2.5)
+  before.add(2.0, 0.0, 2.0, 2, 0); // A again, edited [2.5, 4.5)
+  before.add(2.0, 0.0, 2.0, 3, 0); // and again, edited [4.5, 6.5)
+  before.finish();
+
+  CompiledTimeline after; // B cut: A three times, edited [0, 6)
+  for (int i = 0; i < 3; ++i) after.add(2.0, 0.0, 2.0, i, 0);
+  after.finish();
+
+  CHECK(near(after.remapEdited(before, 1.0), 1.0));
+  CHECK(near(after.remapEdited(before, 3.5), 3.0));
+  CHECK(near(after.remapEdited(before, 6.0), 5.5));
+  // From the cut region into the next loop pass, not back to the first.
+  CHECK(near(after.remapEdited(before, 2.25), 2.0));
+
+  // Late in a pass stays in that pass, not the next one that starts nearer.
+  CHECK(near(after.remapEdited(after, 1.9), 1.9));
+
+  // Extending the loop keeps a playhead in its pass.
+  CompiledTimeline longer;
+  for (int i = 0; i < 5; ++i) longer.add(2.0, 0.0, 2.0, i, 0);
+  longer.finish();
+  CHECK(near(longer.remapEdited(after, 4.5), 4.5));
+  CHECK(near(after.remapEdited(longer, 9.5), 5.5));
+}
+
+} // namespace
+
+int main() {
+  sameTimelineKeepsPosition();
+  cutsShiftThePlayhead();
+  lookaheadIsBounded();
+  pastTheLastSpan();
+  loopedMaterial();
+  return check::finish("timeline");
+}
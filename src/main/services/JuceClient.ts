@@ -1,5 +1,5 @@
 import { spawn, ChildProcessWithoutNullStreams } from 'child_process';
-import { promises as fsPromises } from 'fs';
+import { existsSync, promises as fsPromises } from 'fs';
 import * as path from 'path';
 import { EventEmitter } from 'events';
 import {
@@ -780,7 +780,11 @@ export class JuceClient implements Transport {
       return this.edlTempDirectory;
     }
 
-    const base = path.join(app.getPath('temp'), 'juce-edl-cache');
+    // On Linux /dev/shm is memory-backed: the backend maps the payload
+    // straight from it and it never reaches the disk.
+    const shm = '/dev/shm';
+    const useShm = process.platform === 'linux' && existsSync(shm);
+    const base = path.join(useShm ? shm : app.getPath('temp'), 'juce-edl-cache');
     try {
       await fsPromises.mkdir(base, { recursive: true });
     } catch (error) {
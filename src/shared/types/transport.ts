@@ -32,15 +32,172 @@ type JuceCommandBase = {
 export type JuceCommand =
   | ({ type: 'load'; path: string } & JuceCommandBase)
   | ({ type: 'updateEdl'; revision?: number; clips: EdlClip[] } & JuceCommandBase)
-  | ({ type: 'updateEdlFromFile'; revision?: number; path: string } & JuceCommandBase)
+  | ({ type: 'updateEdlFromFile'; revision?: number } & ({ path: string } | { fd: number }) & JuceCommandBase) // file, shm or memfd path, or an inherited descriptor (POSIX)
   | ({ type: 'play' } & JuceCommandBase)
   | ({ type: 'pause' } & JuceCommandBase)
   | ({ type: 'stop' } & JuceCommandBase)
   | ({ type: 'seek'; timeSec: number } & JuceCommandBase) // edited timeline time
+  | ({ type: 'playRange'; startSec: number; endSec: number; loop?: boolean; crossfadeMs?: number } & JuceCommandBase) // edited seconds
+  | ({ type: 'setLoop'; enabled: boolean; startSec?: number; endSec?: number; crossfadeMs?: number } & JuceCommandBase)
+  | ({ type: 'scrubStart'; velocity?: boolean } & JuceCommandBase) // velocity: grains follow pointer speed/direction
+  | ({ type: 'scrub'; timeSec: number } & JuceCommandBase) // edited time; only the newest target is played
+  | ({ type: 'scrubEnd'; timeSec?: number } & JuceCommandBase)
   | ({ type: 'setRate'; rate: number } & JuceCommandBase) // Legacy: changes both speed and pitch
   | ({ type: 'setTimeStretch'; ratio: number } & JuceCommandBase) // New: changes speed while preserving pitch
   | ({ type: 'setVolume'; value: number } & JuceCommandBase)
-  | ({ type: 'queryState' } & JuceCommandBase);
+  | ({ type: 'queryState' } & JuceCommandBase)
+  | ({ type: 'getOutputStats' } & JuceCommandBase)
+  | ({ type: 'getPrerollStats' } & JuceCommandBase)
+  | ({ type: 'setMeterRate'; hz: number } & JuceCommandBase) // 0 disables metering
+  | ({
+        type: 'analyzeSilence';
+        thresholdDb?: number;    // default -45 dBFS
+        minDurationSec?: number; // default 0.3
+        hangoverSec?: number;    // default 0.05
+        frameSec?: number;       // default 0.01
+        threads?: number;        // default: hardware concurrency
+        refineSpacers?: boolean; // also match spacer segments of the current EDL
+        maxShiftSec?: number;    // how far a refined spacer bound may move (default 0.2)
+      } & JuceCommandBase)
+  | ({
+        type: 'analyzeLoudness';
+        targetLufs?: number;   // used for the reported gainDb (default -16)
+        ceilingDbtp?: number;  // true-peak ceiling for gainDb (default -1)
+        curves?: boolean;      // include momentary / short-term curves
+        curveHopSec?: number;  // curve resolution (default 0.1)
+        threads?: number;
+      } & JuceCommandBase)
+  | ({ type: 'setLoudnessNormalization'; enabled: boolean; targetLufs?: number; ceilingDbtp?: number } & JuceCommandBase)
+  | ({
+        type: 'setStrip';
+        scope: 'speaker' | 'clip';
+        target: string;          // speaker name or clip id
+        gainDb?: number;         // speaker and clip gains add
+        highPassHz?: number;     // 0 = off
+        compressor?: boolean;
+        compThresholdDb?: number; // default -18
+        compRatio?: number;       // default 3
+        compAttackMs?: number;    // default 10
+        compReleaseMs?: number;   // default 120
+        compMakeupDb?: number;
+        mute?: boolean;
+        solo?: boolean;
+      } & JuceCommandBase) // omitted fields keep their previous value
+  | ({ type: 'clearStrips' } & JuceCommandBase)
+  | ({
+        type: 'denoise';
+        reductionDb?: number;  // attenuation of gated bins (default 18)
+        thresholdDb?: number;  // margin above the noise profile that opens a bin (default 6)
+        releaseMs?: number;    // default 80
+        fftSize?: number;      // power of two, 256-8192 (default 2048)
+        threads?: number;
+      } & JuceCommandBase)
+  | ({ type: 'cancelDenoise' } & JuceCommandBase)
+  | ({ type: 'cancel'; jobId: number } & JuceCommandBase) // any running job, by the id from jobStarted
+  | ({ type: 'getJobs' } & JuceCommandBase)
+  | ({ type: 'setDenoise'; enabled: boolean } & JuceCommandBase) // switch between original and processed audio
+  | ({
+        type: 'getSpectrogramTiles';
+        startSec: number;     // edited timeline
+        endSec: number;
+        level?: number;       // 0-3; default: finest that fits maxColumns
+        maxColumns?: number;  // default 2048
+      } & JuceCommandBase)
+  | ({ type: 'computeSpectrogram'; minLevel?: number } & JuceCommandBase) // background fill, coarsest level first (default minLevel 1)
+  | ({
+        type: 'findText';
+        text: string;         // word or phrase, matched case-insensitively on whole words
+        prefix?: boolean;     // the last word may be a prefix
+        fromSec?: number;     // edited-time window for the first word
+        toSec?: number;
+        maxResults?: number;  // default 100
+      } & JuceCommandBase)
+  | ({ type: 'getWordsInRange'; startSec: number; endSec: number; maxResults?: number } & JuceCommandBase)
+  | ({ type: 'activateRevision'; revision: number } & JuceCommandBase) // re-apply a cached compile without resending the EDL
+  | ({ type: 'getRevisionCacheStats' } & JuceCommandBase)
+  | ({ type: 'setRevisionCache'; maxBytes: number } & JuceCommandBase)
+  | ({ type: 'getArtifactCacheStats' } & JuceCommandBase)
+  | ({ type: 'setArtifactCache'; maxBytes: number } & JuceCommandBase) // evicts down to the new limit; 0 empties it
+  | ({ type: 'getMetrics'; reset?: boolean } & JuceCommandBase) // reset clears histograms after reporting
+  | ({ type: 'setMetricsInterval'; intervalMs: number } & JuceCommandBase) // periodic metrics events; 0 = off
+  | ({ type: 'getRtSafety'; reset?: boolean } & JuceCommandBase) // reset clears counts and sites after reporting
+  | ({ type: 'startCapture'; path: string } & JuceCommandBase) // record incoming commands for --replay
+  | ({ type: 'stopCapture' } & JuceCommandBase)
+  | ({ type: 'setClock'; rate?: number; manual?: boolean } & JuceCommandBase) // mock engine only
+  | ({ type: 'advanceClock'; seconds: number } & JuceCommandBase) // mock engine only; steps a manual clock
+  | ({
+        type: 'seekToWord';
+        segmentIndex?: number; // flattened word segment index
+        text?: string;         // or: the occurrence-th match of text at or after fromSec
+        occurrence?: number;
+        fromSec?: number;
+      } & JuceCommandBase)
+  | ({
+        type: 'renderEdited';
+        path: string;           // output WAV
+        normalize?: boolean;    // apply per-clip loudness gain
+        targetLufs?: number;
+        ceilingDbtp?: number;
+        bitsPerSample?: 16 | 24 | 32; // 32 = float (default)
+      } & JuceCommandBase)
+  | ({
+        type: 'exportStems' | 'exportClips'; // one WAV per speaker (edited timeline) or per EDL clip
+        directory: string;      // must exist
+        normalize?: boolean;
+        targetLufs?: number;
+        ceilingDbtp?: number;
+        bitsPerSample?: 16 | 24 | 32;
+        threads?: number;       // 0 = one per core
+      } & JuceCommandBase)
+  | ({
+        type: 'saveSidecar'; // loudness, silence map, peaks and timeline of the loaded file
+        path: string;        // the project's sidecar; created or appended to
+        thresholdDb?: number; // silence map parameters, as for analyzeSilence
+        minDurationSec?: number;
+        hangoverSec?: number;
+        frameSec?: number;
+      } & JuceCommandBase)
+  | ({ type: 'openSidecar'; path: string } & JuceCommandBase) // analyses of matching audio read from it
+  | ({
+        type: 'refineCuts'; // snap the EDL's segment boundaries in the original audio
+        mode?: 'auto' | 'zeroCrossing' | 'energy'; // auto: quietest point, then the nearest zero crossing
+        windowMs?: number;  // searched each side of a boundary (default 10, max 50)
+        frameMs?: number;   // energy frame (default 2.5)
+        apply?: boolean;    // make the result the EDL, as revision
+        revision?: number;  // required with apply
+        threads?: number;
+      } & JuceCommandBase);
+
+export type LoudnessFigures = {
+  integratedLufs: number;
+  momentaryMaxLufs: number;
+  shortTermMaxLufs: number;
+  truePeakDbtp: number;
+  gainDb: number; // normalisation gain towards targetLufs, limited by the ceiling
+};
+
+// Durations in microseconds; percentiles are accurate to about 9%.
+export type LatencyHistogram = {
+  count: number;
+  meanUs: number;
+  p50Us: number;
+  p90Us: number;
+  p99Us: number;
+  p999Us: number;
+  maxUs: number;
+};
+
+// One transcript hit; a phrase spans from its first word to its last.
+export type TextMatch = {
+  segmentIndex: number; // flattened word segment of the first word
+  clipId: string;
+  indexInClip: number;
+  text: string;
+  editedStart: number;
+  editedEnd: number;
+  originalStart: number;
+  originalEnd: number;
+};
 
 // Events emitted by the JUCE backend
 type JuceEventBase = {
@@ -73,6 +230,323 @@ export type JuceEvent =
         message?: string;
       } & JuceEventBase)
   | ({ type: 'ended' } & JuceEventBase)
+  | ({ type: 'rangeEnded'; startSec: number; endSec: number } & JuceEventBase)
+  | ({
+        type: 'meter';
+        channels: number;
+        peakDb: number[];
+        rmsDb: number[];
+        truePeakDb: number[];
+        clipped: number[];  // samples at full scale since the previous meter event
+        costPct: number;    // metering cost as % of the audio block budget
+        costMaxPct: number;
+      } & JuceEventBase)
+  | ({
+        type: 'silenceAnalysis';
+        status: 'ok' | 'error' | string;
+        message?: string;
+        cached?: boolean; // served from the artifact cache
+        thresholdDb?: number;
+        minDurationSec?: number;
+        hangoverSec?: number;
+        durationSec?: number;
+        elapsedMs?: number;
+        threads?: number;
+        intervals?: Array<{ startSec: number; endSec: number }>; // original file seconds
+        spacers?: Array<{
+          index: number; // flattened segment index in the current EDL
+          startSec: number;
+          endSec: number;
+          originalStartSec: number;
+          originalEndSec: number;
+          refinedStartSec: number;
+          refinedEndSec: number;
+        }>;
+      } & JuceEventBase)
+  | ({
+        type: 'loudnessAnalysis';
+        status: 'ok' | 'error' | string;
+        message?: string;
+        cached?: boolean;
+        elapsedMs?: number;
+        threads?: number;
+        durationSec?: number;
+        targetLufs?: number;
+        curveHopSec?: number;
+        momentaryLufs?: number[];
+        shortTermLufs?: number[];
+        clips?: Array<{ id: string; speaker: string } & LoudnessFigures>;
+        speakers?: Array<{ speaker: string } & LoudnessFigures>;
+      } & Partial<LoudnessFigures> & JuceEventBase)
+  | ({
+        type: 'renderComplete';
+        status: 'ok' | 'error' | string;
+        path: string;
+        message?: string;
+        normalized?: boolean;
+        durationSec?: number;
+        elapsedMs?: number;
+      } & JuceEventBase)
+  | ({ type: 'denoiseProgress'; fraction: number } & JuceEventBase)
+  | ({
+        type: 'denoiseComplete';
+        status: 'ok' | 'error' | 'cancelled' | string;
+        path?: string;            // processed copy, reused while the source and parameters are unchanged
+        cached?: boolean;
+        profileSource?: 'spacers' | 'quietest';
+        noiseSec?: number;        // audio the noise profile was learnt from
+        threads?: number;
+        durationSec?: number;
+        elapsedMs?: number;
+        realtimeFactor?: number;
+        message?: string;
+      } & JuceEventBase)
+  | ({ type: 'denoiseState'; enabled: boolean; active: boolean } & JuceEventBase) // active: playback uses the processed copy
+  | ({
+        type: 'spectrogramTiles';
+        startSec: number;
+        endSec: number;
+        level: number;
+        columnSec: number;    // width of one column
+        columns: number;      // per tile
+        rows: number;         // frequency rows, lowest first, up to Nyquist
+        fftSize: number;
+        sampleRate: number;
+        minDb: number;        // byte 0
+        maxDb: number;        // byte 255
+        spans: Array<{ editedStart: number; editedEnd: number; originalStart: number; originalEnd: number }>;
+        tiles: Array<{ index: number; originalStart: number; originalEnd: number; path: string }>; // layout in Spectrogram.h
+        computed: number;
+        cached: number;
+        elapsedMs: number;
+      } & JuceEventBase)
+  | ({
+        type: 'exportProgress';
+        kind: 'stems' | 'clips';
+        fraction: number;
+        filesDone: number;
+        files: number;
+      } & JuceEventBase)
+  | ({ type: 'exportFileComplete'; kind: 'stems' | 'clips'; name: string; path: string; durationSec: number } & JuceEventBase)
+  | ({
+        type: 'exportComplete';
+        kind: 'stems' | 'clips';
+        status: 'ok' | 'error' | string;
+        message?: string;
+        files?: number;
+        normalized?: boolean;
+        durationSec?: number;
+        threads?: number;
+        elapsedMs?: number;
+      } & JuceEventBase)
+  | ({ type: 'spectrogramProgress'; fraction: number } & JuceEventBase)
+  | ({
+        type: 'spectrogramComplete';
+        status: 'ok' | 'error' | 'cancelled' | string;
+        minLevel: number;
+        computed: number;
+        cached: number;
+        elapsedMs: number;
+      } & JuceEventBase)
+  | ({
+        type: 'findTextResult';
+        query: string;
+        total: number;         // all matches, even past maxResults
+        matches: TextMatch[];
+        elapsedUs: number;
+      } & JuceEventBase)
+  | ({ type: 'wordsInRange'; startSec: number; endSec: number; total: number; words: TextMatch[] } & JuceEventBase)
+  | ({
+        type: 'metrics';
+        uptimeSec: number;
+        audio: LatencyHistogram & {
+          budgetUs: number;     // duration of one block at the device rate
+          loadP99: number;      // p99 callback time / budget
+          overBudget: number;   // callbacks slower than their block
+          gaps: number;         // callbacks that started more than two blocks late
+          deviceXruns: number;  // -1 when the device does not report them
+        };
+        timer: LatencyHistogram;
+        commands: Record<string, LatencyHistogram>; // by command type
+        lanes: {
+          control: LatencyHistogram; // read to start, transport and queries
+          work: LatencyHistogram & { depth: number; highWater: number }; // EDL, analysis, render
+        };
+        edl: { parse: LatencyHistogram; compile: LatencyHistogram; payloadBytes: number; segments: number };
+        output: { depth: number; highWater: number; capacity: number; dropped: number; lost: number; coalesced: number };
+        memory: {
+          residentBytes: number;
+          prerollBytes: number;
+          edlBytes: number;
+          revisionCacheBytes: number;
+          eventQueueBytes: number;
+        };
+      } & JuceEventBase)
+  | ({ type: 'captureState'; active: boolean; path: string; bytes: number } & JuceEventBase)
+  | ({ type: 'clockState'; rate: number; manual: boolean; clockSec: number } & JuceEventBase) // mock engine only
+  | ({
+        type: 'replayComplete'; // last event of a --replay run
+        capture: string;
+        mode: 'paced' | 'fast';
+        commands: number;
+        capturedSec: number;
+        wallMs: number;
+        audioSamples: number;  // rendered headless, all channels
+        audioHash: string;     // bit-exact hash of the rendered audio
+        eventsHash: string;    // hash of the event counts by type
+        events: Record<string, number>;
+        mediaMismatches: number;
+        expected?: { audioHash: string; eventsHash: string }; // with --expect
+        audioMatch?: boolean;
+        eventsMatch?: boolean;
+        match: boolean;
+      } & JuceEventBase)
+  | ({
+        type: 'rtSafety';
+        enabled: boolean; // false unless built with RT_SAFETY_CHECKS
+        trap: boolean;    // RT_SAFETY_TRAP set: the first violation aborts
+        counts: { allocation: number; deallocation: number; lock: number; syscall: number };
+        droppedSites: number;
+        sites: { kind: 'allocation' | 'deallocation' | 'lock' | 'syscall'; what: string; count: number; stack: string[] }[];
+      } & JuceEventBase)
+  | ({
+        type: 'sidecarSaved';
+        status: 'ok' | 'error' | string;
+        path: string;
+        message?: string;
+        fingerprint?: string;
+        generation?: number;    // saves since the file was created
+        bytes?: number;
+        appendedBytes?: number;
+        compacted?: boolean;    // rewritten without dead chunks
+        chunks?: Array<{ tag: string; name: string; bytes: number; written: boolean }>;
+        elapsedMs?: number;
+      } & JuceEventBase)
+  | ({
+        type: 'sidecarOpened';
+        status: 'ok' | 'error' | string;
+        path: string;
+        message?: string;
+        version?: number;
+        generation?: number;
+        fingerprint?: string;
+        matches?: boolean;       // written for the audio loaded now
+        damagedTrailers?: number; // an interrupted save was skipped
+        chunks?: Array<{ tag: string; name: string; bytes: number }>;
+      } & JuceEventBase)
+  | ({
+        type: 'cutsRefined';
+        status: 'ok' | 'error';
+        message?: string;    // with status 'error', e.g. the EDL changed while refining, so nothing was applied
+        mode?: 'auto' | 'zeroCrossing' | 'energy';
+        windowMs?: number;
+        boundaries?: number; // distinct boundary times searched
+        moved?: number;
+        meanShiftMs?: number; // over the boundaries that moved
+        maxShiftMs?: number;
+        applied?: boolean;
+        revision?: number;    // when applied; edlApplied follows as usual
+        threads?: number;
+        elapsedMs?: number;
+        segments?: Array<{ clipId: string; index: number; originalStartSec: number; originalEndSec: number }>; // changed ones; index within the clip
+      } & JuceEventBase)
+  | ({
+        type: 'jobStarted'; // a long-running command was handed to the job scheduler
+        jobId: number;
+        kind: string;       // e.g. 'loudness', 'spectrogramFill', 'exportClips'
+        priority: 'interactive' | 'background';
+      } & JuceEventBase)
+  | ({
+        type: 'jobProgress'; // in steps of 0.05
+        jobId: number;
+        kind: string;
+        fraction: number;
+      } & JuceEventBase)
+  | ({
+        type: 'jobFinished';
+        jobId: number;
+        kind: string;
+        status: 'ok' | 'cancelled' | 'error'; // the job's own events say why it failed
+        elapsedMs: number;
+      } & JuceEventBase)
+  | ({
+        type: 'jobs';
+        workers: number;  // scheduler threads
+        executed: number; // tasks run by them
+        stolen: number;   // of which taken from another worker's deque
+        queued: number;
+        active: Array<{
+          jobId: number;
+          kind: string;
+          priority: 'interactive' | 'background';
+          fraction: number;
+          cancelled: boolean;
+          elapsedMs: number;
+        }>;
+      } & JuceEventBase)
+  | ({
+        type: 'fingerprint'; // after load: content hash of the source
+        hash: string;        // 32 hex digits; the artifact cache key
+        bytes: number;
+        cached: boolean;     // the file was already hashed unchanged
+        elapsedMs: number;
+        threads: number;
+      } & JuceEventBase)
+  | ({
+        type: 'artifactCacheStats';
+        directory: string;
+        files: number;
+        bytes: number;     // on disk
+        maxBytes: number;
+        hits: number;      // artifacts reused
+        misses: number;    // artifacts computed and stored
+        hitRate: number;
+        evictions: number;
+        fingerprints: number; // source hashes held in memory
+      } & JuceEventBase)
+  | ({
+        type: 'revisionCacheStats';
+        entries: number;
+        bytes: number;     // estimated memory held by cached revisions
+        maxBytes: number;
+        hits: number;
+        misses: number;
+        evictions: number;
+      } & JuceEventBase)
+  | ({
+        type: 'prerollStats';
+        revision: number;
+        requested: number; // clip + word starts in the EDL
+        cached: number;    // starts that fit in the memory budget
+        regions: number;   // after merging overlapping starts
+        bytes: number;
+        fillMs: number;
+        hits: number;      // seeks served from memory
+        misses: number;
+        hitRate: number;
+      } & JuceEventBase)
+  | ({
+        type: 'scrubStats';
+        targets: number;
+        consumed: number;
+        dropped: number;         // superseded before the audio thread saw them
+        grains: number;
+        gaps: number;            // grains left silent until the feeder had read their audio
+        latencyAvgMs: number;    // scrub command received -> grain at the device output
+        latencyMaxMs: number;
+        outputLatencyMs: number; // device share of the above
+      } & JuceEventBase)
+  | ({
+        type: 'outputStats';
+        enqueued: number;
+        written: number;
+        dropped: number;    // position/meter events refused because the stdout queue was running hot
+        lost: number;       // other events refused because the queue was full
+        coalesced: number;  // position events superseded before they were written
+        depth: number;
+        highWater: number;
+        capacity: number;
+      } & JuceEventBase)
   | { type: 'error'; id?: TransportId; code?: string | number; message: string; generationId?: number }
   | BackendStatusEvent;
 
@@ -140,6 +614,70 @@ export function isJuceEvent(obj: any): obj is JuceEvent {
       );
     case 'ended':
       return typeof obj.id === 'string';
+    case 'rangeEnded':
+      return typeof obj.id === 'string' && typeof obj.startSec === 'number' && typeof obj.endSec === 'number';
+    case 'meter':
+      return typeof obj.id === 'string' && Array.isArray(obj.peakDb) && Array.isArray(obj.rmsDb);
+    case 'silenceAnalysis':
+    case 'loudnessAnalysis':
+      return typeof obj.id === 'string' && typeof obj.status === 'string';
+    case 'prerollStats':
+      return typeof obj.id === 'string' && typeof obj.hits === 'number' && typeof obj.bytes === 'number';
+    case 'scrubStats':
+      return typeof obj.id === 'string' && typeof obj.targets === 'number';
+    case 'renderComplete':
+      return typeof obj.id === 'string' && typeof obj.status === 'string' && typeof obj.path === 'string';
+    case 'denoiseProgress':
+      return typeof obj.id === 'string' && typeof obj.fraction === 'number';
+    case 'denoiseComplete':
+      return typeof obj.id === 'string' && typeof obj.status === 'string';
+    case 'denoiseState':
+      return typeof obj.id === 'string' && typeof obj.enabled === 'boolean' && typeof obj.active === 'boolean';
+    case 'exportProgress':
+      return typeof obj.id === 'string' && typeof obj.kind === 'string' && typeof obj.fraction === 'number';
+    case 'exportFileComplete':
+      return typeof obj.id === 'string' && typeof obj.kind === 'string' && typeof obj.path === 'string';
+    case 'exportComplete':
+      return typeof obj.id === 'string' && typeof obj.kind === 'string' && typeof obj.status === 'string';
+    case 'spectrogramTiles':
+      return typeof obj.id === 'string' && typeof obj.level === 'number' && Array.isArray(obj.spans) && Array.isArray(obj.tiles);
+    case 'spectrogramProgress':
+      return typeof obj.id === 'string' && typeof obj.fraction === 'number';
+    case 'spectrogramComplete':
+      return typeof obj.id === 'string' && typeof obj.status === 'string';
+    case 'findTextResult':
+      return typeof obj.id === 'string' && typeof obj.total === 'number' && Array.isArray(obj.matches);
+    case 'wordsInRange':
+      return typeof obj.id === 'string' && typeof obj.total === 'number' && Array.isArray(obj.words);
+    case 'metrics':
+      return typeof obj.id === 'string' && typeof obj.uptimeSec === 'number' && typeof obj.audio === 'object';
+    case 'captureState':
+      return typeof obj.id === 'string' && typeof obj.active === 'boolean' && typeof obj.path === 'string';
+    case 'replayComplete':
+      return typeof obj.id === 'string' && typeof obj.audioHash === 'string' && typeof obj.match === 'boolean';
+    case 'clockState':
+      return typeof obj.id === 'string' && typeof obj.rate === 'number' && typeof obj.manual === 'boolean';
+    case 'rtSafety':
+      return typeof obj.id === 'string' && typeof obj.enabled === 'boolean' && Array.isArray(obj.sites);
+    case 'revisionCacheStats':
+    case 'artifactCacheStats':
+      return typeof obj.id === 'string' && typeof obj.hits === 'number' && typeof obj.misses === 'number';
+    case 'sidecarSaved':
+    case 'sidecarOpened':
+      return typeof obj.id === 'string' && typeof obj.status === 'string' && typeof obj.path === 'string';
+    case 'fingerprint':
+      return typeof obj.id === 'string' && typeof obj.hash === 'string' && typeof obj.bytes === 'number';
+    case 'cutsRefined':
+      return typeof obj.id === 'string' && typeof obj.status === 'string';
+    case 'jobStarted':
+    case 'jobFinished':
+      return typeof obj.id === 'string' && typeof obj.jobId === 'number' && typeof obj.kind === 'string';
+    case 'jobProgress':
+      return typeof obj.id === 'string' && typeof obj.jobId === 'number' && typeof obj.fraction === 'number';
+    case 'jobs':
+      return typeof obj.id === 'string' && typeof obj.workers === 'number' && Array.isArray(obj.active);
+    case 'outputStats':
+      return typeof obj.id === 'string' && typeof obj.dropped === 'number' && typeof obj.coalesced === 'number';
     case 'error':
       return typeof obj.message === 'string';
     case 'backendStatus':
@@ -163,20 +701,91 @@ export function isJuceCommand(obj: any): obj is JuceCommand {
         )
       );
     case 'updateEdlFromFile':
-      return typeof obj.id === 'string' && typeof obj.path === 'string';
+      return typeof obj.id === 'string' && (typeof obj.path === 'string' || typeof obj.fd === 'number');
     case 'play':
     case 'pause':
     case 'stop':
     case 'queryState':
+    case 'getOutputStats':
+    case 'getPrerollStats':
       return typeof obj.id === 'string';
     case 'seek':
+    case 'scrub':
       return typeof obj.id === 'string' && typeof obj.timeSec === 'number';
+    case 'playRange':
+      return typeof obj.id === 'string' && typeof obj.startSec === 'number' && typeof obj.endSec === 'number';
+    case 'setLoop':
+      return typeof obj.id === 'string' && typeof obj.enabled === 'boolean';
+    case 'scrubStart':
+    case 'scrubEnd':
+      return typeof obj.id === 'string';
     case 'setRate':
       return typeof obj.id === 'string' && typeof obj.rate === 'number';
     case 'setTimeStretch':
       return typeof obj.id === 'string' && typeof obj.ratio === 'number';
     case 'setVolume':
       return typeof obj.id === 'string' && typeof obj.value === 'number';
+    case 'setMeterRate':
+      return typeof obj.id === 'string' && typeof obj.hz === 'number';
+    case 'analyzeSilence':
+    case 'analyzeLoudness':
+      return typeof obj.id === 'string';
+    case 'setLoudnessNormalization':
+      return typeof obj.id === 'string' && typeof obj.enabled === 'boolean';
+    case 'renderEdited':
+      return typeof obj.id === 'string' && typeof obj.path === 'string';
+    case 'exportStems':
+    case 'exportClips':
+      return typeof obj.id === 'string' && typeof obj.directory === 'string';
+    case 'saveSidecar':
+    case 'openSidecar':
+      return typeof obj.id === 'string' && typeof obj.path === 'string';
+    case 'setStrip':
+      return (
+        typeof obj.id === 'string' &&
+        (obj.scope === 'speaker' || obj.scope === 'clip') &&
+        typeof obj.target === 'string'
+      );
+    case 'clearStrips':
+    case 'denoise':
+    case 'cancelDenoise':
+    case 'getJobs':
+      return typeof obj.id === 'string';
+    case 'refineCuts':
+      return typeof obj.id === 'string' && (obj.apply !== true || typeof obj.revision === 'number');
+    case 'cancel':
+      return typeof obj.id === 'string' && typeof obj.jobId === 'number';
+    case 'setDenoise':
+      return typeof obj.id === 'string' && typeof obj.enabled === 'boolean';
+    case 'findText':
+      return typeof obj.id === 'string' && typeof obj.text === 'string';
+    case 'getWordsInRange':
+      return typeof obj.id === 'string' && typeof obj.startSec === 'number' && typeof obj.endSec === 'number';
+    case 'seekToWord':
+      return typeof obj.id === 'string' && (typeof obj.segmentIndex === 'number' || typeof obj.text === 'string');
+    case 'activateRevision':
+      return typeof obj.id === 'string' && typeof obj.revision === 'number';
+    case 'getRevisionCacheStats':
+    case 'getArtifactCacheStats':
+    case 'getMetrics':
+    case 'getRtSafety':
+    case 'stopCapture':
+      return typeof obj.id === 'string';
+    case 'setMetricsInterval':
+      return typeof obj.id === 'string' && typeof obj.intervalMs === 'number';
+    case 'startCapture':
+      return typeof obj.id === 'string' && typeof obj.path === 'string';
+    case 'getSpectrogramTiles':
+      return typeof obj.id === 'string' && typeof obj.startSec === 'number' && typeof obj.endSec === 'number';
+    case 'computeSpectrogram':
+      return typeof obj.id === 'string';
+    case 'setClock':
+      return typeof obj.id === 'string';
+    case 'advanceClock':
+      return typeof obj.id === 'string' && typeof obj.seconds === 'number';
+    case 'setRevisionCache':
+    case 'setArtifactCache':
+      return typeof obj.id === 'string' && typeof obj.maxBytes === 'number';
     default:
       return false;
   }